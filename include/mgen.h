@@ -9,6 +9,11 @@
 #include "mgenMsg.h"
 #include "mgenPayload.h"
 #include "mgenAnalytic.h"
+#include "mgenLogPipe.h"
+#include "mgenLogStream.h"
+#include "mgenLogSampler.h"
+#include "mgenLogFormat.h"
+#include "mgenFlightRecorder.h"
 
 class MgenController
 {
@@ -170,7 +175,25 @@ class Mgen
       PAUSE,     // Pauses flow while tcp attempts to reconnect
       RECONNECT, // Enables TCP reconnect
       EPOCH_TIMESTAMP, // Log timetamp as epoch time in sec.usec format
-      RESET
+      RESET,
+      RXBATCH,   // max datagrams per batched UDP receive call
+      RXTIMESTAMP,// Use kernel (SO_TIMESTAMPNS) UDP receive timestamps
+      TXTIMESTAMP,// Log UDP SEND events with kernel (SO_TIMESTAMPING) tx time
+      RXSHARDS,  // SO_REUSEPORT UDP receive sockets (and threads) per LISTEN port
+      COUNTERS,  // Keep per-flow receive counters (optional periodic dump)
+      DUMPCOUNTERS,// Log current per-flow receive counters
+      RXGRO,     // Use kernel UDP_GRO receive coalescing
+      LOGPIPE,   // Format and write the text log from a separate thread
+      TCPRXRING, // Size of the TCP receive ring buffer (0 = per-message reads)
+      REORDER,   // Analytic reorder tracking window depth and REORDER logging
+      BINARY3,   // binary logs use the fixed-width, indexed v3 format
+      COMPRESS,  // gzip compress log files as they are written
+      ROTATE,    // roll log files over by size and/or time
+      LOGSAMPLE, // log 1 in N (or 1 per interval) SEND/RECV events of flows
+      LOGFILTER, // log SEND/RECV events of the given flows/addresses only
+      LOGFORMAT, // text log encoding: "text", "json" (JSON Lines) or "csv"
+      RECORDER,  // record recent SEND/RECV events into an mmap() ring file
+      SNAPSHOT   // write the RECORDER ring out as a log file
     };
 
     static Command GetCommandFromString(const char* string);
@@ -187,6 +210,10 @@ class Mgen
         {return  transport_list;} // for ns2
 
     void ProcessFlowCommand(MgenFlowCommand::Status status, UINT32 flowId);
+    void ProcessRecvReport(const ProtoTime&             theTime,
+                           const MgenAnalytic::Report&  report,
+                           const ProtoAddress&          senderAddr,
+                           const ProtoTime&             sentTime);
     bool OnCommand(Mgen::Command cmd, const char* arg, bool override = false);
     bool GetChecksumEnable() {return checksum_enable;}
     bool GetChecksumForce() {return checksum_force;}
@@ -197,6 +224,13 @@ class Mgen
     void SetLogFile(FILE* filePtr);
     FILE* GetLogFile() {return log_file;}
     bool GetLogBinary() {return log_binary;}
+    bool GetLogBinaryV3() const {return log_binary_v3;}
+    int GetLogCompress() const {return log_compress;}  // level, 0 if off
+    MgenLogSampler& GetLogSampler() {return log_sampler;}
+    MgenLogEncoder::Encoding GetLogEncoding() const {return log_encoding;}
+    MgenFlightRecorder& GetFlightRecorder() {return flight_recorder;}
+    // "true" if received messages need to be unpacked for the log or RECORDER ring
+    bool GetLogging() const {return ((NULL != log_file) || flight_recorder.IsOpen());}
     bool GetLocalTime() {return local_time;}
     bool GetLogFlush() {return log_flush;}
     bool GetLogTx() {return log_tx;}
@@ -214,6 +248,10 @@ class Mgen
     static void SetEpochTimestamp(bool enable);
     static void LogEpochTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime);
     static void LogLegacyTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime);
+    // Writes preformatted text (via "Log" unless it's fprintf())
+    static void LogText(FILE* filePtr, const char* text, unsigned int len);
+    // Writes the encoder's current event line
+    static void LogEncoded(FILE* filePtr, MgenLogEncoder& encoder);
     bool ParseScript(const char* path);
 #if OPNET  // JPH 11/16/2005
     bool ParseScript(List*);
@@ -239,6 +277,32 @@ class Mgen
     ProtoAddress::Type GetDefaultSocketType() {return addr_type;}
     
     void SetDefaultReuse(bool reuseTemp) { reuse = reuseTemp;}
+    
+    void SetRxBatch(unsigned int count) {rx_batch = count;}
+    unsigned int GetRxBatch() const {return rx_batch;}
+    void SetRxTimestamp(bool state) {rx_timestamp = state;}
+    bool GetRxTimestamp() const {return rx_timestamp;}
+    void SetTxTimestamp(bool state) {tx_timestamp = state;}
+    bool GetTxTimestamp() const {return tx_timestamp;}
+    void SetRxGro(bool state) {rx_gro = state;}
+    bool GetRxGro() const {return rx_gro;}
+    void SetTcpRxRing(unsigned int bytes) {tcp_rx_ring = bytes;}
+    unsigned int GetTcpRxRing() const {return tcp_rx_ring;}
+    void SetLogPipe(unsigned int ringSize, unsigned int latency);  // latency in msec
+#ifdef HAVE_PTHREAD
+    // Returns NULL unless the log pipe writer thread is running
+    MgenLogPipe* GetLogPipe() 
+        {return log_pipe.IsRunning() ? &log_pipe : NULL;}
+#endif // HAVE_PTHREAD
+    void SetRxShards(unsigned int count, int firstCpu) 
+        {rx_shards = count; rx_shard_cpu = firstCpu;}
+    unsigned int GetRxShards() const {return rx_shards;}
+    int GetRxShardCpu() const {return rx_shard_cpu;}  // -1 if not pinned
+    ProtoTimerMgr& GetTimerMgr() {return timer_mgr;}
+    void SetCounters(double interval);
+    bool GetCounters() const {return counters_enable;}
+    MgenFlowCounters& GetFlowCounters() {return flow_counters;}
+    void DumpCounters();
 
     void SetDefaultRetryCount(int retryCountValue, bool override)
     {
@@ -311,6 +375,11 @@ class Mgen
     bool IsStarted () {return started;};
     
     void UpdateRecvAnalytics(const ProtoTime& currentTime, MgenMsg* theMsg = NULL, Protocol theProtocol = UDP);
+    // Header-only variant for receivers that skip MgenMsg::Unpack()
+    void UpdateRecvAnalytics(const ProtoTime&    currentTime, 
+                             const MgenMsgView&  msgView, 
+                             const ProtoAddress& srcAddr, 
+                             Protocol            theProtocol);
     
     MgenTransport* GetMgenTransport(Protocol theProtocol,
                                     UINT16 srcPort,
@@ -386,6 +455,12 @@ class Mgen
     void SetAnalyticWindow(double windowSize);
     double GetAnalyticWindow() const
         {return analytic_window;}
+    void SetReorderWindow(unsigned int depth)
+        {reorder_window = depth;}
+    unsigned int GetReorderWindow() const  // 0 if REORDER not given
+        {return reorder_window;}
+    UINT32 GetAnalyticHistory() const
+        {return (0 != reorder_window) ? reorder_window : MgenAnalytic::DEFAULT_HISTORY;}
     bool GetDefaultBroadcast() {return default_broadcast;}
     unsigned int GetDefaultMulticastTtl() {return default_multicast_ttl;}
     unsigned int GetDefaultUnicastTtl() {return default_unicast_ttl;}
@@ -399,6 +474,14 @@ class Mgen
     {return (('\0' != default_interface[0]) ? default_interface : NULL);}
     int GetDefaultQueuLimit() {return default_queue_limit;}
   private:
+    void UpdateFlowAnalytic(const ProtoTime&    theTime, 
+                            const ProtoAddress& srcAddr, 
+                            const ProtoAddress& dstAddr, 
+                            UINT32              flowId,
+                            UINT16              msgLen, 
+                            const ProtoTime&    txTime, 
+                            UINT32              seqNum,
+                            Protocol            theProtocol);
     // MGEN script command types ("global" commands)
     void SetDefaultBroadcast(bool broadcastValue, bool override)
     {
@@ -474,6 +557,9 @@ class Mgen
     
     bool OnStartTimeout(ProtoTimer& theTimer);
     bool OnDrecEventTimeout(ProtoTimer& theTimer);
+    bool OnCountersTimeout(ProtoTimer& theTimer);
+    void StartLogPipe();
+    void StopLogPipe();
 
     // Common state
 	MgenController*    controller; // optional mgen controller
@@ -530,6 +616,22 @@ class Mgen
     bool               log_gps_data;
     ProtoAddress       host_addr;
     bool               checksum_enable;       
+    unsigned int       rx_batch;              // max datagrams per UDP receive call
+    bool               rx_timestamp;          // use kernel receive timestamps
+    bool               tx_timestamp;          // use kernel transmit timestamps
+    bool               rx_gro;                // use kernel UDP_GRO coalescing
+    unsigned int       tcp_rx_ring;           // TCP receive ring bytes (0 = none)
+    unsigned int       rx_shards;             // UDP receive sockets per port
+    int                rx_shard_cpu;          // first cpu for shard threads
+    bool               counters_enable;       // keep per-flow receive counters
+    double             counters_interval;     // periodic counters dump (0 = none)
+    ProtoTimer         counters_timer;
+    MgenFlowCounters   flow_counters;
+    unsigned int       log_pipe_size;         // ring records (0 = no log pipe)
+    unsigned int       log_pipe_latency;      // max buffered output delay (msec)
+#ifdef HAVE_PTHREAD
+    MgenLogPipe        log_pipe;
+#endif // HAVE_PTHREAD
     
 	MgenFlowList       flow_list;
     MgenTransportList  transport_list;
@@ -542,6 +644,7 @@ class Mgen
     ProtoAddress::Type addr_type;
     MgenAnalyticTable  analytic_table;
     double             analytic_window;
+    unsigned int       reorder_window;        // analytic seq history (0 = default)
     bool               compute_analytics; // measure and log analytics for recv flows
     bool               report_analytics;  // include analytic reports in message payload for all flows
     MgenEvent::FlowStatus flow_status;    // keeps state for received MgenFlowCommands
@@ -555,6 +658,15 @@ class Mgen
   protected:
     FILE*              log_file;
     bool               log_binary;
+    bool               log_binary_v3;     // binary logs are v3 (see MgenBinaryLog)
+    MgenBinaryLog      binary_log;
+    int                log_compress;      // gzip level (0 = uncompressed logs)
+    uint64_t           log_rotate_bytes;  // log file rollover size (0 = none)
+    unsigned int       log_rotate_interval; // log file rollover period (sec, 0 = none)
+    MgenLogStream*     log_stream;        // for the open log_file, if compressed or rotated
+    MgenLogSampler     log_sampler;       // LOGSAMPLE and LOGFILTER state
+    MgenLogEncoder::Encoding log_encoding; // LOGFORMAT (text logs only)
+    MgenFlightRecorder flight_recorder;   // RECORDER ring, if open
     bool               local_time;
     bool               log_flush;
     bool               log_file_lock;
@@ -10,6 +10,7 @@
 #include "mgenPayload.h"
 
 #include <math.h>  // for fabs()
+#include <string.h>  // for memset()
 
 // MGEN_DATA analytic report format
 // 
@@ -57,6 +58,63 @@
 //  lossFraction - measured message loss rate during measurement window
 
 
+// Duplicate and reordering detection over a sliding window of the 
+// most recent "depth" sequence numbers (a bit per sequence number plus 
+// the arrival index of the first message that passed it, so memory is 
+// bounded and each update is O(1) amortized).  Messages older than the 
+// window are reported as "late" since duplicates can't be told apart.
+// Reordered messages are measured as in RFC 4737: "extent" is how many 
+// arrivals earlier the first higher sequence numbered message arrived 
+// and "distance" is how far the sequence number is behind the highest 
+// received.  Both are kept as log2 histograms (bin i counts 2^i to 2^(i+1)-1).
+class MgenReorderTracker
+{
+    public:
+        MgenReorderTracker();
+        ~MgenReorderTracker();
+        
+        enum Result {SEQ_NEW, SEQ_REORDERED, SEQ_DUPLICATE, SEQ_LATE};
+        enum {HISTOGRAM_BINS = 16};
+        
+        struct Stats
+        {
+            unsigned long   dups;
+            unsigned long   reordered;
+            unsigned long   late;
+            UINT32          extent_max;
+            unsigned long   extent[HISTOGRAM_BINS];
+            unsigned long   distance[HISTOGRAM_BINS];
+        };
+        
+        bool Init(UINT32 depth);  // depth is rounded up to a power of 2
+        void Destroy();
+        
+        bool IsStarted() const
+            {return started;}
+        void Reset()
+            {started = false;}
+        Result Update(UINT32 seqNum);
+        UINT32 GetMaxSeq() const
+            {return max_seq;}
+        
+        const Stats& GetStats() const
+            {return stats;}
+        void ResetStats()
+            {memset(&stats, 0, sizeof(Stats));}
+        static void LogHistogram(FILE* filePtr, const char* name, const unsigned long* bins);
+        
+    private:
+        static unsigned int GetBin(UINT32 value);
+        
+        UINT32*         rx_mask;        // received bit per sequence number
+        UINT32*         first_greater;  // arrival index of first higher seq
+        UINT32          depth;
+        UINT32          max_seq;
+        UINT32          arrival_count;
+        bool            started;
+        Stats           stats;
+};  // end class MgenReorderTracker
+
 // Per-flow statistics tracking for rate, loss, and latency
 // where a flow is identified by src addr/port : dst addr/port 
 // and MGEN flowId
@@ -79,7 +137,8 @@ class MgenAnalytic : public ProtoQueue::Item
                   const ProtoAddress&    dstAddr, 
                   UINT32                 flowId, 
                   double                 windowSize = MgenAnalytic::DEFAULT_WINDOW,
-                  UINT32                 historyDepth = MgenAnalytic::DEFAULT_HISTORY);
+                  UINT32                 historyDepth = MgenAnalytic::DEFAULT_HISTORY,
+                  bool                   logReorder = false);
         
         void SetWindowSize(double windowSize)
         {
@@ -358,9 +417,9 @@ class MgenAnalytic : public ProtoQueue::Item
         ProtoTime           window_end;
         unsigned long       msg_count;
         unsigned long       byte_count;
-        unsigned long       dup_msg_count;
         UINT32              seq_start;
-        ProtoSlidingMask    dup_mask;
+        MgenReorderTracker  seq_tracker;
+        bool                log_reorder;  // log REORDER stats with REPORT
         double              latency_sum;
         double              latency_min;
         double              latency_max;
@@ -375,6 +434,7 @@ class MgenAnalytic : public ProtoQueue::Item
         double              report_latency_ave;
         double              report_latency_min;
         double              report_latency_max;
+        MgenReorderTracker::Stats report_reorder;
         ProtoTime           report_time;
         UINT32              report_buffer[Report::MAX_LENGTH/sizeof(UINT32)];
         Report              report_msg;
@@ -432,4 +492,59 @@ class MgenAnalyticReporter
         
 };  // end class MgenReportQueue()
 
+// Cheap per-flow receive counters (the COUNTERS option) kept in a compact
+// open-addressed (linear probing) hash table keyed by source address/port, 
+// destination port and flow id.  This is intended for heavily loaded
+// receivers where per-message logging or windowed analytics cost too much.
+class MgenFlowCounters
+{
+    public:
+        MgenFlowCounters();
+        ~MgenFlowCounters();
+        
+        bool Update(const ProtoAddress&   srcAddr, 
+                    UINT16                dstPort, 
+                    UINT32                flowId, 
+                    UINT32                seqNum, 
+                    unsigned int          msgSize, 
+                    const struct timeval& rxTime);
+        
+        // One "COUNTERS" line per flow
+        void Log(FILE*                 filePtr, 
+                 const struct timeval& theTime, 
+                 bool                  localTime) const;
+        
+        unsigned int GetFlowCount() const
+            {return flow_count;}
+        void Destroy();
+        
+    private:
+        enum {INIT_SIZE = 64, ADDR_MAX = 16, SEQ_HISTORY = 32};
+        struct Entry
+        {
+            bool            in_use;
+            UINT8           addr_type;   // ProtoAddress::Type
+            UINT8           addr_len;
+            UINT16          src_port;
+            UINT16          dst_port;
+            UINT32          flow_id;
+            char            src_addr[ADDR_MAX];
+            UINT32          max_seq;
+            UINT32          seq_mask;    // bit i set if (max_seq - i) received
+            unsigned long   packets;
+            unsigned long   bytes;
+            unsigned long   gaps;        // messages missing below max_seq
+            unsigned long   dups;
+            struct timeval  last_rx;
+        };
+        
+        static unsigned int Hash(const char* addr, unsigned int addrLen, UINT16 srcPort, 
+                                 UINT16 dstPort, UINT32 flowId);
+        bool Grow();
+        
+        Entry*          table;
+        unsigned int    table_size;  // power of 2
+        unsigned int    flow_count;
+};  // end class MgenFlowCounters
+
 #endif // _MGEN_ANALYTIC
@@ -59,6 +59,7 @@ class MgenApp : public ProtoApp
 #endif // HAVE_GPS
         bool              have_ports;
         bool              convert;
+        bool              convert_summary;
         char              convert_path[PATH_MAX];
         char              ifinfo_name[64];
         UINT32            ifinfo_tx_count;
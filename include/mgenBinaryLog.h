@@ -0,0 +1,235 @@
+#ifndef _MGEN_BINARY_LOG
+#define _MGEN_BINARY_LOG
+
+#include "protokit.h"
+#include "mgenGlobals.h"
+#include <stdio.h>
+#include <stdint.h>  // for uint64_t
+
+/**
+ * @class MgenBinaryLog
+ *
+ * @brief Writes the "v3" binary log format.  Unlike the original binary
+ * log (variable length records carrying a copy of each message), a v3
+ * log is an array of fixed size (RECORD_SIZE) slots in network byte
+ * order, so it can be mmap()ed, split up for parallel processing and
+ * searched by time:
+ *
+ *   slot 0         header line ("mgen version=<v> type=binary_log_v3\n"),
+ *                  NULL padded
+ *   slots 1..N-1   event records and dictionary entries
+ *   trailer        time index table, dictionary table and a footer slot
+ *                  (written when the log is closed)
+ *
+ * Event record fields (byte offset):
+ *    0 eventType (LogEventType)   1 protocol   2 msg flags   3 gpsStatus
+ *    4 eventTime sec/usec        12 txTime sec/usec
+ *   20 flowId   24 seqNum   28 size
+ *   32 srcId    36 dstId    40 hostId (endpoint dictionary ids, 0 = none)
+ *   44 aux (RECV payload id, RERR error code, LISTEN/IGNORE port,
+ *      JOIN/LEAVE interface name id)
+ *   48 ttl   49 info (INFO_TTL, INFO_CLIENT)
+ *   50 sample (SEND/RECV events a sampled line stands for, 0 = not sampled)
+ *   52 latitude   56 longitude (encoded as in MGEN messages)   60 altitude
+ *
+ * Addresses, interface names and payloads are stored once in a per-file
+ * dictionary of DICT_ENTRY slots (followed by DICT_DATA continuation
+ * slots for entries longer than 56 bytes) interleaved with the events
+ * and referenced by id.  Every INDEX_INTERVAL events the time and slot
+ * of an event are noted for the time index.  The trailer holds the
+ * index and the slot of each dictionary entry, so a reader needn't scan
+ * the file; a log without a trailer (e.g. after a crash) is still
+ * readable with a single scan.  Appending to an existing v3 log strips
+ * its trailer and continues its dictionary and index.
+ */
+class MgenBinaryLog
+{
+  public:
+    MgenBinaryLog();
+    ~MgenBinaryLog();
+
+    enum {RECORD_SIZE = 64};
+    enum {INDEX_INTERVAL = 1024};     // events per time index entry
+    enum {ENTRY_DATA_MAX = 56};       // data bytes in a DICT_ENTRY slot
+    enum {DATA_MAX = RECORD_SIZE - 1};// data bytes in a DICT_DATA slot
+    enum SlotType
+    {
+        DICT_ENTRY  = 0xf0,
+        DICT_DATA   = 0xf1,
+        INDEX_TABLE = 0xf2,
+        DICT_TABLE  = 0xf3,
+        FOOTER      = 0xf4
+    };
+    enum EntryKind
+    {
+        ENDPOINT     = 1,  // addrType, addrLen, port, addr
+        STRING       = 2,
+        USER_PAYLOAD = 3,
+        MGEN_PAYLOAD = 4
+    };
+    enum InfoFlag
+    {
+        INFO_TTL    = 0x01,  // "ttl" is valid
+        INFO_CLIENT = 0x02   // TCP connection event logged by the client
+    };
+
+    // Decoded event record
+    struct Record
+    {
+        Record(LogEventType eventType, const struct timeval& eventTime);
+        Record() {}
+        UINT8           type;
+        UINT8           protocol;
+        UINT8           flags;
+        UINT8           gps_status;
+        struct timeval  event_time;
+        struct timeval  tx_time;
+        UINT32          flow_id;
+        UINT32          seq_num;
+        UINT32          size;
+        UINT32          src_id;
+        UINT32          dst_id;
+        UINT32          host_id;
+        UINT32          aux;
+        UINT8           ttl;
+        UINT8           info;
+        UINT16          sample;
+        UINT32          latitude;
+        UINT32          longitude;
+        INT32           altitude;
+    };
+    // Time index entry
+    struct IndexEntry
+    {
+        struct timeval  time;
+        uint64_t        slot;
+    };
+    static void PackRecord(char* slot, const Record& record);
+    static void UnpackRecord(const char* slot, Record& record);
+    static bool IsEvent(UINT8 slotType)
+        {return ((INVALID_EVENT != slotType) && (slotType < DICT_ENTRY));}
+
+    // "logFile" must be open for writing at its end.  If "empty" is false,
+    // the existing v3 log at "path" is continued.
+    bool Open(FILE* logFile, const char* path, bool empty);
+    void Close();  // writes the trailer (the FILE is left open)
+    bool IsOpen() const
+        {return (NULL != log_file);}
+    // Returns the open v3 log writing to "logFile", if any
+    static MgenBinaryLog* GetActive(FILE* logFile)
+        {return (((NULL != active_log) && (logFile == active_log->log_file)) ? active_log : NULL);}
+
+    // Return dictionary ids (0 for an invalid address with no port or no data)
+    UINT32 AddEndpoint(const ProtoAddress& addr);
+    UINT32 AddData(EntryKind kind, const char* data, unsigned int len);
+    bool WriteEvent(const Record& record);
+
+  private:
+    bool WriteSlot(const char* slot);
+    bool AddIndexEntry(const struct timeval& theTime, uint64_t slot);
+    bool AddDictSlot(uint64_t slot);
+    UINT32 LookupEntry(EntryKind kind, const char* data, unsigned int len, UINT32 hash) const;
+    bool CacheEntry(EntryKind kind, const char* data, unsigned int len, UINT32 hash, UINT32 id);
+    static UINT32 HashEntry(EntryKind kind, const char* data, unsigned int len);
+
+    static MgenBinaryLog* active_log;
+
+    FILE*           log_file;
+    uint64_t        slot_count;       // slots written (including the header)
+    uint64_t        event_count;
+
+    // Dictionary entry slots (by id - 1)
+    uint64_t*       dict_slot;
+    UINT32          dict_count;
+    UINT32          dict_size;
+
+    IndexEntry*     index;
+    unsigned int    index_count;
+    unsigned int    index_size;
+
+    // Open addressing cache of short dictionary entries (endpoints, names)
+    enum {CACHE_DATA_MAX = 20};
+    struct DictCacheEntry
+    {
+        UINT32  hash;
+        UINT32  id;            // 0 if unused
+        UINT8   kind;
+        UINT8   len;
+        char    data[CACHE_DATA_MAX];
+    };
+    DictCacheEntry* cache;
+    unsigned int    cache_size;       // power of 2
+    unsigned int    cache_count;
+};  // end class MgenBinaryLog
+
+/**
+ * @class MgenBinaryLogReader
+ *
+ * @brief Read-only (mmap()ed) access to a v3 binary log.  Slots are
+ * returned as pointers into the mapping and event records decoded with
+ * MgenBinaryLog::UnpackRecord().  GetSlot() and the dictionary lookups
+ * are safe to call from multiple threads once Open() returns.
+ */
+class MgenBinaryLogReader
+{
+  public:
+    MgenBinaryLogReader();
+    ~MgenBinaryLogReader();
+
+    // Returns true if "path" begins with a v3 log header
+    static bool IsBinaryLogV3(const char* path);
+
+    bool Open(const char* path);
+    void Close();
+
+    // Slots [1, GetRecordEnd()) hold events and dictionary entries
+    uint64_t GetRecordEnd() const
+        {return record_end;}
+    const char* GetSlot(uint64_t slot) const
+        {return (file_data + slot*MgenBinaryLog::RECORD_SIZE);}
+    UINT8 GetSlotType(uint64_t slot) const
+        {return (UINT8)file_data[slot*MgenBinaryLog::RECORD_SIZE];}
+    uint64_t GetEventCount() const
+        {return event_count;}
+    bool HasTrailer() const
+        {return has_trailer;}
+
+    // Returns a slot at or before the first event at or after "theTime"
+    uint64_t FindTime(const struct timeval& theTime) const;
+
+    UINT32 GetDictCount() const
+        {return dict_count;}
+    uint64_t GetDictSlot(UINT32 id) const  // id in [1, GetDictCount()]
+        {return dict_slot[id - 1];}
+    bool GetEndpoint(UINT32 id, ProtoAddress& addr) const;  // addr invalid if none
+    // Copies up to "bufferSize" bytes of entry data, returns the entry length
+    unsigned int GetData(UINT32 id, char* buffer, unsigned int bufferSize,
+                         MgenBinaryLog::EntryKind* kind = NULL) const;
+
+    unsigned int GetIndexCount() const
+        {return index_count;}
+    void GetIndexEntry(unsigned int i, struct timeval& theTime, uint64_t& slot) const;
+
+  private:
+    bool LoadTrailer();
+    bool ScanRecords();
+    bool AddDictSlot(uint64_t slot);
+    bool AddIndexEntry(const struct timeval& theTime, uint64_t slot);
+    const char* GetEntry(UINT32 id) const;
+
+    char*           file_data;
+    uint64_t        file_size;
+    bool            mapped;           // else "file_data" is heap allocated
+    uint64_t        slot_total;
+    uint64_t        record_end;
+    uint64_t        event_count;
+    bool            has_trailer;
+    uint64_t*       dict_slot;
+    UINT32          dict_count;
+    UINT32          dict_size;
+    MgenBinaryLog::IndexEntry* index;
+    unsigned int    index_count;
+    unsigned int    index_size;
+};  // end class MgenBinaryLogReader
+
+#endif // _MGEN_BINARY_LOG
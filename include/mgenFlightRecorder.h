@@ -0,0 +1,115 @@
+#ifndef _MGEN_FLIGHT_RECORDER
+#define _MGEN_FLIGHT_RECORDER
+
+#include "protoDefs.h"
+#include "mgenGlobals.h"
+#include "mgenLogFormat.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef UNIX
+#define MGEN_FLIGHT_RECORDER
+#endif // UNIX
+
+class MgenMsg;
+
+/**
+ * @class MgenFlightRecorder
+ *
+ * @brief Always-on recording (RECORDER) of the most recent SEND and RECV
+ * events into a ring of fixed-size slots in a shared, file-backed mmap().
+ * Recording an event is a copy of its header fields (an MgenLogRecord)
+ * into the next slot, with no formatting or system call, so it can stay
+ * on at rates where a text log can't.  Since the slots live in the page
+ * cache, the ring survives a crash of the mgen process (but not of the
+ * host).
+ *
+ * Nothing is formatted until the ring is written out, oldest event first,
+ * as a text log (or in the LOGFORMAT encoding): by the SNAPSHOT command
+ * (e.g. sent over the "instance" control pipe) while mgen runs, or by
+ * "convert <ringFile>" after a crash.
+ *
+ * File layout (native byte order and alignment, so the file is read on
+ * the same kind of host that wrote it):
+ *   Header: magic, version, slot size, slot count and the number of
+ *   events recorded so far
+ *   Slots: sequence number (the event's count, from 1, or 0 while the
+ *   slot is being written), event type and MgenLogRecord
+ * A slot is valid only if its sequence number matches its position, so
+ * a slot that was being written at a crash is skipped.
+ */
+class MgenFlightRecorder
+{
+  public:
+    MgenFlightRecorder();
+    ~MgenFlightRecorder();
+
+    enum {DEFAULT_SLOTS = 65536};
+
+    // Creates (or replaces) the ring file, with "slotCount" rounded up
+    // to a power of 2
+    bool Open(const char* path, unsigned int slotCount);
+    void Close();
+    bool IsOpen() const
+        {return (NULL != slot_list);}
+
+    // SEND_EVENT or RECV_EVENT only (main thread)
+    void Record(LogEventType            eventType,
+                MgenMsg&                theMsg,
+                const struct timeval&   eventTime,
+                bool                    logGpsData);
+
+    // Writes the ring to a new file at "path"
+    bool Snapshot(const char*               path,
+                  bool                      localTime,
+                  bool                      epochTime,
+                  MgenLogEncoder::Encoding  encoding) const;
+
+    // "true" if the file starts with a ring file header
+    static bool IsRecorderFile(const char* path);
+    // Writes the events of a ring file (e.g. left by a crashed mgen)
+    static bool Dump(const char*                path,
+                     FILE*                      outFile,
+                     bool                       localTime,
+                     bool                       epochTime,
+                     MgenLogEncoder::Encoding   encoding);
+
+  private:
+    enum {VERSION = 1};
+    static const char MAGIC[8];
+    struct Header
+    {
+        char        magic[8];
+        UINT32      version;
+        UINT32      slot_size;      // sizeof(Slot) of the writer
+        UINT32      slot_count;     // power of 2
+        UINT32      reserved;
+        uint64_t    count;          // events recorded
+    };
+    struct Slot
+    {
+        uint64_t        seq;        // 0 while being written
+        UINT8           type;       // SEND_EVENT or RECV_EVENT
+        UINT8           reserved[7];
+        MgenLogRecord   record;
+    };
+
+    static bool CheckHeader(const Header* header, uint64_t fileSize);
+    // Writes the valid slots, returns the number of events written
+    static unsigned long WriteRing(const Header*               header,
+                                   const Slot*                 slotList,
+                                   FILE*                       outFile,
+                                   bool                        localTime,
+                                   bool                        epochTime,
+                                   MgenLogEncoder::Encoding    encoding);
+
+    char*           map_ptr;
+    size_t          map_size;
+    Header*         header;
+    Slot*           slot_list;
+    unsigned int    slot_mask;      // slot_count - 1
+    uint64_t        count;
+};  // end class MgenFlightRecorder
+
+#endif // _MGEN_FLIGHT_RECORDER
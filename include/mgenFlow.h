@@ -98,6 +98,9 @@ class MgenFlow
     bool GetReportAnalytics() const
         {return report_analytics;}
     bool UpdateAnalyticReport(MgenAnalytic& analytic);
+    void OnRecvReport(const ProtoTime& theTime, const MgenAnalytic::Report& report);
+    const ProtoAddress& GetDstAddr() const
+        {return dst_addr;}
     void RemoveAnalyticReport(MgenAnalytic& analytic)
         {analytic_reporter.Remove(analytic);}
 	bool SendMessage();
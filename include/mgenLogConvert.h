@@ -0,0 +1,111 @@
+#ifndef _MGEN_LOG_CONVERT
+#define _MGEN_LOG_CONVERT
+
+#include "protokit.h"
+#include "mgenBinaryLog.h"
+#include "mgenLogFormat.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif // HAVE_PTHREAD
+
+class Mgen;
+class MgenMsg;
+
+/**
+ * @class MgenLogConverter
+ *
+ * @brief Converts a binary log (original or v3 format) to the text log
+ * format, or to per-flow SEND/RECV summaries, using multiple threads.
+ * The input is mmap()ed.  For the original format, a quick pre-pass over
+ * the record headers finds the record boundaries and splits the log into
+ * chunks (the fixed size slots of the v3 format need no pre-pass).
+ * Worker threads format whole chunks into memory with MgenLogFormatter
+ * while the calling thread writes finished chunks to the log in order, so
+ * the output is the same as a one record at a time conversion.  Records
+ * the formatter doesn't handle (LISTEN, JOIN, START, TCP connection
+ * events, RECV events with content to log, etc) are marked by the workers
+ * and converted through MgenMsg by the calling thread at their place in
+ * the output.  Workers stay at most a few chunks ahead of the writer to
+ * bound memory use.  In summary mode, workers tally SEND and RECV events
+ * by flow and the calling thread merges the chunk tallies in order.
+ * When a v3 binary log is open (an upgrade), every record is converted
+ * through MgenMsg.  Either input format may be gzip compressed, in which
+ * case it is read into memory rather than mapped.
+ */
+class MgenLogConverter
+{
+  public:
+    MgenLogConverter();
+    ~MgenLogConverter();
+
+    enum {CHUNK_SIZE = 1048576};  // input bytes per chunk
+    enum {THREAD_MAX = 32};
+
+    // Writes to the "mgen" log file.  A "threadCount" of 0 uses
+    // a worker thread per online CPU.
+    bool Convert(const char* path, Mgen& mgen, bool summarize, unsigned int threadCount = 0);
+
+  private:
+    struct Chunk;
+    class FlowTable;
+
+    bool OpenLegacy(const char* path);
+    bool SplitLegacy();
+    bool SplitV3();
+    bool AddChunk(uint64_t start, uint64_t end);
+    void Close();
+
+    void ProcessChunk(Chunk& chunk, MgenLogFormatter& formatter);
+    bool FormatMsg(Chunk& chunk, MgenLogFormatter& formatter, MgenMsg& msg,
+                   LogEventType eventType, const struct timeval& eventTime, int ttl);
+    bool WriteChunk(Chunk& chunk);
+    bool ConvertRecord(uint64_t position);
+    void WriteText(const char* text, unsigned int len);
+    void LogSummary();
+
+#ifdef HAVE_PTHREAD
+    static void* ThreadMain(void* arg);
+    void Run();
+#endif // HAVE_PTHREAD
+
+    Mgen*               mgen;
+    FILE*               log_file;
+    bool                summarize;
+    bool                local_time;
+    bool                epoch_time;
+    bool                log_rx;
+    bool                log_data;
+    bool                log_gps_data;
+    bool                log_flush;
+    bool                relog;            // records go to an open v3 binary log
+    MgenLogEncoder::Encoding log_encoding; // LOGFORMAT of text output
+
+    // Original format input
+    char*               file_data;
+    uint64_t            file_size;
+    bool                mapped;           // else "file_data" is heap allocated
+    uint64_t            record_end;       // end of the last whole record
+    bool                input_error;      // invalid or truncated record at "record_end"
+    // v3 format input
+    bool                is_v3;
+    MgenBinaryLogReader reader;
+
+    Chunk*              chunk_list;
+    unsigned int        chunk_count;
+    unsigned int        chunk_size;
+    FlowTable*          flow_table;       // merged summaries
+
+#ifdef HAVE_PTHREAD
+    pthread_t           thread_list[THREAD_MAX];
+    unsigned int        thread_count;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;             // signals chunk completion and writer progress
+    unsigned int        next_chunk;       // next to be formatted
+    unsigned int        write_chunk;      // next to be written
+    unsigned int        window;           // max chunks formatted ahead of the writer
+    bool                abort;
+#endif // HAVE_PTHREAD
+};  // end class MgenLogConverter
+
+#endif // _MGEN_LOG_CONVERT
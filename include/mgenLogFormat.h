@@ -0,0 +1,224 @@
+#ifndef _MGEN_LOG_FORMAT
+#define _MGEN_LOG_FORMAT
+
+#include "protoDefs.h"
+#include "protoAddress.h"
+#include "mgenGlobals.h"
+#include "mgenTimestamp.h"
+
+#include <stdio.h>
+
+class MgenMsg;
+
+/**
+ * @struct MgenLogRecord
+ *
+ * @brief Compact copy of the fields a plain SEND or RECV event logs,
+ * with addresses kept as raw IPv4/IPv6 bytes so it can be formatted
+ * on another thread (or after "theMsg" is gone).
+ */
+struct MgenLogRecord
+{
+    enum {ADDR_MAX = 16};
+    struct timeval  rx_time;      // event time for SEND records
+    struct timeval  tx_time;
+    double          latitude;
+    double          longitude;
+    INT32           altitude;
+    UINT32          flow_id;
+    UINT32          seq_num;
+    UINT32          msg_len;
+    UINT32          sample;       // events a sampled line stands for (0 = not sampled)
+    INT16           ttl;          // < 0 if unknown
+    UINT16          src_port;
+    UINT16          dst_port;
+    UINT16          host_port;
+    UINT8           protocol;
+    UINT8           flags;
+    UINT8           gps_status;   // 0xff if GPS isn't logged
+    UINT8           src_len;      // 4 (IPv4) or 16 (IPv6)
+    UINT8           dst_len;
+    UINT8           host_len;     // 0 if no host address
+    char            src_addr[ADDR_MAX];
+    char            dst_addr[ADDR_MAX];
+    char            host_addr[ADDR_MAX];
+};  // end struct MgenLogRecord
+
+/**
+ * @class MgenLogEncoder
+ *
+ * @brief Writes log events as JSON Lines or CSV (LOGFORMAT) instead of the
+ * "<name>><value>" text format.  Both use one fixed schema (the Column
+ * list): a CSV line has a value, possibly empty, for every column in
+ * Column order (under the header line from FormatHeader()), and a JSON
+ * object has a member, named as in the CSV header, for each column the
+ * event sets, in the same order.  Times are always epoch "<sec>.<usec>"
+ * and addresses are given without their port.  Values are set between
+ * Begin() and Finish() without printf() (except floating point values).
+ * An instance is not thread-safe.
+ */
+class MgenLogEncoder
+{
+  public:
+    enum Encoding {TEXT, JSON, CSV, INVALID_ENCODING};
+    enum Column
+    {
+        COL_TIME,
+        COL_EVENT,
+        COL_PROTO,
+        COL_FLOW,
+        COL_SEQ,
+        COL_SRC,
+        COL_SRC_PORT,
+        COL_DST,
+        COL_DST_PORT,
+        COL_HOST,
+        COL_HOST_PORT,
+        COL_SENT,
+        COL_SIZE,
+        COL_TTL,
+        COL_GPS,
+        COL_LAT,
+        COL_LON,
+        COL_ALT,
+        COL_DATA,       // hex user data (set by reference)
+        COL_FLAGS,
+        COL_SAMPLE,
+        COL_PORT,
+        COL_GROUP,
+        COL_SOURCE,
+        COL_INTERFACE,
+        COL_ERROR,
+        COL_REPORTER,
+        COL_REPORTER_PORT,
+        COL_OFFSET,
+        COL_WINDOW,
+        COL_RATE,       // kbps
+        COL_LOSS,
+        COL_LATENCY_AVE,
+        COL_LATENCY_MIN,
+        COL_LATENCY_MAX,
+        COL_VERSION,
+        COLUMN_COUNT
+    };
+    enum {HEADER_MAX = 512};   // FormatHeader() length limit
+
+    MgenLogEncoder(Encoding theEncoding);
+
+    void SetEncoding(Encoding theEncoding)
+        {encoding = theEncoding;}
+    Encoding GetEncoding() const
+        {return encoding;}
+
+    // "text", "json" or "csv" (any case)
+    static Encoding GetEncodingFromString(const char* string);
+
+    // The encoding (TEXT if none) of the current text log file
+    static Encoding GetActive(FILE* filePtr);
+    static void SetActive(FILE* filePtr, Encoding theEncoding);
+    // Where lines with no encoded form (COUNTERS, TXDELAY, REORDER, etc)
+    // go: "filePtr" unless it's a JSON or CSV log, then stderr
+    static FILE* GetTextFile(FILE* filePtr)
+        {return ((NULL == filePtr) || (TEXT == GetActive(filePtr))) ? filePtr : stderr;}
+
+    // Clears all columns and sets the COL_TIME and COL_EVENT columns
+    void Begin(LogEventType eventType, const struct timeval& eventTime);
+    void Begin(const char* eventName, const struct timeval& eventTime);  // e.g. "REPORT"
+    void SetString(Column column, const char* text);
+    void SetUnsigned(Column column, unsigned long value);
+    void SetSigned(Column column, long value);
+    void SetDouble(Column column, double value);  // "%f"
+    void SetTime(Column column, const struct timeval& theTime);
+    // Sets the address (and port, unless "portColumn" is COLUMN_COUNT)
+    void SetAddress(Column addrColumn, Column portColumn,
+                    const char* addr, unsigned int addrLen, UINT16 port);
+    void SetAddress(Column addrColumn, Column portColumn, const ProtoAddress& addr);
+    // "data" must stay valid until Finish()
+    void SetHex(Column column, const char* data, unsigned int len);
+
+    // Room Finish() needs for the current event
+    unsigned int GetMaxLength() const;
+    // Writes the line (with its '\n'), returns its length
+    unsigned int Finish(char* buffer);
+
+    // The CSV header line (with its '\n'), returns its length
+    static unsigned int FormatHeader(char* buffer);
+
+  private:
+    enum {SCRATCH_MAX = 1024};
+    enum Kind {NONE, NUMBER, STRING, HEX};
+    struct Value
+    {
+        UINT16      offset;   // into "scratch"
+        UINT16      len;
+        UINT8       kind;
+    };
+
+    char* Reserve(Column column, Kind kind, unsigned int len);
+    void Commit(Column column, unsigned int len)
+        {values[column].len = len; scratch_len += len;}
+
+    Encoding                encoding;
+    MgenTimestampFormatter  timestamp_formatter;
+    Value                   values[COLUMN_COUNT];
+    char                    scratch[SCRATCH_MAX];
+    unsigned int            scratch_len;
+    const char*             hex_data;
+    unsigned int            hex_len;
+};  // end class MgenLogEncoder
+
+/**
+ * @class MgenLogFormatter
+ *
+ * @brief Writes the same SEND and RECV text as MgenMsg::LogSendEvent()
+ * and MgenMsg::LogRecvEvent() from an MgenLogRecord, without printf()
+ * (except for GPS fields) and using only reentrant calls, so separate
+ * instances can format on separate threads.  None of the Format*()
+ * methods NULL terminate; each returns the number of bytes written.
+ * With a JSON or CSV encoding set, FormatRecv() and FormatSend() write
+ * the MgenLogEncoder line for the event instead.
+ */
+class MgenLogFormatter
+{
+  public:
+    MgenLogFormatter();
+
+    enum {OUTPUT_LINE_MAX = 1024};  // room to reserve for each formatted line
+
+    void SetTimeFormat(bool localTime, bool epochTime)
+    {
+        local_time = localTime;
+        epoch_time = epochTime;
+    }
+    void SetEncoding(MgenLogEncoder::Encoding theEncoding)
+        {encoder.SetEncoding(theEncoding);}
+
+    // These return "false" if the event needs MgenMsg::LogRecvEvent() or
+    // MgenMsg::LogSendEvent() (message content to log, non-IP addresses, etc)
+    static bool InitRecv(MgenLogRecord& record, MgenMsg& theMsg, const struct timeval& rxTime,
+                         bool logData, bool logGpsData, int ttl = -1);
+    static bool InitSend(MgenLogRecord& record, MgenMsg& theMsg, const struct timeval& txTime);
+
+    unsigned int FormatRecv(char* buffer, const MgenLogRecord& record);
+    unsigned int FormatSend(char* buffer, const MgenLogRecord& record);
+    // "<hh>:<mm>:<ss>.<usec> " or "<sec>.<usec> " (epoch time) with a trailing space
+    unsigned int FormatTimestamp(char* buffer, const struct timeval& theTime)
+        {return timestamp_formatter.Format(buffer, theTime, local_time, epoch_time);}
+
+    static unsigned int FormatString(char* buffer, const char* text);
+    static unsigned int FormatUnsigned(char* buffer, unsigned long value);
+    // "<addr>/<port>"
+    static unsigned int FormatAddress(char* buffer, const char* addr,
+                                      unsigned int addrLen, UINT16 port);
+
+  private:
+    unsigned int EncodeRecv(char* buffer, const MgenLogRecord& record);
+    unsigned int EncodeSend(char* buffer, const MgenLogRecord& record);
+
+    MgenTimestampFormatter  timestamp_formatter;
+    MgenLogEncoder          encoder;
+    bool                    local_time;
+    bool                    epoch_time;
+};  // end class MgenLogFormatter
+
+#endif // _MGEN_LOG_FORMAT
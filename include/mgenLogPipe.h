@@ -0,0 +1,145 @@
+#ifndef _MGEN_LOG_PIPE
+#define _MGEN_LOG_PIPE
+
+#include "protoDefs.h"
+#include "mgenGlobals.h"  // for Protocol types
+#include "mgenLogFormat.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+class MgenMsg;
+
+/**
+ * @class MgenLogPipe
+ *
+ * @brief Moves text log output off the receive (main) thread.  The main
+ * thread pushes compact fixed-size records into a lock-free single
+ * producer / single consumer ring and a writer thread formats and writes
+ * them.  Plain SEND and RECV events are queued as binary records and 
+ * formatted by the writer.  Everything else written with Mgen::Log() to 
+ * the log file (while the pipe is running) is formatted on the main thread
+ * and queued as text so that log ordering is preserved.  When the ring is 
+ * full, receive path records are dropped and counted rather than blocking
+ * reception; the drop count is reported in the log.
+ *
+ * The writer formats straight into one of two large output buffers with 
+ * its own (printf-free) MgenLogFormatter.  Full buffers are handed to an I/O
+ * thread that write()s them to the log file descriptor while the other is
+ * filled, so the formatter never waits on the disk unless both are busy.
+ * Buffered output is handed off within the flush latency bound (or after 
+ * every batch of records with the "flush" option) instead of being flushed
+ * per event.
+ */
+class MgenLogPipe
+{
+  public:
+    MgenLogPipe();
+    ~MgenLogPipe();
+
+    enum {DEFAULT_SIZE = 65536};  // ring records
+    enum {DEFAULT_LATENCY = 100}; // max output hand off delay (msec)
+
+    bool Start(FILE* logFile, unsigned int ringSize, bool localTime, bool flush,
+               unsigned int latency = DEFAULT_LATENCY);
+    void Stop();  // drains the ring and joins the writer thread
+    bool IsRunning() const
+        {return thread_started;}
+
+    // Main thread only.  Returns "false" if the message has content
+    // (user data, MGEN_DATA items, etc) that needs MgenMsg::LogRecvEvent()
+    bool PushRecv(MgenMsg& theMsg, const struct timeval& rxTime, bool logData, bool logGpsData);
+    // Main thread only.  Returns "false" if MgenMsg::LogSendEvent() is needed
+    bool PushSend(MgenMsg& theMsg, const struct timeval& txTime);
+    // Text logged while this is set is dropped (rather than waited on) when
+    // the ring is full, e.g. LogRecvEvent() fallback output
+    void SetRecvContext(bool state)
+        {recv_context = state;}
+
+    // Installed as Mgen::Log while a pipe is running
+    static int Log(FILE* filePtr, const char* format, ...);
+
+  private:
+    enum RecordType {RECORD_TEXT, RECORD_RECV, RECORD_SEND};
+    enum {OUTPUT_SIZE = 1048576};  // bytes per output buffer
+    enum {OUTPUT_LINE_MAX = MgenLogFormatter::OUTPUT_LINE_MAX};
+    enum {TEXT_MAX = sizeof(MgenLogRecord)};
+    struct Record
+    {
+        UINT8           type;
+        UINT16          text_len;
+        union
+        {
+            MgenLogRecord   msg;
+            char            text[TEXT_MAX];
+        };
+    };
+
+    static void* ThreadMain(void* arg);
+    void Run();
+    unsigned int Drain();  // writer thread, returns records written
+    void LogSummary(const char* label);
+    
+    // Output buffers (writer thread) and I/O thread hand off
+    char* ReserveOutput();  // OUTPUT_LINE_MAX bytes, hands off the buffer if needed
+    bool OutputExpired() const;
+    void HandOff();
+    static void* IoThreadMain(void* arg);
+    void IoRun();
+
+    // Producer side (main thread)
+    int AppendText(const char* format, va_list args);
+    bool PushText(const char* text, unsigned int len, bool droppable);
+    unsigned int GetFree() const;
+
+    static MgenLogPipe* active_pipe;      // whose file Log() redirects
+
+    FILE*               log_file;
+    bool                local_time;
+    bool                log_flush;
+    bool                log_text;         // "false" for JSON or CSV (LOGFORMAT) logs
+    bool                recv_context;
+    MgenLogFormatter    formatter;        // writer thread
+    int                 (*prev_log)(FILE*, const char*, ...);
+
+    Record*             ring;
+    unsigned int        ring_size;        // power of 2
+    unsigned int        ring_head;        // next record to write (writer)
+    unsigned int        ring_tail;        // next free record (main thread)
+
+    char*               text_buffer;      // partial line being assembled
+    unsigned int        text_len;
+    unsigned int        text_size;
+
+    pthread_t           thread;
+    bool                thread_started;
+    bool                stop;             // set by main thread
+
+    unsigned long       record_count;     // written (writer thread)
+    unsigned long       drop_count;       // written by main thread only
+    unsigned long       drop_reported;    // writer thread
+    unsigned int        max_fill;         // writer thread
+    
+    int                 log_fd;
+    unsigned int        flush_latency;    // msec
+    char*               out_buffer[2];
+    unsigned int        out_len;          // of out_buffer[out_index]
+    unsigned int        out_index;
+    struct timespec     out_since;        // when out_buffer[out_index] became non-empty
+    pthread_t           io_thread;
+    bool                io_started;
+    pthread_mutex_t     io_lock;
+    pthread_cond_t      io_cond;          // signals io_busy or io_stop changes
+    bool                io_busy;          // out_buffer[io_index] is being written
+    bool                io_stop;
+    unsigned int        io_index;
+    unsigned int        io_len;
+    unsigned long       write_count;      // I/O thread
+    unsigned long long  write_bytes;      // I/O thread
+};  // end class MgenLogPipe
+
+#endif // HAVE_PTHREAD
+#endif // _MGEN_LOG_PIPE
@@ -0,0 +1,122 @@
+#ifndef _MGEN_LOG_SAMPLER
+#define _MGEN_LOG_SAMPLER
+
+#include "protokit.h"
+#include "mgenGlobals.h"
+
+class MgenMsg;
+
+/**
+ * @class MgenLogSampler
+ *
+ * @brief Decides which SEND and RECV events are logged, before any
+ * formatting work is done, for flows whose rate makes logging every
+ * message impractical.
+ *
+ * Filters (LOGFILTER) restrict logging to the given flow ids, RECV
+ * source addresses and/or destination addresses.  Filters of the same
+ * kind are alternatives; an event must pass each kind that is set.
+ *
+ * Sampling (LOGSAMPLE) logs one in every N events of a flow, or the first
+ * event of a flow in each "interval" seconds.  A rule may be global or
+ * apply to a list of flow ids (the last matching rule is used).  A logged
+ * line of a sampled flow is marked with the number of events it stands
+ * for ("sample>K"): itself and the events not logged since the flow's
+ * previous logged line, so the sum of K over a flow's lines counts its
+ * events up to its last logged line.  K never exceeds SAMPLE_MAX.
+ */
+class MgenLogSampler
+{
+  public:
+    MgenLogSampler();
+    ~MgenLogSampler();
+
+    enum {SAMPLE_MAX = 65535};  // max events a logged line stands for
+
+    // "[<flowIds>:]<count>" or "[<flowIds>:]<interval>s", where
+    // <flowIds> is "<id>[-<id>][,...]" (a <count> of 1 logs every event)
+    bool ParseSample(const char* arg);
+    // "flow:<flowIds>", "src:<addr>[/<port>]", "dst:<addr>[/<port>]", or
+    // "none" to clear all filters
+    bool ParseFilter(const char* arg);
+
+    bool IsActive() const
+        {return ((0 != rule_count) || (0 != flow_filter_count) ||
+                 (0 != src_filter_count) || (0 != dst_filter_count));}
+    bool IsSampling() const
+        {return (0 != rule_count);}
+
+    // Returns "false" if the event is not to be logged.  Otherwise
+    // "sample" is set to the number of events the logged line stands for,
+    // or 0 if the flow isn't sampled.  (SEND and RECV events only)
+    bool Check(LogEventType             eventType,
+               MgenMsg&                 theMsg,
+               const struct timeval&    eventTime,
+               unsigned int&            sample);
+
+    void Destroy();
+
+  private:
+    enum {RULE_MAX = 32, FILTER_MAX = 32, RANGE_MAX = 64};
+    enum {INIT_SIZE = 64, ADDR_MAX = 16};
+    struct FlowRange
+    {
+        UINT32  first;
+        UINT32  last;
+    };
+    struct Rule
+    {
+        unsigned int    range_index;  // into "range_list"
+        unsigned int    range_count;  // 0 = all flows
+        unsigned int    count;        // 1 in "count", or 0 if time based
+        double          interval;     // sec
+    };
+    struct AddrFilter
+    {
+        char            addr[ADDR_MAX];
+        UINT8           addr_len;
+        UINT16          port;         // 0 = any port
+    };
+    struct Entry
+    {
+        bool            in_use;
+        UINT8           type;         // SEND_EVENT or RECV_EVENT
+        UINT8           addr_len;
+        UINT16          src_port;
+        UINT32          flow_id;
+        char            src_addr[ADDR_MAX];
+        int             rule;         // index into "rule_list", -1 if not sampled
+        unsigned int    count;        // events since the last logged one
+        double          next_time;    // for time based sampling
+    };
+
+    static bool ParseFlowRanges(const char* text, FlowRange* rangeList,
+                                unsigned int rangeMax, unsigned int& rangeCount);
+    static bool ParseAddrFilter(const char* text, AddrFilter& filter);
+    static bool MatchFlow(const FlowRange* rangeList, unsigned int rangeCount, UINT32 flowId);
+    static bool MatchAddr(const AddrFilter* filterList, unsigned int filterCount,
+                          const ProtoAddress& addr);
+    static unsigned int Hash(UINT8 type, const char* addr, unsigned int addrLen,
+                             UINT16 srcPort, UINT32 flowId);
+    int FindRule(UINT32 flowId) const;
+    Entry* GetEntry(LogEventType eventType, MgenMsg& theMsg);
+    bool Grow();
+    void ClearTable();
+
+    Rule            rule_list[RULE_MAX];
+    unsigned int    rule_count;
+    FlowRange       range_list[RANGE_MAX];   // flow ids of sampling rules
+    unsigned int    range_count;
+    FlowRange       flow_filter[FILTER_MAX];
+    unsigned int    flow_filter_count;
+    AddrFilter      src_filter[FILTER_MAX];
+    unsigned int    src_filter_count;
+    AddrFilter      dst_filter[FILTER_MAX];
+    unsigned int    dst_filter_count;
+    // Per-flow sampling state
+    Entry*          table;
+    unsigned int    table_size;   // power of 2
+    unsigned int    flow_count;
+};  // end class MgenLogSampler
+
+#endif // _MGEN_LOG_SAMPLER
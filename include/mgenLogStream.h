@@ -0,0 +1,137 @@
+#ifndef _MGEN_LOG_STREAM
+#define _MGEN_LOG_STREAM
+
+#include "protoDefs.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(HAVE_PTHREAD) && defined(UNIX)
+#include <pthread.h>
+#define MGEN_LOG_STREAM
+#endif // HAVE_PTHREAD && UNIX
+
+/**
+ * @class MgenLogStream
+ *
+ * @brief Background output stage for log files that are gzip compressed
+ * and/or rotated as they are written.  Open() returns a FILE* (the write
+ * end of a pipe) that is used like any other log file (text, log pipe
+ * write()s or original format binary records).  A thread reads the pipe
+ * and writes the stream to the file, so compression and rotation are
+ * kept off the main (send/receive) thread.
+ *
+ * Compression: the stream is deflated with gzip framing.  When the pipe
+ * goes idle, output is sync flushed within about a second so the file
+ * stays readable (e.g. "zcat") while mgen runs.  Appending adds a new
+ * gzip member to the file, which gzip readers (and ReadFile())
+ * concatenate.
+ *
+ * Rotation: after "maxBytes" (written to disk) or every "interval"
+ * seconds, the thread switches files at the next text line or binary
+ * record boundary.  The current file is always "path".  At rollover it is
+ * renamed to "path.<n>" (or "<name>.<n>.gz" for a "<name>.gz" path) and a
+ * next file, opened ahead of time as "path.next", is renamed to "path",
+ * so each finished file appears complete under its final name.  Each new
+ * file starts with a "mgen version=<version> type=<text_log|binary_log>
+ * part=<n>" header line (NULL terminated for binary logs, as the original
+ * binary log header is), or the SetHeader() text.
+ *
+ * The static methods read logs that may or may not be compressed, so
+ * "convert", "summarize" and the v3 log reader take either.
+ */
+class MgenLogStream
+{
+  public:
+    MgenLogStream();
+    ~MgenLogStream();
+
+    enum {DEFAULT_LEVEL = 6};     // zlib compression level (1-9)
+
+    // These must be set before Open()
+    void SetCompression(int level)  // 0 = no compression
+        {compress_level = level;}
+    void SetRotation(uint64_t maxBytes, unsigned int interval)  // 0 = no limit
+    {
+        rotate_bytes = maxBytes;
+        rotate_interval = interval;
+    }
+    // Replaces the header line of text log parts ("" for none), e.g. a
+    // CSV column header (the text is copied)
+    bool SetHeader(const char* text);
+    // "binary" logs are rotated at record boundaries; "empty" binary logs
+    // start with the header line that Mgen writes
+    FILE* Open(const char* path, bool append, bool binary, bool empty);
+    // The FILE* from Open() must be fclose()d before Close() is called.
+    // This finishes the stream, joins the thread and reports throughput.
+    void Close();
+    bool IsOpen() const
+        {return thread_started;}
+
+    // "true" if the file has the gzip magic number
+    static bool IsCompressed(const char* path);
+    // Decompresses the whole file into "data": a read-only mmap() of an
+    // unlinked temporary file (munmap() it) if "mapped", else a new[]
+    // buffer (delete[] it).  "data" is NULL for an empty file.
+    static bool ReadFile(const char* path, char*& data, uint64_t& size, bool& mapped);
+    // Maps (or, where mmap() isn't available, reads) the whole file,
+    // decompressing it with ReadFile() if it's compressed.  "data" is NULL
+    // for an empty file.  Release it with UnmapFile().
+    static bool MapFile(const char* path, char*& data, uint64_t& size, bool& mapped);
+    static void UnmapFile(char* data, uint64_t size, bool mapped);
+    // Reads up to "len" leading (decompressed) bytes, returns bytes read
+    static unsigned int ReadHead(const char* path, char* buffer, unsigned int len);
+
+  private:
+    enum {READ_CHUNK = 262144};   // ReadFile() gzread() size
+#ifdef MGEN_LOG_STREAM
+    enum {BUFFER_SIZE = 262144};
+    enum {SYNC_INTERVAL = 1000};  // msec of pipe idle time before a sync flush
+    enum {PATH_SIZE = 1024};
+    // Binary log record parsing state
+    enum ParseState {PARSE_HEADER_LINE, PARSE_RECORD_HEADER, PARSE_RECORD_BODY};
+
+    static void* ThreadMain(void* arg);
+    void Run();
+    bool Write(const char* data, unsigned int len);
+    bool Deflate(int flush);
+    unsigned int Scan(const char* data, unsigned int len, bool stopAtBoundary);
+    bool RotateDue(double now) const;
+    bool OpenNext();
+    bool Rotate(double now);
+    bool WriteHeader();
+    void GetPartPath(char* buffer, unsigned int part) const;
+
+    char                path[PATH_SIZE - 16];  // (room for the part suffix)
+    char                next_path[PATH_SIZE];
+    bool                binary;
+    int                 pipe_fd;          // read end
+    int                 out_fd;
+    int                 next_fd;          // pre-opened next file (rotation)
+    char*               in_buffer;
+    char*               out_buffer;
+    void*               stream;           // z_stream (compression)
+    pthread_t           thread;
+    bool                error;
+    // Rotation state
+    unsigned int        part;             // current file part number
+    uint64_t            file_bytes;       // written to the current file
+    double              file_start;       // time current file was started
+    bool                at_boundary;      // stream is between records
+    ParseState          parse_state;
+    unsigned int        parse_count;      // record header bytes read or body bytes left
+    unsigned char       record_header[4];
+    // Statistics
+    unsigned long long  in_bytes;
+    unsigned long long  out_bytes;
+    double              deflate_time;     // thread CPU sec spent compressing
+    unsigned int        rotate_count;
+#endif // MGEN_LOG_STREAM
+    int                 compress_level;
+    uint64_t            rotate_bytes;
+    unsigned int        rotate_interval;  // sec
+    char*               header_text;      // SetHeader() text, NULL for the default
+    bool                thread_started;
+};  // end class MgenLogStream
+
+#endif // _MGEN_LOG_STREAM
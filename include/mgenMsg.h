@@ -36,6 +36,7 @@
 #include "protokit.h"
 #include "mgenGlobals.h"
 #include "mgenPayload.h"
+#include "mgenBinaryLog.h"
 #include <stdio.h>  // for FILE*
 
 
@@ -143,6 +144,10 @@ class MgenMsg
     void SetGPSLongitude(double value) {longitude = value;}
     void SetGPSAltitude(INT32 value) {altitude = value;}
     void SetGPSStatus(GPSStatus status) {gps_status = status;}
+    double GetGPSLatitude() const {return latitude;}
+    double GetGPSLongitude() const {return longitude;}
+    INT32 GetGPSAltitude() const {return altitude;}
+    GPSStatus GetGPSStatus() const {return gps_status;}
     void SetPayload(PayloadType type, UINT32* buffer, UINT16 len)
     {
         payload_type = type;
@@ -159,6 +164,10 @@ class MgenMsg
         {return payload_len;}
     void SetError(MgenMsg::Error error) {msg_error = error;};
     void SetChecksumError() {msg_error = ERROR_CHECKSUM;};
+    // Number of events a logged SEND/RECV line stands for when its flow's
+    // logging is sampled (0 = not sampled)
+    void SetLogSample(unsigned int sample) {log_sample = sample;}
+    unsigned int GetLogSample() const {return log_sample;}
 	bool ComputeCRC() {return compute_crc;}
 	void ComputeCRC(bool theFlag) {compute_crc = theFlag;}
     // For these, "msgBuffer" is a packed message buffer
@@ -196,7 +205,32 @@ class MgenMsg
                       const DrecEvent *event, 
                       UINT16 portNumber,
                       Mgen& mgen);
+    // Converts a binary (original or v3, optionally gzip compressed) log to
+    // the "mgen" log format (text, or a v3 binary log if one is open)
     bool ConvertBinaryLog(const char* path,Mgen& mgen);
+    // Writes per-flow SEND/RECV summaries of a binary log to the "mgen" log
+    bool SummarizeBinaryLog(const char* path, Mgen& mgen);
+    
+    // Original binary log records (as read by MgenLogConverter)
+    enum {BINARY_RECORD_MAX = 1024};  // maximum record size
+    // Unpacks a SEND or RECV record, setting "eventTime"
+    bool UnpackBinaryRecord(LogEventType    eventType, 
+                            Protocol        theProtocol, 
+                            UINT32*         alignedBuffer,
+                            UINT16          recordLength,
+                            bool            logData,
+                            struct timeval& eventTime);
+    static bool ConvertBinaryRecord(LogEventType    eventType, 
+                                    Protocol        theProtocol, 
+                                    UINT32*         alignedBuffer,
+                                    UINT16          recordLength,
+                                    Mgen&           mgen);
+    // v3 binary log records (the payload of RECV records isn't unpacked)
+    void UnpackBinaryRecord(const MgenBinaryLogReader&      reader, 
+                            const MgenBinaryLog::Record&    record);
+    static bool ConvertBinaryRecord(const MgenBinaryLogReader&  reader, 
+                                    MgenBinaryLog::Record&      record,
+                                    Mgen&                       mgen);
     
     static void ComputeCRC32(UINT32& checksum,
                              const UINT8* buffer, 
@@ -209,11 +243,20 @@ class MgenMsg
 	unsigned int    mgen_msg_len;
     
   private:
+    // Fills in the v3 record fields common to message events
+    void InitBinaryRecord(MgenBinaryLog::Record& record, MgenBinaryLog& binaryLog);
     
     static UINT32 ComputeCRC32(const UINT8* buffer, 
                                UINT32               buflen);
+    // Advance the (pre-XOR) CRC register using the fastest 
+    // implementation this CPU supports (selected once at startup)
+    static UINT32 UpdateCRC32(UINT32 crc, const UINT8* buffer, UINT32 buflen);
+    static UINT32 UpdateCRC32Slice8(UINT32 crc, const UINT8* buffer, UINT32 buflen);
+    static bool InitCRC32SliceTable();
     static const UINT32 CRC32_XINIT;
     static const UINT32 CRC32_TABLE[256];
+    static UINT32 CRC32_SLICE_TABLE[8][256];  // built from CRC32_TABLE
+    static const bool CRC32_SLICE_TABLE_INIT;
     
     UINT8   version;
     UINT8   flags; 
@@ -235,8 +278,77 @@ class MgenMsg
     Protocol        protocol;
     Error           msg_error;
 	bool            compute_crc;
+    unsigned int    log_sample;
     
     enum {FLAGS_OFFSET = 3};
 };  // end class MgenMsg    
 
+/**
+ * @class MgenMsgView
+ *
+ * @brief Read-only view over a received, packed MGEN message buffer.
+ * Fields are decoded on demand straight from the buffer, so receivers
+ * that only need flow_id/seq_num/tx_time/msg_len (e.g. analytics)
+ * can skip the full MgenMsg::Unpack().  The buffer must outlive the view.
+ */
+class MgenMsgView
+{
+  public:
+    MgenMsgView(const UINT32* alignedBuffer, unsigned int bufferLen)
+      : buffer((const char*)alignedBuffer), buffer_len(bufferLen) {}
+    
+    // Checks length, version and dst_addr fields (what Unpack() requires)
+    bool IsValid() const;
+    // Validates trailing CRC32 (caller checks CHECKSUM flag or force)
+    bool ChecksumIsValid() const;
+    
+    unsigned int GetBufferLen() const {return buffer_len;}
+    UINT16 GetMsgLen() const {return GetUINT16(MSG_LEN_OFFSET);}
+    UINT8 GetVersion() const {return (UINT8)buffer[VERSION_OFFSET];}
+    bool FlagIsSet(MgenMsg::Flag theFlag) const
+        {return (0 != ((UINT8)buffer[FLAGS_OFFSET] & theFlag));}
+    UINT32 GetFlowId() const {return GetUINT32(FLOW_ID_OFFSET);}
+    UINT32 GetSeqNum() const {return GetUINT32(SEQ_NUM_OFFSET);}
+    UINT16 GetDstPort() const {return GetUINT16(DST_PORT_OFFSET);}
+    void GetTxTime(struct timeval& txTime) const
+    {
+        txTime.tv_sec = GetUINT32(TX_SEC_OFFSET);
+        txTime.tv_usec = GetUINT32(TX_USEC_OFFSET);
+    }
+    // These walk the variable length fields so are a little more costly
+    bool GetDstAddr(ProtoAddress& dstAddr) const;
+    MgenMsg::PayloadType GetPayloadType() const;
+    
+  private:
+    enum
+    {
+        MSG_LEN_OFFSET       = 0,
+        VERSION_OFFSET       = 2,
+        FLAGS_OFFSET         = 3,
+        FLOW_ID_OFFSET       = 4,
+        SEQ_NUM_OFFSET       = 8,
+        TX_SEC_OFFSET        = 12,
+        TX_USEC_OFFSET       = 16,
+        DST_PORT_OFFSET      = 20,
+        DST_ADDR_TYPE_OFFSET = 22,
+        DST_ADDR_LEN_OFFSET  = 23,
+        DST_ADDR_OFFSET      = 24
+    };
+    UINT16 GetUINT16(unsigned int offset) const
+    {
+        UINT16 temp16;
+        memcpy(&temp16, buffer + offset, sizeof(UINT16));
+        return ntohs(temp16);
+    }
+    UINT32 GetUINT32(unsigned int offset) const
+    {
+        UINT32 temp32;
+        memcpy(&temp32, buffer + offset, sizeof(UINT32));
+        return ntohl(temp32);
+    }
+    
+    const char*     buffer;
+    unsigned int    buffer_len;
+};  // end class MgenMsgView
+
 #endif // _MGEN_MESSAGE
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>    // for rand(), RAND_MAX
 #include <math.h>      // for log()
+#include <stdio.h>     // for REPLAY log files
 #ifdef HAVE_PCAP
 #include <pcap.h>      // for CLONE tcpdump files
 #include <limits.h>    // for CLONE file size
@@ -29,12 +30,12 @@ class MgenPattern
         MgenPattern();
         ~MgenPattern();
 #ifdef HAVE_PCAP	
-        enum Type {INVALID_TYPE, PERIODIC, POISSON, BURST, JITTER, CLONE};
+        enum Type {INVALID_TYPE, PERIODIC, POISSON, BURST, JITTER, REPLAY, RAMP, ADAPTIVE, BUCKET, CLONE};
 	enum FileType {INVALID_FILETYPE, TCPDUMP};
 	static const StringMapper CLONE_FILE_LIST[];
 	static FileType GetFileTypeFromString(const char* string);
 #else
-        enum Type {INVALID_TYPE, PERIODIC, POISSON, BURST, JITTER};    
+        enum Type {INVALID_TYPE, PERIODIC, POISSON, BURST, JITTER, REPLAY, RAMP, ADAPTIVE, BUCKET};    
 #endif
     static Type GetTypeFromString(const char* string);
 
@@ -47,6 +48,17 @@ class MgenPattern
 	MgenPattern::Type GetType() { return type;};
 	bool UnlimitedRate() {return unlimitedRate;}
     bool FlowPaused() {return flowPaused;}
+    
+    // Receiver feedback (e.g. from analytic REPORT payloads) for feedback
+    // driven patterns.  Returns "true" when the pattern rate was reevaluated.
+    bool OnFeedback(double theTime, double lossFraction, double latencyAve, double windowSize);
+    double GetRate() const 
+        {return (interval_ave > 0.0) ? (1.0 / interval_ave) : 0.0;}
+    double GetPktSizeAve() const
+        {return (0.5 * (double)(pkt_size_min + pkt_size_max));}
+    double GetBitRate() const {return (8.0 * bucket_rate);}  // BUCKET target
+    bool RampDone() const {return ramp_done;}
+    bool RampPassed() const {return ramp_passed;}
 #ifdef HAVE_PCAP
 	bool ReadingPcapFile() {return pcap_device;}
 #endif
@@ -58,6 +70,9 @@ class MgenPattern
         enum Duration {INVALID_DURATION, FIXED, EXPONENTIAL};  
         static const StringMapper DURATION_LIST[];   
         static Duration GetDurationTypeFromString(const char* string);
+        enum Adapt {INVALID_ADAPT, AIMD, LATENCY};
+        static const StringMapper ADAPT_LIST[];
+        static Adapt GetAdaptTypeFromString(const char* string);
         
         static double UniformRand(double min, double max)
         {
@@ -75,6 +90,14 @@ class MgenPattern
 //           return (-(log(1.0 - ( ((double)rand())/((double)RAND_MAX)) )) * mean);
              return(-log(((double)rand())/((double)RAND_MAX))*mean);
         }
+        bool InitSizeFromString(const char* sizeText, Protocol protocol);
+        // REPLAY pattern helpers (the log file is streamed one record at a time)
+        bool OpenReplayFile();
+        bool ReadReplayRecord(double& txTime, unsigned int& msgSize);
+        bool ReadReplayTextRecord(double& txTime, unsigned int& msgSize);
+        bool ReadReplayBinaryRecord(double& txTime, unsigned int& msgSize);
+        void SetReplaySize(unsigned int msgSize);
+        static bool ParseLogTime(const char* text, double& theTime);
 #ifdef HAVE_PCAP	
         double RestartPcapRead(double &prevTime);
         bool OpenPcapDevice();
@@ -91,10 +114,46 @@ class MgenPattern
         Duration        burst_duration_type;
         double          burst_duration_ave;
         double          burst_duration;
-        struct timeval  last_time;
+        struct timeval  last_time;  // BURST and BUCKET timing
 	    bool            unlimitedRate;
         bool            flowPaused;
 
+        // REPLAY pattern state
+        enum {REPLAY_NAME_MAX = 256};
+        char            replay_fname[REPLAY_NAME_MAX];
+        FILE*           replay_file;
+        bool            replay_binary;  // binary vs. text MGEN log
+        unsigned long   replay_flow;    // flow id whose records are replayed
+        LogEventType    replay_event;   // SEND or RECV, locked to first match
+        int             replay_repeat;
+        double          replay_prev_time;
+        double          replay_first_gap;
+        unsigned int    replay_size_min;
+        unsigned int    replay_size_max;
+
+        // Feedback driven (RAMP and ADAPTIVE) pattern state (rates in messages/sec)
+        double          feedback_rate_min;
+        double          feedback_rate_max;
+        double          feedback_time;     // time of last rate change (< 0.0 if none)
+        double          ramp_loss_max;
+        double          ramp_latency_max;  // 0.0 ignores latency
+        double          ramp_tolerance;    // search resolution (fraction of rate)
+        double          ramp_rate_good;    // highest rate that passed
+        double          ramp_rate_bad;     // lowest rate that failed (< 0.0 if none)
+        bool            ramp_passed;
+        bool            ramp_done;
+        Adapt           adapt_type;
+        double          adapt_loss_max;    // AIMD loss threshold
+        double          adapt_increase;    // AIMD additive increase (messages/sec)
+        double          adapt_decrease;    // AIMD multiplicative decrease factor
+        double          adapt_latency;     // LATENCY target (seconds)
+        double          adapt_gain;        // LATENCY controller gain
+
+        // BUCKET (token bucket) pattern state
+        double          bucket_rate;    // bytes/sec
+        double          bucket_depth;   // bytes
+        double          bucket_tokens;  // bytes (negative while in debt)
+
 #ifdef HAVE_PCAP
         pcap_t*         pcap_device;
         FileType        file_type; // clone file type
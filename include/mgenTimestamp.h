@@ -0,0 +1,60 @@
+#ifndef _MGEN_TIMESTAMP
+#define _MGEN_TIMESTAMP
+
+#ifdef WIN32
+#include <winsock2.h>   // for struct timeval
+#else
+#include <sys/time.h>   // for struct timeval
+#endif // if/else WIN32
+#include <time.h>
+
+/**
+ * @class MgenTimestampFormatter
+ *
+ * @brief Writes MGEN log timestamps ("<hh>:<mm>:<ss>.<usec> " or the epoch
+ * "<sec>.<usec> " format, each with a trailing space) straight into a
+ * caller's buffer.  The text for the current second is cached so most
+ * timestamps only need their microseconds filled in, avoiding the
+ * gmtime()/localtime() and printf() calls per timestamp.  The output is
+ * byte-identical to the printf() formats used by Mgen::LogTimestamp.
+ * The buffer is not NULL terminated.  An instance is not thread-safe,
+ * so each thread that formats timestamps needs its own.
+ */
+class MgenTimestampFormatter
+{
+    public:
+        MgenTimestampFormatter();
+
+        enum {MAX_LENGTH = 48};  // worst case Format() length
+
+        // Returns the number of bytes written
+        unsigned int Format(char* buffer, const struct timeval& theTime,
+                            bool localTime, bool epochTime)
+        {
+            return (epochTime ? FormatEpoch(buffer, theTime) :
+                                FormatLegacy(buffer, theTime, localTime));
+        }
+        // "%02d:%02d:%02d.%06lu " of the gmtime() or localtime() fields
+        unsigned int FormatLegacy(char* buffer, const struct timeval& theTime, bool localTime);
+        // "%lu.%06lu "
+        unsigned int FormatEpoch(char* buffer, const struct timeval& theTime);
+
+    private:
+        void UpdateLegacy(time_t secs, bool localTime);
+        void UpdateEpoch(time_t secs);
+        static unsigned int FormatUsec(char* buffer, unsigned long usec);
+
+        // Cached "<hh>:<mm>:<ss>." text for legacy_sec
+        bool            legacy_valid;
+        bool            legacy_local;
+        time_t          legacy_sec;
+        char            legacy_text[9];
+
+        // Cached "<sec>." text for epoch_sec
+        bool            epoch_valid;
+        time_t          epoch_sec;
+        unsigned int    epoch_len;
+        char            epoch_text[24];
+};  // end class MgenTimestampFormatter
+
+#endif // _MGEN_TIMESTAMP
@@ -5,12 +5,20 @@
 #include "mgenGlobals.h"
 #include "mgenMsg.h"
 #include "mgenEvent.h"
+#ifdef HAVE_SO_REUSEPORT
+#ifndef HAVE_RECVMMSG
+#error "HAVE_SO_REUSEPORT (RXSHARDS) requires HAVE_RECVMMSG"
+#endif // !HAVE_RECVMMSG
+#include "mgenAnalytic.h"
+#include <pthread.h>
+#endif // HAVE_SO_REUSEPORT
 
 class MgenController;
 class MgenFlowList;
 class MgenFlow;
 class Mgen;
 class MgenTransport;
+class MgenRxShard;
 /**
  * @class MgenTransportList
  *
@@ -91,6 +99,8 @@ class MgenTransport
 #ifdef HAVE_IPV6	  
     virtual void SetFlowLabel(UINT32 label) {;}
 #endif //HAVE_IPV6
+    // Logs per-flow counters kept outside of Mgen::flow_counters (e.g. rx shards)
+    virtual void LogCounters(FILE* filePtr, const struct timeval& theTime) {;}
 
     // virtual functions
     virtual bool Open(ProtoAddress::Type addrType, bool bindOnOpen) = 0;
@@ -261,6 +271,63 @@ class MgenSocketTransport : public MgenTransport
     
 }; // end class MgenTransport::MgenSocketTransport
 
+#ifdef HAVE_RECVMMSG
+/**
+ * @class MgenRxBatch
+ *
+ * @brief recvmmsg() receive buffers for a UDP socket.  Recv() pulls a
+ * batch of datagrams and each one's source address, kernel receive time
+ * (RXTIMESTAMP) and UDP_GRO segment size (RXGRO) are then read from the
+ * batch.  Used by MgenUdpTransport::RecvBatch() and by the MgenRxShard
+ * threads.
+ */
+class MgenRxBatch
+{
+  public:
+    MgenRxBatch();
+    ~MgenRxBatch();
+    
+    enum {BATCH_MAX = 64};
+    
+    // (Re)allocates "batchSize" (up to BATCH_MAX) buffers of "slotSize"
+    // bytes unless the current ones already match
+    bool Init(unsigned int batchSize, unsigned int slotSize);
+    // Receives up to "count" datagrams (with control messages if
+    // "control"), returns the number received (0 once drained)
+    unsigned int Recv(int fd, unsigned int count, bool control);
+    
+    unsigned int GetBatchSize() const {return batch_size;}
+    UINT32* GetBuffer(unsigned int index) const
+        {return (buffer + index*(slot_size/4));}
+    unsigned int GetLength(unsigned int index) const;
+    const struct sockaddr_storage& GetSockAddr(unsigned int index) const;
+    void GetSrcAddr(unsigned int index, ProtoAddress& srcAddr) const;
+#ifdef SO_TIMESTAMPNS
+    // "rxTime" is left as is if there is no kernel timestamp
+    bool GetRxTime(unsigned int index, struct timeval& rxTime) const;
+#endif // SO_TIMESTAMPNS
+#ifdef HAVE_UDP_GRO
+    unsigned int GetSegmentSize(unsigned int index) const;
+#endif // HAVE_UDP_GRO
+#ifdef HAVE_SO_REUSEPORT
+    // "true" for a broadcast or multicast destination (needs IP_PKTINFO)
+    bool IsGroupDelivery(unsigned int index) const;
+#endif // HAVE_SO_REUSEPORT
+    
+  private:
+    enum {CONTROL_SIZE = 256};  // per datagram (timestamp, GRO size, pktinfo)
+    void Destroy();
+    
+    UINT32*                     buffer;         // batch_size buffers of slot_size bytes
+    unsigned int                batch_size;
+    unsigned int                slot_size;
+    struct mmsghdr*             msg_vector;
+    struct iovec*               iov_vector;
+    struct sockaddr_storage*    addr_vector;
+    char*                       control_buffer; // CONTROL_SIZE bytes per datagram
+};  // end class MgenRxBatch
+#endif // HAVE_RECVMMSG
+
 /**
  * @class MgenUdpTransport
  *
@@ -268,6 +335,9 @@ class MgenSocketTransport : public MgenTransport
  */
 class MgenUdpTransport : public MgenSocketTransport
 {
+#ifdef HAVE_SO_REUSEPORT
+    friend class MgenRxShard;
+#endif // HAVE_SO_REUSEPORT
   public:
     MgenUdpTransport(Mgen& mgen,Protocol theProtocol, UINT16 thePort);
     MgenUdpTransport(Mgen& mgen,Protocol theProtocol, UINT16 thePort, const ProtoAddress& theDstAddress);
@@ -281,8 +351,17 @@ class MgenUdpTransport : public MgenSocketTransport
     bool LeaveGroup(const ProtoAddress& theAddress, 
 		    const ProtoAddress& sourceAddress,
                     const char* interfaceName = NULL);
+    void Close();
     MessageStatus SendMessage(MgenMsg& theMsg,const ProtoAddress& dstAddr);
     bool Listen(UINT16 port,ProtoAddress::Type addrType, bool bindOnOpen);
+#ifdef HAVE_SO_REUSEPORT
+    void LogCounters(FILE* filePtr, const struct timeval& theTime);
+#endif // HAVE_SO_REUSEPORT
+#ifdef HAVE_SO_TIMESTAMPING
+    // Input notification also reads the transmit timestamp error
+    // queue, so it stays on while TXTIMESTAMP is enabled
+    void StopInputNotification();
+#endif // HAVE_SO_TIMESTAMPING
     
     unsigned int GroupCount() {return group_count;}
 
@@ -306,10 +385,177 @@ class MgenUdpTransport : public MgenSocketTransport
       }
 
   private:	  
+    // "updateStats" is false for messages an MgenRxShard has already
+    // counted and added to its analytics
+    void HandleRecvMessage(UINT32*               alignedBuffer, 
+                           unsigned int          len, 
+                           const ProtoAddress&   srcAddr, 
+                           const struct timeval& currentTime,
+                           bool                  updateStats = true);
+#ifdef SO_TIMESTAMPNS
+    bool EnableRxTimestamp();
+    void RecvControl(ProtoSocket& theSocket);
+#endif // SO_TIMESTAMPNS
+#ifdef HAVE_UDP_GRO
+    enum {RX_GRO_MAX = 65536};        // largest coalesced receive
+    bool EnableRxGro();
+    void HandleRecvSegments(UINT32*               alignedBuffer, 
+                            unsigned int          len, 
+                            unsigned int          segSize,
+                            const ProtoAddress&   srcAddr, 
+                            const struct timeval& currentTime);
+    static UINT32* NextSegment(UINT32*       alignedBuffer, 
+                               unsigned int  len, 
+                               unsigned int  segSize,
+                               unsigned int& offset,
+                               unsigned int& segLen,
+                               UINT32*       segBuffer);
+    UINT32*         rx_gro_buffer;    // RX_GRO_MAX buffer for RecvControl()
+#endif // HAVE_UDP_GRO
+#ifdef HAVE_RECVMMSG
+    void RecvBatch(ProtoSocket& theSocket);
+    MgenRxBatch     rx_batch;
+#endif // HAVE_RECVMMSG
+#ifdef HAVE_SO_TIMESTAMPING
+    // SEND events awaiting their kernel transmit timestamp 
+    // are held in a ring indexed by the socket's tx counter
+    enum {TX_STAMP_MAX = 256, TX_STAMP_COPY = 256, TX_DELAY_BINS = 24};
+    struct TxStamp
+    {
+        UINT32          id;
+        MgenMsg         msg;
+        struct timeval  app_time;         // time stamped by MgenFlow
+        UINT32          buffer[TX_STAMP_COPY/4];
+    };
+    bool EnableTxTimestamp();
+    void QueueTxStamp(MgenMsg& theMsg, const UINT32* txBuffer, unsigned int len);
+    void RecvTxTimestamps();
+    void LogTxStamp(TxStamp& txStamp, const struct timeval* kernelTime);
+    void FlushTxStamps();
+    TxStamp*        tx_stamp_ring;
+    unsigned int    tx_stamp_head;
+    unsigned int    tx_stamp_count;
+    UINT32          tx_stamp_id;      // id of the next datagram sent
+    bool            tx_timestamp;     // kernel SO_TIMESTAMPING enabled
+    unsigned long   tx_delay_count;   // in-host send delay statistics
+    double          tx_delay_sum;
+    double          tx_delay_min;
+    double          tx_delay_max;
+    unsigned long   tx_delay_hist[TX_DELAY_BINS];  // log2(usec) bins
+#endif // HAVE_SO_TIMESTAMPING
+#ifdef HAVE_SO_REUSEPORT
+    bool StartShards(UINT16 port, ProtoAddress::Type addrType);
+    void StopShards();
+    bool OnShardTimeout(ProtoTimer& theTimer);
+    MgenRxShard**   rx_shard_list;    // worker shards (the transport socket is shard 0)
+    unsigned int    rx_shard_count;
+    ProtoTimer      rx_shard_timer;   // drains shard queues on the main thread
+#endif // HAVE_SO_REUSEPORT
+    bool            rx_timestamp;     // kernel SO_TIMESTAMPNS enabled
+    bool            rx_gro;           // kernel UDP_GRO enabled
     unsigned int    group_count;	  
     bool            connect;
 }; // end class MgenUdpTransport
 
+#ifdef HAVE_SO_REUSEPORT
+/**
+ * @class MgenRxShard
+ *
+ * @brief One extra SO_REUSEPORT UDP receive socket serviced by its own
+ * thread.  The thread does the (batched) receive system calls, header
+ * validation, checksums, COUNTERS and analytics for the flows the kernel
+ * hashes to the shard.  Received messages that need logging or full 
+ * processing are queued and handed to the owning MgenUdpTransport on the
+ * main thread by Drain(), so log output and Mgen state stay 
+ * single-threaded.  The thread never reads Mgen state: Drain() refreshes
+ * the shard's copy of the receive options.
+ */
+class MgenRxShard
+{
+  public:
+    MgenRxShard(MgenUdpTransport& theTransport, unsigned int theIndex);
+    ~MgenRxShard();
+    
+    // Binds to the transport socket's address (and device)
+    bool Open(unsigned int rxBufferSize);
+    bool Start(int cpu);  // cpu < 0 leaves the thread unpinned
+    void Stop();          // joins thread, closes socket and does final Drain()
+    void Drain();         // main thread only
+    void LogSummary(FILE* logFile, const struct timeval& theTime);
+    void LogCounters(FILE* filePtr, const struct timeval& theTime);
+    
+    unsigned long GetRxCount() const {return rx_count;}
+    unsigned long GetRxBytes() const {return rx_bytes;}
+    unsigned long GetDropCount() const {return drop_count;}
+    
+  private:
+    enum RecordType {RECORD_LOG, RECORD_FULL};
+    enum {QUEUE_INIT = 65536, QUEUE_MAX = 8*1024*1024, REPORT_MAX = 256};
+    // Queued message record header (followed by message, padded to 8 bytes)
+    struct Record
+    {
+        UINT16                  len;
+        UINT8                   type;
+        struct timeval          rx_time;
+        struct sockaddr_storage src_addr;
+    };
+    // Receive options copied from Mgen on the main thread
+    struct Config
+    {
+        bool            logging;
+        bool            analytics;
+        bool            counters;
+        bool            checksum_force;
+        unsigned int    rx_batch;
+        double          analytic_window;
+        UINT32          analytic_history;
+        bool            reorder;
+    };
+    
+    static void* ThreadMain(void* arg);
+    void Run();
+    void Configure();
+    void OnRecv(UINT32* alignedBuffer, unsigned int len, 
+                const struct sockaddr_storage& srcAddr, 
+                const struct timeval& rxTime);
+    void UpdateAnalytic(const MgenMsgView& msgView, 
+                        const ProtoAddress& srcAddr, 
+                        const struct timeval& rxTime);
+    void Enqueue(RecordType type, const UINT32* alignedBuffer, unsigned int len,
+                 const struct sockaddr_storage& srcAddr, const struct timeval& rxTime);
+    
+    MgenUdpTransport&   transport;
+    Mgen&               mgen;
+    unsigned int        index;
+    int                 cpu;
+    int                 sock_fd;
+    bool                rx_timestamp;      // kernel SO_TIMESTAMPNS enabled
+    bool                rx_gro;            // kernel UDP_GRO enabled
+    MgenRxBatch         rx_batch;          // shard thread only
+    pthread_t           thread;
+    bool                thread_started;
+    bool                stop;              // protected by "lock"
+    Config              config;            // protected by "lock"
+    pthread_mutex_t     lock;
+    
+    // Records queued by the shard thread (fill) and processed by Drain()
+    char*               fill_buffer;
+    unsigned int        fill_len;
+    unsigned int        fill_size;
+    char*               drain_buffer;
+    unsigned int        drain_size;
+    
+    MgenAnalyticTable   analytic_table;    // flows received on this shard
+    MgenAnalytic*       report_list[REPORT_MAX];  // updated since last Drain()
+    unsigned int        report_count;
+    MgenFlowCounters    flow_counters;     // COUNTERS option state for this shard
+    
+    unsigned long       rx_count;
+    unsigned long       rx_bytes;
+    unsigned long       drop_count;        // queue overflow
+};  // end class MgenRxShard
+#endif // HAVE_SO_REUSEPORT
+
 /**
  * @class MgenTcpTransport
  *
@@ -358,6 +604,10 @@ class MgenTcpTransport : public MgenSocketTransport
     void CopyMsgBuffer(unsigned int numBytes,unsigned int bufferIndex,const char* buffer);
     void CalcRxChecksum(const char* buffer,unsigned int bufferIndex,unsigned int numBytes);
     void CalcTxChecksum(); 
+    // Large ring buffer receive path (TCPRXRING)
+    bool RecvRing(ProtoSocket& theSocket);
+    bool ParseRing(const struct timeval& currentTime);
+    void HandleRingMessage(unsigned int offset, UINT16 msgLen, const struct timeval& currentTime);
     bool IsTransmitting() 
     {
 	    if (tx_msg.GetMsgLen()) 
@@ -403,6 +653,14 @@ private:
     UINT16                  rx_msg_index;
     UINT32                  rx_checksum;
 
+    // Messages are parsed in place from rx_ring and only copied into 
+    // rx_msg_buffer for unpacking when they wrap or are misaligned
+    enum {RX_RING_MIN = 131072};  // must exceed MAX_FRAG_SIZE
+    UINT32*                 rx_ring;
+    unsigned int            rx_ring_size;   // bytes, power of 2
+    unsigned int            rx_ring_head;   // next message to parse (free running)
+    unsigned int            rx_ring_tail;   // next byte to receive (free running)
+
     int                     retry_count;
     unsigned int            retry_delay;
 }; // end class MgenTcpTransport
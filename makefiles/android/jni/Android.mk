@@ -16,13 +16,21 @@ LOCAL_EXPORT_CFLAGS := $(LOCAL_CFLAGS)
 LOCAL_SRC_FILES := \
 	../../../src/common/mgen.cpp \
 	../../../src/common/mgenAnalytic.cpp \
+	../../../src/common/mgenBinaryLog.cpp \
+	../../../src/common/mgenLogFormat.cpp \
+	../../../src/common/mgenLogConvert.cpp \
+	../../../src/common/mgenLogStream.cpp \
+	../../../src/common/mgenLogSampler.cpp \
+	../../../src/common/mgenFlightRecorder.cpp \
 	../../../src/common/mgenEvent.cpp \
 	../../../src/common/mgenFlow.cpp \
+	../../../src/common/mgenLogPipe.cpp \
 	../../../src/common/mgenMsg.cpp \
 	../../../src/common/mgenTransport.cpp \
 	../../../src/common/mgenPattern.cpp \
 	../../../src/common/mgenPayload.cpp \
 	../../../src/common/mgenSequencer.cpp \
+	../../../src/common/mgenTimestamp.cpp \
 	../../../src/common/mgenAppSinkTransport.cpp \
 	../../../src/common/mgenApp.cpp
 include $(BUILD_EXECUTABLE)
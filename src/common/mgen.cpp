@@ -3,6 +3,7 @@
 #include "mgenMsg.h"
 #include "mgenVersion.h"
 #include "mgenEvent.h"
+#include "mgenTimestamp.h"
 #include "protoString.h"  // for ProtoTokenator
 
 #include <string.h>
@@ -52,35 +53,47 @@ void Mgen::SetEpochTimestamp(bool enable)
     }
 }
 
-void Mgen::LogEpochTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime)
+// Timestamps are formatted (main thread only) with a formatter that
+// caches the text of the current second
+static MgenTimestampFormatter log_timestamp_formatter;
+
+void Mgen::LogText(FILE* filePtr, const char* text, unsigned int len)
 {
-    Mgen::Log(filePtr, "%lu.%06lu ", theTime.tv_sec, theTime.tv_usec);
-}
+    if (Log == (LogFunction)fprintf)
+        fwrite(text, 1, len, filePtr);
+    else
+        Log(filePtr, "%.*s", (int)len, text);
+}  // end Mgen::LogText()
 
-void Mgen::LogLegacyTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime)
+void Mgen::LogEncoded(FILE* filePtr, MgenLogEncoder& encoder)
 {
-#ifdef _WIN32_WCE
-    struct tm timeStruct;
-    timeStruct.tm_hour = theTime.tv_sec / 3600;
-    UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-    timeStruct.tm_min = (theTime.tv_sec - hourSecs) / 60;
-    timeStruct.tm_sec = theTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-    timeStruct.tm_hour = timeStruct.tm_hour % 24;
-    struct tm* timePtr = &timeStruct;
-#else
-    struct tm* timePtr;
-    time_t secs = theTime.tv_sec;
+    // Lines with user data may need more than the stack buffer
+    char buffer[4096];
+    unsigned int maxLen = encoder.GetMaxLength();
+    char* line = (maxLen <= sizeof(buffer)) ? buffer : new char[maxLen];
+    if (NULL == line)
+    {
+        PLOG(PL_ERROR, "Mgen::LogEncoded() new line error: %s\n", GetErrorString());
+        return;
+    }
+    unsigned int len = encoder.Finish(line);
+    LogText(filePtr, line, len);
+    if (line != buffer) delete[] line;
+}  // end Mgen::LogEncoded()
 
-    if (localTime)
-        timePtr = localtime((time_t*)&secs);
-    else
-        timePtr = gmtime((time_t*)&secs);
+void Mgen::LogEpochTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime)
+{
+    char buffer[MgenTimestampFormatter::MAX_LENGTH];
+    unsigned int len = log_timestamp_formatter.FormatEpoch(buffer, theTime);
+    LogText(filePtr, buffer, len);
+}  // end Mgen::LogEpochTimestamp()
 
-#endif // if/else _WIN32_WCE
-     Mgen::Log(filePtr, "%02d:%02d:%02d.%06lu ",
-                  timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                  (UINT32)theTime.tv_usec);
-}  // end Mgen::LogTimeStamp()
+void Mgen::LogLegacyTimestamp(FILE* filePtr, const struct timeval& theTime, bool localTime)
+{
+    char buffer[MgenTimestampFormatter::MAX_LENGTH];
+    unsigned int len = log_timestamp_formatter.FormatLegacy(buffer, theTime, localTime);
+    LogText(filePtr, buffer, len);
+}  // end Mgen::LogLegacyTimestamp()
 
 
 Mgen::Mgen(ProtoTimerMgr&         timerMgr,
@@ -109,12 +122,16 @@ Mgen::Mgen(ProtoTimerMgr&         timerMgr,
   default_retry_count_lock(false), default_retry_delay_lock(false),
   sink_non_blocking(true),
   log_data(true), log_gps_data(true),
-  checksum_enable(false), 
+  checksum_enable(false), rx_batch(1), rx_timestamp(false), tx_timestamp(false), rx_gro(false), tcp_rx_ring(0), rx_shards(1), rx_shard_cpu(-1),
+  counters_enable(false), counters_interval(0.0), log_pipe_size(0), log_pipe_latency(100),
   addr_type(ProtoAddress::IPv4), 
-  analytic_window(MgenAnalytic::DEFAULT_WINDOW),
+  analytic_window(MgenAnalytic::DEFAULT_WINDOW), reorder_window(0),
   compute_analytics(false), report_analytics(false),
   get_position(NULL), get_position_data(NULL),
-  log_file(NULL), log_binary(false), local_time(false), log_flush(false), 
+  log_file(NULL), log_binary(false), log_binary_v3(false), log_compress(0),
+  log_rotate_bytes(0), log_rotate_interval(0), log_stream(NULL),
+  log_encoding(MgenLogEncoder::TEXT),
+  local_time(false), log_flush(false), 
   log_file_lock(false), log_tx(false), log_rx(true), log_open(false), log_empty(true),
   reuse(true)
 
@@ -127,6 +144,10 @@ Mgen::Mgen(ProtoTimerMgr&         timerMgr,
     drec_event_timer.SetInterval(0.0);
     drec_event_timer.SetRepeat(-1);
 
+    counters_timer.SetListener(this, &Mgen::OnCountersTimeout);
+    counters_timer.SetInterval(0.0);
+    counters_timer.SetRepeat(-1);
+
     default_interface[0] = '\0';
     sink_path[0] = '\0';
     source_path[0] = '\0';
@@ -159,6 +180,12 @@ bool Mgen::Start()
         PLOG(PL_ERROR, "Mgen::Start() error: unable to initialize flow_status (out of memory?)\n");
         return false;
     }
+    StartLogPipe();
+    if (counters_enable && (counters_interval > 0.0) && !counters_timer.IsActive())
+    {
+        counters_timer.SetInterval(counters_interval);
+        timer_mgr.ActivateTimer(counters_timer);
+    }
                 
     if (start_sec < 0.0)
     {
@@ -166,7 +193,13 @@ bool Mgen::Start()
         if (log_file)
         {
             // Log START event
-            if (log_binary)
+            MgenBinaryLog* binaryLog = MgenBinaryLog::GetActive(log_file);
+            if (NULL != binaryLog)
+            {
+                MgenBinaryLog::Record record(START_EVENT, currentTime);
+                binaryLog->WriteEvent(record);
+            }
+            else if (log_binary)
             {
                 char buffer[128];
                 if (log_empty)
@@ -198,6 +231,21 @@ bool Mgen::Start()
                   DMSG(0, "Mgen::Start() fwrite() error: %s\n", GetErrorString());   
                 }
             }
+            else if (MgenLogEncoder::TEXT != log_encoding)
+            {
+                // (rotated logs get the CSV header from the MgenLogStream)
+                bool rotated = (NULL != log_stream) && 
+                               ((0 != log_rotate_bytes) || (0 != log_rotate_interval));
+                if (log_empty && !rotated && (MgenLogEncoder::CSV == log_encoding))
+                {
+                    char header[MgenLogEncoder::HEADER_MAX];
+                    LogText(log_file, header, MgenLogEncoder::FormatHeader(header));
+                }
+                MgenLogEncoder encoder(log_encoding);
+                encoder.Begin(START_EVENT, currentTime);
+                encoder.SetString(MgenLogEncoder::COL_VERSION, MGEN_VERSION);
+                LogEncoded(log_file, encoder);
+            }
             else
             {
 
@@ -572,12 +620,20 @@ void Mgen::Stop()
 {
     if (started)
     {
+        // Final per-flow counters (while transports still exist)
+        if (counters_enable) DumpCounters();
         if (NULL != log_file) 
         {
             // Log STOP event
             struct timeval currentTime;
             ProtoSystemTime(currentTime);
-            if (log_binary)
+            MgenBinaryLog* binaryLog = MgenBinaryLog::GetActive(log_file);
+            if (NULL != binaryLog)
+            {
+                MgenBinaryLog::Record record(STOP_EVENT, currentTime);
+                binaryLog->WriteEvent(record);
+            }
+            else if (log_binary)
             {
                     unsigned int index = 0;
                     char buffer[128];
@@ -599,6 +655,12 @@ void Mgen::Stop()
                     if (fwrite(buffer, sizeof(char), index, log_file) < index)
                         DMSG(0, "Mgen::Stop() fwrite error: %s\n", GetErrorString());
             }
+            else if (MgenLogEncoder::TEXT != log_encoding)
+            {
+                MgenLogEncoder encoder(log_encoding);
+                encoder.Begin(STOP_EVENT, currentTime);
+                LogEncoded(log_file, encoder);
+            }
             else
             {
                 Mgen::LogTimestamp(log_file, currentTime, local_time);
@@ -625,9 +687,10 @@ void Mgen::Stop()
         started = false;
     } // end if (started)
 
-    
+    StopLogPipe();
     if (NULL != log_file)
     {
+        if (binary_log.IsOpen()) binary_log.Close();
         fflush(log_file);
         if ((log_file != stdout) && (stderr != log_file))
         {
@@ -635,11 +698,19 @@ void Mgen::Stop()
             log_file = NULL;   
         }
     }
+    if (NULL != log_stream)
+    {
+        log_stream->Close();
+        delete log_stream;
+        log_stream = NULL;
+    }
     
 
     if (start_timer.IsActive()) start_timer.Deactivate();
     flow_list.Destroy();
     if (drec_event_timer.IsActive()) drec_event_timer.Deactivate();
+    if (counters_timer.IsActive()) counters_timer.Deactivate();
+    flow_counters.Destroy();
     drec_event_list.Destroy();
     drec_group_list.Destroy(*this);
     transport_list.Destroy();
@@ -669,6 +740,25 @@ void Mgen::ProcessFlowCommand(MgenFlowCommand::Status status, UINT32 flowId)
     }
 }  // Mgen::ProcessFlowCommand()
 
+// Received (remote) analytic reports are passed to the controller (if any)
+// and fed back to the matching local flow so feedback driven patterns
+// can adjust their rate.
+void Mgen::ProcessRecvReport(const ProtoTime&             theTime,
+                             const MgenAnalytic::Report&  report,
+                             const ProtoAddress&          senderAddr,
+                             const ProtoTime&             sentTime)
+{
+    if (NULL != controller)
+        controller->OnRecvReport(theTime, report, senderAddr, sentTime);
+    UINT32 flowId = report.GetFlowId();
+    if (0 == flowId) flowId = 1;  // null flowId means flow 1 by default
+    MgenFlow* flow = flow_list.FindFlowById(flowId);
+    if (NULL == flow) return;
+    ProtoAddress dstAddr;
+    if (report.GetDstAddr(dstAddr) && dstAddr.IsEqual(flow->GetDstAddr()))
+        flow->OnRecvReport(theTime, report);
+}  // end Mgen::ProcessRecvReport()
+
 bool Mgen::OnStartTimeout(ProtoTimer& /*theTimer*/)
 {
     start_sec = -1.0;
@@ -699,6 +789,68 @@ bool Mgen::OnDrecEventTimeout(ProtoTimer& /*theTimer*/)
     }
 }  // end Mgen::OnDrecEventTimeout()
 
+void Mgen::SetCounters(double interval)
+{
+    counters_enable = true;
+    counters_interval = interval;
+    if (counters_timer.IsActive()) counters_timer.Deactivate();
+    if (started && (interval > 0.0))
+    {
+        counters_timer.SetInterval(interval);
+        timer_mgr.ActivateTimer(counters_timer);
+    }
+}  // end Mgen::SetCounters()
+
+bool Mgen::OnCountersTimeout(ProtoTimer& /*theTimer*/)
+{
+    DumpCounters();
+    return true;
+}  // end Mgen::OnCountersTimeout()
+
+void Mgen::DumpCounters()
+{
+    // Counters are text records, so they go to stdout when logging is binary
+    // (and to stderr when it's JSON or CSV)
+    FILE* filePtr = ((NULL != log_file) && !log_binary) ? MgenLogEncoder::GetTextFile(log_file) : stdout;
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    flow_counters.Log(filePtr, currentTime, local_time);
+    MgenTransport* next = transport_list.head;
+    while (NULL != next)
+    {
+        next->LogCounters(filePtr, currentTime);
+        next = next->next;
+    }
+    fflush(filePtr);
+}  // end Mgen::DumpCounters()
+
+void Mgen::SetLogPipe(unsigned int ringSize, unsigned int latency)
+{
+    log_pipe_size = ringSize;
+    log_pipe_latency = latency;
+    if (started) StartLogPipe();  // (re)start with new size
+}  // end Mgen::SetLogPipe()
+
+// The log pipe is only used for text logs
+void Mgen::StartLogPipe()
+{
+#ifdef HAVE_PTHREAD
+    StopLogPipe();
+    if ((0 != log_pipe_size) && (NULL != log_file) && !log_binary)
+    {
+        if (!log_pipe.Start(log_file, log_pipe_size, local_time, log_flush, log_pipe_latency))
+            DMSG(0, "Mgen::StartLogPipe() error: logging from main thread\n");
+    }
+#endif // HAVE_PTHREAD
+}  // end Mgen::StartLogPipe()
+
+void Mgen::StopLogPipe()
+{
+#ifdef HAVE_PTHREAD
+    log_pipe.Stop();
+#endif // HAVE_PTHREAD
+}  // end Mgen::StopLogPipe()
+
 /**
  * Process JOIN, LEAVE, IGNORE, LISTEN events
  */
@@ -969,13 +1121,70 @@ bool Mgen::OpenLog(const char* path, bool append, bool binary)
         mode = append ? "a" : "w+";
         log_binary = false;
     }
-    FILE* logFile = fopen(path, mode);
-    if (!logFile)
+    if (binary && (MgenLogEncoder::TEXT != log_encoding))
+    {
+        DMSG(0, "Mgen::OpenLog() Error: LOGFORMAT can't be used with binary logs\n");
+        return false;
+    }
+    // (the original binary log format has no field to mark sampled events)
+    if (binary && !log_binary_v3 && log_sampler.IsSampling())
+    {
+        DMSG(0, "Mgen::OpenLog() Error: LOGSAMPLE requires a text or BINARY3 log\n");
+        return false;
+    }
+    MgenLogStream* logStream = NULL;
+    FILE* logFile;
+    if ((0 != log_compress) || (0 != log_rotate_bytes) || (0 != log_rotate_interval))
+    {
+        // (the v3 binary log is updated in place, so can't be streamed)
+        if (binary && log_binary_v3)
+        {
+            DMSG(0, "Mgen::OpenLog() Error: COMPRESS and ROTATE can't be used with BINARY3 logs\n");
+            return false;
+        }
+        if (NULL == (logStream = new MgenLogStream))
+        {
+            DMSG(0, "Mgen::OpenLog() new MgenLogStream error: %s\n", GetErrorString());
+            return false;
+        }
+        logStream->SetCompression(log_compress);
+        logStream->SetRotation(log_rotate_bytes, log_rotate_interval);
+        if (!binary && (MgenLogEncoder::TEXT != log_encoding))
+        {
+            // Rotated JSON parts have no header line, CSV parts the column header
+            char csvHeader[MgenLogEncoder::HEADER_MAX];
+            unsigned int len = 0;
+            if (MgenLogEncoder::CSV == log_encoding)
+                len = MgenLogEncoder::FormatHeader(csvHeader);
+            csvHeader[len] = '\0';
+            if (!logStream->SetHeader(csvHeader))
+            {
+                delete logStream;
+                return false;
+            }
+        }
+        if (NULL == (logFile = logStream->Open(path, append, binary, log_empty)))
+        {
+            delete logStream;
+            return false;
+        }
+    }
+    else if (NULL == (logFile = fopen(path, mode)))
     {
         DMSG(0, "Mgen::OpenLog() fopen() Error: %s\n", GetErrorString());   
         return false;    
     }   
     SetLogFile(logFile);
+    log_stream = logStream;  // (after SetLogFile() closes any previous log)
+    if (binary && log_binary_v3)
+    {
+        if (!binary_log.Open(logFile, path, log_empty))
+        {
+            SetLogFile(NULL);
+            return false;
+        }
+        log_empty = false;  // (the v3 log has its own header)
+    }
     log_open = true;
     return true;
 }  // end Mgen::OpenLog()
@@ -984,6 +1193,9 @@ void Mgen::SetLogFile(FILE* filePtr)
 {
     CloseLog();
     log_file = filePtr;
+    if ((NULL != log_file) && !log_binary)
+        MgenLogEncoder::SetActive(log_file, log_encoding);
+    if (started) StartLogPipe();
 #ifdef _WIN32_WCE
     if ((stdout == log_file) || (stderr == log_file))
         Log = Mgen::LogToDebug;
@@ -995,12 +1207,21 @@ void Mgen::SetLogFile(FILE* filePtr)
 
 void Mgen::CloseLog()
 {
+    StopLogPipe();
+    MgenLogEncoder::SetActive(NULL, MgenLogEncoder::TEXT);
+    if (binary_log.IsOpen()) binary_log.Close();  // writes its trailer
     if (log_file)
     {
         if ((stdout != log_file) && (stderr != log_file))
             fclose(log_file);
         log_file = NULL;
     }
+    if (NULL != log_stream)
+    {
+        log_stream->Close();  // finishes the compressed or rotated file
+        delete log_stream;
+        log_stream = NULL;
+    }
 }  // end Mgen::CloseLog()
 
 
@@ -1031,28 +1252,56 @@ void Mgen::UpdateRecvAnalytics(const ProtoTime& theTime, MgenMsg* theMsg, Protoc
     // here is just a temporary "feature" 
     if (!compute_analytics) return;
     if (NULL == theMsg) return; // TBD - support timeout driven update
-    MgenAnalytic* analytic = analytic_table.FindFlow(theMsg->GetSrcAddr(), theMsg->GetDstAddr(), theMsg->GetFlowId());
+    UpdateFlowAnalytic(theTime, theMsg->GetSrcAddr(), theMsg->GetDstAddr(), theMsg->GetFlowId(),
+                       theMsg->GetMsgLen(), ProtoTime(theMsg->GetTxTime()), theMsg->GetSeqNum(), theProtocol);
+}  // end Mgen::UpdateRecvAnalytics()
+
+void Mgen::UpdateRecvAnalytics(const ProtoTime&    theTime, 
+                               const MgenMsgView&  msgView, 
+                               const ProtoAddress& srcAddr, 
+                               Protocol            theProtocol)
+{
+    if (!compute_analytics) return;
+    ProtoAddress dstAddr;
+    msgView.GetDstAddr(dstAddr);
+    struct timeval txTime;
+    msgView.GetTxTime(txTime);
+    UpdateFlowAnalytic(theTime, srcAddr, dstAddr, msgView.GetFlowId(),
+                       msgView.GetMsgLen(), ProtoTime(txTime), msgView.GetSeqNum(), theProtocol);
+}  // end Mgen::UpdateRecvAnalytics(MgenMsgView)
+
+void Mgen::UpdateFlowAnalytic(const ProtoTime&    theTime, 
+                              const ProtoAddress& srcAddr, 
+                              const ProtoAddress& dstAddr, 
+                              UINT32              flowId,
+                              UINT16              msgLen, 
+                              const ProtoTime&    txTime, 
+                              UINT32              seqNum,
+                              Protocol            theProtocol)
+{
+    MgenAnalytic* analytic = analytic_table.FindFlow(srcAddr, dstAddr, flowId);
     if (NULL == analytic)
     {
         if (NULL == (analytic = new MgenAnalytic()))
         {
-            PLOG(PL_ERROR, "Mgen::UpdateRecvAnalytics() new MgenAnalytic() error: %s\n", GetErrorString());
+            PLOG(PL_ERROR, "Mgen::UpdateFlowAnalytic() new MgenAnalytic() error: %s\n", GetErrorString());
             return;
         }
-        if (!analytic->Init(theProtocol, theMsg->GetSrcAddr(), theMsg->GetDstAddr(), theMsg->GetFlowId(), analytic_window))
+        if (!analytic->Init(theProtocol, srcAddr, dstAddr, flowId, analytic_window,
+                            GetAnalyticHistory(), (0 != reorder_window)))
         {
-            PLOG(PL_ERROR, "Mgen::UpdateRecvAnalytics() MgenAnalytic() initialization error: %s\n", GetErrorString());
+            PLOG(PL_ERROR, "Mgen::UpdateFlowAnalytic() MgenAnalytic() initialization error: %s\n", GetErrorString());
             return;
         }
         if (!analytic_table.Insert(*analytic))
         {
-            PLOG(PL_ERROR, "Mgen::UpdateRecvAnalytics() unable to add new flow analytic: %s\n", GetErrorString());
+            PLOG(PL_ERROR, "Mgen::UpdateFlowAnalytic() unable to add new flow analytic: %s\n", GetErrorString());
             delete analytic;
             return;
         }
     }
     
-    if (analytic->Update(theTime, theMsg->GetMsgLen(), ProtoTime(theMsg->GetTxTime()), theMsg->GetSeqNum()))
+    if (analytic->Update(theTime, msgLen, txTime, seqNum))
     {
         MgenFlow* nextFlow = flow_list.Head();
         while (NULL != nextFlow)
@@ -1067,7 +1316,7 @@ void Mgen::UpdateRecvAnalytics(const ProtoTime& theTime, MgenMsg* theMsg, Protoc
         analytic->Log(log_file, theTime, theTime, local_time);
     }
     
-}  // end Mgen::UpdateRecvAnalytics()
+}  // end Mgen::UpdateFlowAnalytic()
 
 
 /**
@@ -1451,6 +1700,24 @@ const StringMapper Mgen::COMMAND_LIST[] =
     {"+PAUSE",      PAUSE},
     {"+RECONNECT",  RECONNECT},
     {"-EPOCHTIMESTAMP", EPOCH_TIMESTAMP},
+    {"+RXBATCH",    RXBATCH},
+    {"-RXTIMESTAMP", RXTIMESTAMP},
+    {"-TXTIMESTAMP", TXTIMESTAMP},
+    {"+RXSHARDS",   RXSHARDS},
+    {"+COUNTERS",   COUNTERS},
+    {"-DUMPCOUNTERS", DUMPCOUNTERS},
+    {"-RXGRO",      RXGRO},
+    {"+LOGPIPE",    LOGPIPE},
+    {"+TCPRXRING",  TCPRXRING},
+    {"+REORDER",    REORDER},
+    {"-BINARY3",    BINARY3},
+    {"+COMPRESS",   COMPRESS},
+    {"+ROTATE",     ROTATE},
+    {"+LOGSAMPLE",  LOGSAMPLE},
+    {"+LOGFILTER",  LOGFILTER},
+    {"+LOGFORMAT",  LOGFORMAT},
+    {"+RECORDER",   RECORDER},
+    {"+SNAPSHOT",   SNAPSHOT},
     {"+OFF",        INVALID_COMMAND},  // to deconflict "offset" from "off" event
     {NULL,          INVALID_COMMAND}   
 };
@@ -2131,6 +2398,282 @@ bool Mgen::OnCommand(Mgen::Command cmd, const char* arg, bool override)
     case EPOCH_TIMESTAMP:
       SetEpochTimestamp(true);
       break;
+    case RXBATCH:
+    {
+        unsigned int batchCount;
+        if ((NULL == arg) || (1 != sscanf(arg, "%u", &batchCount)) || (0 == batchCount))
+        {
+            DMSG(0, "Mgen::OnCommand() Error: invalid RXBATCH count\n");
+            return false;
+        }
+#ifndef HAVE_RECVMMSG
+        if (batchCount > 1)
+            DMSG(0, "Mgen::OnCommand() Warning: RXBATCH not supported on this system\n");
+#endif // !HAVE_RECVMMSG
+        SetRxBatch(batchCount);
+        break;
+    }
+    case RXTIMESTAMP:
+#ifndef SO_TIMESTAMPNS
+      DMSG(0, "Mgen::OnCommand() Warning: RXTIMESTAMP not supported on this system\n");
+#endif // !SO_TIMESTAMPNS
+      SetRxTimestamp(true);
+      break;
+    case TXTIMESTAMP:
+#ifndef HAVE_SO_TIMESTAMPING
+      DMSG(0, "Mgen::OnCommand() Warning: TXTIMESTAMP not supported on this system\n");
+#endif // !HAVE_SO_TIMESTAMPING
+      SetTxTimestamp(true);
+      break;
+    case RXSHARDS:
+    {
+        // RXSHARDS <count>[/<firstCpu>]
+        unsigned int shardCount = 0;
+        int firstCpu = -1;
+        if ((NULL == arg) || (sscanf(arg, "%u/%d", &shardCount, &firstCpu) < 1) || (0 == shardCount))
+        {
+            DMSG(0, "Mgen::OnCommand() Error: invalid RXSHARDS argument: rxshards <count>[/<firstCpu>]\n");
+            return false;
+        }
+#ifndef HAVE_SO_REUSEPORT
+        if (shardCount > 1)
+            DMSG(0, "Mgen::OnCommand() Warning: RXSHARDS not supported on this system\n");
+#endif // !HAVE_SO_REUSEPORT
+        SetRxShards(shardCount, firstCpu);
+        break;
+    }
+    case COUNTERS:
+    {
+        // COUNTERS <interval>  (0 = dump on demand and at exit only)
+        double interval;
+        if ((NULL == arg) || (1 != sscanf(arg, "%lf", &interval)) || (interval < 0.0))
+        {
+            DMSG(0, "Mgen::OnCommand() Error: invalid COUNTERS interval\n");
+            return false;
+        }
+        SetCounters(interval);
+        break;
+    }
+    case DUMPCOUNTERS:
+      if (counters_enable)
+          DumpCounters();
+      else
+          DMSG(0, "Mgen::OnCommand() Warning: DUMPCOUNTERS without COUNTERS enabled\n");
+      break;
+    case RXGRO:
+#ifndef HAVE_UDP_GRO
+      DMSG(0, "Mgen::OnCommand() Warning: RXGRO not supported on this system\n");
+#endif // !HAVE_UDP_GRO
+      SetRxGro(true);
+      break;
+    case LOGPIPE:
+    {
+        // LOGPIPE <records>[/<latency msec>]
+        unsigned int ringSize;
+        unsigned int latency = 100;
+        if ((NULL == arg) || (sscanf(arg, "%u/%u", &ringSize, &latency) < 1))
+        {
+            DMSG(0, "Mgen::OnCommand() Error: invalid LOGPIPE argument: logpipe <records>[/<latency>]\n");
+            return false;
+        }
+#ifndef HAVE_PTHREAD
+        if (0 != ringSize)
+            DMSG(0, "Mgen::OnCommand() Warning: LOGPIPE not supported on this system\n");
+#endif // !HAVE_PTHREAD
+        SetLogPipe(ringSize, latency);
+        break;
+    }
+    case TCPRXRING:
+    {
+        unsigned int ringBytes;
+        if ((NULL == arg) || (1 != sscanf(arg, "%u", &ringBytes)))
+        {
+            DMSG(0, "Mgen::OnCommand() Error: invalid TCPRXRING size\n");
+            return false;
+        }
+        SetTcpRxRing(ringBytes);
+        break;
+    }
+    case REORDER:
+    {
+        unsigned int depth;
+        if ((NULL == arg) || (1 != sscanf(arg, "%u", &depth)) || (0 == depth))
+        {
+            PLOG(PL_ERROR, "Mgen::OnCommand() Error: invalid REORDER window\n");
+            return false;
+        }
+        // Applies to flows first seen after the command
+        SetReorderWindow(depth);
+        compute_analytics = true;
+        break;
+    }
+    case BINARY3:
+      if (log_open)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: BINARY3 option must precede OUTPUT and LOG commands\n");
+          return false;
+      }
+      log_binary = true;
+      log_binary_v3 = true;
+      break;
+    case COMPRESS:
+    {
+      int level;
+      if ((NULL == arg) || (1 != sscanf(arg, "%d", &level)) || (level < 0) || (level > 9))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid COMPRESS level\n");
+          return false;
+      }
+      if (log_open)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: COMPRESS option must precede OUTPUT and LOG commands\n");
+          return false;
+      }
+      log_compress = level;
+      break;
+    }
+    case ROTATE:
+    {
+      // <size>[k|m|g][/<interval>]
+      double size = 0.0;
+      char units = '\0';
+      unsigned int interval = 0;
+      const char* ptr = (NULL != arg) ? strchr(arg, '/') : NULL;
+      if ((NULL == arg) || (sscanf(arg, "%lf%c", &size, &units) < 1) || (size < 0.0) ||
+          ((NULL != ptr) && (1 != sscanf(ptr + 1, "%u", &interval))))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid ROTATE size/interval\n");
+          return false;
+      }
+      units = tolower(units);
+      if ('k' == units)
+          size *= 1024.0;
+      else if ('m' == units)
+          size *= 1048576.0;
+      else if ('g' == units)
+          size *= 1073741824.0;
+      else if (('\0' != units) && ('/' != units))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid ROTATE size units\n");
+          return false;
+      }
+      if (log_open)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: ROTATE option must precede OUTPUT and LOG commands\n");
+          return false;
+      }
+      log_rotate_bytes = (uint64_t)size;
+      log_rotate_interval = interval;
+      break;
+    }
+    case LOGSAMPLE:
+      // [<flowIds>:]<count>|<sec>s  or  off
+      if (log_open && log_binary && !log_binary_v3)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: LOGSAMPLE requires a text or BINARY3 log\n");
+          return false;
+      }
+      if ((NULL == arg) || !log_sampler.ParseSample(arg))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid LOGSAMPLE argument: logsample [<flowIds>:]<count>|<sec>s\n");
+          return false;
+      }
+      break;
+    case LOGFILTER:
+      // flow:<flowIds> | src:<addr>[/<port>] | dst:<addr>[/<port>] | none
+      if ((NULL == arg) || !log_sampler.ParseFilter(arg))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid LOGFILTER argument\n");
+          return false;
+      }
+      break;
+    case LOGFORMAT:
+    {
+      // text | json | csv
+      MgenLogEncoder::Encoding encoding = 
+          (NULL != arg) ? MgenLogEncoder::GetEncodingFromString(arg) : MgenLogEncoder::INVALID_ENCODING;
+      if (MgenLogEncoder::INVALID_ENCODING == encoding)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: invalid LOGFORMAT argument: logformat text|json|csv\n");
+          return false;
+      }
+      if (log_open)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: LOGFORMAT option must precede OUTPUT and LOG commands\n");
+          return false;
+      }
+      if (log_binary && (MgenLogEncoder::TEXT != encoding))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: LOGFORMAT can't be used with binary logs\n");
+          return false;
+      }
+      log_encoding = encoding;
+      if (NULL != log_file)
+      {
+          // (the default stdout log)
+          MgenLogEncoder::SetActive(log_file, log_encoding);
+          if (started) StartLogPipe();
+      }
+      break;
+    }
+    case RECORDER:
+    {
+      // [<slots>:]<ringFile>  or  off
+      if (NULL == arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing RECORDER argument: recorder [<slots>:]<ringFile>|off\n");
+          return false;
+      }
+      // convert to upper case for case-insensitivity
+      char temp[4];
+      unsigned int i;
+      for (i = 0; (i < 3) && ('\0' != arg[i]); i++)
+          temp[i] = toupper(arg[i]);
+      temp[i] = '\0';
+      if (('\0' == arg[i]) && !strcmp("OFF", temp))
+      {
+          flight_recorder.Close();
+          break;
+      }
+      unsigned int slotCount = MgenFlightRecorder::DEFAULT_SLOTS;
+      const char* path = arg;
+      const char* ptr = arg;
+      while (isdigit(*ptr)) ptr++;
+      if ((ptr != arg) && (':' == *ptr))
+      {
+          if ((1 != sscanf(arg, "%u", &slotCount)) || (0 == slotCount))
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid RECORDER slot count\n");
+              return false;
+          }
+          path = ptr + 1;
+      }
+      if (('\0' == *path) || !flight_recorder.Open(path, slotCount))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: unable to open RECORDER file\n");
+          return false;
+      }
+      break;
+    }
+    case SNAPSHOT:
+      // <logFile>
+      if (NULL == arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing SNAPSHOT <logFile> argument\n");
+          return false;
+      }
+      if (!flight_recorder.IsOpen())
+      {
+          DMSG(0, "Mgen::OnCommand() Error: SNAPSHOT requires a RECORDER file\n");
+          return false;
+      }
+      if (!flight_recorder.Snapshot(arg, local_time, (LogTimestamp == LogEpochTimestamp),
+                                    log_binary ? MgenLogEncoder::TEXT : log_encoding))
+      {
+          DMSG(0, "Mgen::OnCommand() Error: SNAPSHOT to \"%s\" failed\n", arg);
+          return false;
+      }
+      break;
     case INVALID_COMMAND:
       DMSG(0, "Mgen::OnCommand() Error: invalid command\n");
       return false;   
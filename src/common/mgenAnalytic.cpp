@@ -3,16 +3,144 @@
 #include "mgen.h"  // for logging
 #include <string.h>  // for memcpy()
 
+MgenReorderTracker::MgenReorderTracker()
+ : rx_mask(NULL), first_greater(NULL), depth(0), max_seq(0), 
+   arrival_count(0), started(false)
+{
+    ResetStats();
+}
+
+MgenReorderTracker::~MgenReorderTracker()
+{
+    Destroy();
+}
+
+bool MgenReorderTracker::Init(UINT32 windowDepth)
+{
+    Destroy();
+    UINT32 size = 32;
+    while (size < windowDepth) size <<= 1;
+    if (NULL == (rx_mask = new UINT32[size >> 5]))
+    {
+        PLOG(PL_ERROR, "MgenReorderTracker::Init() new rx_mask error: %s\n", GetErrorString());
+        return false;
+    }
+    if (NULL == (first_greater = new UINT32[size]))
+    {
+        PLOG(PL_ERROR, "MgenReorderTracker::Init() new first_greater error: %s\n", GetErrorString());
+        Destroy();
+        return false;
+    }
+    depth = size;
+    started = false;
+    ResetStats();
+    return true;
+}  // end MgenReorderTracker::Init()
+
+void MgenReorderTracker::Destroy()
+{
+    if (NULL != rx_mask)
+    {
+        delete[] rx_mask;
+        rx_mask = NULL;
+    }
+    if (NULL != first_greater)
+    {
+        delete[] first_greater;
+        first_greater = NULL;
+    }
+    depth = 0;
+    started = false;
+}  // end MgenReorderTracker::Destroy()
+
+MgenReorderTracker::Result MgenReorderTracker::Update(UINT32 seqNum)
+{
+    UINT32 mask = depth - 1;
+    UINT32 arrival = ++arrival_count;
+    if (!started)
+    {
+        // Anything older than the first message that shows 
+        // up later was passed by this first arrival
+        memset(rx_mask, 0, (depth >> 5) * sizeof(UINT32));
+        for (UINT32 i = 0; i < depth; i++)
+            first_greater[i] = arrival;
+        rx_mask[(seqNum & mask) >> 5] |= ((UINT32)0x01 << (seqNum & 31));
+        max_seq = seqNum;
+        started = true;
+        return SEQ_NEW;
+    }
+    UINT32 delta = seqNum - max_seq;
+    if ((0 != delta) && (delta < 0x80000000))
+    {
+        // New highest sequence number.  Slots for the skipped sequence
+        // numbers (at most "depth" of them) are recycled as missing and 
+        // marked as passed by this arrival
+        UINT32 seq = (delta > depth) ? (seqNum - depth + 1) : (max_seq + 1);
+        for (; seq != seqNum; seq++)
+        {
+            UINT32 index = seq & mask;
+            rx_mask[index >> 5] &= ~((UINT32)0x01 << (index & 31));
+            first_greater[index] = arrival;
+        }
+        UINT32 index = seqNum & mask;
+        rx_mask[index >> 5] |= ((UINT32)0x01 << (index & 31));
+        max_seq = seqNum;
+        return SEQ_NEW;
+    }
+    UINT32 behind = max_seq - seqNum;
+    if (behind >= depth)
+    {
+        stats.late++;
+        return SEQ_LATE;
+    }
+    UINT32 index = seqNum & mask;
+    UINT32 bit = (UINT32)0x01 << (index & 31);
+    if (0 != (rx_mask[index >> 5] & bit))
+    {
+        stats.dups++;
+        return SEQ_DUPLICATE;
+    }
+    rx_mask[index >> 5] |= bit;
+    UINT32 extent = arrival - first_greater[index];
+    if (extent > stats.extent_max) stats.extent_max = extent;
+    stats.extent[GetBin(extent)]++;
+    stats.distance[GetBin(behind)]++;
+    stats.reordered++;
+    return SEQ_REORDERED;
+}  // end MgenReorderTracker::Update()
+
+unsigned int MgenReorderTracker::GetBin(UINT32 value)
+{
+    unsigned int bin = 0;
+    while ((value >>= 1) && (bin < (HISTOGRAM_BINS - 1))) bin++;
+    return bin;
+}  // end MgenReorderTracker::GetBin()
+
+void MgenReorderTracker::LogHistogram(FILE* filePtr, const char* name, const unsigned long* bins)
+{
+    // e.g. "extent>1:12,2:3,8:1" (bin lower bound : count, empty bins omitted)
+    Mgen::Log(filePtr, " %s>", name);
+    bool empty = true;
+    for (unsigned int i = 0; i < HISTOGRAM_BINS; i++)
+    {
+        if (0 == bins[i]) continue;
+        Mgen::Log(filePtr, "%s%lu:%lu", empty ? "" : ",", 1UL << i, bins[i]);
+        empty = false;
+    }
+    if (empty) Mgen::Log(filePtr, "none");
+}  // end MgenReorderTracker::LogHistogram()
+
 const double MgenAnalytic::DEFAULT_WINDOW = 1.0;
 
 MgenAnalytic::MgenAnalytic()
  : flow_key(NULL), flow_keysize(0), window_size(DEFAULT_WINDOW), window_valid(false), 
-   msg_count(0), byte_count(0), dup_msg_count(0), latency_sum(0.0), 
+   msg_count(0), byte_count(0), log_reorder(false), latency_sum(0.0), 
    report_valid(false), report_msg_count(0)
 { 
     // Adjust set window_size to quantized version
     UINT8 q = Report::QuantizeTimeValue(window_size);
     window_size = Report::UnquantizeTimeValue(q);
+    memset(&report_reorder, 0, sizeof(report_reorder));
 }
 
 MgenAnalytic::~MgenAnalytic()
@@ -22,7 +150,7 @@ MgenAnalytic::~MgenAnalytic()
         delete[] flow_key;
         flow_key = NULL;
     }
-    dup_mask.Destroy();
+    seq_tracker.Destroy();
 }
 
 bool MgenAnalytic::Init(Protocol               protocol,
@@ -30,20 +158,22 @@ bool MgenAnalytic::Init(Protocol               protocol,
                         const ProtoAddress&    dstAddr,
                         UINT32                 flowId, 
                         double                 windowSize,
-                        UINT32                 historyDepth)
+                        UINT32                 historyDepth,
+                        bool                   logReorder)
 {
-    if (!dup_mask.Init(historyDepth, 0xffffffff))
+    if (!seq_tracker.Init(historyDepth))
     {
-        PLOG(PL_ERROR, "MgenAnalytic::Init() dup_mask.Init() error: %s\n", GetErrorString());
+        PLOG(PL_ERROR, "MgenAnalytic::Init() seq_tracker.Init() error: %s\n", GetErrorString());
         return false;
     }
+    log_reorder = logReorder;
     if (NULL != flow_key) delete[] flow_key;
     unsigned int dstLen = dstAddr.GetLength();
     unsigned int srcLen = srcAddr.GetLength();
     if (0 == (flow_key = new char[dstLen + 2 + srcLen + 2 + 4]))
     {
         PLOG(PL_ERROR, "MgenAnalytic::Init() new flow_key[] error: %s\n", GetErrorString());
-        dup_mask.Destroy();
+        seq_tracker.Destroy();
         return false;
     }
     UINT8 q = Report::QuantizeTimeValue(windowSize);
@@ -85,7 +215,7 @@ bool MgenAnalytic::Update(const ProtoTime& rxTime,
         window_end += window_size;
         if (0 != msgSize)
         {
-            dup_mask.Set(seqNum);
+            seq_tracker.Update(seqNum);
             seq_start = seqNum;
             msg_count = 1;
             byte_count = msgSize;
@@ -102,35 +232,25 @@ bool MgenAnalytic::Update(const ProtoTime& rxTime,
     double latency = 0.0;
     if (0 != msgSize)
     {
-        if (dup_mask.IsSet())
+        if (seq_tracker.IsStarted())
         {
-        
-            // IMPORTANT TBD: manage the duplicate detector more intelligently (or limit its range, perhaps temporally)
-            if (dup_mask.Test(seqNum))
+            // The tracker window slides forward with the highest sequence
+            // number received, so it never needs to be forced forward
+            MgenReorderTracker::Result result = seq_tracker.Update(seqNum);
+            if (MgenReorderTracker::SEQ_DUPLICATE == result)
             {
                 // It's a duplicate 
-                dup_msg_count++;
                 // TBD - keep track of dup_byte_count to report overall receive rate?
             }
-            else if (window_valid && (dup_mask.Difference(seqNum, seq_start) < 0))
+            else if ((MgenReorderTracker::SEQ_LATE == result) ||
+                     ((INT32)(seqNum - seq_start) < 0))
             {
-                // It precedes our window, but mark dup_mask
-                // for duplicate message count purposes
-                dup_mask.Set(seqNum);  // doesn't matter if it succeeds
+                // It precedes our window (or is too old to tell if 
+                // it's a duplicate) so it isn't counted
             }
             else
             {
-                // It's a valid, new message, so count it
-                if (!dup_mask.Set(seqNum))
-                {
-                    // Need to force our dup_mask forward to 
-                    // (TBD - add a param to ProtoSlidingMask::Set() to do this automatically)
-                    UINT32 firstSet;
-                    dup_mask.GetFirstSet(firstSet);
-                    UINT32 numBits = dup_mask.Difference(seqNum, firstSet);
-                    dup_mask.UnsetBits(firstSet, numBits);
-                    dup_mask.Set(seqNum);
-                }
+                // It's a valid, new (possibly reordered) message, so count it
                 // Ignore size of first message (serves as time reference only) 
                 // when more than one message in window
                 if (1 == msg_count)
@@ -156,8 +276,7 @@ bool MgenAnalytic::Update(const ProtoTime& rxTime,
         else
         {
             // First actual message received for this analytic
-            if (dup_mask.IsSet()) dup_mask.Clear(); // TBD - Is this right thing to do???
-            dup_mask.Set(seqNum);
+            seq_tracker.Update(seqNum);
             seq_start = seqNum;
             byte_count = msgSize;
             latency_sum = latency_min = latency_max = ProtoTime::Delta(rxTime, txTime);
@@ -171,9 +290,10 @@ bool MgenAnalytic::Update(const ProtoTime& rxTime,
         report_valid = true;
         report_start = window_start;
         report_duration = ProtoTime::Delta(rxTime, window_start);
-        UINT32 seqMax;
-        if (!dup_mask.GetLastSet(seqMax))  // gets highest sequence number observed
-            seqMax = seq_start;
+        UINT32 seqMax = seq_tracker.IsStarted() ?  // highest sequence number observed
+                            seq_tracker.GetMaxSeq() : seq_start;
+        report_reorder = seq_tracker.GetStats();
+        seq_tracker.ResetStats();
         
         switch (msg_count)
         {
@@ -263,8 +383,6 @@ void MgenAnalytic::Log(FILE*            filePtr,
                        bool             localTime) const
 {
     if (NULL == filePtr) return;  // not logging
-    // MGEN logging timestamp format (TBD - create an Mgen::LogTimeStamp() method
-    Mgen::LogTimestamp(filePtr, theTime.GetTimeVal(), localTime);
     UINT32 flowId = report_msg.GetFlowId();
     if (0 == flowId) flowId = 1;  // null flowId means flow 1 by default
     ProtoAddress srcAddr;
@@ -285,13 +403,50 @@ void MgenAnalytic::Log(FILE*            filePtr,
             protocol = "???";
             break;
     }
-    Mgen::Log(filePtr, "REPORT proto>%s flow>%lu src>%s/%hu ", protocol, flowId, srcAddr.GetHostString(), srcAddr.GetPort());
     ProtoAddress dstAddr;
     report_msg.GetDstAddr(dstAddr);
-    Mgen::Log(filePtr, "dst>%s/%hu ", dstAddr.GetHostString(), dstAddr.GetPort());
-    Mgen::Log(filePtr,"window>%lf rate>%lf kbps loss>%lf latency ave>%lf min>%lf max>%lf, count>%u\n",
-                report_duration, report_rate_ave*8.0e-03, report_loss_ave, 
-                report_latency_ave, report_latency_min, report_latency_max, report_msg_count);
+    MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(filePtr);
+    if (MgenLogEncoder::TEXT != encoding)
+    {
+        // JSON or CSV (LOGFORMAT) REPORT computed by this receiver
+        MgenLogEncoder encoder(encoding);
+        encoder.Begin("REPORT", theTime.GetTimeVal());
+        encoder.SetString(MgenLogEncoder::COL_PROTO, protocol);
+        encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, flowId);
+        encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT, srcAddr);
+        encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT, dstAddr);
+        encoder.SetDouble(MgenLogEncoder::COL_WINDOW, report_duration);
+        encoder.SetDouble(MgenLogEncoder::COL_RATE, report_rate_ave*8.0e-03);
+        encoder.SetDouble(MgenLogEncoder::COL_LOSS, report_loss_ave);
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_AVE, report_latency_ave);
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_MIN, report_latency_min);
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_MAX, report_latency_max);
+        Mgen::LogEncoded(filePtr, encoder);
+    }
+    else
+    {
+        // MGEN logging timestamp format (TBD - create an Mgen::LogTimeStamp() method
+        Mgen::LogTimestamp(filePtr, theTime.GetTimeVal(), localTime);
+        Mgen::Log(filePtr, "REPORT proto>%s flow>%lu src>%s/%hu ", protocol, flowId, srcAddr.GetHostString(), srcAddr.GetPort());
+        Mgen::Log(filePtr, "dst>%s/%hu ", dstAddr.GetHostString(), dstAddr.GetPort());
+        Mgen::Log(filePtr,"window>%lf rate>%lf kbps loss>%lf latency ave>%lf min>%lf max>%lf, count>%u\n",
+                    report_duration, report_rate_ave*8.0e-03, report_loss_ave, 
+                    report_latency_ave, report_latency_min, report_latency_max, report_msg_count);
+    }
+    if (log_reorder)
+    {
+        // REORDER has no encoded form
+        FILE* textFile = MgenLogEncoder::GetTextFile(filePtr);
+        Mgen::LogTimestamp(textFile, theTime.GetTimeVal(), localTime);
+        Mgen::Log(textFile, "REORDER proto>%s flow>%lu src>%s/%hu ", protocol, flowId, srcAddr.GetHostString(), srcAddr.GetPort());
+        Mgen::Log(textFile, "dst>%s/%hu ", dstAddr.GetHostString(), dstAddr.GetPort());
+        Mgen::Log(textFile, "window>%lf dups>%lu reordered>%lu late>%lu extentMax>%lu", 
+                  report_duration, report_reorder.dups, report_reorder.reordered, 
+                  report_reorder.late, (unsigned long)report_reorder.extent_max);
+        MgenReorderTracker::LogHistogram(textFile, "extent", report_reorder.extent);
+        MgenReorderTracker::LogHistogram(textFile, "distance", report_reorder.distance);
+        Mgen::Log(textFile, "\n");
+    }
 }  // end void MgenAnalytic:::Log()
 
 const MgenAnalytic::Report& MgenAnalytic::GetReport(const ProtoTime& theTime)
@@ -751,8 +906,6 @@ void MgenAnalytic::Report::Log(FILE*                filePtr,
                                const ProtoAddress&  reporterAddr) const
 {
     if (NULL == filePtr) return;  // not logging
-    // MGEN logging timestamp format (TBD - create an Mgen::LogTimeStamp() method
-    Mgen::LogTimestamp(filePtr, theTime.GetTimeVal(), localTime);
     UINT32 flowId = GetFlowId();
     if (0 == flowId) flowId = 1;  // null flowId means flow 1 by default
     ProtoAddress srcAddr;
@@ -773,9 +926,33 @@ void MgenAnalytic::Report::Log(FILE*                filePtr,
             protocol = "???";
             break;
     }
-    Mgen::Log(filePtr, "REPORT proto>%s flow>%lu src>%s/%hu ", protocol, flowId, srcAddr.GetHostString(), srcAddr.GetPort());
     ProtoAddress dstAddr;
     GetDstAddr(dstAddr);
+    MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(filePtr);
+    if (MgenLogEncoder::TEXT != encoding)
+    {
+        // JSON or CSV (LOGFORMAT) REPORT of a received MGEN_DATA payload
+        MgenLogEncoder encoder(encoding);
+        encoder.Begin("REPORT", theTime.GetTimeVal());
+        encoder.SetString(MgenLogEncoder::COL_PROTO, protocol);
+        encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, flowId);
+        encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT, srcAddr);
+        encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT, dstAddr);
+        encoder.SetAddress(MgenLogEncoder::COL_REPORTER, MgenLogEncoder::COL_REPORTER_PORT, reporterAddr);
+        encoder.SetTime(MgenLogEncoder::COL_SENT, sentTime.GetTimeVal());
+        encoder.SetDouble(MgenLogEncoder::COL_OFFSET, GetWindowOffset());
+        encoder.SetDouble(MgenLogEncoder::COL_WINDOW, GetWindowSize());
+        encoder.SetDouble(MgenLogEncoder::COL_RATE, GetRateAve()*8.0e-03);
+        encoder.SetDouble(MgenLogEncoder::COL_LOSS, GetLossFraction());
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_AVE, GetLatencyAve());
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_MIN, GetLatencyMin());
+        encoder.SetDouble(MgenLogEncoder::COL_LATENCY_MAX, GetLatencyMax());
+        Mgen::LogEncoded(filePtr, encoder);
+        return;
+    }
+    // MGEN logging timestamp format (TBD - create an Mgen::LogTimeStamp() method
+    Mgen::LogTimestamp(filePtr, theTime.GetTimeVal(), localTime);
+    Mgen::Log(filePtr, "REPORT proto>%s flow>%lu src>%s/%hu ", protocol, flowId, srcAddr.GetHostString(), srcAddr.GetPort());
     Mgen::Log(filePtr, "dst>%s/%hu ", dstAddr.GetHostString(), dstAddr.GetPort());
     Mgen::Log(filePtr, "reporter>%s/%hu sent>", reporterAddr.GetHostString(), reporterAddr.GetPort());
     Mgen::LogTimestamp(filePtr, theTime.GetTimeVal(), localTime);
@@ -785,5 +962,155 @@ void MgenAnalytic::Report::Log(FILE*                filePtr,
                 GetLatencyAve(), GetLatencyMin(), GetLatencyMax());
 }  // end MgenAnalytic::Report::Log()
 
+MgenFlowCounters::MgenFlowCounters()
+ : table(NULL), table_size(0), flow_count(0)
+{
+}
+
+MgenFlowCounters::~MgenFlowCounters()
+{
+    Destroy();
+}
+
+void MgenFlowCounters::Destroy()
+{
+    if (NULL != table)
+    {
+        delete[] table;
+        table = NULL;
+    }
+    table_size = flow_count = 0;
+}  // end MgenFlowCounters::Destroy()
+
+// FNV-1a over the flow key fields
+unsigned int MgenFlowCounters::Hash(const char* addr, unsigned int addrLen, UINT16 srcPort, 
+                                    UINT16 dstPort, UINT32 flowId)
+{
+    UINT32 hash = 2166136261UL;
+    for (unsigned int i = 0; i < addrLen; i++)
+        hash = (hash ^ (UINT8)addr[i]) * 16777619UL;
+    UINT32 fields[2] = {((UINT32)srcPort << 16) | dstPort, flowId};
+    const UINT8* ptr = (const UINT8*)fields;
+    for (unsigned int i = 0; i < sizeof(fields); i++)
+        hash = (hash ^ ptr[i]) * 16777619UL;
+    return hash;
+}  // end MgenFlowCounters::Hash()
+
+bool MgenFlowCounters::Grow()
+{
+    unsigned int newSize = (0 != table_size) ? (2 * table_size) : INIT_SIZE;
+    Entry* newTable = new Entry[newSize];
+    if (NULL == newTable)
+    {
+        PLOG(PL_ERROR, "MgenFlowCounters::Grow() new table error: %s\n", GetErrorString());
+        return false;
+    }
+    memset(newTable, 0, newSize*sizeof(Entry));
+    for (unsigned int i = 0; i < table_size; i++)
+    {
+        Entry& entry = table[i];
+        if (!entry.in_use) continue;
+        unsigned int index = Hash(entry.src_addr, entry.addr_len, entry.src_port, 
+                                  entry.dst_port, entry.flow_id) & (newSize - 1);
+        while (newTable[index].in_use) index = (index + 1) & (newSize - 1);
+        newTable[index] = entry;
+    }
+    if (NULL != table) delete[] table;
+    table = newTable;
+    table_size = newSize;
+    return true;
+}  // end MgenFlowCounters::Grow()
 
+bool MgenFlowCounters::Update(const ProtoAddress&   srcAddr, 
+                              UINT16                dstPort, 
+                              UINT32                flowId, 
+                              UINT32                seqNum, 
+                              unsigned int          msgSize, 
+                              const struct timeval& rxTime)
+{
+    // Keep load factor under 3/4 so probe sequences stay short
+    if ((4*(flow_count + 1)) > (3*table_size))
+    {
+        if (!Grow()) return false;
+    }
+    const char* addr = srcAddr.GetRawHostAddress();
+    unsigned int addrLen = srcAddr.GetLength();
+    if (addrLen > ADDR_MAX) addrLen = ADDR_MAX;
+    UINT16 srcPort = srcAddr.GetPort();
+    unsigned int index = Hash(addr, addrLen, srcPort, dstPort, flowId) & (table_size - 1);
+    while (table[index].in_use)
+    {
+        Entry& entry = table[index];
+        if ((entry.flow_id == flowId) && (entry.src_port == srcPort) && 
+            (entry.dst_port == dstPort) && (entry.addr_len == addrLen) &&
+            (0 == memcmp(entry.src_addr, addr, addrLen)))
+        {
+            break;
+        }
+        index = (index + 1) & (table_size - 1);
+    }
+    Entry& entry = table[index];
+    if (!entry.in_use)
+    {
+        memset(&entry, 0, sizeof(Entry));
+        entry.in_use = true;
+        entry.addr_type = (UINT8)srcAddr.GetType();
+        entry.addr_len = (UINT8)addrLen;
+        entry.src_port = srcPort;
+        entry.dst_port = dstPort;
+        entry.flow_id = flowId;
+        memcpy(entry.src_addr, addr, addrLen);
+        entry.max_seq = seqNum;
+        entry.seq_mask = 1;
+        flow_count++;
+    }
+    else if (seqNum > entry.max_seq)
+    {
+        UINT32 delta = seqNum - entry.max_seq;
+        entry.gaps += delta - 1;
+        entry.seq_mask = (delta < SEQ_HISTORY) ? ((entry.seq_mask << delta) | 1) : 1;
+        entry.max_seq = seqNum;
+    }
+    else
+    {
+        UINT32 delta = entry.max_seq - seqNum;
+        UINT32 bit = (delta < SEQ_HISTORY) ? (1UL << delta) : 0;
+        if ((0 != bit) && (0 != (entry.seq_mask & bit)))
+        {
+            entry.dups++;
+        }
+        else
+        {
+            // Late (reordered) arrival fills a gap.  Beyond the
+            // history depth a duplicate can't be told from a late one
+            entry.seq_mask |= bit;
+            if (entry.gaps > 0) 
+                entry.gaps--;
+            else
+                entry.dups++;
+        }
+    }
+    entry.packets++;
+    entry.bytes += msgSize;
+    entry.last_rx = rxTime;
+    return true;
+}  // end MgenFlowCounters::Update()
 
+void MgenFlowCounters::Log(FILE*                 filePtr, 
+                           const struct timeval& theTime, 
+                           bool                  localTime) const
+{
+    if (NULL == filePtr) return;
+    for (unsigned int i = 0; i < table_size; i++)
+    {
+        const Entry& entry = table[i];
+        if (!entry.in_use) continue;
+        ProtoAddress srcAddr;
+        srcAddr.SetRawHostAddress((ProtoAddress::Type)entry.addr_type, entry.src_addr, entry.addr_len);
+        Mgen::LogTimestamp(filePtr, theTime, localTime);
+        Mgen::Log(filePtr, "COUNTERS flow>%lu src>%s/%hu dstPort>%hu rx>%lu bytes>%lu gaps>%lu dups>%lu maxSeq>%lu lastRx>%lu.%06lu\n",
+                  (unsigned long)entry.flow_id, srcAddr.GetHostString(), entry.src_port, entry.dst_port,
+                  entry.packets, entry.bytes, entry.gaps, entry.dups, (unsigned long)entry.max_seq,
+                  (unsigned long)entry.last_rx.tv_sec, (unsigned long)entry.last_rx.tv_usec);
+    }
+}  // end MgenFlowCounters::Log()
@@ -23,7 +23,7 @@ MgenApp::MgenApp()
 #ifdef HAVE_GPS
      gps_handle(NULL), payload_handle(NULL),
 #endif // HAVE_GPS
-     have_ports(false), convert(false), 
+     have_ports(false), convert(false), convert_summary(false),
      ifinfo_tx_count(0), ifinfo_rx_count(0)
 {
     control_pipe.SetNotifier(&GetSocketNotifier());
@@ -41,7 +41,11 @@ void MgenApp::Usage()
     fprintf(stderr, "mgen [ipv4][ipv6][input <scriptFile>][save <saveFile>]\n"
             "     [output <logFile>][log <logFile>][hostAddr {on|off}\n"
             "     [logData {on|off}][logGpsData {on|off}]\n"
-            "     [binary][txlog][nolog][flush]\n"
+            "     [binary][binary3][compress <level>][txlog][nolog][flush]\n"
+            "     [rotate <size>[k|m|g][/<sec>]]\n"
+            "     [logsample [<flowIds>:]<count>|<sec>s][logfilter <filter>]\n"
+            "     [logformat text|json|csv]\n"
+            "     [recorder [<slots>:]<ringFile>][snapshot <logFile>]\n"
             "     [event \"<mgen event>\"][port <recvPortList>]\n"
             "     [instance <name>][command <cmdInput>]\n"
             "     [sink <sinkFile>][block][source <sourceFile>]\n"
@@ -50,14 +54,18 @@ void MgenApp::Usage()
             "     [df <on|off>]\n"
             "     [tos <typeOfService>][label <value>]\n"
             "     [txbuffer <txSocketBufferSize>][rxbuffer <rxSocketBufferSize>]\n"
+            "     [rxbatch <count>][rxtimestamp][txtimestamp]\n"
+            "     [rxshards <count>[/<firstCpu>]][rxgro][tcprxring <bytes>]\n"
+            "     [counters <interval>][dumpcounters][logpipe <records>[/<msec>]]\n"
             "     [start <hr:min:sec>[GMT]][offset <sec>]\n"
             "     [precise {on|off}][ifinfo <ifName>]\n"
             "     [txcheck][rxcheck][check]\n"
             "     [queue <queueSize>][broadcast {on|off}]\n"
-            "     [convert <binaryLog>][debug <debugLevel>]\n"
+            "     [convert <binaryLog>][summarize <binaryLog>]\n"
+            "     [debug <debugLevel>]\n"
             "     [gpskey <gpsSharedMemoryLocation>]\n"
             "     [boost] [reuse {on|off}]\n"
-            "     [epochtimestamp]\n");
+            "     [epochtimestamp][reorder <depth>]\n");
 }  // end MgenApp::Usage()
 
 
@@ -67,6 +75,7 @@ const char* const MgenApp::CMD_LIST[] =
     "-ipv6",       // open IPv6 sockets by default
     "-ipv4",       // open IPv4 sockets by default
     "+convert",    // convert binary logfile to text-based logfile
+    "+summarize",  // summarize binary logfile flows to text-based logfile
     "+sink",       // set Mgen::sink to stream sink
     "-block",      // set Mgen::sink to blocking I/O
     "+source",     // specify an MGEN stream source
@@ -135,7 +144,8 @@ bool MgenApp::ProcessCommands(int argc, const char*const* argv)
     // and their (if applicable) respective arguments
     // Parse command line
     int i = 1;
-    convert = false;  // initialize conversion flag
+    convert = false;  // initialize conversion flags
+    convert_summary = false;
     while (i < argc)
     {
         CmdType cmdType = GetCmdType(argv[i]);
@@ -296,6 +306,12 @@ bool MgenApp::OnCommand(const char* cmd, const char* val)
         convert = true;             // set flag to do the conversion
         strcpy(convert_path, val);  // save path of file to convert
     }
+    else if (!strcmp("summarize", lowerCmd))
+    {
+        convert = true;             // a conversion to per-flow summaries
+        convert_summary = true;
+        strcpy(convert_path, val);
+    }
     else if (!strncmp("sink", lowerCmd, len))
     {
         mgen.SetSinkPath(val);
@@ -520,7 +536,10 @@ bool MgenApp::OnStartup(int argc, const char*const* argv)
     {
         fprintf(stderr, "mgen: beginning binary to text log conversion ...\n");
         MgenMsg theMsg;
-        theMsg.ConvertBinaryLog(convert_path,mgen);
+        if (convert_summary)
+            theMsg.SummarizeBinaryLog(convert_path,mgen);
+        else
+            theMsg.ConvertBinaryLog(convert_path,mgen);
         fprintf(stderr, "mgen: conversion complete (exiting).\n");
     }
     else
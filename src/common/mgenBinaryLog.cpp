@@ -0,0 +1,796 @@
+#include "mgenBinaryLog.h"
+#include "mgenMsg.h"      // for MgenMsg::AddressType
+#include "mgenVersion.h"
+#include "mgenLogStream.h"
+
+#include <string.h>
+#include <stdlib.h>       // for realloc()
+#ifdef UNIX
+#include <sys/types.h>
+#include <unistd.h>       // for ftruncate()
+#endif // UNIX
+#ifdef WIN32
+#include <io.h>           // for _chsize_s()
+#endif // WIN32
+
+// Slot field helpers (all fields are in network byte order)
+static inline void PutUINT32(char* ptr, UINT32 value)
+{
+    value = htonl(value);
+    memcpy(ptr, &value, sizeof(UINT32));
+}
+static inline UINT32 GetUINT32(const char* ptr)
+{
+    UINT32 value;
+    memcpy(&value, ptr, sizeof(UINT32));
+    return ntohl(value);
+}
+static inline void PutUINT64(char* ptr, uint64_t value)
+{
+    PutUINT32(ptr, (UINT32)(value >> 32));
+    PutUINT32(ptr + 4, (UINT32)value);
+}
+static inline uint64_t GetUINT64(const char* ptr)
+{
+    return (((uint64_t)GetUINT32(ptr) << 32) | (uint64_t)GetUINT32(ptr + 4));
+}
+static inline void PutUINT16(char* ptr, UINT16 value)
+{
+    value = htons(value);
+    memcpy(ptr, &value, sizeof(UINT16));
+}
+static inline UINT16 GetUINT16(const char* ptr)
+{
+    UINT16 value;
+    memcpy(&value, ptr, sizeof(UINT16));
+    return ntohs(value);
+}
+
+// Footer slot fields
+enum
+{
+    FOOTER_DICT_COUNT   = 4,
+    FOOTER_RECORD_END   = 8,
+    FOOTER_INDEX_SLOT   = 16,
+    FOOTER_DICT_SLOT    = 24,
+    FOOTER_EVENT_COUNT  = 32,
+    FOOTER_INDEX_COUNT  = 40,
+    FOOTER_INTERVAL     = 44,
+    FOOTER_MAGIC        = 56
+};
+static const char FOOTER_MAGIC_TEXT[8] = {'M', 'G', 'E', 'N', 'L', 'O', 'G', '3'};
+static const char* const LOG_TYPE_V3 = " type=binary_log_v3\n";
+
+// Table slots ("count" at offset 4) are followed by packed UINT32 values
+enum {TABLE_COUNT = 4, TABLE_VALUES = MgenBinaryLog::RECORD_SIZE / sizeof(UINT32)};
+enum {INDEX_VALUES = 4, DICT_VALUES = 2};  // UINT32 values per table entry
+
+// Number of DICT_DATA slots following a DICT_ENTRY of "len" bytes
+static inline unsigned int GetDataSlotCount(unsigned int len)
+{
+    if (len <= MgenBinaryLog::ENTRY_DATA_MAX) return 0;
+    len -= MgenBinaryLog::ENTRY_DATA_MAX;
+    return ((len + MgenBinaryLog::DATA_MAX - 1) / MgenBinaryLog::DATA_MAX);
+}
+
+// Number of slots following a table slot with "count" entries
+static inline uint64_t GetTableSlotCount(uint64_t count, unsigned int valuesPerEntry)
+{
+    return ((count*valuesPerEntry + TABLE_VALUES - 1) / TABLE_VALUES);
+}
+
+MgenBinaryLog* MgenBinaryLog::active_log = NULL;
+
+MgenBinaryLog::Record::Record(LogEventType eventType, const struct timeval& eventTime)
+{
+    memset(this, 0, sizeof(Record));
+    type = (UINT8)eventType;
+    event_time = eventTime;
+}
+
+MgenBinaryLog::MgenBinaryLog()
+ : log_file(NULL), slot_count(0), event_count(0),
+   dict_slot(NULL), dict_count(0), dict_size(0),
+   index(NULL), index_count(0), index_size(0),
+   cache(NULL), cache_size(0), cache_count(0)
+{
+}
+
+MgenBinaryLog::~MgenBinaryLog()
+{
+    Close();
+}
+
+void MgenBinaryLog::PackRecord(char* slot, const Record& record)
+{
+    memset(slot, 0, RECORD_SIZE);
+    slot[0] = (char)record.type;
+    slot[1] = (char)record.protocol;
+    slot[2] = (char)record.flags;
+    slot[3] = (char)record.gps_status;
+    PutUINT32(slot + 4, (UINT32)record.event_time.tv_sec);
+    PutUINT32(slot + 8, (UINT32)record.event_time.tv_usec);
+    PutUINT32(slot + 12, (UINT32)record.tx_time.tv_sec);
+    PutUINT32(slot + 16, (UINT32)record.tx_time.tv_usec);
+    PutUINT32(slot + 20, record.flow_id);
+    PutUINT32(slot + 24, record.seq_num);
+    PutUINT32(slot + 28, record.size);
+    PutUINT32(slot + 32, record.src_id);
+    PutUINT32(slot + 36, record.dst_id);
+    PutUINT32(slot + 40, record.host_id);
+    PutUINT32(slot + 44, record.aux);
+    slot[48] = (char)record.ttl;
+    slot[49] = (char)record.info;
+    PutUINT16(slot + 50, record.sample);
+    PutUINT32(slot + 52, record.latitude);
+    PutUINT32(slot + 56, record.longitude);
+    PutUINT32(slot + 60, (UINT32)record.altitude);
+}  // end MgenBinaryLog::PackRecord()
+
+void MgenBinaryLog::UnpackRecord(const char* slot, Record& record)
+{
+    record.type = (UINT8)slot[0];
+    record.protocol = (UINT8)slot[1];
+    record.flags = (UINT8)slot[2];
+    record.gps_status = (UINT8)slot[3];
+    record.event_time.tv_sec = GetUINT32(slot + 4);
+    record.event_time.tv_usec = GetUINT32(slot + 8);
+    record.tx_time.tv_sec = GetUINT32(slot + 12);
+    record.tx_time.tv_usec = GetUINT32(slot + 16);
+    record.flow_id = GetUINT32(slot + 20);
+    record.seq_num = GetUINT32(slot + 24);
+    record.size = GetUINT32(slot + 28);
+    record.src_id = GetUINT32(slot + 32);
+    record.dst_id = GetUINT32(slot + 36);
+    record.host_id = GetUINT32(slot + 40);
+    record.aux = GetUINT32(slot + 44);
+    record.ttl = (UINT8)slot[48];
+    record.info = (UINT8)slot[49];
+    record.sample = GetUINT16(slot + 50);
+    record.latitude = GetUINT32(slot + 52);
+    record.longitude = GetUINT32(slot + 56);
+    record.altitude = (INT32)GetUINT32(slot + 60);
+}  // end MgenBinaryLog::UnpackRecord()
+
+bool MgenBinaryLog::Open(FILE* logFile, const char* path, bool empty)
+{
+    Close();
+    if (empty)
+    {
+        // The header slot is a NULL padded text line
+        char slot[RECORD_SIZE];
+        memset(slot, 0, RECORD_SIZE);
+        strcpy(slot, "mgen version=");
+        strncat(slot, MGEN_VERSION, RECORD_SIZE - 1 - strlen(slot) - strlen(LOG_TYPE_V3));
+        strcat(slot, LOG_TYPE_V3);
+        log_file = logFile;
+        if (!WriteSlot(slot))
+        {
+            log_file = NULL;
+            return false;
+        }
+    }
+    else
+    {
+        // Pick up the dictionary and index of the existing log, then
+        // strip its trailer (and any partially written record)
+        MgenBinaryLogReader reader;
+        if (!reader.Open(path))
+        {
+            PLOG(PL_ERROR, "MgenBinaryLog::Open() error: unable to append to \"%s\" (not a v3 binary log)\n", path);
+            return false;
+        }
+        for (UINT32 id = 1; id <= reader.GetDictCount(); id++)
+        {
+            if (!AddDictSlot(reader.GetDictSlot(id)))
+            {
+                Close();
+                return false;
+            }
+            char data[CACHE_DATA_MAX];
+            EntryKind kind = STRING;
+            unsigned int len = reader.GetData(id, data, CACHE_DATA_MAX, &kind);
+            if ((len <= CACHE_DATA_MAX) && ((ENDPOINT == kind) || (STRING == kind)))
+                CacheEntry(kind, data, len, HashEntry(kind, data, len), id);
+        }
+        for (unsigned int i = 0; i < reader.GetIndexCount(); i++)
+        {
+            struct timeval indexTime;
+            uint64_t indexSlot;
+            reader.GetIndexEntry(i, indexTime, indexSlot);
+            if (!AddIndexEntry(indexTime, indexSlot))
+            {
+                Close();
+                return false;
+            }
+        }
+        slot_count = reader.GetRecordEnd();
+        event_count = reader.GetEventCount();
+        reader.Close();
+        fflush(logFile);
+#ifdef WIN32
+        int result = _chsize_s(_fileno(logFile), (__int64)(slot_count*RECORD_SIZE));
+#else
+        int result = ftruncate(fileno(logFile), (off_t)(slot_count*RECORD_SIZE));
+#endif // if/else WIN32
+        if (0 != result)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLog::Open() error: unable to truncate \"%s\": %s\n", path, GetErrorString());
+            Close();
+            return false;
+        }
+        fseek(logFile, 0, SEEK_END);
+        log_file = logFile;
+    }
+    active_log = this;
+    return true;
+}  // end MgenBinaryLog::Open()
+
+void MgenBinaryLog::Close()
+{
+    if (NULL != log_file)
+    {
+        // Write the trailer: time index table, dictionary table and footer
+        char slot[RECORD_SIZE];
+        uint64_t recordEnd = slot_count;
+        uint64_t indexSlot = slot_count;
+        memset(slot, 0, RECORD_SIZE);
+        slot[0] = (char)INDEX_TABLE;
+        PutUINT32(slot + TABLE_COUNT, index_count);
+        bool result = WriteSlot(slot);
+        unsigned int count = 0;
+        memset(slot, 0, RECORD_SIZE);
+        for (unsigned int i = 0; result && (i < index_count); i++)
+        {
+            UINT32 values[INDEX_VALUES];
+            values[0] = (UINT32)index[i].time.tv_sec;
+            values[1] = (UINT32)index[i].time.tv_usec;
+            values[2] = (UINT32)(index[i].slot >> 32);
+            values[3] = (UINT32)index[i].slot;
+            for (unsigned int j = 0; j < INDEX_VALUES; j++)
+            {
+                PutUINT32(slot + sizeof(UINT32)*count++, values[j]);
+                if (TABLE_VALUES == count)
+                {
+                    result = WriteSlot(slot);
+                    memset(slot, 0, RECORD_SIZE);
+                    count = 0;
+                }
+            }
+        }
+        if (result && (0 != count)) result = WriteSlot(slot);
+
+        uint64_t dictSlot = slot_count;
+        memset(slot, 0, RECORD_SIZE);
+        slot[0] = (char)DICT_TABLE;
+        PutUINT32(slot + TABLE_COUNT, dict_count);
+        if (result) result = WriteSlot(slot);
+        count = 0;
+        memset(slot, 0, RECORD_SIZE);
+        for (UINT32 i = 0; result && (i < dict_count); i++)
+        {
+            PutUINT64(slot + sizeof(UINT32)*count, dict_slot[i]);
+            count += DICT_VALUES;
+            if (TABLE_VALUES == count)
+            {
+                result = WriteSlot(slot);
+                memset(slot, 0, RECORD_SIZE);
+                count = 0;
+            }
+        }
+        if (result && (0 != count)) result = WriteSlot(slot);
+
+        memset(slot, 0, RECORD_SIZE);
+        slot[0] = (char)FOOTER;
+        PutUINT32(slot + FOOTER_DICT_COUNT, dict_count);
+        PutUINT64(slot + FOOTER_RECORD_END, recordEnd);
+        PutUINT64(slot + FOOTER_INDEX_SLOT, indexSlot);
+        PutUINT64(slot + FOOTER_DICT_SLOT, dictSlot);
+        PutUINT64(slot + FOOTER_EVENT_COUNT, event_count);
+        PutUINT32(slot + FOOTER_INDEX_COUNT, index_count);
+        PutUINT32(slot + FOOTER_INTERVAL, INDEX_INTERVAL);
+        memcpy(slot + FOOTER_MAGIC, FOOTER_MAGIC_TEXT, 8);
+        if (result) WriteSlot(slot);
+        fflush(log_file);
+        log_file = NULL;
+    }
+    if (this == active_log) active_log = NULL;
+    if (NULL != dict_slot)
+    {
+        free(dict_slot);
+        dict_slot = NULL;
+    }
+    dict_count = dict_size = 0;
+    if (NULL != index)
+    {
+        free(index);
+        index = NULL;
+    }
+    index_count = index_size = 0;
+    if (NULL != cache)
+    {
+        delete[] cache;
+        cache = NULL;
+    }
+    cache_size = cache_count = 0;
+    slot_count = event_count = 0;
+}  // end MgenBinaryLog::Close()
+
+bool MgenBinaryLog::WriteSlot(const char* slot)
+{
+    if (fwrite(slot, 1, RECORD_SIZE, log_file) < RECORD_SIZE)
+    {
+        PLOG(PL_ERROR, "MgenBinaryLog::WriteSlot() fwrite() error: %s\n", GetErrorString());
+        return false;
+    }
+    slot_count++;
+    return true;
+}  // end MgenBinaryLog::WriteSlot()
+
+bool MgenBinaryLog::AddDictSlot(uint64_t slot)
+{
+    if (dict_count == dict_size)
+    {
+        UINT32 newSize = (0 != dict_size) ? 2*dict_size : 256;
+        uint64_t* newSlots = (uint64_t*)realloc(dict_slot, newSize*sizeof(uint64_t));
+        if (NULL == newSlots)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLog::AddDictSlot() realloc() error: %s\n", GetErrorString());
+            return false;
+        }
+        dict_slot = newSlots;
+        dict_size = newSize;
+    }
+    dict_slot[dict_count++] = slot;
+    return true;
+}  // end MgenBinaryLog::AddDictSlot()
+
+bool MgenBinaryLog::AddIndexEntry(const struct timeval& theTime, uint64_t slot)
+{
+    if (index_count == index_size)
+    {
+        unsigned int newSize = (0 != index_size) ? 2*index_size : 256;
+        IndexEntry* newIndex = (IndexEntry*)realloc(index, newSize*sizeof(IndexEntry));
+        if (NULL == newIndex)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLog::AddIndexEntry() realloc() error: %s\n", GetErrorString());
+            return false;
+        }
+        index = newIndex;
+        index_size = newSize;
+    }
+    index[index_count].time = theTime;
+    index[index_count].slot = slot;
+    index_count++;
+    return true;
+}  // end MgenBinaryLog::AddIndexEntry()
+
+UINT32 MgenBinaryLog::HashEntry(EntryKind kind, const char* data, unsigned int len)
+{
+    // FNV-1a
+    UINT32 hash = 2166136261U;
+    hash = (hash ^ (UINT8)kind) * 16777619U;
+    for (unsigned int i = 0; i < len; i++)
+        hash = (hash ^ (UINT8)data[i]) * 16777619U;
+    return hash;
+}  // end MgenBinaryLog::HashEntry()
+
+UINT32 MgenBinaryLog::LookupEntry(EntryKind kind, const char* data, unsigned int len, UINT32 hash) const
+{
+    if (0 == cache_size) return 0;
+    unsigned int mask = cache_size - 1;
+    for (unsigned int i = hash & mask; 0 != cache[i].id; i = (i + 1) & mask)
+    {
+        const DictCacheEntry& entry = cache[i];
+        if ((hash == entry.hash) && (kind == entry.kind) && (len == entry.len) &&
+            (0 == memcmp(data, entry.data, len)))
+            return entry.id;
+    }
+    return 0;
+}  // end MgenBinaryLog::LookupEntry()
+
+bool MgenBinaryLog::CacheEntry(EntryKind kind, const char* data, unsigned int len, UINT32 hash, UINT32 id)
+{
+    if (2*(cache_count + 1) > cache_size)
+    {
+        // Grow and rehash (keeps the load factor at or below 1/2)
+        unsigned int newSize = (0 != cache_size) ? 2*cache_size : 1024;
+        DictCacheEntry* newCache = new DictCacheEntry[newSize];
+        if (NULL == newCache)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLog::CacheEntry() new error: %s\n", GetErrorString());
+            return false;
+        }
+        memset(newCache, 0, newSize*sizeof(DictCacheEntry));
+        unsigned int newMask = newSize - 1;
+        for (unsigned int i = 0; i < cache_size; i++)
+        {
+            if (0 == cache[i].id) continue;
+            unsigned int j = cache[i].hash & newMask;
+            while (0 != newCache[j].id) j = (j + 1) & newMask;
+            newCache[j] = cache[i];
+        }
+        if (NULL != cache) delete[] cache;
+        cache = newCache;
+        cache_size = newSize;
+    }
+    unsigned int mask = cache_size - 1;
+    unsigned int i = hash & mask;
+    while (0 != cache[i].id) i = (i + 1) & mask;
+    cache[i].hash = hash;
+    cache[i].id = id;
+    cache[i].kind = (UINT8)kind;
+    cache[i].len = (UINT8)len;
+    memcpy(cache[i].data, data, len);
+    cache_count++;
+    return true;
+}  // end MgenBinaryLog::CacheEntry()
+
+UINT32 MgenBinaryLog::AddEndpoint(const ProtoAddress& addr)
+{
+    UINT16 port = addr.GetPort();
+    char data[4 + 16];
+    unsigned int addrLen = 0;
+    switch (addr.GetType())
+    {
+        case ProtoAddress::IPv4:
+            data[0] = (char)MgenMsg::IPv4;
+            addrLen = addr.GetLength();
+            break;
+        case ProtoAddress::IPv6:
+            data[0] = (char)MgenMsg::IPv6;
+            addrLen = addr.GetLength();
+            break;
+        default:
+            if (0 == port) return 0;
+            data[0] = (char)MgenMsg::INVALID_ADDRESS;
+            break;
+    }
+    if (addrLen > 16) addrLen = 16;
+    data[1] = (char)addrLen;
+    UINT16 temp16 = htons(port);
+    memcpy(data + 2, &temp16, sizeof(UINT16));
+    if (0 != addrLen) memcpy(data + 4, addr.GetRawHostAddress(), addrLen);
+    return AddData(ENDPOINT, data, 4 + addrLen);
+}  // end MgenBinaryLog::AddEndpoint()
+
+UINT32 MgenBinaryLog::AddData(EntryKind kind, const char* data, unsigned int len)
+{
+    if ((NULL == log_file) || (0 == len)) return 0;
+    if (len > 0xffff) len = 0xffff;
+    bool cacheable = (len <= CACHE_DATA_MAX) && ((ENDPOINT == kind) || (STRING == kind));
+    UINT32 hash = 0;
+    if (cacheable)
+    {
+        hash = HashEntry(kind, data, len);
+        UINT32 id = LookupEntry(kind, data, len, hash);
+        if (0 != id) return id;
+    }
+    UINT32 id = dict_count + 1;
+    if (!AddDictSlot(slot_count)) return 0;
+    char slot[RECORD_SIZE];
+    memset(slot, 0, RECORD_SIZE);
+    slot[0] = (char)DICT_ENTRY;
+    slot[1] = (char)kind;
+    UINT16 temp16 = htons((UINT16)len);
+    memcpy(slot + 2, &temp16, sizeof(UINT16));
+    PutUINT32(slot + 4, id);
+    unsigned int count = (len < ENTRY_DATA_MAX) ? len : ENTRY_DATA_MAX;
+    memcpy(slot + 8, data, count);
+    bool result = WriteSlot(slot);
+    while (result && (count < len))
+    {
+        memset(slot, 0, RECORD_SIZE);
+        slot[0] = (char)DICT_DATA;
+        unsigned int dataLen = len - count;
+        if (dataLen > DATA_MAX) dataLen = DATA_MAX;
+        memcpy(slot + 1, data + count, dataLen);
+        count += dataLen;
+        result = WriteSlot(slot);
+    }
+    if (!result) return 0;
+    if (cacheable) CacheEntry(kind, data, len, hash, id);
+    return id;
+}  // end MgenBinaryLog::AddData()
+
+bool MgenBinaryLog::WriteEvent(const Record& record)
+{
+    if (NULL == log_file) return false;
+    if (0 == (event_count % INDEX_INTERVAL))
+    {
+        if (!AddIndexEntry(record.event_time, slot_count)) return false;
+    }
+    char slot[RECORD_SIZE];
+    PackRecord(slot, record);
+    if (!WriteSlot(slot)) return false;
+    event_count++;
+    return true;
+}  // end MgenBinaryLog::WriteEvent()
+
+
+MgenBinaryLogReader::MgenBinaryLogReader()
+ : file_data(NULL), file_size(0), mapped(false), slot_total(0),
+   record_end(0), event_count(0), has_trailer(false),
+   dict_slot(NULL), dict_count(0), dict_size(0),
+   index(NULL), index_count(0), index_size(0)
+{
+}
+
+MgenBinaryLogReader::~MgenBinaryLogReader()
+{
+    Close();
+}
+
+// Checks the header slot text
+static bool IsHeaderV3(const char* slot)
+{
+    char text[MgenBinaryLog::RECORD_SIZE + 1];
+    memcpy(text, slot, MgenBinaryLog::RECORD_SIZE);
+    text[MgenBinaryLog::RECORD_SIZE] = '\0';
+    return ((0 == strncmp(text, "mgen version=", 13)) && (NULL != strstr(text, LOG_TYPE_V3)));
+}  // end IsHeaderV3()
+
+bool MgenBinaryLogReader::IsBinaryLogV3(const char* path)
+{
+    char slot[MgenBinaryLog::RECORD_SIZE];
+    return ((MgenLogStream::ReadHead(path, slot, MgenBinaryLog::RECORD_SIZE) == MgenBinaryLog::RECORD_SIZE) &&
+            IsHeaderV3(slot));
+}  // end MgenBinaryLogReader::IsBinaryLogV3()
+
+bool MgenBinaryLogReader::Open(const char* path)
+{
+    Close();
+    if (!MgenLogStream::MapFile(path, file_data, file_size, mapped)) return false;
+    if ((NULL == file_data) || (file_size < MgenBinaryLog::RECORD_SIZE) || !IsHeaderV3(file_data))
+    {
+        PLOG(PL_ERROR, "MgenBinaryLogReader::Open() error: \"%s\" is not a v3 binary log\n", path);
+        Close();
+        return false;
+    }
+    slot_total = file_size / MgenBinaryLog::RECORD_SIZE;
+    has_trailer = LoadTrailer();
+    if (!has_trailer && !ScanRecords())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}  // end MgenBinaryLogReader::Open()
+
+void MgenBinaryLogReader::Close()
+{
+    MgenLogStream::UnmapFile(file_data, file_size, mapped);
+    file_data = NULL;
+    mapped = false;
+    file_size = slot_total = record_end = event_count = 0;
+    has_trailer = false;
+    if (NULL != dict_slot)
+    {
+        free(dict_slot);
+        dict_slot = NULL;
+    }
+    dict_count = dict_size = 0;
+    if (NULL != index)
+    {
+        free(index);
+        index = NULL;
+    }
+    index_count = index_size = 0;
+}  // end MgenBinaryLogReader::Close()
+
+bool MgenBinaryLogReader::AddDictSlot(uint64_t slot)
+{
+    if (dict_count == dict_size)
+    {
+        UINT32 newSize = (0 != dict_size) ? 2*dict_size : 256;
+        uint64_t* newSlots = (uint64_t*)realloc(dict_slot, newSize*sizeof(uint64_t));
+        if (NULL == newSlots)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLogReader::AddDictSlot() realloc() error: %s\n", GetErrorString());
+            return false;
+        }
+        dict_slot = newSlots;
+        dict_size = newSize;
+    }
+    dict_slot[dict_count++] = slot;
+    return true;
+}  // end MgenBinaryLogReader::AddDictSlot()
+
+bool MgenBinaryLogReader::AddIndexEntry(const struct timeval& theTime, uint64_t slot)
+{
+    if (index_count == index_size)
+    {
+        unsigned int newSize = (0 != index_size) ? 2*index_size : 256;
+        MgenBinaryLog::IndexEntry* newIndex =
+            (MgenBinaryLog::IndexEntry*)realloc(index, newSize*sizeof(MgenBinaryLog::IndexEntry));
+        if (NULL == newIndex)
+        {
+            PLOG(PL_ERROR, "MgenBinaryLogReader::AddIndexEntry() realloc() error: %s\n", GetErrorString());
+            return false;
+        }
+        index = newIndex;
+        index_size = newSize;
+    }
+    index[index_count].time = theTime;
+    index[index_count].slot = slot;
+    index_count++;
+    return true;
+}  // end MgenBinaryLogReader::AddIndexEntry()
+
+bool MgenBinaryLogReader::LoadTrailer()
+{
+    if (slot_total < 4) return false;
+    uint64_t footerSlot = slot_total - 1;
+    const char* footer = GetSlot(footerSlot);
+    if ((MgenBinaryLog::FOOTER != (UINT8)footer[0]) ||
+        (0 != memcmp(footer + FOOTER_MAGIC, FOOTER_MAGIC_TEXT, 8)))
+        return false;
+    uint64_t recordEnd = GetUINT64(footer + FOOTER_RECORD_END);
+    uint64_t indexSlot = GetUINT64(footer + FOOTER_INDEX_SLOT);
+    uint64_t dictSlot = GetUINT64(footer + FOOTER_DICT_SLOT);
+    UINT32 dictCount = GetUINT32(footer + FOOTER_DICT_COUNT);
+    UINT32 indexCount = GetUINT32(footer + FOOTER_INDEX_COUNT);
+    // Validate the layout before trusting any of it
+    if ((recordEnd < 1) || (recordEnd != indexSlot) ||
+        (indexSlot + 1 + GetTableSlotCount(indexCount, INDEX_VALUES) != dictSlot) ||
+        (dictSlot + 1 + GetTableSlotCount(dictCount, DICT_VALUES) != footerSlot) ||
+        (MgenBinaryLog::INDEX_TABLE != GetSlotType(indexSlot)) ||
+        (indexCount != GetUINT32(GetSlot(indexSlot) + TABLE_COUNT)) ||
+        (MgenBinaryLog::DICT_TABLE != GetSlotType(dictSlot)) ||
+        (dictCount != GetUINT32(GetSlot(dictSlot) + TABLE_COUNT)))
+    {
+        PLOG(PL_WARN, "MgenBinaryLogReader::LoadTrailer() warning: invalid trailer (will scan log)\n");
+        return false;
+    }
+    const char* values = GetSlot(indexSlot + 1);
+    for (UINT32 i = 0; i < indexCount; i++)
+    {
+        const char* ptr = values + i*INDEX_VALUES*sizeof(UINT32);
+        struct timeval indexTime;
+        indexTime.tv_sec = GetUINT32(ptr);
+        indexTime.tv_usec = GetUINT32(ptr + 4);
+        uint64_t slot = GetUINT64(ptr + 8);
+        if ((slot < 1) || (slot >= recordEnd) || !AddIndexEntry(indexTime, slot))
+        {
+            index_count = 0;
+            return false;
+        }
+    }
+    values = GetSlot(dictSlot + 1);
+    for (UINT32 i = 0; i < dictCount; i++)
+    {
+        uint64_t slot = GetUINT64(values + i*DICT_VALUES*sizeof(UINT32));
+        if ((slot < 1) || (slot >= recordEnd) ||
+            (MgenBinaryLog::DICT_ENTRY != GetSlotType(slot)) ||
+            ((i + 1) != GetUINT32(GetSlot(slot) + 4)) ||
+            ((slot + 1 + GetDataSlotCount(GetUINT16(GetSlot(slot) + 2))) > recordEnd) ||
+            !AddDictSlot(slot))
+        {
+            index_count = 0;
+            dict_count = 0;
+            return false;
+        }
+    }
+    record_end = recordEnd;
+    event_count = GetUINT64(footer + FOOTER_EVENT_COUNT);
+    return true;
+}  // end MgenBinaryLogReader::LoadTrailer()
+
+bool MgenBinaryLogReader::ScanRecords()
+{
+    // No (valid) trailer, e.g. the writer didn't exit cleanly, so
+    // rebuild the dictionary and time index the same way the writer does
+    uint64_t slot = 1;
+    while (slot < slot_total)
+    {
+        UINT8 slotType = GetSlotType(slot);
+        if (MgenBinaryLog::IsEvent(slotType))
+        {
+            if (0 == (event_count % MgenBinaryLog::INDEX_INTERVAL))
+            {
+                struct timeval eventTime;
+                eventTime.tv_sec = GetUINT32(GetSlot(slot) + 4);
+                eventTime.tv_usec = GetUINT32(GetSlot(slot) + 8);
+                if (!AddIndexEntry(eventTime, slot)) return false;
+            }
+            event_count++;
+            slot++;
+        }
+        else if (MgenBinaryLog::DICT_ENTRY == slotType)
+        {
+            const char* entry = GetSlot(slot);
+            uint64_t next = slot + 1 + GetDataSlotCount(GetUINT16(entry + 2));
+            if ((next > slot_total) || ((dict_count + 1) != GetUINT32(entry + 4)))
+                break;  // truncated or out of sequence entry
+            if (!AddDictSlot(slot)) return false;
+            slot = next;
+        }
+        else
+        {
+            break;  // start of (partial) trailer or garbage
+        }
+    }
+    record_end = slot;
+    if (record_end < slot_total)
+        PLOG(PL_WARN, "MgenBinaryLogReader::ScanRecords() warning: ignoring %lu trailing slots\n",
+             (unsigned long)(slot_total - record_end));
+    return true;
+}  // end MgenBinaryLogReader::ScanRecords()
+
+uint64_t MgenBinaryLogReader::FindTime(const struct timeval& theTime) const
+{
+    // Binary search for the last index entry strictly before "theTime"
+    unsigned int lo = 0;
+    unsigned int hi = index_count;
+    while (lo < hi)
+    {
+        unsigned int mid = lo + (hi - lo) / 2;
+        const struct timeval& t = index[mid].time;
+        if ((t.tv_sec < theTime.tv_sec) ||
+            ((t.tv_sec == theTime.tv_sec) && (t.tv_usec < theTime.tv_usec)))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return ((0 == lo) ? 1 : index[lo - 1].slot);
+}  // end MgenBinaryLogReader::FindTime()
+
+void MgenBinaryLogReader::GetIndexEntry(unsigned int i, struct timeval& theTime, uint64_t& slot) const
+{
+    theTime = index[i].time;
+    slot = index[i].slot;
+}  // end MgenBinaryLogReader::GetIndexEntry()
+
+const char* MgenBinaryLogReader::GetEntry(UINT32 id) const
+{
+    if ((0 == id) || (id > dict_count)) return NULL;
+    return GetSlot(dict_slot[id - 1]);
+}  // end MgenBinaryLogReader::GetEntry()
+
+unsigned int MgenBinaryLogReader::GetData(UINT32 id, char* buffer, unsigned int bufferSize,
+                                          MgenBinaryLog::EntryKind* kind) const
+{
+    const char* entry = GetEntry(id);
+    if (NULL == entry) return 0;
+    if (NULL != kind) *kind = (MgenBinaryLog::EntryKind)entry[1];
+    unsigned int len = GetUINT16(entry + 2);
+    unsigned int copyLen = (len < bufferSize) ? len : bufferSize;
+    unsigned int count = (copyLen < MgenBinaryLog::ENTRY_DATA_MAX) ? copyLen : MgenBinaryLog::ENTRY_DATA_MAX;
+    memcpy(buffer, entry + 8, count);
+    const char* dataSlot = entry;
+    while (count < copyLen)
+    {
+        dataSlot += MgenBinaryLog::RECORD_SIZE;
+        unsigned int dataLen = copyLen - count;
+        if (dataLen > MgenBinaryLog::DATA_MAX) dataLen = MgenBinaryLog::DATA_MAX;
+        memcpy(buffer + count, dataSlot + 1, dataLen);
+        count += dataLen;
+    }
+    return len;
+}  // end MgenBinaryLogReader::GetData()
+
+bool MgenBinaryLogReader::GetEndpoint(UINT32 id, ProtoAddress& addr) const
+{
+    addr.Invalidate();
+    char data[4 + 16];
+    MgenBinaryLog::EntryKind kind;
+    unsigned int len = GetData(id, data, sizeof(data), &kind);
+    if ((len < 4) || (MgenBinaryLog::ENDPOINT != kind)) return false;
+    unsigned int addrLen = (UINT8)data[1];
+    if ((addrLen > 16) || (len < (4 + addrLen))) return false;
+    ProtoAddress::Type addrType;
+    switch (data[0])
+    {
+        case MgenMsg::IPv4:
+            addrType = ProtoAddress::IPv4;
+            break;
+        case MgenMsg::IPv6:
+            addrType = ProtoAddress::IPv6;
+            break;
+        default:
+            return true;  // port only
+    }
+    addr.SetRawHostAddress(addrType, data + 4, addrLen);
+    addr.SetPort(GetUINT16(data + 2));
+    return true;
+}  // end MgenBinaryLogReader::GetEndpoint()
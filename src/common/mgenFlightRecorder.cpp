@@ -0,0 +1,347 @@
+#include "mgenFlightRecorder.h"
+#include "mgen.h"         // for Mgen::LogText()
+#include "mgenMsg.h"
+#include "mgenLogStream.h"
+
+#include <string.h>
+#ifdef MGEN_FLIGHT_RECORDER
+#include <sys/types.h>
+#include <sys/stat.h>     // for fstat()
+#include <sys/mman.h>     // for mmap()
+#include <fcntl.h>        // for open()
+#include <unistd.h>       // for ftruncate()
+
+// A slot's sequence number is cleared before its fields are written and
+// set after, so a crash part way through leaves an invalid (skipped) slot.
+// Only the compiler needs fencing: the recorder is written by one thread
+// and a crashed process's stores are all in the page cache.
+#define RECORDER_FENCE() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#endif // MGEN_FLIGHT_RECORDER
+
+const char MgenFlightRecorder::MAGIC[8] = {'M', 'G', 'E', 'N', 'R', 'I', 'N', 'G'};
+
+// Slots start on a cache line boundary after the header
+static const size_t RECORDER_HEADER_SIZE = 64;
+// Output is formatted into chunks of this size
+static const unsigned int RECORDER_CHUNK_SIZE = 65536;
+
+MgenFlightRecorder::MgenFlightRecorder()
+ : map_ptr(NULL), map_size(0), header(NULL), slot_list(NULL), slot_mask(0), count(0)
+{
+}
+
+MgenFlightRecorder::~MgenFlightRecorder()
+{
+    Close();
+}
+
+bool MgenFlightRecorder::Open(const char* path, unsigned int slotCount)
+{
+    Close();
+#ifdef MGEN_FLIGHT_RECORDER
+    if ((0 == slotCount) || (slotCount > 0x40000000))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Open() error: invalid slot count %u\n", slotCount);
+        return false;
+    }
+    unsigned int slots = 1;
+    while (slots < slotCount) slots <<= 1;
+    size_t size = RECORDER_HEADER_SIZE + (size_t)slots * sizeof(Slot);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Open() open() error: %s\n", GetErrorString());
+        return false;
+    }
+    // (the slots start out as zero filled, i.e. empty, file holes)
+    if (0 != ftruncate(fd, (off_t)size))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Open() ftruncate() error: %s\n", GetErrorString());
+        close(fd);
+        return false;
+    }
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Open() mmap() error: %s\n", GetErrorString());
+        return false;
+    }
+    map_ptr = (char*)ptr;
+    map_size = size;
+    header = (Header*)map_ptr;
+    header->version = VERSION;
+    header->slot_size = sizeof(Slot);
+    header->slot_count = slots;
+    header->count = 0;
+    memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    slot_list = (Slot*)(map_ptr + RECORDER_HEADER_SIZE);
+    slot_mask = slots - 1;
+    count = 0;
+    return true;
+#else
+    PLOG(PL_ERROR, "MgenFlightRecorder::Open() error: not supported in this build\n");
+    return false;
+#endif // if/else MGEN_FLIGHT_RECORDER
+}  // end MgenFlightRecorder::Open()
+
+void MgenFlightRecorder::Close()
+{
+#ifdef MGEN_FLIGHT_RECORDER
+    // The file is left in place to be read with "convert"
+    if (NULL != map_ptr)
+        munmap(map_ptr, map_size);
+#endif // MGEN_FLIGHT_RECORDER
+    map_ptr = NULL;
+    map_size = 0;
+    header = NULL;
+    slot_list = NULL;
+    slot_mask = 0;
+    count = 0;
+}  // end MgenFlightRecorder::Close()
+
+// Sets a raw address, with non-IP addresses recorded as 0.0.0.0
+static inline void RecorderSetAddress(char* addr, UINT8& addrLen, UINT16& port,
+                                      const ProtoAddress& theAddr)
+{
+    unsigned int len = theAddr.IsValid() ? theAddr.GetLength() : 0;
+    if ((4 == len) || (16 == len))
+    {
+        memcpy(addr, theAddr.GetRawHostAddress(), len);
+        port = theAddr.GetPort();
+    }
+    else
+    {
+        len = 4;
+        memset(addr, 0, 4);
+        port = 0;
+    }
+    addrLen = (UINT8)len;
+}  // end RecorderSetAddress()
+
+void MgenFlightRecorder::Record(LogEventType            eventType,
+                                MgenMsg&                theMsg,
+                                const struct timeval&   eventTime,
+                                bool                    logGpsData)
+{
+#ifdef MGEN_FLIGHT_RECORDER
+    if (NULL == slot_list) return;
+    Slot& slot = slot_list[count & slot_mask];
+    slot.seq = 0;
+    RECORDER_FENCE();
+    slot.type = (UINT8)eventType;
+    MgenLogRecord& record = slot.record;
+    // As MgenLogFormatter::InitRecv() and InitSend() fill records, except
+    // message content is never kept
+    record.rx_time = eventTime;
+    record.flow_id = theMsg.GetFlowId();
+    record.seq_num = theMsg.GetSeqNum();
+    record.sample = 0;
+    record.ttl = -1;
+    record.protocol = (UINT8)theMsg.GetProtocol();
+    RecorderSetAddress(record.dst_addr, record.dst_len, record.dst_port, theMsg.GetDstAddr());
+    const ProtoAddress& hostAddr = theMsg.GetHostAddr();
+    if (hostAddr.IsValid())
+        RecorderSetAddress(record.host_addr, record.host_len, record.host_port, hostAddr);
+    else
+        record.host_len = 0;
+    if (SEND_EVENT == eventType)
+    {
+        // TCP SEND events give the whole message size, not the fragment
+        record.msg_len = (TCP == theMsg.GetProtocol()) ? theMsg.GetMgenMsgLen() : theMsg.GetMsgLen();
+        record.src_port = theMsg.GetSrcAddr().GetPort();
+        record.src_len = 0;
+        record.flags = 0;
+        record.gps_status = 0xff;
+    }
+    else
+    {
+        record.tx_time = theMsg.GetTxTime();
+        record.msg_len = theMsg.GetMsgLen();
+        RecorderSetAddress(record.src_addr, record.src_len, record.src_port, theMsg.GetSrcAddr());
+        record.flags = 0;
+        if (theMsg.FlagIsSet(MgenMsg::CONTINUES)) record.flags |= MgenMsg::CONTINUES;
+        if (theMsg.FlagIsSet(MgenMsg::END_OF_MSG)) record.flags |= MgenMsg::END_OF_MSG;
+        if (theMsg.FlagIsSet(MgenMsg::CHECKSUM_ERROR)) record.flags |= MgenMsg::CHECKSUM_ERROR;
+        UINT8 gpsStatus = theMsg.GetGPSStatus();
+        if (logGpsData &&
+            ((MgenMsg::INVALID_GPS == gpsStatus) || (MgenMsg::STALE == gpsStatus) ||
+             (MgenMsg::CURRENT == gpsStatus)))
+        {
+            record.gps_status = gpsStatus;
+            record.latitude = theMsg.GetGPSLatitude();
+            record.longitude = theMsg.GetGPSLongitude();
+            record.altitude = theMsg.GetGPSAltitude();
+        }
+        else
+        {
+            record.gps_status = 0xff;
+        }
+    }
+    count++;
+    RECORDER_FENCE();
+    slot.seq = count;
+    RECORDER_FENCE();
+    header->count = count;
+#endif // MGEN_FLIGHT_RECORDER
+}  // end MgenFlightRecorder::Record()
+
+bool MgenFlightRecorder::Snapshot(const char*               path,
+                                  bool                      localTime,
+                                  bool                      epochTime,
+                                  MgenLogEncoder::Encoding  encoding) const
+{
+    if (NULL == slot_list)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Snapshot() error: no RECORDER file is open\n");
+        return false;
+    }
+    FILE* file = fopen(path, "w");
+    if (NULL == file)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Snapshot() fopen() error: %s\n", GetErrorString());
+        return false;
+    }
+    unsigned long eventCount = WriteRing(header, slot_list, file, localTime, epochTime, encoding);
+    if (0 != fclose(file))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Snapshot() fclose() error: %s\n", GetErrorString());
+        return false;
+    }
+    PLOG(PL_INFO, "MgenFlightRecorder::Snapshot() wrote %lu events to %s\n", eventCount, path);
+    return true;
+}  // end MgenFlightRecorder::Snapshot()
+
+bool MgenFlightRecorder::CheckHeader(const Header* header, uint64_t fileSize)
+{
+    if ((fileSize < RECORDER_HEADER_SIZE) || (0 != memcmp(header->magic, MAGIC, sizeof(MAGIC))))
+        return false;
+    if ((VERSION != header->version) || (sizeof(Slot) != header->slot_size))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::CheckHeader() error: ring file version %u "
+                       "slot size %u is not readable by this build\n",
+                       header->version, header->slot_size);
+        return false;
+    }
+    UINT32 slots = header->slot_count;
+    if ((0 == slots) || (0 != (slots & (slots - 1))) ||
+        (fileSize < (RECORDER_HEADER_SIZE + (uint64_t)slots * sizeof(Slot))))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::CheckHeader() error: truncated or invalid ring file\n");
+        return false;
+    }
+    return true;
+}  // end MgenFlightRecorder::CheckHeader()
+
+unsigned long MgenFlightRecorder::WriteRing(const Header*               header,
+                                            const Slot*                 slotList,
+                                            FILE*                       outFile,
+                                            bool                        localTime,
+                                            bool                        epochTime,
+                                            MgenLogEncoder::Encoding    encoding)
+{
+    char* chunk = new char[RECORDER_CHUNK_SIZE];
+    if (NULL == chunk)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::WriteRing() new error: %s\n", GetErrorString());
+        return 0;
+    }
+    unsigned int len = 0;
+    if (MgenLogEncoder::CSV == encoding)
+        len = MgenLogEncoder::FormatHeader(chunk);
+    MgenLogFormatter formatter;
+    formatter.SetTimeFormat(localTime, epochTime);
+    formatter.SetEncoding(encoding);
+    // The header count may lag the last slot written before a crash
+    uint64_t slotCount = header->slot_count;
+    uint64_t mask = slotCount - 1;
+    uint64_t end = header->count;
+    for (uint64_t i = 0; i < slotCount; i++)
+    {
+        if ((end + 1) != slotList[end & mask].seq) break;
+        end++;
+    }
+    unsigned long eventCount = 0;
+    for (uint64_t n = (end > slotCount) ? (end - slotCount) : 0; n < end; n++)
+    {
+        const Slot& slot = slotList[n & mask];
+        if ((n + 1) != slot.seq) continue;  // overwritten, or being written at a crash
+        if ((RECV_EVENT != slot.type) && (SEND_EVENT != slot.type)) continue;
+        if ((RECORDER_CHUNK_SIZE - len) < MgenLogFormatter::OUTPUT_LINE_MAX)
+        {
+            Mgen::LogText(outFile, chunk, len);
+            len = 0;
+        }
+        if (RECV_EVENT == slot.type)
+            len += formatter.FormatRecv(chunk + len, slot.record);
+        else
+            len += formatter.FormatSend(chunk + len, slot.record);
+        eventCount++;
+    }
+    if (0 != len) Mgen::LogText(outFile, chunk, len);
+    fflush(outFile);
+    delete[] chunk;
+    return eventCount;
+}  // end MgenFlightRecorder::WriteRing()
+
+bool MgenFlightRecorder::IsRecorderFile(const char* path)
+{
+    char magic[sizeof(MAGIC)];
+    return ((sizeof(MAGIC) == MgenLogStream::ReadHead(path, magic, sizeof(MAGIC))) &&
+            (0 == memcmp(magic, MAGIC, sizeof(MAGIC))));
+}  // end MgenFlightRecorder::IsRecorderFile()
+
+bool MgenFlightRecorder::Dump(const char*                path,
+                              FILE*                      outFile,
+                              bool                       localTime,
+                              bool                       epochTime,
+                              MgenLogEncoder::Encoding   encoding)
+{
+#ifdef MGEN_FLIGHT_RECORDER
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Dump() open() error: %s\n", GetErrorString());
+        return false;
+    }
+    struct stat info;
+    if (0 != fstat(fd, &info))
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Dump() fstat() error: %s\n", GetErrorString());
+        close(fd);
+        return false;
+    }
+    uint64_t fileSize = (uint64_t)info.st_size;
+    if (fileSize < RECORDER_HEADER_SIZE)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Dump() error: \"%s\" is not a ring file\n", path);
+        close(fd);
+        return false;
+    }
+    void* ptr = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == ptr)
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Dump() mmap() error: %s\n", GetErrorString());
+        return false;
+    }
+    const Header* header = (const Header*)ptr;
+    bool result = CheckHeader(header, fileSize);
+    if (result)
+    {
+        const Slot* slotList = (const Slot*)((const char*)ptr + RECORDER_HEADER_SIZE);
+        unsigned long eventCount = WriteRing(header, slotList, outFile, localTime, epochTime, encoding);
+        PLOG(PL_INFO, "MgenFlightRecorder::Dump() wrote %lu of %llu recorded events\n",
+             eventCount, (unsigned long long)header->count);
+    }
+    else
+    {
+        PLOG(PL_ERROR, "MgenFlightRecorder::Dump() error: \"%s\" is not a readable ring file\n", path);
+    }
+    munmap(ptr, (size_t)fileSize);
+    return result;
+#else
+    PLOG(PL_ERROR, "MgenFlightRecorder::Dump() error: not supported in this build\n");
+    return false;
+#endif // if/else MGEN_FLIGHT_RECORDER
+}  // end MgenFlightRecorder::Dump()
@@ -921,6 +921,58 @@ bool MgenFlow::UpdateAnalyticReport(MgenAnalytic& analytic)
     return true;
 }  // end MgenFlow::UpdateAnalyticReport()
 
+// Called for received remote analytic reports about this flow (see
+// Mgen::ProcessRecvReport()).  Feedback driven patterns adjust their
+// rate and the rate decision is logged.  BUCKET flows log the bit rate
+// achieved at the receiver against their target rate.
+void MgenFlow::OnRecvReport(const ProtoTime& theTime, const MgenAnalytic::Report& report)
+{
+    // (these lines have no LOGFORMAT encoding)
+    FILE* logFile = MgenLogEncoder::GetTextFile(mgen.GetLogFile());
+    if (MgenPattern::BUCKET == pattern.GetType())
+    {
+        // Log the bit rate achieved at the receiver against our target
+        if ((NULL == logFile) || mgen.GetLogBinary()) return;
+        Mgen::LogTimestamp(logFile, theTime.GetTimeVal(), mgen.GetLocalTime());
+        Mgen::Log(logFile, "BUCKET flow>%lu target>%lf kbps achieved>%lf kbps loss>%lf\n",
+                  (unsigned long)flow_id, pattern.GetBitRate()*1.0e-03, 
+                  report.GetRateAve()*8.0e-03, report.GetLossFraction());
+        if (mgen.GetLogFlush()) fflush(logFile);
+        return;
+    }
+    double oldRate = pattern.GetRate();
+    double loss = report.GetLossFraction();
+    double latency = report.GetLatencyAve();
+    if (!pattern.OnFeedback(theTime.GetValue(), loss, latency, report.GetWindowSize())) return;
+    double newRate = pattern.GetRate();
+    // Don't wait out a long interval after a rate increase
+    if ((newRate > 0.0) && tx_timer.IsActive() && (tx_timer.GetTimeRemaining() > (1.0/newRate)))
+    {
+        tx_timer.SetInterval(1.0/newRate);
+        tx_timer.Reschedule();
+    }
+    if ((NULL == logFile) || mgen.GetLogBinary()) return;
+    if (MgenPattern::RAMP == pattern.GetType())
+    {
+        Mgen::LogTimestamp(logFile, theTime.GetTimeVal(), mgen.GetLocalTime());
+        Mgen::Log(logFile, "RAMP flow>%lu rate>%lf loss>%lf latency>%lf result>%s ",
+                  (unsigned long)flow_id, oldRate, loss, latency, 
+                  pattern.RampPassed() ? "pass" : "fail");
+        if (pattern.RampDone())
+            Mgen::Log(logFile, "final>%lf kbps>%lf\n", newRate, 
+                      newRate * pattern.GetPktSizeAve() * 8.0e-03);
+        else
+            Mgen::Log(logFile, "next>%lf\n", newRate);
+    }
+    else if (MgenPattern::ADAPTIVE == pattern.GetType())
+    {
+        Mgen::LogTimestamp(logFile, theTime.GetTimeVal(), mgen.GetLocalTime());
+        Mgen::Log(logFile, "ADAPT flow>%lu rate>%lf loss>%lf latency>%lf next>%lf\n",
+                  (unsigned long)flow_id, oldRate, loss, latency, newRate);
+    }
+    if (mgen.GetLogFlush()) fflush(logFile);
+}  // end MgenFlow::OnRecvReport()
+
 bool MgenFlow::SendMessage()
 {
     // If we have an off event for flows with unlimited
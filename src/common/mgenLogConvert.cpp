@@ -0,0 +1,845 @@
+#include "mgenLogConvert.h"
+#include "mgen.h"
+#include "mgenMsg.h"
+#include "mgenEvent.h"  // for GetStringFromProtocol()
+#include "mgenLogStream.h"
+
+#include <string.h>
+#include <stdlib.h>     // for malloc(), realloc()
+#include <time.h>
+
+#ifdef UNIX
+#include <unistd.h>     // for sysconf()
+#endif // UNIX
+
+// Output of a chunk is its "text" with the records that are
+// converted by the writer inserted at "text_offset"s
+struct MgenLogConverter::Chunk
+{
+    struct Deferred
+    {
+        unsigned int    text_offset;
+        uint64_t        position;     // byte offset (original format) or slot (v3)
+    };
+    uint64_t            start;        // byte offset (original format) or slot (v3)
+    uint64_t            end;
+    unsigned long       record_count;
+    char*               text;
+    unsigned int        text_len;
+    unsigned int        text_size;
+    Deferred*           deferred;
+    unsigned int        deferred_count;
+    unsigned int        deferred_size;
+    FlowTable*          flows;
+    bool                done;
+    bool                failed;       // out of memory
+};  // end struct MgenLogConverter::Chunk
+
+/**
+ * @class MgenLogConverter::FlowTable
+ *
+ * @brief SEND or RECV tallies by flow, kept in order of first appearance
+ * with an open addressing hash index.
+ */
+class MgenLogConverter::FlowTable
+{
+  public:
+    FlowTable();
+    ~FlowTable();
+
+    struct Key
+    {
+        UINT32  flow_id;
+        UINT16  src_port;
+        UINT16  dst_port;
+        UINT8   type;         // SEND_EVENT or RECV_EVENT
+        UINT8   protocol;
+        UINT8   src_len;      // 0 if the source address isn't known
+        UINT8   dst_len;
+        char    src_addr[MgenLogRecord::ADDR_MAX];
+        char    dst_addr[MgenLogRecord::ADDR_MAX];
+    };
+    struct Flow
+    {
+        Key             key;
+        UINT32          hash;
+        unsigned long   count;        // scaled by "sample>" counts
+        unsigned long long bytes;
+        unsigned long   logged;       // events in the log
+        struct timeval  first_time;
+        struct timeval  last_time;
+        UINT32          first_seq;
+        UINT32          last_seq;
+        UINT32          min_seq;
+        UINT32          max_seq;
+        unsigned long   reordered;    // arrivals with a lower "seq" than the one before
+        double          delay_sum;    // RECV latency (sec)
+        double          delay_min;
+        double          delay_max;
+    };
+
+    bool Add(LogEventType eventType, MgenMsg& msg, const struct timeval& eventTime);
+    bool Merge(const FlowTable& table);  // "table" tallies follow ours
+    unsigned int GetCount() const
+        {return flow_count;}
+    const Flow& GetFlow(unsigned int i) const
+        {return flow_list[i];}
+
+  private:
+    Flow* Find(const Key& key, UINT32 hash, bool& isNew);
+    static UINT32 Hash(const Key& key);
+
+    Flow*           flow_list;
+    unsigned int    flow_count;
+    unsigned int    flow_size;
+    unsigned int*   hash_list;        // flow index + 1, 0 if empty
+    unsigned int    hash_size;        // power of 2
+};  // end class MgenLogConverter::FlowTable
+
+MgenLogConverter::FlowTable::FlowTable()
+ : flow_list(NULL), flow_count(0), flow_size(0), hash_list(NULL), hash_size(0)
+{
+}
+
+MgenLogConverter::FlowTable::~FlowTable()
+{
+    if (NULL != flow_list) free(flow_list);
+    if (NULL != hash_list) delete[] hash_list;
+}
+
+// FNV-1a
+UINT32 MgenLogConverter::FlowTable::Hash(const Key& key)
+{
+    const UINT8* ptr = (const UINT8*)&key;
+    UINT32 hash = 2166136261UL;
+    for (unsigned int i = 0; i < sizeof(Key); i++)
+    {
+        hash ^= ptr[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}  // end MgenLogConverter::FlowTable::Hash()
+
+MgenLogConverter::FlowTable::Flow* MgenLogConverter::FlowTable::Find(const Key& key, UINT32 hash, bool& isNew)
+{
+    isNew = false;
+    if ((2 * (flow_count + 1)) > hash_size)
+    {
+        // Grow (and rebuild) the hash index
+        unsigned int newSize = (0 != hash_size) ? (2 * hash_size) : 64;
+        unsigned int* newList = new unsigned int[newSize];
+        if (NULL == newList)
+        {
+            PLOG(PL_ERROR, "MgenLogConverter::FlowTable::Find() new error: %s\n", GetErrorString());
+            return NULL;
+        }
+        memset(newList, 0, newSize * sizeof(unsigned int));
+        for (unsigned int i = 0; i < flow_count; i++)
+        {
+            unsigned int j = flow_list[i].hash & (newSize - 1);
+            while (0 != newList[j]) j = (j + 1) & (newSize - 1);
+            newList[j] = i + 1;
+        }
+        if (NULL != hash_list) delete[] hash_list;
+        hash_list = newList;
+        hash_size = newSize;
+    }
+    unsigned int j = hash & (hash_size - 1);
+    while (0 != hash_list[j])
+    {
+        Flow& flow = flow_list[hash_list[j] - 1];
+        if ((hash == flow.hash) && (0 == memcmp(&key, &flow.key, sizeof(Key))))
+            return &flow;
+        j = (j + 1) & (hash_size - 1);
+    }
+    if (flow_count == flow_size)
+    {
+        unsigned int newSize = (0 != flow_size) ? (2 * flow_size) : 32;
+        Flow* newList = (Flow*)realloc(flow_list, newSize * sizeof(Flow));
+        if (NULL == newList)
+        {
+            PLOG(PL_ERROR, "MgenLogConverter::FlowTable::Find() realloc() error: %s\n", GetErrorString());
+            return NULL;
+        }
+        flow_list = newList;
+        flow_size = newSize;
+    }
+    Flow& flow = flow_list[flow_count];
+    memset(&flow, 0, sizeof(Flow));
+    flow.key = key;
+    flow.hash = hash;
+    hash_list[j] = ++flow_count;
+    isNew = true;
+    return &flow;
+}  // end MgenLogConverter::FlowTable::Find()
+
+bool MgenLogConverter::FlowTable::Add(LogEventType eventType, MgenMsg& msg, const struct timeval& eventTime)
+{
+    Key key;
+    memset(&key, 0, sizeof(Key));  // it is hashed and compared as bytes
+    key.flow_id = msg.GetFlowId();
+    key.type = (UINT8)eventType;
+    key.protocol = (UINT8)msg.GetProtocol();
+    const ProtoAddress& srcAddr = msg.GetSrcAddr();
+    key.src_port = srcAddr.GetPort();
+    if (srcAddr.IsValid() && (srcAddr.GetLength() <= MgenLogRecord::ADDR_MAX))
+    {
+        key.src_len = srcAddr.GetLength();
+        memcpy(key.src_addr, srcAddr.GetRawHostAddress(), key.src_len);
+    }
+    const ProtoAddress& dstAddr = msg.GetDstAddr();
+    key.dst_port = dstAddr.GetPort();
+    if (dstAddr.IsValid() && (dstAddr.GetLength() <= MgenLogRecord::ADDR_MAX))
+    {
+        key.dst_len = dstAddr.GetLength();
+        memcpy(key.dst_addr, dstAddr.GetRawHostAddress(), key.dst_len);
+    }
+    bool isNew;
+    Flow* flow = Find(key, Hash(key), isNew);
+    if (NULL == flow) return false;
+    UINT32 seq = msg.GetSeqNum();
+    if (isNew)
+    {
+        flow->first_time = eventTime;
+        flow->first_seq = flow->min_seq = flow->max_seq = seq;
+    }
+    else
+    {
+        if (seq < flow->last_seq) flow->reordered++;
+        if (seq < flow->min_seq) flow->min_seq = seq;
+        if (seq > flow->max_seq) flow->max_seq = seq;
+    }
+    // A sampled event stands for "sample" events of the flow
+    unsigned int weight = (0 != msg.GetLogSample()) ? msg.GetLogSample() : 1;
+    flow->logged++;
+    flow->count += weight;
+    // TCP SEND events give the whole message size, not the fragment
+    if ((SEND_EVENT == eventType) && (TCP == msg.GetProtocol()))
+        flow->bytes += (unsigned long long)weight * msg.GetMgenMsgLen();
+    else
+        flow->bytes += (unsigned long long)weight * msg.GetMsgLen();
+    flow->last_time = eventTime;
+    flow->last_seq = seq;
+    if (RECV_EVENT == eventType)
+    {
+        const struct timeval& txTime = msg.GetTxTime();
+        double delay = (double)(eventTime.tv_sec - txTime.tv_sec) +
+                       1.0e-06 * (double)(eventTime.tv_usec - txTime.tv_usec);
+        if ((1 == flow->logged) || (delay < flow->delay_min)) flow->delay_min = delay;
+        if ((1 == flow->logged) || (delay > flow->delay_max)) flow->delay_max = delay;
+        flow->delay_sum += delay;
+    }
+    return true;
+}  // end MgenLogConverter::FlowTable::Add()
+
+bool MgenLogConverter::FlowTable::Merge(const FlowTable& table)
+{
+    for (unsigned int i = 0; i < table.flow_count; i++)
+    {
+        const Flow& other = table.flow_list[i];
+        bool isNew;
+        Flow* flow = Find(other.key, other.hash, isNew);
+        if (NULL == flow) return false;
+        if (isNew)
+        {
+            *flow = other;
+            continue;
+        }
+        if (other.first_seq < flow->last_seq) flow->reordered++;
+        flow->reordered += other.reordered;
+        if (other.min_seq < flow->min_seq) flow->min_seq = other.min_seq;
+        if (other.max_seq > flow->max_seq) flow->max_seq = other.max_seq;
+        if (other.delay_min < flow->delay_min) flow->delay_min = other.delay_min;
+        if (other.delay_max > flow->delay_max) flow->delay_max = other.delay_max;
+        flow->delay_sum += other.delay_sum;
+        flow->count += other.count;
+        flow->bytes += other.bytes;
+        flow->logged += other.logged;
+        flow->last_time = other.last_time;
+        flow->last_seq = other.last_seq;
+    }
+    return true;
+}  // end MgenLogConverter::FlowTable::Merge()
+
+
+MgenLogConverter::MgenLogConverter()
+ : mgen(NULL), log_file(NULL), summarize(false), local_time(false), epoch_time(false),
+   log_rx(true), log_data(true), log_gps_data(true), log_flush(false), relog(false),
+   log_encoding(MgenLogEncoder::TEXT),
+   file_data(NULL), file_size(0), mapped(false), record_end(0), input_error(false),
+   is_v3(false), chunk_list(NULL), chunk_count(0), chunk_size(0), flow_table(NULL)
+#ifdef HAVE_PTHREAD
+   ,thread_count(0), next_chunk(0), write_chunk(0), window(0), abort(false)
+#endif // HAVE_PTHREAD
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+#endif // HAVE_PTHREAD
+}
+
+MgenLogConverter::~MgenLogConverter()
+{
+    Close();
+#ifdef HAVE_PTHREAD
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+#endif // HAVE_PTHREAD
+}
+
+void MgenLogConverter::Close()
+{
+    for (unsigned int i = 0; i < chunk_count; i++)
+    {
+        Chunk& chunk = chunk_list[i];
+        if (NULL != chunk.text) free(chunk.text);
+        if (NULL != chunk.deferred) free(chunk.deferred);
+        if (NULL != chunk.flows) delete chunk.flows;
+    }
+    if (NULL != chunk_list) free(chunk_list);
+    chunk_list = NULL;
+    chunk_count = chunk_size = 0;
+    if (NULL != flow_table)
+    {
+        delete flow_table;
+        flow_table = NULL;
+    }
+    MgenLogStream::UnmapFile(file_data, file_size, mapped);
+    file_data = NULL;
+    mapped = false;
+    file_size = record_end = 0;
+    input_error = false;
+    reader.Close();
+    is_v3 = false;
+}  // end MgenLogConverter::Close()
+
+bool MgenLogConverter::OpenLegacy(const char* path)
+{
+    return MgenLogStream::MapFile(path, file_data, file_size, mapped);
+}  // end MgenLogConverter::OpenLegacy()
+
+bool MgenLogConverter::AddChunk(uint64_t start, uint64_t end)
+{
+    if (chunk_count == chunk_size)
+    {
+        unsigned int newSize = (0 != chunk_size) ? (2 * chunk_size) : 256;
+        Chunk* newList = (Chunk*)realloc(chunk_list, newSize * sizeof(Chunk));
+        if (NULL == newList)
+        {
+            PLOG(PL_ERROR, "MgenLogConverter::AddChunk() realloc() error: %s\n", GetErrorString());
+            return false;
+        }
+        chunk_list = newList;
+        chunk_size = newSize;
+    }
+    Chunk& chunk = chunk_list[chunk_count++];
+    memset(&chunk, 0, sizeof(Chunk));
+    chunk.start = start;
+    chunk.end = end;
+    return true;
+}  // end MgenLogConverter::AddChunk()
+
+// Checks the header line (as MgenMsg::ConvertBinaryLog() does) and walks
+// the record headers to find chunk boundaries
+bool MgenLogConverter::SplitLegacy()
+{
+    const char* end = (NULL != file_data) ? (const char*)memchr(file_data, '\0', (size_t)file_size) : NULL;
+    if ((file_size < 4) || (0 != strncmp("mgen", file_data, 4)) || (NULL == end))
+    {
+        DMSG(0, "MgenLogConverter::SplitLegacy() error: invalid mgen log file\n");
+        return false;
+    }
+    const char* ptr = strstr(file_data, "version=");
+    int version;
+    if ((NULL == ptr) || (1 != sscanf(ptr, "version=%d", &version)))
+    {
+        DMSG(0, "MgenLogConverter::SplitLegacy() error finding log \"version\"\n");
+        return false;
+    }
+    if ((version != 4) && (version != 5))
+    {
+        DMSG(0, "MgenLogConverter::SplitLegacy() invalid log file version\n");
+        return false;
+    }
+    ptr = strstr(ptr, "type=");
+    char fileType[128];
+    if ((NULL == ptr) || (1 != sscanf(ptr, "type=%127s", fileType)))
+    {
+        DMSG(0, "MgenLogConverter::SplitLegacy() error finding log \"type\"\n");
+        return false;
+    }
+    if (0 != strcmp(fileType, "binary_log"))
+    {
+        DMSG(0, "MgenLogConverter::SplitLegacy() invalid log file type\n");
+        return false;
+    }
+    uint64_t offset = (uint64_t)(end - file_data) + 1;
+    uint64_t chunkStart = offset;
+    while ((offset + 4) <= file_size)
+    {
+        UINT16 recordLength;
+        memcpy(&recordLength, file_data + offset + 2, sizeof(UINT16));
+        recordLength = ntohs(recordLength);
+        if (recordLength > MgenMsg::BINARY_RECORD_MAX)
+        {
+            DMSG(0, "MgenLogConverter::SplitLegacy() record len:%hu exceeds maximum length\n", recordLength);
+            input_error = true;
+            break;
+        }
+        if ((offset + 4 + recordLength) > file_size)
+        {
+            DMSG(0, "MgenLogConverter::SplitLegacy() error: truncated record\n");
+            input_error = true;
+            break;
+        }
+        offset += 4 + recordLength;
+        if ((offset - chunkStart) >= CHUNK_SIZE)
+        {
+            if (!AddChunk(chunkStart, offset)) return false;
+            chunkStart = offset;
+        }
+    }
+    if ((offset > chunkStart) && !AddChunk(chunkStart, offset)) return false;
+    record_end = offset;
+    return true;
+}  // end MgenLogConverter::SplitLegacy()
+
+bool MgenLogConverter::SplitV3()
+{
+    const uint64_t chunkSlots = CHUNK_SIZE / MgenBinaryLog::RECORD_SIZE;
+    uint64_t end = reader.GetRecordEnd();
+    for (uint64_t slot = 1; slot < end; slot += chunkSlots)
+    {
+        if (!AddChunk(slot, ((end - slot) > chunkSlots) ? (slot + chunkSlots) : end))
+            return false;
+    }
+    return true;
+}  // end MgenLogConverter::SplitV3()
+
+// Formats (or tallies) a SEND or RECV event, returning "false" if
+// it needs to be converted through MgenMsg by the writer
+bool MgenLogConverter::FormatMsg(Chunk& chunk, MgenLogFormatter& formatter, MgenMsg& msg,
+                                 LogEventType eventType, const struct timeval& eventTime, int ttl)
+{
+    if (relog) return false;  // (to the v3 binary log)
+    if (summarize)
+    {
+        if (NULL == chunk.flows)
+        {
+            if (NULL == (chunk.flows = new FlowTable))
+            {
+                chunk.failed = true;
+                return true;
+            }
+        }
+        if (!chunk.flows->Add(eventType, msg, eventTime)) chunk.failed = true;
+        return true;
+    }
+    MgenLogRecord record;
+    if (RECV_EVENT == eventType)
+    {
+        if (!log_rx)
+        {
+            // Only analytic REPORTs (MGEN_DATA content) are logged
+            return ((0 == msg.GetPayloadLength()) || (MgenMsg::MGEN_DATA != msg.GetPayloadType()));
+        }
+        if (!MgenLogFormatter::InitRecv(record, msg, eventTime, log_data, log_gps_data, ttl))
+            return false;
+    }
+    else if (!MgenLogFormatter::InitSend(record, msg, eventTime))
+    {
+        return false;
+    }
+    if ((chunk.text_size - chunk.text_len) < MgenLogFormatter::OUTPUT_LINE_MAX)
+    {
+        unsigned int newSize = (0 != chunk.text_size) ? (2 * chunk.text_size) : (2 * CHUNK_SIZE);
+        char* newText = (char*)realloc(chunk.text, newSize);
+        if (NULL == newText)
+        {
+            chunk.failed = true;
+            return true;
+        }
+        chunk.text = newText;
+        chunk.text_size = newSize;
+    }
+    char* buffer = chunk.text + chunk.text_len;
+    if (RECV_EVENT == eventType)
+        chunk.text_len += formatter.FormatRecv(buffer, record);
+    else
+        chunk.text_len += formatter.FormatSend(buffer, record);
+    return true;
+}  // end MgenLogConverter::FormatMsg()
+
+void MgenLogConverter::ProcessChunk(Chunk& chunk, MgenLogFormatter& formatter)
+{
+    UINT32 alignedBuffer[MgenMsg::BINARY_RECORD_MAX/4];
+    uint64_t position = chunk.start;
+    while ((position < chunk.end) && !chunk.failed)
+    {
+        bool deferred = true;
+        if (is_v3)
+        {
+            if (!MgenBinaryLog::IsEvent(reader.GetSlotType(position)))
+            {
+                position++;  // dictionary, index, etc slots
+                continue;
+            }
+            chunk.record_count++;
+            MgenBinaryLog::Record record;
+            MgenBinaryLog::UnpackRecord(reader.GetSlot(position), record);
+            LogEventType eventType = (LogEventType)record.type;
+            if ((RECV_EVENT == eventType) || (SEND_EVENT == eventType))
+            {
+                MgenMsg msg;
+                msg.UnpackBinaryRecord(reader, record);
+                if ((RECV_EVENT == eventType) && (0 != record.aux))
+                {
+                    // Only the payload type and length are needed to
+                    // know if the writer has to log the content
+                    char data[1];
+                    MgenBinaryLog::EntryKind kind;
+                    unsigned int len = reader.GetData(record.aux, data, 0, &kind);
+                    if (0 != len)
+                        msg.SetPayload((MgenBinaryLog::MGEN_PAYLOAD == kind) ? MgenMsg::MGEN_DATA : MgenMsg::USER_DATA,
+                                       NULL, (UINT16)len);
+                }
+                int ttl = (0 != (record.info & MgenBinaryLog::INFO_TTL)) ? record.ttl : -1;
+                deferred = !FormatMsg(chunk, formatter, msg, eventType, record.event_time, ttl);
+            }
+        }
+        else
+        {
+            const char* header = file_data + position;
+            LogEventType eventType = (LogEventType)header[0];
+            UINT16 recordLength;
+            memcpy(&recordLength, header + 2, sizeof(UINT16));
+            recordLength = ntohs(recordLength);
+            chunk.record_count++;
+            if ((RECV_EVENT == eventType) || (SEND_EVENT == eventType))
+            {
+                memcpy(alignedBuffer, header + 4, recordLength);
+                MgenMsg msg;
+                struct timeval eventTime;
+                if (msg.UnpackBinaryRecord(eventType, (Protocol)header[1], alignedBuffer,
+                                           recordLength, log_data, eventTime))
+                    deferred = !FormatMsg(chunk, formatter, msg, eventType, eventTime, -1);
+            }
+        }
+        if (deferred && !summarize)
+        {
+            if (chunk.deferred_count == chunk.deferred_size)
+            {
+                unsigned int newSize = (0 != chunk.deferred_size) ? (2 * chunk.deferred_size) : 64;
+                Chunk::Deferred* newList =
+                    (Chunk::Deferred*)realloc(chunk.deferred, newSize * sizeof(Chunk::Deferred));
+                if (NULL == newList)
+                {
+                    chunk.failed = true;
+                    break;
+                }
+                chunk.deferred = newList;
+                chunk.deferred_size = newSize;
+            }
+            Chunk::Deferred& entry = chunk.deferred[chunk.deferred_count++];
+            entry.text_offset = chunk.text_len;
+            entry.position = position;
+        }
+        // Advance to the next record
+        if (is_v3)
+        {
+            position++;
+        }
+        else
+        {
+            UINT16 recordLength;
+            memcpy(&recordLength, file_data + position + 2, sizeof(UINT16));
+            position += 4 + ntohs(recordLength);
+        }
+    }
+}  // end MgenLogConverter::ProcessChunk()
+
+void MgenLogConverter::WriteText(const char* text, unsigned int len)
+{
+    if (0 == len) return;
+    if ((Mgen::LogFunction)fprintf == Mgen::Log)
+        fwrite(text, 1, len, log_file);
+    else
+        Mgen::Log(log_file, "%.*s", (int)len, text);
+}  // end MgenLogConverter::WriteText()
+
+bool MgenLogConverter::ConvertRecord(uint64_t position)
+{
+    if (is_v3)
+    {
+        MgenBinaryLog::Record record;
+        MgenBinaryLog::UnpackRecord(reader.GetSlot(position), record);
+        MgenMsg::ConvertBinaryRecord(reader, record, *mgen);
+        return true;  // (bad v3 records are skipped)
+    }
+    const char* header = file_data + position;
+    UINT16 recordLength;
+    memcpy(&recordLength, header + 2, sizeof(UINT16));
+    recordLength = ntohs(recordLength);
+    UINT32 alignedBuffer[MgenMsg::BINARY_RECORD_MAX/4];
+    memcpy(alignedBuffer, header + 4, recordLength);
+    return MgenMsg::ConvertBinaryRecord((LogEventType)header[0], (Protocol)header[1],
+                                        alignedBuffer, recordLength, *mgen);
+}  // end MgenLogConverter::ConvertRecord()
+
+// Writes (or merges) a chunk and frees its buffers
+bool MgenLogConverter::WriteChunk(Chunk& chunk)
+{
+    bool result = !chunk.failed;
+    if (!result)
+        PLOG(PL_ERROR, "MgenLogConverter::WriteChunk() error: out of memory\n");
+    if (summarize)
+    {
+        if (result && (NULL != chunk.flows))
+        {
+            if (NULL == flow_table) flow_table = new FlowTable;
+            result = (NULL != flow_table) && flow_table->Merge(*chunk.flows);
+        }
+    }
+    else if (result)
+    {
+        unsigned int offset = 0;
+        for (unsigned int i = 0; i < chunk.deferred_count; i++)
+        {
+            const Chunk::Deferred& entry = chunk.deferred[i];
+            WriteText(chunk.text + offset, entry.text_offset - offset);
+            offset = entry.text_offset;
+            if (!ConvertRecord(entry.position))
+            {
+                result = false;
+                break;
+            }
+        }
+        if (result) WriteText(chunk.text + offset, chunk.text_len - offset);
+        if (log_flush) fflush(log_file);
+    }
+    if (NULL != chunk.text) free(chunk.text);
+    if (NULL != chunk.deferred) free(chunk.deferred);
+    if (NULL != chunk.flows) delete chunk.flows;
+    chunk.text = NULL;
+    chunk.deferred = NULL;
+    chunk.flows = NULL;
+    chunk.text_len = chunk.text_size = chunk.deferred_count = chunk.deferred_size = 0;
+    return result;
+}  // end MgenLogConverter::WriteChunk()
+
+// One "FLOW" line per flow, in order of first appearance
+void MgenLogConverter::LogSummary()
+{
+    if (NULL == flow_table) return;
+    MgenLogFormatter formatter;
+    formatter.SetTimeFormat(local_time, epoch_time);
+    for (unsigned int i = 0; i < flow_table->GetCount(); i++)
+    {
+        const FlowTable::Flow& flow = flow_table->GetFlow(i);
+        const FlowTable::Key& key = flow.key;
+        char buffer[MgenLogFormatter::OUTPUT_LINE_MAX];
+        unsigned int len = formatter.FormatTimestamp(buffer, flow.first_time);
+        len += MgenLogFormatter::FormatString(buffer + len, "FLOW proto>");
+        len += MgenLogFormatter::FormatString(buffer + len, MgenEvent::GetStringFromProtocol((Protocol)key.protocol));
+        len += MgenLogFormatter::FormatString(buffer + len, " flow>");
+        len += MgenLogFormatter::FormatUnsigned(buffer + len, key.flow_id);
+        if ((4 == key.src_len) || (16 == key.src_len))
+        {
+            len += MgenLogFormatter::FormatString(buffer + len, " src>");
+            len += MgenLogFormatter::FormatAddress(buffer + len, key.src_addr, key.src_len, key.src_port);
+        }
+        else
+        {
+            len += MgenLogFormatter::FormatString(buffer + len, " srcPort>");
+            len += MgenLogFormatter::FormatUnsigned(buffer + len, key.src_port);
+        }
+        if ((4 == key.dst_len) || (16 == key.dst_len))
+        {
+            len += MgenLogFormatter::FormatString(buffer + len, " dst>");
+            len += MgenLogFormatter::FormatAddress(buffer + len, key.dst_addr, key.dst_len, key.dst_port);
+        }
+        else
+        {
+            len += MgenLogFormatter::FormatString(buffer + len, " dstPort>");
+            len += MgenLogFormatter::FormatUnsigned(buffer + len, key.dst_port);
+        }
+        double duration = (double)(flow.last_time.tv_sec - flow.first_time.tv_sec) +
+                          1.0e-06 * (double)(flow.last_time.tv_usec - flow.first_time.tv_usec);
+        double rate = (duration > 0.0) ? ((8.0e-03 * (double)flow.bytes) / duration) : 0.0;
+        len += snprintf(buffer + len, sizeof(buffer) - len,
+                        " %s>%lu bytes>%llu duration>%lf rate>%lf kbps seq>%lu-%lu",
+                        (SEND_EVENT == key.type) ? "sent" : "recv", flow.count, flow.bytes,
+                        duration, rate, (unsigned long)flow.min_seq, (unsigned long)flow.max_seq);
+        if (RECV_EVENT == key.type)
+        {
+            unsigned long expected = (unsigned long)(flow.max_seq - flow.min_seq) + 1;
+            unsigned long lost = (expected > flow.count) ? (expected - flow.count) : 0;
+            len += snprintf(buffer + len, sizeof(buffer) - len,
+                            " lost>%lu reordered>%lu latency ave>%lf min>%lf max>%lf",
+                            lost, flow.reordered, flow.delay_sum / (double)flow.logged,
+                            flow.delay_min, flow.delay_max);
+        }
+        if (flow.logged != flow.count)
+            len += snprintf(buffer + len, sizeof(buffer) - len, " sampled>%lu", flow.logged);
+        if (len > (sizeof(buffer) - 1)) len = sizeof(buffer) - 1;
+        buffer[len++] = '\n';
+        WriteText(buffer, len);
+    }
+}  // end MgenLogConverter::LogSummary()
+
+#ifdef HAVE_PTHREAD
+void* MgenLogConverter::ThreadMain(void* arg)
+{
+    ((MgenLogConverter*)arg)->Run();
+    return NULL;
+}  // end MgenLogConverter::ThreadMain()
+
+void MgenLogConverter::Run()
+{
+    MgenLogFormatter formatter;
+    formatter.SetTimeFormat(local_time, epoch_time);
+    formatter.SetEncoding(log_encoding);
+    pthread_mutex_lock(&lock);
+    while (true)
+    {
+        while (!abort && (next_chunk < chunk_count) && (next_chunk >= (write_chunk + window)))
+            pthread_cond_wait(&cond, &lock);
+        if (abort || (next_chunk >= chunk_count)) break;
+        Chunk& chunk = chunk_list[next_chunk++];
+        pthread_mutex_unlock(&lock);
+        ProcessChunk(chunk, formatter);
+        pthread_mutex_lock(&lock);
+        chunk.done = true;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+}  // end MgenLogConverter::Run()
+#endif // HAVE_PTHREAD
+
+bool MgenLogConverter::Convert(const char* path, Mgen& theMgen, bool summary, unsigned int threadCount)
+{
+    Close();
+    mgen = &theMgen;
+    log_file = theMgen.GetLogFile();
+    if (NULL == log_file) return false;
+    summarize = summary;
+    local_time = theMgen.GetLocalTime();
+    epoch_time = (Mgen::LogTimestamp == Mgen::LogEpochTimestamp);
+    log_rx = theMgen.GetLogRx();
+    log_data = theMgen.GetLogData();
+    log_gps_data = theMgen.GetLogGpsData();
+    log_flush = theMgen.GetLogFlush();
+    relog = (NULL != MgenBinaryLog::GetActive(log_file)) && !summarize;
+    log_encoding = summarize ? MgenLogEncoder::TEXT : MgenLogEncoder::GetActive(log_file);
+
+    struct timeval startTime;
+    ProtoSystemTime(startTime);
+    is_v3 = MgenBinaryLogReader::IsBinaryLogV3(path);
+    if (is_v3)
+    {
+        if (!reader.Open(path))
+        {
+            DMSG(0, "MgenLogConverter::Convert() error: unable to open \"%s\"\n", path);
+            return false;
+        }
+        if (!SplitV3())
+        {
+            Close();
+            return false;
+        }
+    }
+    else if (!OpenLegacy(path) || !SplitLegacy())
+    {
+        Close();
+        return false;
+    }
+    if (0 == threadCount)
+    {
+#if defined(HAVE_PTHREAD) && defined(UNIX)
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = (cpuCount > 0) ? (unsigned int)cpuCount : 1;
+#else
+        threadCount = 1;
+#endif // if/else HAVE_PTHREAD && UNIX
+    }
+    if (relog) threadCount = 1;  // MgenMsg does all the work
+    if (threadCount > THREAD_MAX) threadCount = THREAD_MAX;
+    if (threadCount > chunk_count) threadCount = chunk_count;
+
+    if (MgenLogEncoder::CSV == log_encoding)
+    {
+        char header[MgenLogEncoder::HEADER_MAX];
+        WriteText(header, MgenLogEncoder::FormatHeader(header));
+    }
+
+    bool result = true;
+    unsigned long recordCount = 0;
+    unsigned int chunkIndex = 0;
+#ifdef HAVE_PTHREAD
+    thread_count = 0;
+    next_chunk = write_chunk = 0;
+    window = 2 * threadCount;
+    abort = false;
+    if (threadCount > 1)
+    {
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            if (0 != pthread_create(&thread_list[i], NULL, ThreadMain, this))
+            {
+                PLOG(PL_WARN, "MgenLogConverter::Convert() pthread_create() error: %s\n", GetErrorString());
+                break;
+            }
+            thread_count++;
+        }
+    }
+    if (0 != thread_count)
+    {
+        // Write chunks in order as the workers finish them
+        for (; chunkIndex < chunk_count; chunkIndex++)
+        {
+            Chunk& chunk = chunk_list[chunkIndex];
+            pthread_mutex_lock(&lock);
+            while (!chunk.done) pthread_cond_wait(&cond, &lock);
+            pthread_mutex_unlock(&lock);
+            recordCount += chunk.record_count;
+            result = WriteChunk(chunk);
+            pthread_mutex_lock(&lock);
+            write_chunk = chunkIndex + 1;
+            if (!result) abort = true;
+            pthread_cond_broadcast(&cond);
+            pthread_mutex_unlock(&lock);
+            if (!result) break;
+        }
+        for (unsigned int i = 0; i < thread_count; i++)
+            pthread_join(thread_list[i], NULL);
+        threadCount = thread_count;
+        thread_count = 0;
+    }
+    else
+#endif // HAVE_PTHREAD
+    {
+        threadCount = 1;
+        MgenLogFormatter formatter;
+        formatter.SetTimeFormat(local_time, epoch_time);
+        formatter.SetEncoding(log_encoding);
+        for (; chunkIndex < chunk_count; chunkIndex++)
+        {
+            Chunk& chunk = chunk_list[chunkIndex];
+            ProcessChunk(chunk, formatter);
+            recordCount += chunk.record_count;
+            if (!(result = WriteChunk(chunk))) break;
+        }
+    }
+    if (result && summarize) LogSummary();
+    fflush(log_file);
+    if (result && input_error) result = false;  // (reported by SplitLegacy())
+
+    struct timeval stopTime;
+    ProtoSystemTime(stopTime);
+    double elapsed = (double)(stopTime.tv_sec - startTime.tv_sec) +
+                     1.0e-06 * (double)(stopTime.tv_usec - startTime.tv_usec);
+    PLOG(PL_INFO, "MgenLogConverter::Convert() %lu records in %lf sec (%lf records/sec) threads>%u\n",
+         recordCount, elapsed, (elapsed > 0.0) ? ((double)recordCount / elapsed) : 0.0, threadCount);
+    Close();
+    return result;
+}  // end MgenLogConverter::Convert()
@@ -0,0 +1,597 @@
+#include "mgenLogFormat.h"
+#include "mgenMsg.h"
+#include "mgenEvent.h"  // for GetStringFromProtocol()
+
+#include <string.h>
+#include <stdio.h>
+#include <float.h>   // for DBL_MAX
+#include <ctype.h>   // for toupper()
+#ifdef WIN32
+#include <ws2tcpip.h>   // for inet_ntop()
+#else
+#include <arpa/inet.h>  // for inet_ntop()
+#endif // if/else WIN32
+
+// CSV header names (and JSON member names), in Column order
+static const char* const COLUMN_NAME[MgenLogEncoder::COLUMN_COUNT] =
+{
+    "time", "event", "proto", "flow", "seq", "src", "srcPort", "dst", "dstPort",
+    "host", "hostPort", "sent", "size", "ttl", "gps", "lat", "lon", "alt", "data",
+    "flags", "sample", "port", "group", "source", "interface", "error",
+    "reporter", "reporterPort", "offset", "window", "rate", "loss",
+    "latencyAve", "latencyMin", "latencyMax", "version"
+};
+
+// Indexed by LogEventType
+static const char* const EVENT_NAME[] =
+{
+    "INVALID", "RECV", "RERR", "SEND", "LISTEN", "IGNORE", "JOIN", "LEAVE",
+    "START", "STOP", "ON", "ACCEPT", "DISCONNECT", "CONNECT", "OFF",
+    "SHUTDOWN", "RECONNECT"
+};
+
+static const char HEX_DIGIT[] = "0123456789abcdef";
+static const char DATA_DIGIT[] = "0123456789ABCDEF";  // as the text log "data>"
+
+// The text log file and its encoding (there is one log file at a time)
+static FILE* active_file = NULL;
+static MgenLogEncoder::Encoding active_encoding = MgenLogEncoder::TEXT;
+
+MgenLogEncoder::MgenLogEncoder(Encoding theEncoding)
+ : encoding(theEncoding), scratch_len(0), hex_data(NULL), hex_len(0)
+{
+    memset(values, 0, sizeof(values));
+}
+
+MgenLogEncoder::Encoding MgenLogEncoder::GetEncodingFromString(const char* string)
+{
+    // Make comparison case-insensitive
+    char upperString[8];
+    size_t len = strlen(string);
+    if (len >= sizeof(upperString)) return INVALID_ENCODING;
+    unsigned int i;
+    for (i = 0; i < len; i++)
+        upperString[i] = toupper(string[i]);
+    upperString[i] = '\0';
+    if (0 == strcmp(upperString, "TEXT"))
+        return TEXT;
+    else if (0 == strcmp(upperString, "JSON"))
+        return JSON;
+    else if (0 == strcmp(upperString, "CSV"))
+        return CSV;
+    else
+        return INVALID_ENCODING;
+}  // end MgenLogEncoder::GetEncodingFromString()
+
+MgenLogEncoder::Encoding MgenLogEncoder::GetActive(FILE* filePtr)
+{
+    return (((NULL != filePtr) && (filePtr == active_file)) ? active_encoding : TEXT);
+}  // end MgenLogEncoder::GetActive()
+
+void MgenLogEncoder::SetActive(FILE* filePtr, Encoding theEncoding)
+{
+    active_file = filePtr;
+    active_encoding = theEncoding;
+}  // end MgenLogEncoder::SetActive()
+
+void MgenLogEncoder::Begin(LogEventType eventType, const struct timeval& eventTime)
+{
+    unsigned int index = (unsigned int)eventType;
+    if (index >= (sizeof(EVENT_NAME) / sizeof(const char*))) index = 0;
+    Begin(EVENT_NAME[index], eventTime);
+}  // end MgenLogEncoder::Begin()
+
+void MgenLogEncoder::Begin(const char* eventName, const struct timeval& eventTime)
+{
+    memset(values, 0, sizeof(values));
+    scratch_len = 0;
+    hex_data = NULL;
+    hex_len = 0;
+    SetTime(COL_TIME, eventTime);
+    SetString(COL_EVENT, eventName);
+}  // end MgenLogEncoder::Begin()
+
+// Returns NULL (leaving the column unset) if the scratch space is used up
+char* MgenLogEncoder::Reserve(Column column, Kind kind, unsigned int len)
+{
+    if ((scratch_len + len) > SCRATCH_MAX)
+    {
+        values[column].kind = NONE;
+        return NULL;
+    }
+    values[column].kind = kind;
+    values[column].offset = scratch_len;
+    values[column].len = 0;
+    return (scratch + scratch_len);
+}  // end MgenLogEncoder::Reserve()
+
+void MgenLogEncoder::SetString(Column column, const char* text)
+{
+    if (NULL == text) return;
+    unsigned int len = strlen(text);
+    char* ptr = Reserve(column, STRING, len);
+    if (NULL == ptr) return;
+    memcpy(ptr, text, len);
+    Commit(column, len);
+}  // end MgenLogEncoder::SetString()
+
+void MgenLogEncoder::SetUnsigned(Column column, unsigned long value)
+{
+    char* ptr = Reserve(column, NUMBER, 24);
+    if (NULL == ptr) return;
+    Commit(column, MgenLogFormatter::FormatUnsigned(ptr, value));
+}  // end MgenLogEncoder::SetUnsigned()
+
+void MgenLogEncoder::SetSigned(Column column, long value)
+{
+    char* ptr = Reserve(column, NUMBER, 24);
+    if (NULL == ptr) return;
+    unsigned int len = 0;
+    if (value < 0)
+    {
+        ptr[len++] = '-';
+        len += MgenLogFormatter::FormatUnsigned(ptr + len, 0UL - (unsigned long)value);
+    }
+    else
+    {
+        len = MgenLogFormatter::FormatUnsigned(ptr, (unsigned long)value);
+    }
+    Commit(column, len);
+}  // end MgenLogEncoder::SetSigned()
+
+void MgenLogEncoder::SetDouble(Column column, double value)
+{
+    // NaN and infinity have no JSON representation
+    if ((value != value) || (value > DBL_MAX) || (value < -DBL_MAX)) return;
+    char* ptr = Reserve(column, NUMBER, 64);
+    if (NULL == ptr) return;
+    int len = snprintf(ptr, 64, "%f", value);
+    if ((len <= 0) || (len >= 64))
+    {
+        values[column].kind = NONE;
+        return;
+    }
+    Commit(column, (unsigned int)len);
+}  // end MgenLogEncoder::SetDouble()
+
+void MgenLogEncoder::SetTime(Column column, const struct timeval& theTime)
+{
+    char* ptr = Reserve(column, NUMBER, MgenTimestampFormatter::MAX_LENGTH);
+    if (NULL == ptr) return;
+    // (without the trailing space)
+    Commit(column, timestamp_formatter.FormatEpoch(ptr, theTime) - 1);
+}  // end MgenLogEncoder::SetTime()
+
+void MgenLogEncoder::SetAddress(Column addrColumn, Column portColumn,
+                                const char* addr, unsigned int addrLen, UINT16 port)
+{
+    char* ptr = Reserve(addrColumn, STRING, 64);
+    if (NULL == ptr) return;
+    // MgenLogFormatter::FormatAddress() gives "<addr>/<port>"
+    char text[80];
+    unsigned int len = MgenLogFormatter::FormatAddress(text, addr, addrLen, port);
+    while ((len > 0) && ('/' != text[len - 1])) len--;
+    if (len > 0) len--;
+    if (len > 64) len = 64;
+    memcpy(ptr, text, len);
+    Commit(addrColumn, len);
+    if (COLUMN_COUNT != portColumn) SetUnsigned(portColumn, port);
+}  // end MgenLogEncoder::SetAddress()
+
+void MgenLogEncoder::SetAddress(Column addrColumn, Column portColumn, const ProtoAddress& addr)
+{
+    unsigned int addrLen = addr.GetLength();
+    if ((4 == addrLen) || (16 == addrLen))
+    {
+        SetAddress(addrColumn, portColumn, addr.GetRawHostAddress(), addrLen, addr.GetPort());
+    }
+    else
+    {
+        SetString(addrColumn, addr.GetHostString());
+        if (COLUMN_COUNT != portColumn) SetUnsigned(portColumn, addr.GetPort());
+    }
+}  // end MgenLogEncoder::SetAddress()
+
+void MgenLogEncoder::SetHex(Column column, const char* data, unsigned int len)
+{
+    // (only one column is hex encoded at a time)
+    values[column].kind = HEX;
+    hex_data = data;
+    hex_len = len;
+}  // end MgenLogEncoder::SetHex()
+
+unsigned int MgenLogEncoder::GetMaxLength() const
+{
+    // Member names, quoting and separators, JSON "\u00XX" escapes of the
+    // strings and the hex data
+    return (HEADER_MAX + 4*COLUMN_COUNT + 6*scratch_len + 2*hex_len + 4);
+}  // end MgenLogEncoder::GetMaxLength()
+
+unsigned int MgenLogEncoder::Finish(char* buffer)
+{
+    unsigned int len = 0;
+    if (JSON == encoding) buffer[len++] = '{';
+    bool first = true;
+    for (unsigned int i = 0; i < COLUMN_COUNT; i++)
+    {
+        const Value& value = values[i];
+        if (JSON == encoding)
+        {
+            if (NONE == value.kind) continue;
+            if (!first) buffer[len++] = ',';
+            buffer[len++] = '"';
+            len += MgenLogFormatter::FormatString(buffer + len, COLUMN_NAME[i]);
+            buffer[len++] = '"';
+            buffer[len++] = ':';
+        }
+        else if (0 != i)
+        {
+            buffer[len++] = ',';
+        }
+        first = false;
+        const char* text = scratch + value.offset;
+        switch (value.kind)
+        {
+            case NUMBER:
+                memcpy(buffer + len, text, value.len);
+                len += value.len;
+                break;
+            case STRING:
+                if (JSON == encoding)
+                {
+                    buffer[len++] = '"';
+                    for (unsigned int j = 0; j < value.len; j++)
+                    {
+                        unsigned char c = (unsigned char)text[j];
+                        if (('"' == c) || ('\\' == c))
+                        {
+                            buffer[len++] = '\\';
+                            buffer[len++] = c;
+                        }
+                        else if (c < 0x20)
+                        {
+                            len += MgenLogFormatter::FormatString(buffer + len, "\\u00");
+                            buffer[len++] = HEX_DIGIT[c >> 4];
+                            buffer[len++] = HEX_DIGIT[c & 0x0f];
+                        }
+                        else
+                        {
+                            buffer[len++] = c;
+                        }
+                    }
+                    buffer[len++] = '"';
+                }
+                else
+                {
+                    // Quoted (with quotes doubled) only if needed
+                    bool quote = false;
+                    for (unsigned int j = 0; j < value.len; j++)
+                    {
+                        char c = text[j];
+                        if ((',' == c) || ('"' == c) || ('\n' == c) || ('\r' == c))
+                        {
+                            quote = true;
+                            break;
+                        }
+                    }
+                    if (quote) buffer[len++] = '"';
+                    for (unsigned int j = 0; j < value.len; j++)
+                    {
+                        if ('"' == text[j]) buffer[len++] = '"';
+                        buffer[len++] = text[j];
+                    }
+                    if (quote) buffer[len++] = '"';
+                }
+                break;
+            case HEX:
+                if (JSON == encoding) buffer[len++] = '"';
+                for (unsigned int j = 0; j < hex_len; j++)
+                {
+                    unsigned char c = (unsigned char)hex_data[j];
+                    buffer[len++] = DATA_DIGIT[c >> 4];
+                    buffer[len++] = DATA_DIGIT[c & 0x0f];
+                }
+                if (JSON == encoding) buffer[len++] = '"';
+                break;
+            default:
+                break;  // empty CSV field
+        }
+    }
+    if (JSON == encoding) buffer[len++] = '}';
+    buffer[len++] = '\n';
+    return len;
+}  // end MgenLogEncoder::Finish()
+
+unsigned int MgenLogEncoder::FormatHeader(char* buffer)
+{
+    unsigned int len = 0;
+    for (unsigned int i = 0; i < COLUMN_COUNT; i++)
+    {
+        if (0 != i) buffer[len++] = ',';
+        len += MgenLogFormatter::FormatString(buffer + len, COLUMN_NAME[i]);
+    }
+    buffer[len++] = '\n';
+    return len;
+}  // end MgenLogEncoder::FormatHeader()
+
+MgenLogFormatter::MgenLogFormatter()
+ : encoder(MgenLogEncoder::TEXT), local_time(false), epoch_time(false)
+{
+}
+
+bool MgenLogFormatter::InitRecv(MgenLogRecord& record, MgenMsg& theMsg, const struct timeval& rxTime,
+                                bool logData, bool logGpsData, int ttl)
+{
+    // These need MgenMsg::LogRecvEvent()
+    if (0 != theMsg.GetPayloadLength())
+    {
+        if ((MgenMsg::MGEN_DATA == theMsg.GetPayloadType()) || logData)
+            return false;
+    }
+    const ProtoAddress& srcAddr = theMsg.GetSrcAddr();
+    const ProtoAddress& dstAddr = theMsg.GetDstAddr();
+    const ProtoAddress& hostAddr = theMsg.GetHostAddr();
+    unsigned int srcLen = srcAddr.GetLength();
+    unsigned int dstLen = dstAddr.GetLength();
+    unsigned int hostLen = hostAddr.IsValid() ? hostAddr.GetLength() : 0;
+    if (((4 != srcLen) && (16 != srcLen)) || ((4 != dstLen) && (16 != dstLen)) ||
+        ((0 != hostLen) && (4 != hostLen) && (16 != hostLen)))
+    {
+        return false;  // non-IP addresses
+    }
+    UINT8 gpsStatus = theMsg.GetGPSStatus();
+    if ((MgenMsg::INVALID_GPS != gpsStatus) && (MgenMsg::STALE != gpsStatus) &&
+        (MgenMsg::CURRENT != gpsStatus))
+    {
+        return false;
+    }
+    record.rx_time = rxTime;
+    record.tx_time = theMsg.GetTxTime();
+    record.flow_id = theMsg.GetFlowId();
+    record.seq_num = theMsg.GetSeqNum();
+    record.msg_len = theMsg.GetMsgLen();
+    record.sample = theMsg.GetLogSample();
+    record.ttl = (ttl < 0) ? -1 : (INT16)ttl;
+    record.protocol = (UINT8)theMsg.GetProtocol();
+    record.flags = 0;
+    if (theMsg.FlagIsSet(MgenMsg::CONTINUES)) record.flags |= MgenMsg::CONTINUES;
+    if (theMsg.FlagIsSet(MgenMsg::END_OF_MSG)) record.flags |= MgenMsg::END_OF_MSG;
+    if (theMsg.FlagIsSet(MgenMsg::CHECKSUM_ERROR)) record.flags |= MgenMsg::CHECKSUM_ERROR;
+    record.gps_status = logGpsData ? gpsStatus : 0xff;
+    record.latitude = theMsg.GetGPSLatitude();
+    record.longitude = theMsg.GetGPSLongitude();
+    record.altitude = theMsg.GetGPSAltitude();
+    record.src_len = srcLen;
+    record.src_port = srcAddr.GetPort();
+    memcpy(record.src_addr, srcAddr.GetRawHostAddress(), srcLen);
+    record.dst_len = dstLen;
+    record.dst_port = dstAddr.GetPort();
+    memcpy(record.dst_addr, dstAddr.GetRawHostAddress(), dstLen);
+    record.host_len = hostLen;
+    if (0 != hostLen)
+    {
+        record.host_port = hostAddr.GetPort();
+        memcpy(record.host_addr, hostAddr.GetRawHostAddress(), hostLen);
+    }
+    return true;
+}  // end MgenLogFormatter::InitRecv()
+
+bool MgenLogFormatter::InitSend(MgenLogRecord& record, MgenMsg& theMsg, const struct timeval& txTime)
+{
+    const ProtoAddress& dstAddr = theMsg.GetDstAddr();
+    const ProtoAddress& hostAddr = theMsg.GetHostAddr();
+    unsigned int dstLen = dstAddr.GetLength();
+    unsigned int hostLen = hostAddr.IsValid() ? hostAddr.GetLength() : 0;
+    if (((4 != dstLen) && (16 != dstLen)) ||
+        ((0 != hostLen) && (4 != hostLen) && (16 != hostLen)))
+    {
+        return false;  // non-IP addresses
+    }
+    record.rx_time = txTime;
+    record.flow_id = theMsg.GetFlowId();
+    record.seq_num = theMsg.GetSeqNum();
+    record.sample = theMsg.GetLogSample();
+    record.protocol = (UINT8)theMsg.GetProtocol();
+    // TCP SEND events give the whole message size, not the fragment
+    record.msg_len = (TCP == theMsg.GetProtocol()) ? theMsg.GetMgenMsgLen() : theMsg.GetMsgLen();
+    record.src_port = theMsg.GetSrcAddr().GetPort();
+    record.dst_len = dstLen;
+    record.dst_port = dstAddr.GetPort();
+    memcpy(record.dst_addr, dstAddr.GetRawHostAddress(), dstLen);
+    record.host_len = hostLen;
+    if (0 != hostLen)
+    {
+        record.host_port = hostAddr.GetPort();
+        memcpy(record.host_addr, hostAddr.GetRawHostAddress(), hostLen);
+    }
+    return true;
+}  // end MgenLogFormatter::InitSend()
+
+unsigned int MgenLogFormatter::FormatString(char* buffer, const char* text)
+{
+    char* ptr = buffer;
+    while ('\0' != *text) *ptr++ = *text++;
+    return (unsigned int)(ptr - buffer);
+}  // end MgenLogFormatter::FormatString()
+
+unsigned int MgenLogFormatter::FormatUnsigned(char* buffer, unsigned long value)
+{
+    char digits[24];
+    unsigned int count = 0;
+    do
+    {
+        digits[count++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (0 != value);
+    for (unsigned int i = 0; i < count; i++)
+        buffer[i] = digits[count - 1 - i];
+    return count;
+}  // end MgenLogFormatter::FormatUnsigned()
+
+unsigned int MgenLogFormatter::FormatAddress(char* buffer, const char* addr,
+                                             unsigned int addrLen, UINT16 port)
+{
+    unsigned int len = 0;
+    if (4 == addrLen)
+    {
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            if (0 != i) buffer[len++] = '.';
+            len += FormatUnsigned(buffer + len, (UINT8)addr[i]);
+        }
+    }
+    else
+    {
+        char addrString[64];
+        if (NULL == inet_ntop(AF_INET6, addr, addrString, sizeof(addrString)))
+            strcpy(addrString, "???");
+        len = FormatString(buffer, addrString);
+    }
+    buffer[len++] = '/';
+    len += FormatUnsigned(buffer + len, port);
+    return len;
+}  // end MgenLogFormatter::FormatAddress()
+
+unsigned int MgenLogFormatter::FormatRecv(char* buffer, const MgenLogRecord& record)
+{
+    if (MgenLogEncoder::TEXT != encoder.GetEncoding()) return EncodeRecv(buffer, record);
+    unsigned int len = FormatTimestamp(buffer, record.rx_time);
+    len += FormatString(buffer + len, "RECV proto>");
+    len += FormatString(buffer + len, MgenEvent::GetStringFromProtocol((Protocol)record.protocol));
+    len += FormatString(buffer + len, " flow>");
+    len += FormatUnsigned(buffer + len, record.flow_id);
+    len += FormatString(buffer + len, " seq>");
+    len += FormatUnsigned(buffer + len, record.seq_num);
+    len += FormatString(buffer + len, " src>");
+    len += FormatAddress(buffer + len, record.src_addr, record.src_len, record.src_port);
+    len += FormatString(buffer + len, " dst>");
+    len += FormatAddress(buffer + len, record.dst_addr, record.dst_len, record.dst_port);
+    len += FormatString(buffer + len, " sent>");
+    len += FormatTimestamp(buffer + len, record.tx_time);
+    len += FormatString(buffer + len, "size>");
+    len += FormatUnsigned(buffer + len, record.msg_len);
+    buffer[len++] = ' ';
+    if (0 != record.host_len)
+    {
+        len += FormatString(buffer + len, "host>");
+        len += FormatAddress(buffer + len, record.host_addr, record.host_len, record.host_port);
+        buffer[len++] = ' ';
+    }
+    if (record.ttl >= 0)
+    {
+        len += FormatString(buffer + len, "ttl>");
+        len += FormatUnsigned(buffer + len, (unsigned long)record.ttl);
+        buffer[len++] = ' ';
+    }
+    if (0xff != record.gps_status)
+    {
+        const char* statusString = "INVALID";
+        if (MgenMsg::STALE == record.gps_status)
+            statusString = "STALE";
+        else if (MgenMsg::CURRENT == record.gps_status)
+            statusString = "CURRENT";
+        len += snprintf(buffer + len, OUTPUT_LINE_MAX - len, "gps>%s,%f,%f,%ld ", statusString,
+                        record.latitude, record.longitude, (long)record.altitude);
+    }
+    // "flags>0x%02x " for each of these flags
+    static const UINT8 FLAG_LIST[] = {MgenMsg::CONTINUES, MgenMsg::END_OF_MSG, MgenMsg::CHECKSUM_ERROR};
+    static const char HEX[] = "0123456789abcdef";
+    for (unsigned int i = 0; i < sizeof(FLAG_LIST); i++)
+    {
+        if (0 == (record.flags & FLAG_LIST[i])) continue;
+        len += FormatString(buffer + len, "flags>0x");
+        buffer[len++] = HEX[FLAG_LIST[i] >> 4];
+        buffer[len++] = HEX[FLAG_LIST[i] & 0x0f];
+        buffer[len++] = ' ';
+    }
+    if (0 != record.sample)
+    {
+        len += FormatString(buffer + len, "sample>");
+        len += FormatUnsigned(buffer + len, record.sample);
+        buffer[len++] = ' ';
+    }
+    buffer[len++] = '\n';
+    return len;
+}  // end MgenLogFormatter::FormatRecv()
+
+unsigned int MgenLogFormatter::FormatSend(char* buffer, const MgenLogRecord& record)
+{
+    if (MgenLogEncoder::TEXT != encoder.GetEncoding()) return EncodeSend(buffer, record);
+    unsigned int len = FormatTimestamp(buffer, record.rx_time);
+    len += FormatString(buffer + len, "SEND proto>");
+    len += FormatString(buffer + len, MgenEvent::GetStringFromProtocol((Protocol)record.protocol));
+    len += FormatString(buffer + len, " flow>");
+    len += FormatUnsigned(buffer + len, record.flow_id);
+    len += FormatString(buffer + len, " seq>");
+    len += FormatUnsigned(buffer + len, record.seq_num);
+    len += FormatString(buffer + len, " srcPort>");
+    len += FormatUnsigned(buffer + len, record.src_port);
+    len += FormatString(buffer + len, " dst>");
+    len += FormatAddress(buffer + len, record.dst_addr, record.dst_len, record.dst_port);
+    len += FormatString(buffer + len, " size>");
+    len += FormatUnsigned(buffer + len, record.msg_len);
+    buffer[len++] = ' ';
+    if (0 != record.host_len)
+    {
+        len += FormatString(buffer + len, "host>");
+        len += FormatAddress(buffer + len, record.host_addr, record.host_len, record.host_port);
+        if (0 != record.sample) buffer[len++] = ' ';
+    }
+    if (0 != record.sample)
+    {
+        len += FormatString(buffer + len, "sample>");
+        len += FormatUnsigned(buffer + len, record.sample);
+    }
+    buffer[len++] = '\n';
+    return len;
+}  // end MgenLogFormatter::FormatSend()
+
+unsigned int MgenLogFormatter::EncodeRecv(char* buffer, const MgenLogRecord& record)
+{
+    encoder.Begin(RECV_EVENT, record.rx_time);
+    encoder.SetString(MgenLogEncoder::COL_PROTO, MgenEvent::GetStringFromProtocol((Protocol)record.protocol));
+    encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, record.flow_id);
+    encoder.SetUnsigned(MgenLogEncoder::COL_SEQ, record.seq_num);
+    encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT,
+                       record.src_addr, record.src_len, record.src_port);
+    encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT,
+                       record.dst_addr, record.dst_len, record.dst_port);
+    if (0 != record.host_len)
+        encoder.SetAddress(MgenLogEncoder::COL_HOST, MgenLogEncoder::COL_HOST_PORT,
+                           record.host_addr, record.host_len, record.host_port);
+    encoder.SetTime(MgenLogEncoder::COL_SENT, record.tx_time);
+    encoder.SetUnsigned(MgenLogEncoder::COL_SIZE, record.msg_len);
+    if (record.ttl >= 0) encoder.SetUnsigned(MgenLogEncoder::COL_TTL, (unsigned long)record.ttl);
+    if (0xff != record.gps_status)
+    {
+        const char* statusString = "INVALID";
+        if (MgenMsg::STALE == record.gps_status)
+            statusString = "STALE";
+        else if (MgenMsg::CURRENT == record.gps_status)
+            statusString = "CURRENT";
+        encoder.SetString(MgenLogEncoder::COL_GPS, statusString);
+        encoder.SetDouble(MgenLogEncoder::COL_LAT, record.latitude);
+        encoder.SetDouble(MgenLogEncoder::COL_LON, record.longitude);
+        encoder.SetSigned(MgenLogEncoder::COL_ALT, record.altitude);
+    }
+    if (0 != record.flags) encoder.SetUnsigned(MgenLogEncoder::COL_FLAGS, record.flags);
+    if (0 != record.sample) encoder.SetUnsigned(MgenLogEncoder::COL_SAMPLE, record.sample);
+    return encoder.Finish(buffer);
+}  // end MgenLogFormatter::EncodeRecv()
+
+unsigned int MgenLogFormatter::EncodeSend(char* buffer, const MgenLogRecord& record)
+{
+    encoder.Begin(SEND_EVENT, record.rx_time);
+    encoder.SetString(MgenLogEncoder::COL_PROTO, MgenEvent::GetStringFromProtocol((Protocol)record.protocol));
+    encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, record.flow_id);
+    encoder.SetUnsigned(MgenLogEncoder::COL_SEQ, record.seq_num);
+    encoder.SetUnsigned(MgenLogEncoder::COL_SRC_PORT, record.src_port);
+    encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT,
+                       record.dst_addr, record.dst_len, record.dst_port);
+    if (0 != record.host_len)
+        encoder.SetAddress(MgenLogEncoder::COL_HOST, MgenLogEncoder::COL_HOST_PORT,
+                           record.host_addr, record.host_len, record.host_port);
+    encoder.SetUnsigned(MgenLogEncoder::COL_SIZE, record.msg_len);
+    if (0 != record.sample) encoder.SetUnsigned(MgenLogEncoder::COL_SAMPLE, record.sample);
+    return encoder.Finish(buffer);
+}  // end MgenLogFormatter::EncodeSend()
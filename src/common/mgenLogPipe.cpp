@@ -0,0 +1,467 @@
+#include "mgenLogPipe.h"
+
+#ifdef HAVE_PTHREAD
+#include "mgen.h"
+#include "mgenMsg.h"
+
+#include <string.h>
+#include <stdlib.h>     // for realloc()
+#include <time.h>       // for nanosleep()
+#include <sched.h>      // for sched_yield()
+#include <unistd.h>     // for write()
+#include <errno.h>
+
+// The ring indices are free-running counters.  The main thread is the
+// only writer of "ring_tail" and "drop_count" and the writer thread the
+// only writer of "ring_head", so acquire/release loads and stores of
+// those are all the synchronization needed.
+#define PIPE_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define PIPE_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+MgenLogPipe* MgenLogPipe::active_pipe = NULL;
+
+MgenLogPipe::MgenLogPipe()
+ : log_file(NULL), local_time(false), log_flush(false), log_text(true),
+   recv_context(false), prev_log(NULL),
+   ring(NULL), ring_size(0), ring_head(0), ring_tail(0),
+   text_buffer(NULL), text_len(0), text_size(0),
+   thread_started(false), stop(false),
+   record_count(0), drop_count(0), drop_reported(0), max_fill(0),
+   log_fd(-1), flush_latency(DEFAULT_LATENCY), out_len(0), out_index(0),
+   io_started(false), io_busy(false), io_stop(false), io_index(0), io_len(0),
+   write_count(0), write_bytes(0)
+{
+    out_buffer[0] = out_buffer[1] = NULL;
+    pthread_mutex_init(&io_lock, NULL);
+    pthread_cond_init(&io_cond, NULL);
+}
+
+MgenLogPipe::~MgenLogPipe()
+{
+    Stop();
+    if (NULL != ring)
+    {
+        delete[] ring;
+        ring = NULL;
+    }
+    if (NULL != text_buffer)
+    {
+        free(text_buffer);
+        text_buffer = NULL;
+    }
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        if (NULL != out_buffer[i])
+        {
+            delete[] out_buffer[i];
+            out_buffer[i] = NULL;
+        }
+    }
+    pthread_cond_destroy(&io_cond);
+    pthread_mutex_destroy(&io_lock);
+}
+
+bool MgenLogPipe::Start(FILE* logFile, unsigned int ringSize, bool localTime, bool flush,
+                        unsigned int latency)
+{
+    if (thread_started) Stop();
+    if (NULL != active_pipe)
+    {
+        PLOG(PL_ERROR, "MgenLogPipe::Start() error: another log pipe is already running\n");
+        return false;
+    }
+    // Round up to a power of 2 so indices can be masked
+    unsigned int size = 64;
+    while ((size < ringSize) && (size < 0x40000000)) size <<= 1;
+    if (size != ring_size)
+    {
+        if (NULL != ring) delete[] ring;
+        ring_size = 0;
+        if (NULL == (ring = new Record[size]))
+        {
+            PLOG(PL_ERROR, "MgenLogPipe::Start() new ring error: %s\n", GetErrorString());
+            return false;
+        }
+        ring_size = size;
+    }
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        if ((NULL == out_buffer[i]) && (NULL == (out_buffer[i] = new char[OUTPUT_SIZE])))
+        {
+            PLOG(PL_ERROR, "MgenLogPipe::Start() new out_buffer error: %s\n", GetErrorString());
+            return false;
+        }
+    }
+    // Anything already buffered by stdio must go out ahead of our write()s
+    fflush(logFile);
+    log_fd = fileno(logFile);
+    log_file = logFile;
+    local_time = localTime;
+    formatter.SetTimeFormat(localTime, (Mgen::LogTimestamp == Mgen::LogEpochTimestamp));
+    formatter.SetEncoding(MgenLogEncoder::GetActive(logFile));
+    log_text = (MgenLogEncoder::TEXT == MgenLogEncoder::GetActive(logFile));
+    log_flush = flush;
+    flush_latency = latency;
+    out_len = out_index = 0;
+    io_busy = io_stop = false;
+    write_count = 0;
+    write_bytes = 0;
+    if (0 != pthread_create(&io_thread, NULL, IoThreadMain, this))
+    {
+        PLOG(PL_ERROR, "MgenLogPipe::Start() pthread_create(io) error: %s\n", GetErrorString());
+        return false;
+    }
+    io_started = true;
+    recv_context = false;
+    ring_head = ring_tail = 0;
+    text_len = 0;
+    stop = false;
+    record_count = drop_count = drop_reported = 0;
+    max_fill = 0;
+    // Redirect Mgen::Log() output for "logFile" into the ring
+    prev_log = Mgen::Log;
+    active_pipe = this;
+    Mgen::Log = MgenLogPipe::Log;
+    if (0 != pthread_create(&thread, NULL, ThreadMain, this))
+    {
+        PLOG(PL_ERROR, "MgenLogPipe::Start() pthread_create() error: %s\n", GetErrorString());
+        Mgen::Log = prev_log;
+        active_pipe = NULL;
+        pthread_mutex_lock(&io_lock);
+        io_stop = true;
+        pthread_cond_broadcast(&io_cond);
+        pthread_mutex_unlock(&io_lock);
+        pthread_join(io_thread, NULL);
+        io_started = false;
+        return false;
+    }
+    thread_started = true;
+    return true;
+}  // end MgenLogPipe::Start()
+
+void MgenLogPipe::Stop()
+{
+    if (!thread_started) return;
+    if (0 != text_len)
+    {
+        // Unterminated text goes out as is
+        PushText(text_buffer, text_len, false);
+        text_len = 0;
+    }
+    PIPE_STORE(stop, true);
+    pthread_join(thread, NULL);
+    thread_started = false;
+    // The writer thread hands off its last buffer and stops the I/O thread
+    pthread_join(io_thread, NULL);
+    io_started = false;
+    Mgen::Log = prev_log;
+    active_pipe = NULL;
+    LogSummary("LOGPIPE");
+    fflush(log_file);
+    log_file = NULL;
+}  // end MgenLogPipe::Stop()
+
+void MgenLogPipe::LogSummary(const char* label)
+{
+    // (this line has no LOGFORMAT encoding)
+    FILE* filePtr = log_text ? log_file : stderr;
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    Mgen::LogTimestamp(filePtr, currentTime, local_time);
+    Mgen::Log(filePtr, "%s size>%u records>%lu drops>%lu maxFill>%u writes>%lu bytes>%llu\n",
+              label, ring_size, record_count, drop_count, max_fill, write_count, write_bytes);
+}  // end MgenLogPipe::LogSummary()
+
+int MgenLogPipe::Log(FILE* filePtr, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result;
+    MgenLogPipe* thePipe = active_pipe;
+    if ((NULL != thePipe) && (filePtr == thePipe->log_file))
+        result = thePipe->AppendText(format, args);
+    else
+        result = vfprintf(filePtr, format, args);
+    va_end(args);
+    return result;
+}  // end MgenLogPipe::Log()
+
+unsigned int MgenLogPipe::GetFree() const
+{
+    return (ring_size - (ring_tail - PIPE_LOAD(ring_head)));
+}  // end MgenLogPipe::GetFree()
+
+// Text is collected until a line is complete, so each line
+// is queued (or dropped) as a whole
+int MgenLogPipe::AppendText(const char* format, va_list args)
+{
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int result = vsnprintf(text_buffer + text_len, text_size - text_len, format, args);
+    if (result < 0)
+    {
+        va_end(argsCopy);
+        return result;
+    }
+    if ((text_len + result) >= text_size)
+    {
+        unsigned int newSize = (0 != text_size) ? (2 * text_size) : 256;
+        while (newSize <= (text_len + result)) newSize *= 2;
+        char* newBuffer = (char*)realloc(text_buffer, newSize);
+        if (NULL == newBuffer)
+        {
+            PLOG(PL_ERROR, "MgenLogPipe::AppendText() realloc() error: %s\n", GetErrorString());
+            va_end(argsCopy);
+            return -1;
+        }
+        text_buffer = newBuffer;
+        text_size = newSize;
+        vsnprintf(text_buffer + text_len, text_size - text_len, format, argsCopy);
+    }
+    va_end(argsCopy);
+    unsigned int start = text_len;
+    text_len += result;
+    // Queue any completed line(s)
+    for (unsigned int i = text_len; i > start; i--)
+    {
+        if ('\n' == text_buffer[i - 1])
+        {
+            PushText(text_buffer, i, recv_context);
+            text_len -= i;
+            memmove(text_buffer, text_buffer + i, text_len);
+            break;
+        }
+    }
+    return result;
+}  // end MgenLogPipe::AppendText()
+
+bool MgenLogPipe::PushText(const char* text, unsigned int len, bool droppable)
+{
+    unsigned int count = (len + TEXT_MAX - 1) / TEXT_MAX;
+    if (count > ring_size)
+    {
+        PIPE_STORE(drop_count, drop_count + 1);
+        return false;
+    }
+    while (GetFree() < count)
+    {
+        // Receive path output is never waited on, but occasional
+        // non-receive events (START, STOP, etc) are not lost
+        if (droppable)
+        {
+            PIPE_STORE(drop_count, drop_count + 1);
+            return false;
+        }
+        sched_yield();
+    }
+    unsigned int tail = ring_tail;
+    while (len > 0)
+    {
+        Record& record = ring[tail & (ring_size - 1)];
+        unsigned int textLen = (len < TEXT_MAX) ? len : TEXT_MAX;
+        record.type = RECORD_TEXT;
+        record.text_len = textLen;
+        memcpy(record.text, text, textLen);
+        text += textLen;
+        len -= textLen;
+        tail++;
+    }
+    PIPE_STORE(ring_tail, tail);
+    return true;
+}  // end MgenLogPipe::PushText()
+
+bool MgenLogPipe::PushRecv(MgenMsg& theMsg, const struct timeval& rxTime, bool logData, bool logGpsData)
+{
+    MgenLogRecord record;
+    if (!MgenLogFormatter::InitRecv(record, theMsg, rxTime, logData, logGpsData))
+        return false;  // needs MgenMsg::LogRecvEvent()
+    if (0 == GetFree())
+    {
+        PIPE_STORE(drop_count, drop_count + 1);
+        return true;
+    }
+    Record& entry = ring[ring_tail & (ring_size - 1)];
+    entry.type = RECORD_RECV;
+    entry.msg = record;
+    PIPE_STORE(ring_tail, ring_tail + 1);
+    return true;
+}  // end MgenLogPipe::PushRecv()
+
+bool MgenLogPipe::PushSend(MgenMsg& theMsg, const struct timeval& txTime)
+{
+    MgenLogRecord record;
+    if (!MgenLogFormatter::InitSend(record, theMsg, txTime))
+        return false;  // needs MgenMsg::LogSendEvent()
+    // Like RECV records, SEND records are dropped (and counted) rather
+    // than holding up message transmission
+    if (0 == GetFree())
+    {
+        PIPE_STORE(drop_count, drop_count + 1);
+        return true;
+    }
+    Record& entry = ring[ring_tail & (ring_size - 1)];
+    entry.type = RECORD_SEND;
+    entry.msg = record;
+    PIPE_STORE(ring_tail, ring_tail + 1);
+    return true;
+}  // end MgenLogPipe::PushSend()
+
+void* MgenLogPipe::ThreadMain(void* arg)
+{
+    ((MgenLogPipe*)arg)->Run();
+    return NULL;
+}  // end MgenLogPipe::ThreadMain()
+
+void MgenLogPipe::Run()
+{
+    struct timespec idleTime = {0, 500000};
+    while (true)
+    {
+        // Check "stop" first so everything queued before it was set gets drained
+        bool stopping = PIPE_LOAD(stop);
+        if (0 != Drain())
+        {
+            if (log_flush || OutputExpired()) HandOff();
+            continue;
+        }
+        // Idle, so bound the latency of buffered output
+        if ((0 != out_len) && OutputExpired()) HandOff();
+        if (stopping) break;
+        nanosleep(&idleTime, NULL);
+    }
+    HandOff();
+    pthread_mutex_lock(&io_lock);
+    io_stop = true;
+    pthread_cond_broadcast(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+}  // end MgenLogPipe::Run()
+
+bool MgenLogPipe::OutputExpired() const
+{
+    if (0 == flush_latency) return true;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long msec = (now.tv_sec - out_since.tv_sec) * 1000 + 
+                (now.tv_nsec - out_since.tv_nsec) / 1000000;
+    return (msec >= (long)flush_latency);
+}  // end MgenLogPipe::OutputExpired()
+
+char* MgenLogPipe::ReserveOutput()
+{
+    if ((OUTPUT_SIZE - out_len) < OUTPUT_LINE_MAX) HandOff();
+    if (0 == out_len) clock_gettime(CLOCK_MONOTONIC, &out_since);
+    return (out_buffer[out_index] + out_len);
+}  // end MgenLogPipe::ReserveOutput()
+
+// Passes the filled output buffer to the I/O thread, waiting 
+// only if it is still writing the other one
+void MgenLogPipe::HandOff()
+{
+    if (0 == out_len) return;
+    pthread_mutex_lock(&io_lock);
+    while (io_busy) pthread_cond_wait(&io_cond, &io_lock);
+    io_index = out_index;
+    io_len = out_len;
+    io_busy = true;
+    pthread_cond_broadcast(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+    out_index ^= 1;
+    out_len = 0;
+}  // end MgenLogPipe::HandOff()
+
+void* MgenLogPipe::IoThreadMain(void* arg)
+{
+    ((MgenLogPipe*)arg)->IoRun();
+    return NULL;
+}  // end MgenLogPipe::IoThreadMain()
+
+void MgenLogPipe::IoRun()
+{
+    pthread_mutex_lock(&io_lock);
+    while (true)
+    {
+        while (!io_busy && !io_stop) pthread_cond_wait(&io_cond, &io_lock);
+        if (!io_busy) break;  // stopped with nothing left to write
+        const char* buffer = out_buffer[io_index];
+        unsigned int len = io_len;
+        pthread_mutex_unlock(&io_lock);
+        unsigned int put = 0;
+        while (put < len)
+        {
+            ssize_t result = write(log_fd, buffer + put, len - put);
+            if (result < 0)
+            {
+                if (EINTR == errno) continue;
+                if (EAGAIN == errno)
+                {
+                    struct timespec waitTime = {0, 1000000};
+                    nanosleep(&waitTime, NULL);
+                    continue;
+                }
+                PLOG(PL_ERROR, "MgenLogPipe::IoRun() write() error: %s\n", GetErrorString());
+                break;
+            }
+            put += result;
+        }
+        write_count++;
+        write_bytes += put;
+        pthread_mutex_lock(&io_lock);
+        io_busy = false;
+        pthread_cond_broadcast(&io_cond);
+    }
+    pthread_mutex_unlock(&io_lock);
+}  // end MgenLogPipe::IoRun()
+
+unsigned int MgenLogPipe::Drain()
+{
+    unsigned int head = ring_head;
+    unsigned int tail = PIPE_LOAD(ring_tail);
+    unsigned int count = tail - head;
+    if (count > max_fill) max_fill = count;
+    while (head != tail)
+    {
+        const Record& record = ring[head & (ring_size - 1)];
+        char* buffer = ReserveOutput();
+        switch (record.type)
+        {
+            case RECORD_RECV:
+                out_len += formatter.FormatRecv(buffer, record.msg);
+                record_count++;
+                break;
+            case RECORD_SEND:
+                out_len += formatter.FormatSend(buffer, record.msg);
+                record_count++;
+                break;
+            default:
+                memcpy(buffer, record.text, record.text_len);
+                out_len += record.text_len;
+                break;
+        }
+        head++;
+        // Hand slots back in batches to keep the main thread moving
+        if (0 == (head & 0xff)) PIPE_STORE(ring_head, head);
+    }
+    PIPE_STORE(ring_head, head);
+    unsigned long drops = __atomic_load_n(&drop_count, __ATOMIC_RELAXED);
+    if ((drops != drop_reported) && !log_text)
+    {
+        // (no LOGFORMAT encoding for this one either)
+        PLOG(PL_WARN, "MgenLogPipe::Drain() LOGPIPE overflow drops>%lu\n", drops - drop_reported);
+        drop_reported = drops;
+    }
+    else if (drops != drop_reported)
+    {
+        char* buffer = ReserveOutput();
+        struct timeval currentTime;
+        ProtoSystemTime(currentTime);
+        unsigned int len = formatter.FormatTimestamp(buffer, currentTime);
+        len += MgenLogFormatter::FormatString(buffer + len, "LOGPIPE overflow drops>");
+        len += MgenLogFormatter::FormatUnsigned(buffer + len, drops - drop_reported);
+        buffer[len++] = '\n';
+        out_len += len;
+        drop_reported = drops;
+    }
+    return count;
+}  // end MgenLogPipe::Drain()
+
+#endif // HAVE_PTHREAD
@@ -0,0 +1,362 @@
+#include "mgenLogSampler.h"
+#include "mgenMsg.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+MgenLogSampler::MgenLogSampler()
+ : rule_count(0), range_count(0), flow_filter_count(0),
+   src_filter_count(0), dst_filter_count(0),
+   table(NULL), table_size(0), flow_count(0)
+{
+}
+
+MgenLogSampler::~MgenLogSampler()
+{
+    Destroy();
+}
+
+void MgenLogSampler::Destroy()
+{
+    ClearTable();
+    rule_count = range_count = 0;
+    flow_filter_count = src_filter_count = dst_filter_count = 0;
+}  // end MgenLogSampler::Destroy()
+
+void MgenLogSampler::ClearTable()
+{
+    if (NULL != table)
+    {
+        delete[] table;
+        table = NULL;
+    }
+    table_size = flow_count = 0;
+}  // end MgenLogSampler::ClearTable()
+
+// Case-insensitive match of the leading "keyword" of "text"
+static bool KeywordMatch(const char* text, const char* keyword, bool whole)
+{
+    while ('\0' != *keyword)
+    {
+        if (tolower(*text++) != *keyword++) return false;
+    }
+    return (!whole || ('\0' == *text));
+}
+
+// "<id>[-<id>][,<id>[-<id>]...]"
+bool MgenLogSampler::ParseFlowRanges(const char* text, FlowRange* rangeList,
+                                     unsigned int rangeMax, unsigned int& rangeCount)
+{
+    const char* ptr = text;
+    while (true)
+    {
+        char* end;
+        unsigned long first = strtoul(ptr, &end, 10);
+        if (end == ptr) return false;
+        unsigned long last = first;
+        ptr = end;
+        if ('-' == *ptr)
+        {
+            last = strtoul(++ptr, &end, 10);
+            if ((end == ptr) || (last < first)) return false;
+            ptr = end;
+        }
+        if (rangeCount >= rangeMax)
+        {
+            PLOG(PL_ERROR, "MgenLogSampler::ParseFlowRanges() error: too many flow ids\n");
+            return false;
+        }
+        rangeList[rangeCount].first = (UINT32)first;
+        rangeList[rangeCount].last = (UINT32)last;
+        rangeCount++;
+        if ('\0' == *ptr) return true;
+        if (',' != *ptr++) return false;
+    }
+}  // end MgenLogSampler::ParseFlowRanges()
+
+// "<addr>[/<port>]"
+bool MgenLogSampler::ParseAddrFilter(const char* text, AddrFilter& filter)
+{
+    char addrString[256];
+    const char* ptr = strchr(text, '/');
+    unsigned int len = (NULL != ptr) ? (unsigned int)(ptr - text) : strlen(text);
+    if ((0 == len) || (len >= sizeof(addrString))) return false;
+    strncpy(addrString, text, len);
+    addrString[len] = '\0';
+    ProtoAddress addr;
+    if (!addr.ResolveFromString(addrString))
+    {
+        PLOG(PL_ERROR, "MgenLogSampler::ParseAddrFilter() error: invalid address \"%s\"\n", addrString);
+        return false;
+    }
+    unsigned int port = 0;
+    if ((NULL != ptr) && ((1 != sscanf(ptr + 1, "%u", &port)) || (port > 65535)))
+        return false;
+    unsigned int addrLen = addr.GetLength();
+    if (addrLen > ADDR_MAX) return false;
+    memcpy(filter.addr, addr.GetRawHostAddress(), addrLen);
+    filter.addr_len = (UINT8)addrLen;
+    filter.port = (UINT16)port;
+    return true;
+}  // end MgenLogSampler::ParseAddrFilter()
+
+bool MgenLogSampler::ParseSample(const char* arg)
+{
+    if (KeywordMatch(arg, "off", true) || KeywordMatch(arg, "none", true))
+    {
+        rule_count = range_count = 0;
+        ClearTable();
+        return true;
+    }
+    if (rule_count >= RULE_MAX)
+    {
+        PLOG(PL_ERROR, "MgenLogSampler::ParseSample() error: too many sampling rules\n");
+        return false;
+    }
+    Rule& rule = rule_list[rule_count];
+    rule.range_index = range_count;
+    rule.range_count = 0;
+    const char* ptr = strchr(arg, ':');
+    unsigned int newRangeCount = range_count;
+    if (NULL != ptr)
+    {
+        char idString[256];
+        unsigned int len = (unsigned int)(ptr - arg);
+        if (len >= sizeof(idString)) return false;
+        strncpy(idString, arg, len);
+        idString[len] = '\0';
+        if (!ParseFlowRanges(idString, range_list, RANGE_MAX, newRangeCount))
+            return false;
+        rule.range_count = newRangeCount - range_count;
+        ptr++;
+    }
+    else
+    {
+        ptr = arg;
+    }
+    double value;
+    char units = '\0';
+    if ((sscanf(ptr, "%lf%c", &value, &units) < 1) || (value <= 0.0))
+        return false;
+    if ('s' == tolower(units))
+    {
+        rule.count = 0;
+        rule.interval = value;
+    }
+    else if (('\0' == units) && (value <= SAMPLE_MAX) && (value == (double)(unsigned int)value))
+    {
+        rule.count = (unsigned int)value;
+        rule.interval = 0.0;
+    }
+    else
+    {
+        return false;
+    }
+    range_count = newRangeCount;
+    rule_count++;
+    ClearTable();  // flows pick up the new rule
+    return true;
+}  // end MgenLogSampler::ParseSample()
+
+bool MgenLogSampler::ParseFilter(const char* arg)
+{
+    if (KeywordMatch(arg, "none", true))
+    {
+        flow_filter_count = src_filter_count = dst_filter_count = 0;
+        return true;
+    }
+    if (KeywordMatch(arg, "flow:", false))
+        return ParseFlowRanges(arg + 5, flow_filter, FILTER_MAX, flow_filter_count);
+    AddrFilter* filterList;
+    unsigned int* filterCount;
+    if (KeywordMatch(arg, "src:", false))
+    {
+        filterList = src_filter;
+        filterCount = &src_filter_count;
+    }
+    else if (KeywordMatch(arg, "dst:", false))
+    {
+        filterList = dst_filter;
+        filterCount = &dst_filter_count;
+    }
+    else
+    {
+        return false;
+    }
+    if (*filterCount >= FILTER_MAX)
+    {
+        PLOG(PL_ERROR, "MgenLogSampler::ParseFilter() error: too many address filters\n");
+        return false;
+    }
+    if (!ParseAddrFilter(arg + 4, filterList[*filterCount])) return false;
+    (*filterCount)++;
+    return true;
+}  // end MgenLogSampler::ParseFilter()
+
+bool MgenLogSampler::MatchFlow(const FlowRange* rangeList, unsigned int rangeCount, UINT32 flowId)
+{
+    for (unsigned int i = 0; i < rangeCount; i++)
+    {
+        if ((flowId >= rangeList[i].first) && (flowId <= rangeList[i].last))
+            return true;
+    }
+    return false;
+}  // end MgenLogSampler::MatchFlow()
+
+bool MgenLogSampler::MatchAddr(const AddrFilter* filterList, unsigned int filterCount,
+                               const ProtoAddress& addr)
+{
+    if (!addr.IsValid()) return false;
+    unsigned int addrLen = addr.GetLength();
+    const char* rawAddr = addr.GetRawHostAddress();
+    UINT16 port = addr.GetPort();
+    for (unsigned int i = 0; i < filterCount; i++)
+    {
+        const AddrFilter& filter = filterList[i];
+        if ((filter.addr_len == addrLen) && (0 == memcmp(filter.addr, rawAddr, addrLen)) &&
+            ((0 == filter.port) || (filter.port == port)))
+        {
+            return true;
+        }
+    }
+    return false;
+}  // end MgenLogSampler::MatchAddr()
+
+// The last rule naming "flowId" (or for all flows) applies
+int MgenLogSampler::FindRule(UINT32 flowId) const
+{
+    for (int i = (int)rule_count - 1; i >= 0; i--)
+    {
+        const Rule& rule = rule_list[i];
+        if ((0 == rule.range_count) ||
+            MatchFlow(range_list + rule.range_index, rule.range_count, flowId))
+        {
+            return i;
+        }
+    }
+    return -1;
+}  // end MgenLogSampler::FindRule()
+
+// FNV-1a over the flow key fields
+unsigned int MgenLogSampler::Hash(UINT8 type, const char* addr, unsigned int addrLen,
+                                  UINT16 srcPort, UINT32 flowId)
+{
+    UINT32 hash = 2166136261UL;
+    for (unsigned int i = 0; i < addrLen; i++)
+        hash = (hash ^ (UINT8)addr[i]) * 16777619UL;
+    UINT32 fields[2] = {((UINT32)type << 16) | srcPort, flowId};
+    const UINT8* ptr = (const UINT8*)fields;
+    for (unsigned int i = 0; i < sizeof(fields); i++)
+        hash = (hash ^ ptr[i]) * 16777619UL;
+    return hash;
+}  // end MgenLogSampler::Hash()
+
+bool MgenLogSampler::Grow()
+{
+    unsigned int newSize = (0 != table_size) ? (2 * table_size) : INIT_SIZE;
+    Entry* newTable = new Entry[newSize];
+    if (NULL == newTable)
+    {
+        PLOG(PL_ERROR, "MgenLogSampler::Grow() new table error: %s\n", GetErrorString());
+        return false;
+    }
+    memset(newTable, 0, newSize*sizeof(Entry));
+    for (unsigned int i = 0; i < table_size; i++)
+    {
+        Entry& entry = table[i];
+        if (!entry.in_use) continue;
+        unsigned int index = Hash(entry.type, entry.src_addr, entry.addr_len,
+                                  entry.src_port, entry.flow_id) & (newSize - 1);
+        while (newTable[index].in_use) index = (index + 1) & (newSize - 1);
+        newTable[index] = entry;
+    }
+    if (NULL != table) delete[] table;
+    table = newTable;
+    table_size = newSize;
+    return true;
+}  // end MgenLogSampler::Grow()
+
+// Flows are told apart by event type, flow id and source address/port
+MgenLogSampler::Entry* MgenLogSampler::GetEntry(LogEventType eventType, MgenMsg& theMsg)
+{
+    // Keep load factor under 3/4 so probe sequences stay short
+    if ((4*(flow_count + 1)) > (3*table_size))
+    {
+        if (!Grow()) return NULL;
+    }
+    const ProtoAddress& srcAddr = theMsg.GetSrcAddr();
+    const char* addr = srcAddr.GetRawHostAddress();
+    unsigned int addrLen = srcAddr.IsValid() ? srcAddr.GetLength() : 0;
+    if (addrLen > ADDR_MAX) addrLen = ADDR_MAX;
+    UINT16 srcPort = srcAddr.GetPort();
+    UINT32 flowId = theMsg.GetFlowId();
+    UINT8 type = (UINT8)eventType;
+    unsigned int index = Hash(type, addr, addrLen, srcPort, flowId) & (table_size - 1);
+    while (table[index].in_use)
+    {
+        Entry& entry = table[index];
+        if ((entry.flow_id == flowId) && (entry.type == type) &&
+            (entry.src_port == srcPort) && (entry.addr_len == addrLen) &&
+            (0 == memcmp(entry.src_addr, addr, addrLen)))
+        {
+            return &entry;
+        }
+        index = (index + 1) & (table_size - 1);
+    }
+    Entry& entry = table[index];
+    memset(&entry, 0, sizeof(Entry));
+    entry.in_use = true;
+    entry.type = type;
+    entry.addr_len = (UINT8)addrLen;
+    entry.src_port = srcPort;
+    entry.flow_id = flowId;
+    memcpy(entry.src_addr, addr, addrLen);
+    entry.rule = FindRule(flowId);
+    flow_count++;
+    return &entry;
+}  // end MgenLogSampler::GetEntry()
+
+bool MgenLogSampler::Check(LogEventType             eventType,
+                           MgenMsg&                 theMsg,
+                           const struct timeval&    eventTime,
+                           unsigned int&            sample)
+{
+    sample = 0;
+    if ((0 != flow_filter_count) &&
+        !MatchFlow(flow_filter, flow_filter_count, theMsg.GetFlowId()))
+    {
+        return false;
+    }
+    if ((0 != dst_filter_count) &&
+        !MatchAddr(dst_filter, dst_filter_count, theMsg.GetDstAddr()))
+    {
+        return false;
+    }
+    // (the source of a SEND event is this host)
+    if ((0 != src_filter_count) && (RECV_EVENT == eventType) &&
+        !MatchAddr(src_filter, src_filter_count, theMsg.GetSrcAddr()))
+    {
+        return false;
+    }
+    if (0 == rule_count) return true;
+    Entry* entry = GetEntry(eventType, theMsg);
+    if ((NULL == entry) || (entry->rule < 0)) return true;  // not sampled
+    const Rule& rule = rule_list[entry->rule];
+    if (1 == rule.count) return true;
+    entry->count++;
+    if (0 != rule.count)
+    {
+        if (entry->count < rule.count) return false;
+    }
+    else
+    {
+        double now = (double)eventTime.tv_sec + 1.0e-06*(double)eventTime.tv_usec;
+        if ((now < entry->next_time) && (entry->count < SAMPLE_MAX)) return false;
+        entry->next_time = now + rule.interval;
+    }
+    sample = entry->count;
+    entry->count = 0;
+    return true;
+}  // end MgenLogSampler::Check()
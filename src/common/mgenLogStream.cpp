@@ -0,0 +1,845 @@
+#include "mgenLogStream.h"
+#include "mgenVersion.h"
+#include "protokit.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif // HAVE_ZLIB
+
+#ifdef MGEN_LOG_STREAM
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#endif // MGEN_LOG_STREAM
+
+#ifdef UNIX
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif // UNIX
+
+MgenLogStream::MgenLogStream()
+ :
+#ifdef MGEN_LOG_STREAM
+   binary(false), pipe_fd(-1), out_fd(-1), next_fd(-1), in_buffer(NULL), out_buffer(NULL),
+   stream(NULL), error(false), part(1), file_bytes(0), file_start(0.0), at_boundary(true),
+   parse_state(PARSE_RECORD_HEADER), parse_count(0),
+   in_bytes(0), out_bytes(0), deflate_time(0.0), rotate_count(0),
+#endif // MGEN_LOG_STREAM
+   compress_level(0), rotate_bytes(0), rotate_interval(0), header_text(NULL), thread_started(false)
+{
+#ifdef MGEN_LOG_STREAM
+    path[0] = next_path[0] = '\0';
+#endif // MGEN_LOG_STREAM
+}
+
+MgenLogStream::~MgenLogStream()
+{
+    Close();
+    if (NULL != header_text) delete[] header_text;
+}
+
+bool MgenLogStream::SetHeader(const char* text)
+{
+    if (NULL != header_text) delete[] header_text;
+    if (NULL == (header_text = new char[strlen(text) + 1]))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::SetHeader() new header_text error: %s\n", GetErrorString());
+        return false;
+    }
+    strcpy(header_text, text);
+    return true;
+}  // end MgenLogStream::SetHeader()
+
+#ifdef MGEN_LOG_STREAM
+
+static bool WriteAll(int fd, const char* buffer, size_t len)
+{
+    while (0 != len)
+    {
+        ssize_t result = write(fd, buffer, len);
+        if (result < 0)
+        {
+            if (EINTR == errno) continue;
+            return false;
+        }
+        buffer += result;
+        len -= (size_t)result;
+    }
+    return true;
+}  // end WriteAll()
+
+static double GetThreadTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((double)ts.tv_sec + 1.0e-09*(double)ts.tv_nsec);
+}  // end GetThreadTime()
+
+static double GetTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((double)tv.tv_sec + 1.0e-06*(double)tv.tv_usec);
+}  // end GetTime()
+
+// "<path>.<part>", or "<name>.<part>.gz" for "<name>.gz"
+void MgenLogStream::GetPartPath(char* buffer, unsigned int thePart) const
+{
+    size_t len = strlen(path);
+    if ((len > 3) && (0 == strcmp(path + len - 3, ".gz")))
+        snprintf(buffer, PATH_SIZE, "%.*s.%u.gz", (int)(len - 3), path, thePart);
+    else
+        snprintf(buffer, PATH_SIZE, "%s.%u", path, thePart);
+}  // end MgenLogStream::GetPartPath()
+
+FILE* MgenLogStream::Open(const char* thePath, bool append, bool isBinary, bool empty)
+{
+    Close();
+    if (strlen(thePath) >= sizeof(path))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() error: path too long\n");
+        return NULL;
+    }
+#ifndef HAVE_ZLIB
+    if (0 != compress_level)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() error: log compression not supported in this build\n");
+        return NULL;
+    }
+#endif // !HAVE_ZLIB
+    strcpy(path, thePath);
+    snprintf(next_path, PATH_SIZE, "%s.next", path);
+    binary = isBinary;
+    out_fd = open(path, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+    if (out_fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() open() error: %s\n", GetErrorString());
+        return NULL;
+    }
+    struct stat info;
+    file_bytes = (0 == fstat(out_fd, &info)) ? (uint64_t)info.st_size : 0;
+    file_start = GetTime();
+    // An empty binary log starts with Mgen's header line
+    parse_state = (binary && empty) ? PARSE_HEADER_LINE : PARSE_RECORD_HEADER;
+    parse_count = 0;
+    at_boundary = true;
+    error = false;
+    in_bytes = out_bytes = 0;
+    deflate_time = 0.0;
+    rotate_count = 0;
+    in_buffer = new char[BUFFER_SIZE];
+    out_buffer = new char[BUFFER_SIZE];
+    if ((NULL == in_buffer) || (NULL == out_buffer))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() new error: %s\n", GetErrorString());
+        Close();
+        return NULL;
+    }
+#ifdef HAVE_ZLIB
+    if (0 != compress_level)
+    {
+        if ((compress_level < 1) || (compress_level > 9)) compress_level = DEFAULT_LEVEL;
+        z_stream* z = new z_stream;
+        if (NULL == z)
+        {
+            PLOG(PL_ERROR, "MgenLogStream::Open() new error: %s\n", GetErrorString());
+            Close();
+            return NULL;
+        }
+        memset(z, 0, sizeof(z_stream));
+        // (windowBits + 16 for gzip framing)
+        if (Z_OK != deflateInit2(z, compress_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY))
+        {
+            PLOG(PL_ERROR, "MgenLogStream::Open() deflateInit2() error\n");
+            delete z;
+            Close();
+            return NULL;
+        }
+        stream = z;
+    }
+#endif // HAVE_ZLIB
+    if ((0 != rotate_bytes) || (0 != rotate_interval))
+    {
+        // Number parts after any left by an earlier run
+        char partPath[PATH_SIZE];
+        for (part = 1; ; part++)
+        {
+            GetPartPath(partPath, part);
+            if (0 != access(partPath, F_OK)) break;
+        }
+        // (binary log headers are written by Mgen for the first file)
+        if (!binary && (0 == file_bytes) && !WriteHeader())
+        {
+            Close();
+            return NULL;
+        }
+        if (!OpenNext())
+        {
+            Close();
+            return NULL;
+        }
+    }
+    int fds[2];
+    if (0 != pipe(fds))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() pipe() error: %s\n", GetErrorString());
+        Close();
+        return NULL;
+    }
+#ifdef F_SETPIPE_SZ
+    // A deeper pipe absorbs bursts while the thread is busy
+    fcntl(fds[1], F_SETPIPE_SZ, BUFFER_SIZE);
+#endif // F_SETPIPE_SZ
+    pipe_fd = fds[0];
+    FILE* file = fdopen(fds[1], "w");
+    if (NULL == file)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() fdopen() error: %s\n", GetErrorString());
+        close(fds[1]);
+        Close();
+        return NULL;
+    }
+    if (0 != pthread_create(&thread, NULL, ThreadMain, this))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Open() pthread_create() error: %s\n", GetErrorString());
+        fclose(file);
+        Close();
+        return NULL;
+    }
+    thread_started = true;
+    return file;
+}  // end MgenLogStream::Open()
+
+void MgenLogStream::Close()
+{
+    if (thread_started)
+    {
+        pthread_join(thread, NULL);
+        thread_started = false;
+        if (NULL != stream)
+        {
+            double ratio = (0 != out_bytes) ? ((double)in_bytes / (double)out_bytes) : 0.0;
+            double rate = (deflate_time > 0.0) ? (1.0e-06 * (double)in_bytes / deflate_time) : 0.0;
+            DMSG(0, "MgenLogStream::Close() compression level>%d in>%llu out>%llu ratio>%.2lf cpu>%.3lf sec rate>%.1lf MB/s\n",
+                 compress_level, in_bytes, out_bytes, ratio, deflate_time, rate);
+        }
+        if ((0 != rotate_bytes) || (0 != rotate_interval))
+            DMSG(0, "MgenLogStream::Close() rotations>%u parts>%u\n", rotate_count, part);
+    }
+#ifdef HAVE_ZLIB
+    if (NULL != stream)
+    {
+        deflateEnd((z_stream*)stream);
+        delete (z_stream*)stream;
+        stream = NULL;
+    }
+#endif // HAVE_ZLIB
+    if (pipe_fd >= 0)
+    {
+        close(pipe_fd);
+        pipe_fd = -1;
+    }
+    if (out_fd >= 0)
+    {
+        close(out_fd);
+        out_fd = -1;
+    }
+    if (next_fd >= 0)
+    {
+        close(next_fd);
+        next_fd = -1;
+        unlink(next_path);  // (unused)
+    }
+    if (NULL != in_buffer)
+    {
+        delete[] in_buffer;
+        in_buffer = NULL;
+    }
+    if (NULL != out_buffer)
+    {
+        delete[] out_buffer;
+        out_buffer = NULL;
+    }
+}  // end MgenLogStream::Close()
+
+void* MgenLogStream::ThreadMain(void* arg)
+{
+    ((MgenLogStream*)arg)->Run();
+    return NULL;
+}  // end MgenLogStream::ThreadMain()
+
+// Compresses any pending input (and flushes per "flush") to the file
+bool MgenLogStream::Deflate(int flush)
+{
+#ifdef HAVE_ZLIB
+    z_stream* z = (z_stream*)stream;
+    do
+    {
+        z->next_out = (Bytef*)out_buffer;
+        z->avail_out = BUFFER_SIZE;
+        double startTime = GetThreadTime();
+        int result = deflate(z, flush);
+        deflate_time += GetThreadTime() - startTime;
+        if (Z_STREAM_ERROR == result)
+        {
+            PLOG(PL_ERROR, "MgenLogStream::Deflate() deflate() error\n");
+            return false;
+        }
+        unsigned int len = BUFFER_SIZE - z->avail_out;
+        if (!WriteAll(out_fd, out_buffer, len))
+        {
+            PLOG(PL_ERROR, "MgenLogStream::Deflate() write() error: %s\n", GetErrorString());
+            return false;
+        }
+        out_bytes += len;
+        file_bytes += len;
+    } while (0 == z->avail_out);
+#endif // HAVE_ZLIB
+    return true;
+}  // end MgenLogStream::Deflate()
+
+bool MgenLogStream::Write(const char* data, unsigned int len)
+{
+    if (0 == len) return true;
+#ifdef HAVE_ZLIB
+    if (NULL != stream)
+    {
+        z_stream* z = (z_stream*)stream;
+        z->next_in = (Bytef*)data;
+        z->avail_in = (uInt)len;
+        return Deflate(Z_NO_FLUSH);
+    }
+#endif // HAVE_ZLIB
+    if (!WriteAll(out_fd, data, len))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Write() write() error: %s\n", GetErrorString());
+        return false;
+    }
+    out_bytes += len;
+    file_bytes += len;
+    return true;
+}  // end MgenLogStream::Write()
+
+// Advances the text line or binary record parsing over up to "len" bytes
+// (stopping after the first record that ends if "stopAtBoundary" is set),
+// returning the number of bytes consumed
+unsigned int MgenLogStream::Scan(const char* data, unsigned int len, bool stopAtBoundary)
+{
+    if (0 == len) return 0;
+    if (!binary)
+    {
+        if (stopAtBoundary)
+        {
+            const char* ptr = (const char*)memchr(data, '\n', len);
+            at_boundary = (NULL != ptr);
+            return at_boundary ? (unsigned int)(ptr - data + 1) : len;
+        }
+        at_boundary = ('\n' == data[len - 1]);
+        return len;
+    }
+    unsigned int index = 0;
+    while (index < len)
+    {
+        switch (parse_state)
+        {
+            case PARSE_HEADER_LINE:
+            {
+                // NULL terminated header line
+                const char* ptr = (const char*)memchr(data + index, '\0', len - index);
+                if (NULL == ptr)
+                {
+                    index = len;
+                    at_boundary = false;
+                }
+                else
+                {
+                    index = (unsigned int)(ptr - data + 1);
+                    parse_state = PARSE_RECORD_HEADER;
+                    parse_count = 0;
+                    at_boundary = true;
+                }
+                break;
+            }
+            case PARSE_RECORD_HEADER:
+                // <type:1><protocol:1><recordLength:2>
+                record_header[parse_count++] = (unsigned char)data[index++];
+                at_boundary = false;
+                if (4 == parse_count)
+                {
+                    parse_count = ((unsigned int)record_header[2] << 8) | record_header[3];
+                    if (0 != parse_count)
+                        parse_state = PARSE_RECORD_BODY;
+                    else
+                        at_boundary = true;
+                }
+                break;
+            case PARSE_RECORD_BODY:
+            {
+                unsigned int count = len - index;
+                if (count > parse_count) count = parse_count;
+                index += count;
+                parse_count -= count;
+                if (0 == parse_count)
+                {
+                    parse_state = PARSE_RECORD_HEADER;
+                    at_boundary = true;
+                }
+                break;
+            }
+        }
+        if (stopAtBoundary && at_boundary) break;
+    }
+    return index;
+}  // end MgenLogStream::Scan()
+
+bool MgenLogStream::RotateDue(double now) const
+{
+    return (((0 != rotate_bytes) && (file_bytes >= rotate_bytes)) ||
+            ((0 != rotate_interval) && ((now - file_start) >= (double)rotate_interval)));
+}  // end MgenLogStream::RotateDue()
+
+bool MgenLogStream::OpenNext()
+{
+    next_fd = open(next_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (next_fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::OpenNext() open() error: %s\n", GetErrorString());
+        return false;
+    }
+    return true;
+}  // end MgenLogStream::OpenNext()
+
+// "mgen version=<version> type=<type> part=<n>" (NULL terminated for binary
+// logs), or the SetHeader() text
+bool MgenLogStream::WriteHeader()
+{
+    if (!binary && (NULL != header_text))
+        return (('\0' == header_text[0]) || Write(header_text, (unsigned int)strlen(header_text)));
+    char header[128];
+    int len = snprintf(header, sizeof(header), "mgen version=%s type=%s part=%u\n",
+                       MGEN_VERSION, binary ? "binary_log" : "text_log", part);
+    if (binary) len++;
+    return Write(header, (unsigned int)len);
+}  // end MgenLogStream::WriteHeader()
+
+// Finishes the current file as "part" and switches to the pre-opened next file
+bool MgenLogStream::Rotate(double now)
+{
+#ifdef HAVE_ZLIB
+    if (NULL != stream)
+    {
+        if (!Deflate(Z_FINISH)) return false;
+        deflateReset((z_stream*)stream);  // (a new gzip stream per file)
+    }
+#endif // HAVE_ZLIB
+    if ((next_fd < 0) && !OpenNext()) return false;
+    char partPath[PATH_SIZE];
+    GetPartPath(partPath, part);
+    if (0 != rename(path, partPath))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Rotate() rename(%s) error: %s\n", partPath, GetErrorString());
+        return false;
+    }
+    if (0 != rename(next_path, path))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::Rotate() rename(%s) error: %s\n", path, GetErrorString());
+        return false;
+    }
+    close(out_fd);
+    out_fd = next_fd;
+    next_fd = -1;
+    part++;
+    rotate_count++;
+    file_bytes = 0;
+    file_start = now;
+    if (!WriteHeader()) return false;
+    OpenNext();  // (else retried at the next rotation)
+    return true;
+}  // end MgenLogStream::Rotate()
+
+void MgenLogStream::Run()
+{
+    bool rotating = (0 != rotate_bytes) || (0 != rotate_interval);
+    struct pollfd pfd;
+    pfd.fd = pipe_fd;
+    pfd.events = POLLIN;
+    bool pending = false;  // compressed output held by zlib
+    while (true)
+    {
+        // Wake up to sync flush an idle compressed stream or to rotate an
+        // idle file on time
+        int timeout = (pending && !error) ? SYNC_INTERVAL : -1;
+        if ((0 != rotate_interval) && at_boundary && !error)
+        {
+            double delay = file_start + (double)rotate_interval - GetTime();
+            int msec = (delay > 0.0) ? ((int)(1000.0 * delay) + 1) : 0;
+            if ((timeout < 0) || (msec < timeout)) timeout = msec;
+        }
+        pfd.revents = 0;
+        int result = poll(&pfd, 1, timeout);
+        if (result < 0)
+        {
+            if (EINTR == errno) continue;
+            PLOG(PL_ERROR, "MgenLogStream::Run() poll() error: %s\n", GetErrorString());
+            break;
+        }
+        else if (0 == result)
+        {
+            double now = GetTime();
+            if (rotating && at_boundary && RotateDue(now))
+            {
+                if (!Rotate(now)) error = true;
+                pending = false;
+            }
+#ifdef HAVE_ZLIB
+            else if (pending)
+            {
+                // Pipe is idle, so make what we have readable
+                if (!Deflate(Z_SYNC_FLUSH)) error = true;
+                pending = false;
+            }
+#endif // HAVE_ZLIB
+            continue;
+        }
+        ssize_t len = read(pipe_fd, in_buffer, BUFFER_SIZE);
+        if (len < 0)
+        {
+            if (EINTR == errno) continue;
+            PLOG(PL_ERROR, "MgenLogStream::Run() read() error: %s\n", GetErrorString());
+            break;
+        }
+        else if (0 == len)
+        {
+            break;  // all writers have closed the pipe
+        }
+        in_bytes += len;
+        if (error) continue;  // keep draining so writers never block
+        const char* data = in_buffer;
+        unsigned int remaining = (unsigned int)len;
+        while (0 != remaining)
+        {
+            unsigned int count = remaining;
+            if (rotating)
+            {
+                double now = GetTime();
+                bool due = RotateDue(now);
+                if (due && at_boundary)
+                {
+                    if (!Rotate(now))
+                    {
+                        error = true;
+                        break;
+                    }
+                    continue;
+                }
+                // Uncompressed files rotate at the first boundary past "rotate_bytes"
+                if (!due && (0 != rotate_bytes) && (NULL == stream) &&
+                    ((rotate_bytes - file_bytes) < count))
+                {
+                    count = (unsigned int)(rotate_bytes - file_bytes);
+                }
+                count = Scan(data, count, due);
+            }
+            if (!Write(data, count))
+            {
+                error = true;
+                break;
+            }
+            data += count;
+            remaining -= count;
+        }
+        if (NULL != stream) pending = true;
+    }
+#ifdef HAVE_ZLIB
+    if (!error && (NULL != stream)) Deflate(Z_FINISH);
+#endif // HAVE_ZLIB
+}  // end MgenLogStream::Run()
+
+#else
+
+FILE* MgenLogStream::Open(const char* path, bool append, bool binary, bool empty)
+{
+    PLOG(PL_ERROR, "MgenLogStream::Open() error: log compression and rotation not supported in this build\n");
+    return NULL;
+}  // end MgenLogStream::Open()
+
+void MgenLogStream::Close()
+{
+}
+
+#endif // if/else MGEN_LOG_STREAM
+
+bool MgenLogStream::IsCompressed(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file) return false;
+    unsigned char magic[2];
+    bool result = (2 == fread(magic, 1, 2, file)) && (0x1f == magic[0]) && (0x8b == magic[1]);
+    fclose(file);
+    return result;
+}  // end MgenLogStream::IsCompressed()
+
+bool MgenLogStream::ReadFile(const char* path, char*& data, uint64_t& size, bool& mapped)
+{
+    data = NULL;
+    size = 0;
+    mapped = false;
+#ifdef HAVE_ZLIB
+    gzFile file = gzopen(path, "rb");
+    if (NULL == file)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::ReadFile() gzopen() error: %s\n", GetErrorString());
+        return false;
+    }
+    gzbuffer(file, READ_CHUNK);
+#ifdef UNIX
+    // Inflate a chunk at a time into an (unlinked) temporary file and
+    // mmap() that, so only the page cache holds the decompressed log
+    const char* tmpDir = getenv("TMPDIR");
+    if ((NULL == tmpDir) || ('\0' == tmpDir[0])) tmpDir = "/tmp";
+    char tmpPath[PATH_MAX];
+    snprintf(tmpPath, PATH_MAX, "%s/mgenXXXXXX", tmpDir);
+    int fd = mkstemp(tmpPath);
+    if (fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::ReadFile() mkstemp(%s) error: %s\n", tmpPath, GetErrorString());
+        gzclose(file);
+        return false;
+    }
+    unlink(tmpPath);
+    char* chunk = new char[READ_CHUNK];
+    if (NULL == chunk)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::ReadFile() new error: %s\n", GetErrorString());
+        close(fd);
+        gzclose(file);
+        return false;
+    }
+    bool result = true;
+    while (result)
+    {
+        int count = gzread(file, chunk, READ_CHUNK);
+        if (count < 0)
+        {
+            int errnum;
+            PLOG(PL_ERROR, "MgenLogStream::ReadFile() gzread() error: %s\n", gzerror(file, &errnum));
+            result = false;
+            break;
+        }
+        if (0 == count) break;
+        const char* ptr = chunk;
+        while (count > 0)
+        {
+            ssize_t written = write(fd, ptr, count);
+            if (written < 0)
+            {
+                if (EINTR == errno) continue;
+                PLOG(PL_ERROR, "MgenLogStream::ReadFile() write() error: %s\n", GetErrorString());
+                result = false;
+                break;
+            }
+            ptr += written;
+            count -= (int)written;
+            size += (uint64_t)written;
+        }
+    }
+    delete[] chunk;
+    gzclose(file);
+    if (result && (size > (uint64_t)SIZE_MAX))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::ReadFile() error: decompressed size too large to map\n");
+        result = false;
+    }
+    if (result && (0 != size))
+    {
+        void* ptr = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == ptr)
+        {
+            PLOG(PL_ERROR, "MgenLogStream::ReadFile() mmap() error: %s\n", GetErrorString());
+            result = false;
+        }
+        else
+        {
+            data = (char*)ptr;
+            mapped = true;
+        }
+    }
+    close(fd);  // (the mapping keeps the file until munmap())
+    if (!result) size = 0;
+    return result;
+#else
+    // Read into a heap buffer where mmap() isn't available
+    uint64_t bufferSize = 0;
+    while (true)
+    {
+        if (size == bufferSize)
+        {
+            uint64_t newSize = (0 != bufferSize) ? (2 * bufferSize) : 16777216;
+            char* newBuffer = (newSize <= (uint64_t)SIZE_MAX) ? new char[(size_t)newSize] : NULL;
+            if (NULL == newBuffer)
+            {
+                PLOG(PL_ERROR, "MgenLogStream::ReadFile() new error: %s\n", GetErrorString());
+                if (NULL != data) delete[] data;
+                data = NULL;
+                size = 0;
+                gzclose(file);
+                return false;
+            }
+            if (NULL != data)
+            {
+                memcpy(newBuffer, data, (size_t)size);
+                delete[] data;
+            }
+            data = newBuffer;
+            bufferSize = newSize;
+        }
+        uint64_t space = bufferSize - size;
+        if (space > 1073741824) space = 1073741824;
+        int result = gzread(file, data + size, (unsigned int)space);
+        if (result < 0)
+        {
+            int errnum;
+            PLOG(PL_ERROR, "MgenLogStream::ReadFile() gzread() error: %s\n", gzerror(file, &errnum));
+            delete[] data;
+            data = NULL;
+            size = 0;
+            gzclose(file);
+            return false;
+        }
+        if (0 == result) break;
+        size += (uint64_t)result;
+    }
+    gzclose(file);
+    return true;
+#endif // if/else UNIX
+#else
+    PLOG(PL_ERROR, "MgenLogStream::ReadFile() error: compressed logs not supported in this build\n");
+    return false;
+#endif // if/else HAVE_ZLIB
+}  // end MgenLogStream::ReadFile()
+
+bool MgenLogStream::MapFile(const char* path, char*& data, uint64_t& size, bool& mapped)
+{
+    if (IsCompressed(path)) return ReadFile(path, data, size, mapped);
+    data = NULL;
+    size = 0;
+    mapped = false;
+#ifdef UNIX
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() open() error: %s\n", GetErrorString());
+        return false;
+    }
+    struct stat info;
+    if (0 != fstat(fd, &info))
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() fstat() error: %s\n", GetErrorString());
+        close(fd);
+        return false;
+    }
+    if ((uint64_t)info.st_size > (uint64_t)SIZE_MAX)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() error: \"%s\" too large to map\n", path);
+        close(fd);
+        return false;
+    }
+    if (0 != info.st_size)
+    {
+        void* ptr = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == ptr)
+        {
+            PLOG(PL_ERROR, "MgenLogStream::MapFile() mmap() error: %s\n", GetErrorString());
+            close(fd);
+            return false;
+        }
+        data = (char*)ptr;
+        size = (uint64_t)info.st_size;
+        mapped = true;
+    }
+    close(fd);
+    return true;
+#else
+    // Read the whole file where mmap() isn't available
+    FILE* file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() fopen() error: %s\n", GetErrorString());
+        return false;
+    }
+#ifdef WIN32
+    __int64 fileSize = (0 == _fseeki64(file, 0, SEEK_END)) ? _ftelli64(file) : -1;
+    _fseeki64(file, 0, SEEK_SET);
+#else
+    off_t fileSize = (0 == fseeko(file, 0, SEEK_END)) ? ftello(file) : -1;
+    fseeko(file, 0, SEEK_SET);
+#endif // if/else WIN32
+    if (fileSize < 0)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() ftell() error: %s\n", GetErrorString());
+        fclose(file);
+        return false;
+    }
+    if ((uint64_t)fileSize > (uint64_t)SIZE_MAX)
+    {
+        PLOG(PL_ERROR, "MgenLogStream::MapFile() error: \"%s\" too large to read\n", path);
+        fclose(file);
+        return false;
+    }
+    if (0 != fileSize)
+    {
+        size_t count = (size_t)fileSize;
+        data = new char[count];
+        if ((NULL == data) || (fread(data, 1, count, file) < count))
+        {
+            PLOG(PL_ERROR, "MgenLogStream::MapFile() read error: %s\n", GetErrorString());
+            if (NULL != data) delete[] data;
+            data = NULL;
+            fclose(file);
+            return false;
+        }
+        size = (uint64_t)fileSize;
+    }
+    fclose(file);
+    return true;
+#endif // if/else UNIX
+}  // end MgenLogStream::MapFile()
+
+void MgenLogStream::UnmapFile(char* data, uint64_t size, bool mapped)
+{
+    if (NULL == data) return;
+#ifdef UNIX
+    if (mapped)
+        munmap(data, (size_t)size);
+    else
+#endif // UNIX
+        delete[] data;
+}  // end MgenLogStream::UnmapFile()
+
+unsigned int MgenLogStream::ReadHead(const char* path, char* buffer, unsigned int len)
+{
+#ifdef HAVE_ZLIB
+    // (gzread() reads uncompressed files as is)
+    gzFile file = gzopen(path, "rb");
+    if (NULL == file) return 0;
+    int result = gzread(file, buffer, len);
+    gzclose(file);
+    return (result > 0) ? (unsigned int)result : 0;
+#else
+    FILE* file = fopen(path, "rb");
+    if (NULL == file) return 0;
+    unsigned int result = (unsigned int)fread(buffer, 1, len, file);
+    fclose(file);
+    return result;
+#endif // if/else HAVE_ZLIB
+}  // end MgenLogStream::ReadHead()
@@ -32,9 +32,25 @@
 #include "mgenGlobals.h"
 #include "mgenMsg.h"
 #include "mgen.h"
+#include "mgenLogConvert.h"
 
 #include <string.h>
 #include <time.h>
+
+// Hardware CRC32 support (see MgenMsg::UpdateCRC32())
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MGEN_CRC32_PCLMUL
+#include <cpuid.h>
+#include <wmmintrin.h>  // for _mm_clmulepi64_si128()
+#include <smmintrin.h>  // for _mm_extract_epi32()
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define MGEN_CRC32_ARMV8
+#include <stdint.h>     // for uint64_t, uintptr_t
+#include <arm_acle.h>
+#include <sys/auxv.h>   // for getauxval()
+#include <asm/hwcap.h>  // for HWCAP_CRC32
+#endif
+
 MgenMsg::MgenMsg()
   : msg_len(0), mgen_msg_len(0),
     version(VERSION), flags(0),  
@@ -44,7 +60,7 @@ MgenMsg::MgenMsg()
     payload_len(0), payload_data(NULL),
     protocol(INVALID_PROTOCOL),
     msg_error(ERROR_NONE),
-    compute_crc(true)
+    compute_crc(true), log_sample(0)
 {
 
 }
@@ -499,6 +515,78 @@ bool MgenMsg::Unpack(UINT32* alignedBuffer, UINT16 bufferLen, bool forceChecksum
     return true;
 }  // end MgenMsg::Unpack()
 
+bool MgenMsgView::IsValid() const
+{
+    if (buffer_len < MIN_SIZE) return false;
+    if (MgenMsg::VERSION != GetVersion()) return false;
+    switch (buffer[DST_ADDR_TYPE_OFFSET])
+    {
+        case MgenMsg::IPv4:
+        case MgenMsg::IPv6:
+#ifdef SIMULATE
+        case MgenMsg::SIM:
+#endif // SIMULATE
+            break;
+        default:
+            return false;
+    }
+    unsigned int addrLen = (UINT8)buffer[DST_ADDR_LEN_OFFSET];
+    return ((DST_ADDR_OFFSET + addrLen) <= buffer_len);
+}  // end MgenMsgView::IsValid()
+
+bool MgenMsgView::ChecksumIsValid() const
+{
+    if (buffer_len < 4) return false;
+    UINT32 checksum = 0;
+    MgenMsg::ComputeCRC32(checksum, (const UINT8*)buffer, buffer_len - 4);
+    checksum ^= MgenMsg::CRC32_XOROT;
+    return (checksum == GetUINT32(buffer_len - 4));
+}  // end MgenMsgView::ChecksumIsValid()
+
+bool MgenMsgView::GetDstAddr(ProtoAddress& dstAddr) const
+{
+    ProtoAddress::Type addrType;
+    switch (buffer[DST_ADDR_TYPE_OFFSET])
+    {
+        case MgenMsg::IPv4:
+            addrType = ProtoAddress::IPv4;
+            break;
+        case MgenMsg::IPv6:
+            addrType = ProtoAddress::IPv6;
+            break;
+#ifdef SIMULATE
+        case MgenMsg::SIM:
+            addrType = ProtoAddress::SIM;
+            break;
+#endif // SIMULATE
+        default:
+            dstAddr.Invalidate();
+            return false;
+    }
+    unsigned int addrLen = (UINT8)buffer[DST_ADDR_LEN_OFFSET];
+    if ((DST_ADDR_OFFSET + addrLen) > buffer_len)
+    {
+        dstAddr.Invalidate();
+        return false;
+    }
+    dstAddr.SetRawHostAddress(addrType, buffer + DST_ADDR_OFFSET, addrLen);
+    dstAddr.SetPort(GetUINT16(DST_PORT_OFFSET));
+    return true;
+}  // end MgenMsgView::GetDstAddr()
+
+// Mirrors the optional field layout walked by MgenMsg::Unpack()
+MgenMsg::PayloadType MgenMsgView::GetPayloadType() const
+{
+    unsigned int len = DST_ADDR_OFFSET + (UINT8)buffer[DST_ADDR_LEN_OFFSET];
+    // host_port, host_addr(type), host_addr(len), host_addr(addr)
+    if ((len + 4) > buffer_len) return MgenMsg::USER_DATA;
+    len += 4 + (UINT8)buffer[len + 3];
+    // GPS latitude, longitude, altitude, status
+    len += 13;
+    if ((len + 1) > buffer_len) return MgenMsg::USER_DATA;
+    return (MgenMsg::PayloadType)buffer[len];
+}  // end MgenMsgView::GetPayloadType()
+
 bool MgenMsg::WriteChecksum(UINT32& tx_checksum,UINT8* buffer,UINT32 bufferLen)
 {
     if (bufferLen >= 4) 
@@ -521,35 +609,225 @@ bool MgenMsg::WriteChecksum(UINT32& tx_checksum,UINT8* buffer,UINT32 bufferLen)
     
 } // MgenMsg::WriteChecksum()
 
-void MgenMsg::ComputeCRC32(UINT32& checksum,
-                           const UINT8* buffer, 
-                           UINT32               bufferLength)
+// Hardware CRC32 support.  The MGEN checksum is the reflected IEEE 802.3
+// polynomial (0x04C11DB7), so the SSE4.2 "crc32" instruction (CRC-32C) can't 
+// be used on x86; instead PCLMULQDQ carry-less multiply folding is used.
+// ARMv8 has native instructions for this polynomial.  The implementation 
+// is picked once at startup from CPU feature flags.
+enum CRC32Impl {CRC32_IMPL_SLICE8, CRC32_IMPL_PCLMUL, CRC32_IMPL_ARMV8};
+
+#ifdef MGEN_CRC32_PCLMUL
+// Folds "bufferLength" (>= 64 and a multiple of 16) bytes into the CRC
+// register using the constants for the reflected 0x04C11DB7 polynomial
+// from Intel's "Fast CRC Computation for Generic Polynomials Using 
+// PCLMULQDQ Instruction" (as also used by zlib and the Linux kernel).
+__attribute__((target("pclmul,sse4.1")))
+static UINT32 UpdateCRC32Pclmul(UINT32 crc, const UINT8* buffer, UINT32 bufferLength)
 {
-    static int totNumBytes;
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000LL, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
     
-    if (checksum == 0) {
-        checksum = CRC32_XINIT;
-        totNumBytes = 0;
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    buffer += 64;
+    bufferLength -= 64;
+    
+    // Fold four 128-bit lanes in parallel
+    while (bufferLength >= 64)
+    {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buffer + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buffer + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buffer + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buffer + 0x30)));
+        buffer += 64;
+        bufferLength -= 64;
     }
     
-    totNumBytes += bufferLength;
-    DMSG(2,"Calcing %d\n",totNumBytes); 
+    // Fold the four lanes into one
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
     
-    for (UINT32 i = 0; i < bufferLength; i++)
-      checksum = CRC32_TABLE[(checksum ^ *buffer++) & 0xFFL] ^ (checksum >> 8);
+    // Remaining 16-byte blocks
+    while (bufferLength >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i*)buffer);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buffer += 16;
+        bufferLength -= 16;
+    }
+    
+    // Fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
     
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (UINT32)_mm_extract_epi32(x1, 1);
+}  // end UpdateCRC32Pclmul()
+#endif // MGEN_CRC32_PCLMUL
+
+#ifdef MGEN_CRC32_ARMV8
+__attribute__((target("+crc")))
+static UINT32 UpdateCRC32Armv8(UINT32 crc, const UINT8* buffer, UINT32 bufferLength)
+{
+    while ((bufferLength > 0) && (0 != ((uintptr_t)buffer & 7)))
+    {
+        crc = __crc32b(crc, *buffer++);
+        bufferLength--;
+    }
+    while (bufferLength >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, buffer, 8);
+        crc = __crc32d(crc, word);
+        buffer += 8;
+        bufferLength -= 8;
+    }
+    while (bufferLength-- > 0)
+        crc = __crc32b(crc, *buffer++);
+    return crc;
+}  // end UpdateCRC32Armv8()
+#endif // MGEN_CRC32_ARMV8
+
+static CRC32Impl SelectCRC32Impl()
+{
+#ifdef MGEN_CRC32_PCLMUL
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && 
+        (0 != (ecx & bit_PCLMUL)) && (0 != (ecx & bit_SSE4_1)))
+        return CRC32_IMPL_PCLMUL;
+#endif // MGEN_CRC32_PCLMUL
+#ifdef MGEN_CRC32_ARMV8
+    if (0 != (getauxval(AT_HWCAP) & HWCAP_CRC32))
+        return CRC32_IMPL_ARMV8;
+#endif // MGEN_CRC32_ARMV8
+    return CRC32_IMPL_SLICE8;
+}  // end SelectCRC32Impl()
+
+static const CRC32Impl CRC32_IMPL = SelectCRC32Impl();
+
+void MgenMsg::ComputeCRC32(UINT32& checksum,
+                           const UINT8* buffer, 
+                           UINT32               bufferLength)
+{
+    // A zero "checksum" starts a new (possibly multi-buffer) computation
+    if (checksum == 0) 
+        checksum = CRC32_XINIT;
+    checksum = UpdateCRC32(checksum, buffer, bufferLength);
 }  // end MgenMsg::ComputeCRC()
 
 UINT32 MgenMsg::ComputeCRC32(const UINT8* buffer, 
                              UINT32               bufferLength)
 {
-    UINT32 result = CRC32_XINIT;
-    for (UINT32 i = 0; i < bufferLength; i++)
-      result = CRC32_TABLE[(result ^ *buffer++) & 0xFFL] ^ (result >> 8);
+    UINT32 result = UpdateCRC32(CRC32_XINIT, buffer, bufferLength);
     // return XOR out value 
     return (result ^ CRC32_XOROT);
 }  // end MgenMsg::ComputeCRC()
 
+// Slice-by-8: consumes 8 bytes per iteration with eight table lookups
+// (Intel "slicing-by-8").  Bytes are assembled explicitly so the 
+// result doesn't depend on host byte order or buffer alignment.
+UINT32 MgenMsg::UpdateCRC32Slice8(UINT32 crc, const UINT8* buffer, UINT32 bufferLength)
+{
+    while (bufferLength >= 8)
+    {
+        UINT32 one = crc ^ ((UINT32)buffer[0] | ((UINT32)buffer[1] << 8) |
+                            ((UINT32)buffer[2] << 16) | ((UINT32)buffer[3] << 24));
+        UINT32 two = (UINT32)buffer[4] | ((UINT32)buffer[5] << 8) |
+                     ((UINT32)buffer[6] << 16) | ((UINT32)buffer[7] << 24);
+        crc = CRC32_SLICE_TABLE[7][one & 0xff] ^
+              CRC32_SLICE_TABLE[6][(one >> 8) & 0xff] ^
+              CRC32_SLICE_TABLE[5][(one >> 16) & 0xff] ^
+              CRC32_SLICE_TABLE[4][one >> 24] ^
+              CRC32_SLICE_TABLE[3][two & 0xff] ^
+              CRC32_SLICE_TABLE[2][(two >> 8) & 0xff] ^
+              CRC32_SLICE_TABLE[1][(two >> 16) & 0xff] ^
+              CRC32_SLICE_TABLE[0][two >> 24];
+        buffer += 8;
+        bufferLength -= 8;
+    }
+    while (bufferLength-- > 0)
+        crc = CRC32_TABLE[(crc ^ *buffer++) & 0xFFL] ^ (crc >> 8);
+    return crc;
+}  // end MgenMsg::UpdateCRC32Slice8()
+
+// Row 0 is CRC32_TABLE, row k gives the CRC contribution of a
+// byte followed by k zero bytes
+bool MgenMsg::InitCRC32SliceTable()
+{
+    for (unsigned int n = 0; n < 256; n++)
+        CRC32_SLICE_TABLE[0][n] = CRC32_TABLE[n];
+    for (unsigned int k = 1; k < 8; k++)
+    {
+        for (unsigned int n = 0; n < 256; n++)
+        {
+            UINT32 crc = CRC32_SLICE_TABLE[k-1][n];
+            CRC32_SLICE_TABLE[k][n] = (crc >> 8) ^ CRC32_TABLE[crc & 0xff];
+        }
+    }
+    return true;
+}  // end MgenMsg::InitCRC32SliceTable()
+
+UINT32 MgenMsg::CRC32_SLICE_TABLE[8][256];
+const bool MgenMsg::CRC32_SLICE_TABLE_INIT = MgenMsg::InitCRC32SliceTable();
+
+UINT32 MgenMsg::UpdateCRC32(UINT32 crc, const UINT8* buffer, UINT32 bufferLength)
+{
+    switch (CRC32_IMPL)
+    {
+#ifdef MGEN_CRC32_PCLMUL
+        case CRC32_IMPL_PCLMUL:
+            if (bufferLength >= 64)
+            {
+                // Fold whole 16-byte blocks, then finish the tail by table
+                UINT32 foldLength = bufferLength & ~((UINT32)15);
+                crc = UpdateCRC32Pclmul(crc, buffer, foldLength);
+                buffer += foldLength;
+                bufferLength -= foldLength;
+            }
+            break;
+#endif // MGEN_CRC32_PCLMUL
+#ifdef MGEN_CRC32_ARMV8
+        case CRC32_IMPL_ARMV8:
+            return UpdateCRC32Armv8(crc, buffer, bufferLength);
+#endif // MGEN_CRC32_ARMV8
+        default:
+            break;
+    }
+    return UpdateCRC32Slice8(crc, buffer, bufferLength);
+}  // end MgenMsg::UpdateCRC32()
+
 const UINT32 MgenMsg::CRC32_XINIT = 0xFFFFFFFFL; // initial value
 const UINT32 MgenMsg::CRC32_XOROT = 0xFFFFFFFFL; // final xor value 
 
@@ -643,13 +921,41 @@ const UINT32 MgenMsg::CRC32_TABLE[256] =
 
 
 
+void MgenMsg::InitBinaryRecord(MgenBinaryLog::Record& record, MgenBinaryLog& binaryLog)
+{
+    record.protocol = (UINT8)protocol;
+    record.flags = flags & ~CHECKSUM;  // as for the original binary log
+    record.gps_status = (UINT8)gps_status;
+    record.tx_time = tx_time;
+    record.flow_id = flow_id;
+    record.seq_num = seq_num;
+    record.size = msg_len;
+    record.src_id = binaryLog.AddEndpoint(src_addr);
+    record.dst_id = binaryLog.AddEndpoint(dst_addr);
+    if (host_addr.IsValid()) 
+        record.host_id = binaryLog.AddEndpoint(host_addr);
+    // Same position encoding as MgenMsg::Pack()
+    record.latitude = (UINT32)((latitude + 180.0)*60000.0);
+    record.longitude = (UINT32)((longitude + 180.0)*60000.0);
+    record.altitude = altitude;
+    record.sample = (UINT16)log_sample;
+}  // end MgenMsg::InitBinaryRecord()
+
 bool MgenMsg::LogRecvError(FILE*                    logFile,
                            bool                     logBinary,
                            bool                     localTime,
                            bool                     flush,
                            const struct timeval&    theTime)
 {
-    if (logBinary)
+    MgenBinaryLog* binaryLog = logBinary ? MgenBinaryLog::GetActive(logFile) : NULL;
+    if (NULL != binaryLog)
+    {
+        MgenBinaryLog::Record record(RERR_EVENT, theTime);
+        record.src_id = binaryLog->AddEndpoint(src_addr);
+        record.aux = (UINT32)msg_error;
+        if (!binaryLog->WriteEvent(record)) return false;
+    }
+    else if (logBinary)
     {
         char header[128];
         unsigned int index = 0;
@@ -729,9 +1035,21 @@ bool MgenMsg::LogRecvError(FILE*                    logFile,
                 errorString = "dstAddr";
                 break;
         }
-        Mgen::LogTimestamp(logFile, theTime, localTime);
-        Mgen::Log(logFile, "RERR type>%s src>%s/%hu\n", errorString, 
-                           src_addr.GetHostString(), src_addr.GetPort());
+        MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(logFile);
+        if (MgenLogEncoder::TEXT != encoding)
+        {
+            MgenLogEncoder encoder(encoding);
+            encoder.Begin(RERR_EVENT, theTime);
+            encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT, src_addr);
+            encoder.SetString(MgenLogEncoder::COL_ERROR, errorString);
+            Mgen::LogEncoded(logFile, encoder);
+        }
+        else
+        {
+            Mgen::LogTimestamp(logFile, theTime, localTime);
+            Mgen::Log(logFile, "RERR type>%s src>%s/%hu\n", errorString, 
+                               src_addr.GetHostString(), src_addr.GetPort());
+        }
     }
     if (flush)  fflush(logFile);
     return true;
@@ -751,7 +1069,20 @@ bool MgenMsg::LogTcpConnectionEvent(FILE*                     logFile,
 
     ProtoAddress addr = GetDstAddr(); // ljt clean this up
     
-    if (logBinary)
+    MgenBinaryLog* binaryLog = logBinary ? MgenBinaryLog::GetActive(logFile) : NULL;
+    if (NULL != binaryLog)
+    {
+        MgenBinaryLog::Record record(eventType, theTime);
+        record.protocol = (UINT8)protocol;
+        record.flow_id = flow_id;
+        record.src_id = binaryLog->AddEndpoint(src_addr);
+        record.dst_id = binaryLog->AddEndpoint(addr);
+        if (host_addr.IsValid()) 
+            record.host_id = binaryLog->AddEndpoint(host_addr);
+        if (isClient) record.info |= MgenBinaryLog::INFO_CLIENT;
+        if (!binaryLog->WriteEvent(record)) return false;
+    }
+    else if (logBinary)
     {
         char header[128];
         unsigned int index = 0;
@@ -856,6 +1187,29 @@ bool MgenMsg::LogTcpConnectionEvent(FILE*                     logFile,
         }            
         
     }
+    else if (MgenLogEncoder::TEXT != MgenLogEncoder::GetActive(logFile))
+    {
+        MgenLogEncoder encoder(MgenLogEncoder::GetActive(logFile));
+        encoder.Begin(eventType, theTime);
+        encoder.SetString(MgenLogEncoder::COL_PROTO, MgenEvent::GetStringFromProtocol(protocol));
+        // As in the text format, client side events give the flow and
+        // remote destination, server side (and ACCEPT) the remote source
+        if ((ON_EVENT == eventType) || (CONNECT_EVENT == eventType) ||
+            ((ACCEPT_EVENT != eventType) && isClient))
+        {
+            encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, flow_id);
+            encoder.SetUnsigned(MgenLogEncoder::COL_SRC_PORT, src_addr.GetPort());
+            encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT, addr);
+        }
+        else
+        {
+            encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT, addr);
+            encoder.SetUnsigned(MgenLogEncoder::COL_DST_PORT, src_addr.GetPort());
+        }
+        if (host_addr.IsValid())
+            encoder.SetAddress(MgenLogEncoder::COL_HOST, MgenLogEncoder::COL_HOST_PORT, host_addr);
+        Mgen::LogEncoded(logFile, encoder);
+    }
     else 
     {
         Mgen::LogTimestamp(logFile, theTime, localTime);
@@ -955,7 +1309,25 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
                            const struct timeval&    theTime)
 {	      
 
-    if (logBinary)
+    MgenBinaryLog* binaryLog = logBinary ? MgenBinaryLog::GetActive(logFile) : NULL;
+    if (NULL != binaryLog)
+    {
+        MgenBinaryLog::Record record(RECV_EVENT, theTime);
+        InitBinaryRecord(record, *binaryLog);
+        if ((0 != payload_len) && (NULL != payload_data))
+        {
+            MgenBinaryLog::EntryKind kind = (MGEN_DATA == payload_type) ? 
+                    MgenBinaryLog::MGEN_PAYLOAD : MgenBinaryLog::USER_PAYLOAD;
+            record.aux = binaryLog->AddData(kind, (const char*)payload_data, payload_len);
+        }
+        if (ttl >= 0)
+        {
+            record.ttl = (UINT8)ttl;
+            record.info |= MgenBinaryLog::INFO_TTL;
+        }
+        if (!binaryLog->WriteEvent(record)) return false;
+    }
+    else if (logBinary)
     {        
         char header[128];
         unsigned int index = 0;
@@ -1033,7 +1405,52 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
     }
     else
     {
-        if (logRx)
+        MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(logFile);
+        if (logRx && (MgenLogEncoder::TEXT != encoding))
+        {
+            const char* statusString  = NULL;
+            switch (gps_status)
+            {
+                case INVALID_GPS:
+                  statusString = "INVALID";
+                  break;
+                case STALE:
+                  statusString = "STALE";
+                  break;
+                case CURRENT:
+                  statusString = "CURRENT";
+                  break; 
+                default:
+                  DMSG(0, "MgenMsg::LogRecvEvent() invalid GPS status\n");
+                  return false;
+            }
+            MgenLogEncoder encoder(encoding);
+            encoder.Begin(RECV_EVENT, theTime);
+            encoder.SetString(MgenLogEncoder::COL_PROTO, MgenEvent::GetStringFromProtocol(protocol));
+            encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, flow_id);
+            encoder.SetUnsigned(MgenLogEncoder::COL_SEQ, seq_num);
+            encoder.SetAddress(MgenLogEncoder::COL_SRC, MgenLogEncoder::COL_SRC_PORT, src_addr);
+            encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT, dst_addr);
+            if (host_addr.IsValid())
+                encoder.SetAddress(MgenLogEncoder::COL_HOST, MgenLogEncoder::COL_HOST_PORT, host_addr);
+            encoder.SetTime(MgenLogEncoder::COL_SENT, tx_time);
+            encoder.SetUnsigned(MgenLogEncoder::COL_SIZE, msg_len);
+            if (ttl >= 0) encoder.SetUnsigned(MgenLogEncoder::COL_TTL, (unsigned long)ttl);
+            if (logGpsData)
+            {
+                encoder.SetString(MgenLogEncoder::COL_GPS, statusString);
+                encoder.SetDouble(MgenLogEncoder::COL_LAT, latitude);
+                encoder.SetDouble(MgenLogEncoder::COL_LON, longitude);
+                encoder.SetSigned(MgenLogEncoder::COL_ALT, altitude);
+            }
+            if ((0 != payload_len) && logData && (USER_DATA == payload_type))
+                encoder.SetHex(MgenLogEncoder::COL_DATA, (const char*)payload_data, payload_len);
+            UINT8 flagBits = flags & (MgenMsg::CONTINUES | MgenMsg::END_OF_MSG | MgenMsg::CHECKSUM_ERROR);
+            if (0 != flagBits) encoder.SetUnsigned(MgenLogEncoder::COL_FLAGS, flagBits);
+            if (0 != log_sample) encoder.SetUnsigned(MgenLogEncoder::COL_SAMPLE, log_sample);
+            Mgen::LogEncoded(logFile, encoder);
+        }
+        else if (logRx)
         {
             Mgen::LogTimestamp(logFile, theTime, localTime);
             Mgen::Log(logFile,"RECV proto>%s flow>%lu seq>%lu src>%s/%hu ",
@@ -1098,6 +1515,8 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
                 SetFlag(MgenMsg::CHECKSUM_ERROR);
                 Mgen::Log(logFile,"flags>0x%02x ",(flags & MgenMsg::CHECKSUM_ERROR));
             }
+            if (0 != log_sample)
+                Mgen::Log(logFile, "sample>%u ", log_sample);
             Mgen::Log(logFile, "\n");
         }  // end if log_rx
         
@@ -1149,7 +1568,15 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
                            bool     flush,
                            const struct timeval& theTime)
 {
-    if (logBinary)
+    MgenBinaryLog* binaryLog = logBinary ? MgenBinaryLog::GetActive(logFile) : NULL;
+    if (NULL != binaryLog)
+    {
+        MgenBinaryLog::Record record(SEND_EVENT, theTime);
+        InitBinaryRecord(record, *binaryLog);
+        if (TCP == protocol) record.size = mgen_msg_len;
+        if (!binaryLog->WriteEvent(record)) return false;
+    }
+    else if (logBinary)
     {
         char header[128];
         unsigned int index = 0;
@@ -1208,6 +1635,21 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
         }
         
     }
+    else if (MgenLogEncoder::TEXT != MgenLogEncoder::GetActive(logFile))
+    {
+        MgenLogEncoder encoder(MgenLogEncoder::GetActive(logFile));
+        encoder.Begin(SEND_EVENT, theTime);
+        encoder.SetString(MgenLogEncoder::COL_PROTO, MgenEvent::GetStringFromProtocol(protocol));
+        encoder.SetUnsigned(MgenLogEncoder::COL_FLOW, flow_id);
+        encoder.SetUnsigned(MgenLogEncoder::COL_SEQ, seq_num);
+        encoder.SetUnsigned(MgenLogEncoder::COL_SRC_PORT, src_addr.GetPort());
+        encoder.SetAddress(MgenLogEncoder::COL_DST, MgenLogEncoder::COL_DST_PORT, dst_addr);
+        if (host_addr.IsValid())
+            encoder.SetAddress(MgenLogEncoder::COL_HOST, MgenLogEncoder::COL_HOST_PORT, host_addr);
+        encoder.SetUnsigned(MgenLogEncoder::COL_SIZE, (TCP == protocol) ? mgen_msg_len : msg_len);
+        if (0 != log_sample) encoder.SetUnsigned(MgenLogEncoder::COL_SAMPLE, log_sample);
+        Mgen::LogEncoded(logFile, encoder);
+    }
     else
     {
         Mgen::LogTimestamp(logFile, theTime, localTime); 
@@ -1228,18 +1670,57 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
         
         if (host_addr.IsValid())
         {
-            Mgen::Log(logFile, "host>%s/%hu\n", host_addr.GetHostString(), 
+            Mgen::Log(logFile, "host>%s/%hu", host_addr.GetHostString(), 
                       host_addr.GetPort());      
+            if (0 != log_sample)
+                Mgen::Log(logFile, " sample>%u", log_sample);
         }
-        else
+        else if (0 != log_sample)
         {
-            Mgen::Log(logFile, "\n");
+            Mgen::Log(logFile, "sample>%u", log_sample);
         }
+        Mgen::Log(logFile, "\n");
     }
     if (flush) fflush(logFile);
     return true;
 }  // end MgenMsg::LogSendEvent()
 
+// JSON or CSV (LOGFORMAT) form of the LISTEN, IGNORE, JOIN, LEAVE, START
+// and STOP events ("groupAddr" and "sourceAddr" are for JOIN and LEAVE only)
+static void LogEncodedEvent(FILE*                       logFile,
+                            MgenLogEncoder::Encoding    encoding,
+                            LogEventType                eventType,
+                            const struct timeval&       eventTime,
+                            Protocol                    protocol,
+                            UINT16                      portNumber,
+                            const ProtoAddress&         groupAddr,
+                            const ProtoAddress&         sourceAddr,
+                            const char*                 ifaceName)
+{
+    MgenLogEncoder encoder(encoding);
+    encoder.Begin(eventType, eventTime);
+    switch (eventType)
+    {
+        case LISTEN_EVENT:
+        case IGNORE_EVENT:
+            encoder.SetString(MgenLogEncoder::COL_PROTO, MgenBaseEvent::GetStringFromProtocol(protocol));
+            encoder.SetUnsigned(MgenLogEncoder::COL_PORT, portNumber);
+            break;
+        case JOIN_EVENT:
+        case LEAVE_EVENT:
+            encoder.SetAddress(MgenLogEncoder::COL_GROUP, MgenLogEncoder::COLUMN_COUNT, groupAddr);
+            if (sourceAddr.IsValid())
+                encoder.SetAddress(MgenLogEncoder::COL_SOURCE, MgenLogEncoder::COLUMN_COUNT, sourceAddr);
+            if ((NULL != ifaceName) && ('\0' != ifaceName[0]))
+                encoder.SetString(MgenLogEncoder::COL_INTERFACE, ifaceName);
+            if (0 != portNumber) encoder.SetUnsigned(MgenLogEncoder::COL_PORT, portNumber);
+            break;
+        default:
+            break;  // START and STOP have no other fields
+    }
+    Mgen::LogEncoded(logFile, encoder);
+}  // end LogEncodedEvent()
+
 void MgenMsg::LogDrecEvent(LogEventType eventType, const DrecEvent *event, UINT16 portNumber,Mgen& mgen)
 {
     FILE* logFile;
@@ -1250,7 +1731,38 @@ void MgenMsg::LogDrecEvent(LogEventType eventType, const DrecEvent *event, UINT1
     struct timeval eventTime;
     ProtoSystemTime(eventTime);
     bool localTime = mgen.GetLocalTime();
-    if (mgen.GetLogBinary())
+    MgenBinaryLog* binaryLog = mgen.GetLogBinary() ? MgenBinaryLog::GetActive(logFile) : NULL;
+    if (NULL != binaryLog)
+    {
+        MgenBinaryLog::Record record(eventType, eventTime);
+        switch (eventType)
+        {
+            case LISTEN_EVENT:
+            case IGNORE_EVENT:
+                record.protocol = (UINT8)event->GetProtocol();
+                record.aux = portNumber;
+                break;
+            case JOIN_EVENT:
+            case LEAVE_EVENT:
+            {
+                ProtoAddress groupAddr = event->GetGroupAddress();
+                groupAddr.SetPort(portNumber);
+                record.dst_id = binaryLog->AddEndpoint(groupAddr);
+                if (event->GetSourceAddress().IsValid())
+                    record.src_id = binaryLog->AddEndpoint(event->GetSourceAddress());
+                const char* interfaceName = event->GetInterface();
+                if (NULL != interfaceName)
+                    record.aux = binaryLog->AddData(MgenBinaryLog::STRING, interfaceName, strlen(interfaceName));
+                break;
+            }
+            default:
+                DMSG(0, "Mgen::LogDrecEvent() error: invalid event type\n");
+                ASSERT(0);
+                return;
+        }
+        binaryLog->WriteEvent(record);
+    }
+    else if (mgen.GetLogBinary())
     {
         char buffer[128];
         unsigned int index = 0;
@@ -1338,6 +1850,12 @@ void MgenMsg::LogDrecEvent(LogEventType eventType, const DrecEvent *event, UINT1
         if (fwrite(buffer, 1, index, logFile) < index)
             DMSG(0, "Mgen::LogDrecEvent() fwrite() error: %s\n", GetErrorString()); 
     }
+    else if (MgenLogEncoder::TEXT != MgenLogEncoder::GetActive(logFile))
+    {
+        LogEncodedEvent(logFile, MgenLogEncoder::GetActive(logFile), eventType, eventTime,
+                        event->GetProtocol(), portNumber, event->GetGroupAddress(),
+                        event->GetSourceAddress(), event->GetInterface());
+    }
     else
     {
         switch (eventType)
@@ -1416,343 +1934,359 @@ void MgenMsg::LogDrecEvent(LogEventType eventType, const DrecEvent *event, UINT1
 
 bool MgenMsg::ConvertBinaryLog(const char* path, Mgen& mgen)
 {
-    FILE* logFile = mgen.GetLogFile();
-    bool localTime = mgen.GetLocalTime();
-    bool log_flush = mgen.GetLogFlush();
-    bool log_rx = mgen.GetLogRx();
-    bool log_data = mgen.GetLogData();
-    bool log_gps_data = mgen.GetLogGpsData();
-
-    if (NULL == logFile) return false;
-    FILE* file = fopen(path, "rb");
-    if (!file)
+    if (NULL == mgen.GetLogFile()) return false;
+    // A RECORDER ring file (e.g. left by a crashed mgen) is written out
+    // as a text log
+    if (MgenFlightRecorder::IsRecorderFile(path))
     {
-        DMSG(0, "Mgen::ConvertFile() fopen() Error: %s\n", GetErrorString());   
-        return false;    
-    }
-    const unsigned int BINARY_RECORD_MAX = 1024;  // maximum record size
-    UINT32 alignedBuffer[BINARY_RECORD_MAX/4];
-    char* buffer = (char*)alignedBuffer;
-    const char* eventName;
-    // Read ASCII binary log header line
-    // The first four characters should be "mgen"
-    if (fread(buffer, 1, 4, file) < 4)
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-        fclose(file);
-        return false;
-    }
-    if (strncmp("mgen", buffer, 4) != 0)
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error: invalid mgen log file\n");
-        fclose(file);
-        return false;
-    }
-    
-    // Read remainder of header line, including terminating NULL
-    unsigned int index = 3;
-    while ('\0' != buffer[index])
-    {
-        index++;
-        if (fread(buffer+index, 1, 1, file) < 1)
+        if (mgen.GetLogBinary())
         {
-            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-            fclose(file);
+            DMSG(0, "MgenMsg::ConvertBinaryLog() error: RECORDER files convert to text logs only\n");
             return false;
         }
+        return MgenFlightRecorder::Dump(path, mgen.GetLogFile(), mgen.GetLocalTime(),
+                                        (Mgen::LogTimestamp == Mgen::LogEpochTimestamp),
+                                        mgen.GetLogEncoding());
     }
-    
-    // Confirm log file "version" and "type"
-    char* ptr = strstr(buffer, "version=");
-    if (ptr)
+    // Conversion to text is done by MgenLogConverter (in parallel).  If
+    // a v3 binary log is open, records are re-logged to it instead (i.e.
+    // the log is upgraded).  Either input may be compressed.
+    MgenLogConverter converter;
+    return converter.Convert(path, mgen, false);
+}  // end MgenMsg::ConvertBinaryLog()
+
+bool MgenMsg::SummarizeBinaryLog(const char* path, Mgen& mgen)
+{
+    if (NULL == mgen.GetLogFile()) return false;
+    MgenLogConverter converter;
+    return converter.Convert(path, mgen, true);
+}  // end MgenMsg::SummarizeBinaryLog()
+
+bool MgenMsg::UnpackBinaryRecord(LogEventType           eventType, 
+                                 Protocol               theProtocol, 
+                                 UINT32*                alignedBuffer,
+                                 UINT16                 recordLength,
+                                 bool                   logData,
+                                 struct timeval&        eventTime)
+{
+    char* buffer = (char*)alignedBuffer;
+    unsigned int index = 0;
+    if (RECV_EVENT == eventType)
     {
-        // Just look at major version number for moment
-        int version;
-        if (1 == sscanf(ptr, "version=%d", &version))
+        // get "eventTime"
+        UINT32 temp32;
+        memcpy(&temp32, buffer+index, sizeof(INT32));
+        eventTime.tv_sec = ntohl(temp32);
+        index += sizeof(INT32);
+        memcpy(&temp32, buffer+index, sizeof(INT32));
+        eventTime.tv_usec = ntohl(temp32);
+        index += sizeof(INT32);
+        // get "srcPort"
+        UINT16 temp16;
+        memcpy(&temp16, buffer+index, sizeof(INT16));
+        UINT16 srcPort = ntohs(temp16);
+        index += sizeof(INT16);
+        // get "srcAddrType"
+        ProtoAddress::Type addrType;
+        switch (buffer[index++])
         {
-            if (version != 4 && version != 5)
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file version\n"); 
-                fclose(file);
-                return false;   
-            }            
+          case MgenMsg::IPv4:
+              addrType = ProtoAddress::IPv4;
+              break;
+          case MgenMsg::IPv6:
+              addrType = ProtoAddress::IPv6;
+              break;
+          default:
+              DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
+                      buffer[index-1]);
+              return false;   
         }
-        else
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" value\n"); 
-            fclose(file);
-            return false;  
-        }                
-    }
-    else
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" label\n"); 
-        fclose(file);
-        return false;  
+        // get "srcAddrLen"
+        unsigned int addrLen = (unsigned int)buffer[index++];
+        ProtoAddress srcAddr;
+        // get "srcAddr"
+        srcAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+        index += addrLen;
+        srcAddr.SetPort(srcPort);
+
+        // The remainder of the record corresponds to the message content
+        SetProtocol(theProtocol);
+        SetSrcAddr(srcAddr);
+        SetTxTime(eventTime);
+        ASSERT(0 == index%4)
+        Unpack(alignedBuffer+index/4, recordLength - index, false, logData);
+        return true;
     }
-    ptr = strstr(ptr, "type=");
-    if (ptr)
+    else if (SEND_EVENT == eventType)
     {
-        char fileType[128];
-        if (1 == sscanf(ptr, "type=%s", fileType))
+        // get tcp mgen_msg_len
+        if (theProtocol == TCP)
         {
-            if (strcmp(fileType, "binary_log"))
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file type\n"); 
-                fclose(file);
-                return false; 
-            }
-        }
-        else
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" value\n"); 
-            fclose(file);
-            return false; 
+            UINT32 temp32;
+            memcpy(&temp32,buffer+index,sizeof(INT32));
+            SetMgenMsgLen(ntohl(temp32));
+            index += sizeof(UINT32);
+
         }
+        SetProtocol(theProtocol);
+        ASSERT(0 == index%4)
+        Unpack(alignedBuffer+index/4, recordLength, false, logData);
+        eventTime = tx_time;
+        return true;
     }
-    else
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" label\n"); 
-        fclose(file);
-        return false;
-    }    
-    
-    // Now loop, reading in records one by one, and output text format
-    while (1)
+    return false;
+}  // end MgenMsg::UnpackBinaryRecord()
+
+bool MgenMsg::ConvertBinaryRecord(LogEventType  eventType, 
+                                  Protocol      theProtocol, 
+                                  UINT32*       alignedBuffer,
+                                  UINT16        recordLength,
+                                  Mgen&         mgen)
+{
+    FILE* logFile = mgen.GetLogFile();
+    bool localTime = mgen.GetLocalTime();
+    bool log_flush = mgen.GetLogFlush();
+    bool log_rx = mgen.GetLogRx();
+    bool log_data = mgen.GetLogData();
+    bool log_gps_data = mgen.GetLogGpsData();
+    MgenBinaryLog* binaryLog = MgenBinaryLog::GetActive(logFile);
+    bool logBinary = (NULL != binaryLog);
+    MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(logFile);
+    char* buffer = (char*)alignedBuffer;
+    const char* eventName;
+    unsigned int index = 0;
+    switch (eventType)
     {
-        // 1) Read record header (4 bytes)
-        char header[4];
-        if (fread(header, 1, 4, file) < 4)
-        {
-            if (feof(file))
-            {
-                break;
-            }
-            else
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-                fclose(file);
-                return false;
-            }   
-        }
-        LogEventType eventType = (LogEventType)header[0];
-        Protocol theProtocol = (Protocol)header[1];
-        UINT16 recordLength;
-        memcpy(&recordLength, header+2, sizeof(INT16));
-        recordLength = ntohs(recordLength);
-        if (recordLength > BINARY_RECORD_MAX)
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() record len:%hu exceeds maximum length\n", recordLength);
-            fclose(file);
-            return false;  
-        }
-        // 2) Read the entire record
-        if (fread(buffer, 1, recordLength, file) < recordLength)
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-            fclose(file);
-            return false;
-        }
-        // 3) Convert the record to text
-        unsigned int index = 0;
-        switch (eventType)
-        {
-            case RECV_EVENT:
+        case RECV_EVENT:
+          {
+              MgenMsg msg;
+              struct timeval eventTime;
+              if (!msg.UnpackBinaryRecord(eventType, theProtocol, alignedBuffer, recordLength,
+                                          log_data, eventTime))
+                  return false;
+              msg.LogRecvEvent(logFile, logBinary, localTime, log_rx, log_data, log_gps_data, NULL, log_flush, -1, eventTime);
+              break;
+          }
+        case SEND_EVENT:
+          {
+              MgenMsg msg;
+              struct timeval eventTime;
+              msg.UnpackBinaryRecord(eventType, theProtocol, alignedBuffer, recordLength,
+                                     log_data, eventTime);
+              msg.LogSendEvent(logFile, logBinary, localTime, NULL, log_flush, eventTime);
+              break;
+          }
+        case LISTEN_EVENT:
+        case IGNORE_EVENT:
+          {
+              eventName = (LISTEN_EVENT == eventType) ? "LISTEN" : "IGNORE";
+              unsigned int index = 0;
+              // get "eventTime"
+              struct timeval eventTime;
+              UINT32 temp32;
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_sec = ntohl(temp32);
+              index += sizeof(INT32);
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_usec = ntohl(temp32);
+              index += sizeof(INT32);
+              // get "protocol"
+              Protocol eventProtocol = (Protocol)buffer[index++];
+              const char* protoName = 
+                MgenBaseEvent::GetStringFromProtocol(eventProtocol);
+              // skip "reserved" field
+              index++;
+              // get "portNumber"
+              UINT16 temp16;
+              memcpy(&temp16, buffer+index, sizeof(INT16));
+              UINT16 portNumber = ntohs(temp16);
+              if (logBinary)
               {
-                  // get "eventTime"
-                  struct timeval eventTime;
-                  UINT32 temp32;
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_sec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_usec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  // get "srcPort"
-                  UINT16 temp16;
-                  memcpy(&temp16, buffer+index, sizeof(INT16));
-                  UINT16 srcPort = ntohs(temp16);
-                  index += sizeof(INT16);
-                  // get "srcAddrType"
-                  ProtoAddress::Type addrType;
-                  switch (buffer[index++])
-                  {
-                    case MgenMsg::IPv4:
-                        addrType = ProtoAddress::IPv4;
-                        break;
-                    case MgenMsg::IPv6:
-                        addrType = ProtoAddress::IPv6;
-                        break;
-                    default:
-                        DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
-                                buffer[index-1]);
-                        fclose(file);
-                        return false;   
-                  }
-                  // get "srcAddrLen"
-                  unsigned int addrLen = (unsigned int)buffer[index++];
-                  ProtoAddress srcAddr;
-                  // get "srcAddr"
-                  srcAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-                  index += addrLen;
-                  srcAddr.SetPort(srcPort);
-
-                  // The remainder of the record corresponds to the message content
-                  MgenMsg msg;
-                  msg.SetProtocol(theProtocol);
-                  msg.SetSrcAddr(srcAddr);
-                  msg.SetTxTime(eventTime);
-                  ASSERT(0 == index%4)
-                  msg.Unpack(alignedBuffer+index/4, recordLength - index, false, log_data);
-                  msg.LogRecvEvent(logFile, false, localTime, log_rx, log_data, log_gps_data, NULL, -1, log_flush,eventTime);
+                  MgenBinaryLog::Record record(eventType, eventTime);
+                  record.protocol = (UINT8)eventProtocol;
+                  record.aux = portNumber;
+                  binaryLog->WriteEvent(record);
                   break;
               }
-            case SEND_EVENT:
+              if (MgenLogEncoder::TEXT != encoding)
               {
-                  MgenMsg msg;
-                  // get tcp mgen_msg_len
-                  if (theProtocol == TCP)
-                  {
-                      UINT32 temp32;
-                      memcpy(&temp32,buffer+index,sizeof(INT32));
-                      msg.SetMgenMsgLen(ntohl(temp32));
-                      index += sizeof(UINT32);
-
-                  }
-                  msg.SetProtocol(theProtocol);
-                  ASSERT(0 == index%4)
-                  msg.Unpack(alignedBuffer+index/4, recordLength, false, log_data);
-                  msg.LogSendEvent(logFile,false, localTime, NULL, log_flush, msg.tx_time);
+                  LogEncodedEvent(logFile, encoding, eventType, eventTime, eventProtocol,
+                                  portNumber, ProtoAddress(), ProtoAddress(), NULL);
                   break;
               }
-            case LISTEN_EVENT:
-            case IGNORE_EVENT:
+              // Output text log format
+              Mgen::LogTimestamp(logFile, eventTime, localTime);
+              Mgen::Log(logFile, "%s proto>%s port>%hu\n",
+                        eventName, protoName, portNumber);
+              break;   
+          }
+        case JOIN_EVENT:
+        case LEAVE_EVENT:
+          {
+              unsigned int index = 0;
+              // get "eventTime"
+              struct timeval eventTime;
+              UINT32 temp32;
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_sec = ntohl(temp32);
+              index += sizeof(INT32);
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_usec = ntohl(temp32);
+              index += sizeof(INT32);
+              // get "groupPort"
+              UINT16 temp16;
+              memcpy(&temp16, buffer+index, sizeof(INT16));
+              UINT16 groupPort = ntohs(temp16);
+              index += sizeof(INT16);
+              // get "groupAddrType"
+              ProtoAddress::Type addrType;
+              switch (buffer[index++])
               {
-                  eventName = (LISTEN_EVENT == eventType) ? "LISTEN" : "IGNORE";
-                  unsigned int index = 0;
-                  // get "eventTime"
-                  struct timeval eventTime;
-                  UINT32 temp32;
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_sec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_usec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  // get "protocol"
-                  const char* protoName = 
-                    MgenBaseEvent::GetStringFromProtocol((Protocol)buffer[index++]);
-                  // skip "reserved" field
-                  index++;
-                  // get "portNumber"
-                  UINT16 temp16;
-                  memcpy(&temp16, buffer+index, sizeof(INT16));
-                  UINT16 portNumber = ntohs(temp16);
-                  // Output text log format
-                  Mgen::LogTimestamp(logFile, eventTime, localTime);
-                  Mgen::Log(logFile, "%s proto>%s port>%hu\n",
-                            eventName, protoName, portNumber);
-                  break;   
+              case MgenMsg::IPv4:
+                addrType = ProtoAddress::IPv4;
+                break;
+              case MgenMsg::IPv6:
+                addrType = ProtoAddress::IPv6;
+                break;
+              default:
+                DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type\n");
+                return false;   
               }
-            case JOIN_EVENT:
-            case LEAVE_EVENT:
+              // get "groupAddrLen"
+              unsigned int addrLen = (unsigned int)buffer[index++];
+              ProtoAddress groupAddr;
+              // get "groupAddr"
+              groupAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+              index += addrLen;
+              // get "ifaceNameLen"
+              unsigned int ifaceNameLen = buffer[index++];
+              char ifaceName[128];
+              memcpy(ifaceName, buffer+index, ifaceNameLen);
+              ifaceName[ifaceNameLen] = '\0';
+              if (logBinary)
               {
-                  unsigned int index = 0;
-                  // get "eventTime"
-                  struct timeval eventTime;
-                  UINT32 temp32;
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_sec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_usec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  // get "groupPort"
-                  UINT16 temp16;
-                  memcpy(&temp16, buffer+index, sizeof(INT16));
-                  UINT16 groupPort = ntohs(temp16);
-                  index += sizeof(INT16);
-                  // get "groupAddrType"
-                  ProtoAddress::Type addrType;
-                  switch (buffer[index++])
-                  {
-                  case MgenMsg::IPv4:
-                    addrType = ProtoAddress::IPv4;
-                    break;
-                  case MgenMsg::IPv6:
-                    addrType = ProtoAddress::IPv6;
-                    break;
-                  default:
-                    DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type\n");
-                    fclose(file);
-                    return false;   
-                  }
-                  // get "groupAddrLen"
-                  unsigned int addrLen = (unsigned int)buffer[index++];
-                  ProtoAddress groupAddr;
-                  // get "groupAddr"
-                  groupAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-                  index += addrLen;
-                  // get "ifaceNameLen"
-                  unsigned int ifaceNameLen = buffer[index++];
-                  char ifaceName[128];
-                  memcpy(ifaceName, buffer+index, ifaceNameLen);
-                  ifaceName[ifaceNameLen] = '\0';
-                  // Output text log format
-                  eventName = (JOIN_EVENT == eventType) ? "JOIN" : "LEAVE";
-                  Mgen::LogTimestamp(logFile, eventTime, localTime);
-                  Mgen::Log(logFile, "%s group>%s", eventName, groupAddr.GetHostString());
-                  if (ifaceNameLen) Mgen::Log(logFile, " interface>%s", ifaceName);
-                  if (groupPort)
-                    Mgen::Log(logFile, " port>%hu\n", groupPort);
-                  else
-                    Mgen::Log(logFile, "\n");
+                  MgenBinaryLog::Record record(eventType, eventTime);
+                  groupAddr.SetPort(groupPort);
+                  record.dst_id = binaryLog->AddEndpoint(groupAddr);
+                  record.aux = binaryLog->AddData(MgenBinaryLog::STRING, ifaceName, ifaceNameLen);
+                  binaryLog->WriteEvent(record);
                   break;
               }
-            case START_EVENT:
-            case STOP_EVENT:
+              if (MgenLogEncoder::TEXT != encoding)
               {
-                  eventName = (START_EVENT == eventType) ? "START" : "STOP";
-                  unsigned int index = 0;
-                  // get "eventTime"
-                  struct timeval eventTime;
-                  UINT32 temp32;
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_sec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_usec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  Mgen::LogTimestamp(logFile, eventTime, localTime);
-                  Mgen::Log(logFile, "%s\n", eventName);
+                  LogEncodedEvent(logFile, encoding, eventType, eventTime, INVALID_PROTOCOL,
+                                  groupPort, groupAddr, ProtoAddress(), ifaceName);
                   break;
               }
-            case ON_EVENT:
-            case ACCEPT_EVENT:
-            case CONNECT_EVENT:
-            case DISCONNECT_EVENT:
-            case OFF_EVENT:
-            case SHUTDOWN_EVENT:
+              // Output text log format
+              eventName = (JOIN_EVENT == eventType) ? "JOIN" : "LEAVE";
+              Mgen::LogTimestamp(logFile, eventTime, localTime);
+              Mgen::Log(logFile, "%s group>%s", eventName, groupAddr.GetHostString());
+              if (ifaceNameLen) Mgen::Log(logFile, " interface>%s", ifaceName);
+              if (groupPort)
+                Mgen::Log(logFile, " port>%hu\n", groupPort);
+              else
+                Mgen::Log(logFile, "\n");
+              break;
+          }
+        case START_EVENT:
+        case STOP_EVENT:
+          {
+              eventName = (START_EVENT == eventType) ? "START" : "STOP";
+              unsigned int index = 0;
+              // get "eventTime"
+              struct timeval eventTime;
+              UINT32 temp32;
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_sec = ntohl(temp32);
+              index += sizeof(INT32);
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_usec = ntohl(temp32);
+              index += sizeof(INT32);
+              if (logBinary)
+              {
+                  MgenBinaryLog::Record record(eventType, eventTime);
+                  binaryLog->WriteEvent(record);
+                  break;
+              }
+              if (MgenLogEncoder::TEXT != encoding)
+              {
+                  LogEncodedEvent(logFile, encoding, eventType, eventTime, INVALID_PROTOCOL,
+                                  0, ProtoAddress(), ProtoAddress(), NULL);
+                  break;
+              }
+              Mgen::LogTimestamp(logFile, eventTime, localTime);
+              Mgen::Log(logFile, "%s\n", eventName);
+              break;
+          }
+        case ON_EVENT:
+        case ACCEPT_EVENT:
+        case CONNECT_EVENT:
+        case DISCONNECT_EVENT:
+        case OFF_EVENT:
+        case SHUTDOWN_EVENT:
 	    case RECONNECT_EVENT:
+          {
+              // get "eventTime"
+              struct timeval eventTime;
+              UINT32 temp32;
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_sec = ntohl(temp32);
+              index += sizeof(INT32);
+              memcpy(&temp32, buffer+index, sizeof(INT32));
+              eventTime.tv_usec = ntohl(temp32);
+              index += sizeof(INT32);
+
+              // get "srcPort"
+              UINT16 temp16;
+              memcpy(&temp16, buffer+index, sizeof(INT16));
+              UINT16 port = ntohs(temp16);
+              index += sizeof(INT16);
+
+              // get "srcAddrType"
+              ProtoAddress::Type addrType;
+              switch (buffer[index++])
               {
-                  // get "eventTime"
-                  struct timeval eventTime;
-                  UINT32 temp32;
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_sec = ntohl(temp32);
-                  index += sizeof(INT32);
-                  memcpy(&temp32, buffer+index, sizeof(INT32));
-                  eventTime.tv_usec = ntohl(temp32);
-                  index += sizeof(INT32);
-
-                  // get "srcPort"
-                  UINT16 temp16;
+              case MgenMsg::IPv4:
+                addrType = ProtoAddress::IPv4;
+                break;
+              case MgenMsg::IPv6:
+                addrType = ProtoAddress::IPv6;
+                break;
+              default:
+                DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
+                     buffer[index-1]);
+                return false;   
+              }
+              // get "srcAddrLen"
+              unsigned int addrLen = (unsigned int)buffer[index++];
+              ProtoAddress addr;
+              // get "srcAddr"
+              addr.SetRawHostAddress(addrType, buffer+index, addrLen);
+              index += addrLen;
+              addr.SetPort(port);
+              // get "dstPort"
+              memcpy(&temp16,buffer+index,sizeof(INT16));
+              UINT16 dstPort = ntohs(temp16);
+              index += sizeof(INT16);              
+
+              // get "flow_id" (it might not exist - its' how we
+              // are differentiating between clients and servers
+              // for now)
+              UINT32 flow_id = 0;
+              memcpy(&temp32,buffer+index,sizeof(UINT32));
+              flow_id = ntohl(temp32);
+              index += sizeof(UINT32);	    
+
+              ProtoAddress hostAddr;
+              // get "hostPort"
+              if ((index+4) <= recordLength)
+              {
+
                   memcpy(&temp16, buffer+index, sizeof(INT16));
-                  UINT16 port = ntohs(temp16);
+                  UINT16 hostPort = ntohs(temp16);
                   index += sizeof(INT16);
-
-                  // get "srcAddrType"
-                  ProtoAddress::Type addrType;
+                  // get "hostAddrType"
                   switch (buffer[index++])
                   {
                   case MgenMsg::IPv4:
@@ -1762,140 +2296,263 @@ bool MgenMsg::ConvertBinaryLog(const char* path, Mgen& mgen)
                     addrType = ProtoAddress::IPv6;
                     break;
                   default:
-                    DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
-                         buffer[index-1]);
-                    fclose(file);
-                    return false;   
+                    addrType = ProtoAddress::INVALID;
+                    break;
                   }
-                  // get "srcAddrLen"
-                  unsigned int addrLen = (unsigned int)buffer[index++];
-                  ProtoAddress addr;
-                  // get "srcAddr"
-                  addr.SetRawHostAddress(addrType, buffer+index, addrLen);
-                  index += addrLen;
-                  addr.SetPort(port);
-                  // get "dstPort"
-                  memcpy(&temp16,buffer+index,sizeof(INT16));
-                  UINT16 dstPort = ntohs(temp16);
-                  index += sizeof(INT16);              
-
-                  // get "flow_id" (it might not exist - its' how we
-                  // are differentiating between clients and servers
-                  // for now)
-                  UINT32 flow_id = 0;
-                  memcpy(&temp32,buffer+index,sizeof(UINT32));
-                  flow_id = ntohl(temp32);
-                  index += sizeof(UINT32);	    
-
-                  ProtoAddress hostAddr;
-                  // get "hostPort"
-                  if ((index+4) <= recordLength)
-                  {
+                  // get "hostAddrLen"
+                  addrLen = (unsigned int)buffer[index++];
 
-                      memcpy(&temp16, buffer+index, sizeof(INT16));
-                      UINT16 hostPort = ntohs(temp16);
-                      index += sizeof(INT16);
-                      // get "hostAddrType"
-                      switch (buffer[index++])
+                  if (index+addrLen <= recordLength)
+                  {
+                      if (ProtoAddress::INVALID != addrType && addrLen)
                       {
-                      case MgenMsg::IPv4:
-                        addrType = ProtoAddress::IPv4;
+                          // get "hostAddr"
+                          hostAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+                          index += addrLen;
+                          hostAddr.SetPort(hostPort);
+                      }
+                  }
+              }
+              if (logBinary || (MgenLogEncoder::TEXT != encoding))
+              {
+                  // The original format has only the port of the local
+                  // endpoint, so it gets a placeholder ("any") address
+                  MgenMsg msg;
+                  char anyAddr[16];
+                  memset(anyAddr, 0, sizeof(anyAddr));
+                  ProtoAddress localAddr;
+                  localAddr.SetRawHostAddress(addr.GetType(), anyAddr, addr.GetLength());
+                  localAddr.SetPort(dstPort);
+                  msg.SetSrcAddr(localAddr);
+                  msg.SetDstAddr(addr);
+                  msg.SetHostAddr(hostAddr);
+                  msg.SetFlowId(flow_id);
+                  msg.LogTcpConnectionEvent(logFile, logBinary, localTime, log_flush, eventType, 
+                                            (0 != flow_id), eventTime);
+                  break;
+              }
+              // Let's just keep it verbose and clear...
+              switch (eventType) 
+              {
+                  case ON_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        Mgen::Log(logFile, "ON flow>%lu srcPort>%hu dst>%s/%hu",
+                                    flow_id,dstPort,addr.GetHostString(),addr.GetPort());
                         break;
-                      case MgenMsg::IPv6:
-                        addrType = ProtoAddress::IPv6;
+                  case ACCEPT_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        Mgen::Log(logFile, "ACCEPT src>%s/%hu dstPort>%hu",
+                                    addr.GetHostString(),addr.GetPort(),dstPort);
                         break;
-                      default:
-                        addrType = ProtoAddress::INVALID;
+                  case CONNECT_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        Mgen::Log(logFile, "CONNECT flow>%lu srcPort>%hu dst>%s/%hu",
+                                    flow_id,dstPort,addr.GetHostString(),addr.GetPort());
+                        break;
+                  case DISCONNECT_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        if (flow_id)
+                            Mgen::Log(logFile, "DISCONNECT flow>%lu dst>%s/%hu srcPort>%hu",
+                                        flow_id,addr.GetHostString(),addr.GetPort(),dstPort);
+                        else
+                            Mgen::Log(logFile, "DISCONNECT src>%s/%hu dstPort>%hu",
+                                        addr.GetHostString(),addr.GetPort(), dstPort);
                         break;
-                      }
-                      // get "hostAddrLen"
-                      addrLen = (unsigned int)buffer[index++];
-
-                      if (index+addrLen <= recordLength)
-                      {
-                          if (ProtoAddress::INVALID != addrType && addrLen)
-                          {
-                              // get "hostAddr"
-                              hostAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-                              index += addrLen;
-                              hostAddr.SetPort(hostPort);
-                          }
-                      }
-                  }
-                  // Let's just keep it verbose and clear...
-                  switch (eventType) 
-                  {
-                      case ON_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            Mgen::Log(logFile, "ON flow>%lu srcPort>%hu dst>%s/%hu",
-                                        flow_id,dstPort,addr.GetHostString(),addr.GetPort());
-                            break;
-                      case ACCEPT_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            Mgen::Log(logFile, "ACCEPT src>%s/%hu dstPort>%hu",
-                                        addr.GetHostString(),addr.GetPort(),dstPort);
-                            break;
-                      case CONNECT_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            Mgen::Log(logFile, "CONNECT flow>%lu srcPort>%hu dst>%s/%hu",
-                                        flow_id,dstPort,addr.GetHostString(),addr.GetPort());
-                            break;
-                      case DISCONNECT_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            if (flow_id)
-                                Mgen::Log(logFile, "DISCONNECT flow>%lu dst>%s/%hu srcPort>%hu",
-                                            flow_id,addr.GetHostString(),addr.GetPort(),dstPort);
-                            else
-                                Mgen::Log(logFile, "DISCONNECT src>%s/%hu dstPort>%hu",
-                                            addr.GetHostString(),addr.GetPort(), dstPort);
-                            break;
 			    
 		      case RECONNECT_EVENT:
 			// We will only have client side connect events but log
 			// both in the event this changes.
 			    Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            if (flow_id)
-                                Mgen::Log(logFile, "RECONNECT flow>%lu dst>%s/%hu srcPort>%hu",
-                                            flow_id,addr.GetHostString(),addr.GetPort(),dstPort);
-                            else
-                                Mgen::Log(logFile, "RECONNECT src>%s/%hu dstPort>%hu",
-                                            addr.GetHostString(),addr.GetPort(), dstPort);
-                            break;
-
-                      case SHUTDOWN_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            if (flow_id)
-                                Mgen::Log(logFile, "SHUTDOWN flow>%lu dst>%s/%hu srcPort>%hu",
-                                            flow_id,addr.GetHostString(),addr.GetPort(), dstPort);
-                            else
-                                Mgen::Log(logFile, "SHUTDOWN src>%s/%hu dstPort>%hu",
-                                            addr.GetHostString(),addr.GetPort(), dstPort);
-                            break;
-
-                      case OFF_EVENT:
-                            Mgen::LogTimestamp(logFile, eventTime, localTime);
-                            if (flow_id)
-                                Mgen::Log(logFile, "OFF flow>%lu srcPort>%hu dst>%s/%hu",
-                                            flow_id,dstPort, addr.GetHostString(),addr.GetPort());
-                            else
-                                Mgen::Log(logFile, "OFF src>%s/%hu dstPort>%hu",
-                                            addr.GetHostString(),addr.GetPort(),dstPort);
-                            break;
-                      default:
-                            DMSG(0,"Mgen::ConvertBinaryLog Invalid event type.\n");
-                  }
-                  if (hostAddr.IsValid()) 		
-                        Mgen::Log(logFile,"host>%s/%hu", hostAddr.GetHostString(),hostAddr.GetPort());	   	  
-                  Mgen::Log(logFile,"\n");
-                  break;
+                        if (flow_id)
+                            Mgen::Log(logFile, "RECONNECT flow>%lu dst>%s/%hu srcPort>%hu",
+                                        flow_id,addr.GetHostString(),addr.GetPort(),dstPort);
+                        else
+                            Mgen::Log(logFile, "RECONNECT src>%s/%hu dstPort>%hu",
+                                        addr.GetHostString(),addr.GetPort(), dstPort);
+                        break;
+
+                  case SHUTDOWN_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        if (flow_id)
+                            Mgen::Log(logFile, "SHUTDOWN flow>%lu dst>%s/%hu srcPort>%hu",
+                                        flow_id,addr.GetHostString(),addr.GetPort(), dstPort);
+                        else
+                            Mgen::Log(logFile, "SHUTDOWN src>%s/%hu dstPort>%hu",
+                                        addr.GetHostString(),addr.GetPort(), dstPort);
+                        break;
+
+                  case OFF_EVENT:
+                        Mgen::LogTimestamp(logFile, eventTime, localTime);
+                        if (flow_id)
+                            Mgen::Log(logFile, "OFF flow>%lu srcPort>%hu dst>%s/%hu",
+                                        flow_id,dstPort, addr.GetHostString(),addr.GetPort());
+                        else
+                            Mgen::Log(logFile, "OFF src>%s/%hu dstPort>%hu",
+                                        addr.GetHostString(),addr.GetPort(),dstPort);
+                        break;
+                  default:
+                        DMSG(0,"Mgen::ConvertBinaryLog Invalid event type.\n");
               }
-            default:
-              DMSG(0, "Mgen::ConvertBinaryLog() invalid event type\n");
-              fclose(file);
-              return false;
-        }  // end switch(eventType)
-    }  // end while(1)
-    fclose(file);
+              if (hostAddr.IsValid()) 		
+                    Mgen::Log(logFile,"host>%s/%hu", hostAddr.GetHostString(),hostAddr.GetPort());	   	  
+              Mgen::Log(logFile,"\n");
+              break;
+          }
+        default:
+          DMSG(0, "Mgen::ConvertBinaryLog() invalid event type\n");
+          return false;
+    }  // end switch(eventType)
     return true;
-}  // end MgenMsg::ConvertBinaryLog()
+}  // end MgenMsg::ConvertBinaryRecord()
+
+void MgenMsg::UnpackBinaryRecord(const MgenBinaryLogReader&     reader, 
+                                 const MgenBinaryLog::Record&   record)
+{
+    protocol = (Protocol)record.protocol;
+    flags = record.flags;
+    gps_status = (GPSStatus)record.gps_status;
+    tx_time = record.tx_time;
+    flow_id = record.flow_id;
+    seq_num = record.seq_num;
+    msg_len = (UINT16)record.size;
+    mgen_msg_len = record.size;
+    reader.GetEndpoint(record.src_id, src_addr);
+    reader.GetEndpoint(record.dst_id, dst_addr);
+    reader.GetEndpoint(record.host_id, host_addr);
+    latitude = ((double)record.latitude)/60000.0 - 180.0;
+    longitude = ((double)record.longitude)/60000.0 - 180.0;
+    altitude = record.altitude;
+    log_sample = record.sample;
+}  // end MgenMsg::UnpackBinaryRecord()
 
+bool MgenMsg::ConvertBinaryRecord(const MgenBinaryLogReader&    reader, 
+                                  MgenBinaryLog::Record&        record,
+                                  Mgen&                         mgen)
+{
+    FILE* logFile = mgen.GetLogFile();
+    bool localTime = mgen.GetLocalTime();
+    bool log_flush = mgen.GetLogFlush();
+    bool log_rx = mgen.GetLogRx();
+    bool log_data = mgen.GetLogData();
+    bool log_gps_data = mgen.GetLogGpsData();
+    MgenBinaryLog* binaryLog = MgenBinaryLog::GetActive(logFile);
+    bool logBinary = (NULL != binaryLog);
+
+    LogEventType eventType = (LogEventType)record.type;
+    switch (eventType)
+    {
+        case RECV_EVENT:
+        case SEND_EVENT:
+        case RERR_EVENT:
+        case ON_EVENT:
+        case ACCEPT_EVENT:
+        case CONNECT_EVENT:
+        case DISCONNECT_EVENT:
+        case OFF_EVENT:
+        case SHUTDOWN_EVENT:
+        case RECONNECT_EVENT:
+        {
+            MgenMsg msg;
+            msg.UnpackBinaryRecord(reader, record);
+            if (RECV_EVENT == eventType)
+            {
+                UINT32 payloadBuffer[MAX_SIZE/4];
+                MgenBinaryLog::EntryKind kind;
+                unsigned int len = reader.GetData(record.aux, (char*)payloadBuffer, 
+                                                  sizeof(payloadBuffer), &kind);
+                if (len > sizeof(payloadBuffer)) len = sizeof(payloadBuffer);
+                if (0 != len)
+                    msg.SetPayload((MgenBinaryLog::MGEN_PAYLOAD == kind) ? MGEN_DATA : USER_DATA,
+                                   payloadBuffer, (UINT16)len);
+                int ttl = (0 != (record.info & MgenBinaryLog::INFO_TTL)) ? record.ttl : -1;
+                return msg.LogRecvEvent(logFile, logBinary, localTime, log_rx, log_data, log_gps_data,
+                                        NULL, log_flush, ttl, record.event_time);
+            }
+            else if (SEND_EVENT == eventType)
+            {
+                return msg.LogSendEvent(logFile, logBinary, localTime, NULL, log_flush, record.event_time);
+            }
+            else if (RERR_EVENT == eventType)
+            {
+                msg.msg_error = (Error)record.aux;
+                return msg.LogRecvError(logFile, logBinary, localTime, log_flush, record.event_time);
+            }
+            else
+            {
+                bool isClient = (0 != (record.info & MgenBinaryLog::INFO_CLIENT));
+                return msg.LogTcpConnectionEvent(logFile, logBinary, localTime, log_flush,
+                                                 eventType, isClient, record.event_time);
+            }
+        }
+        case LISTEN_EVENT:
+        case IGNORE_EVENT:
+        case JOIN_EVENT:
+        case LEAVE_EVENT:
+        case START_EVENT:
+        case STOP_EVENT:
+        {
+            ProtoAddress groupAddr, sourceAddr;
+            reader.GetEndpoint(record.dst_id, groupAddr);
+            reader.GetEndpoint(record.src_id, sourceAddr);
+            char ifaceName[256];
+            unsigned int ifaceNameLen = 0;
+            if ((JOIN_EVENT == eventType) || (LEAVE_EVENT == eventType))
+            {
+                ifaceNameLen = reader.GetData(record.aux, ifaceName, sizeof(ifaceName) - 1);
+                if (ifaceNameLen >= sizeof(ifaceName)) ifaceNameLen = sizeof(ifaceName) - 1;
+            }
+            ifaceName[ifaceNameLen] = '\0';
+            if (logBinary)
+            {
+                // Entries are re-added to this log's dictionary
+                record.src_id = binaryLog->AddEndpoint(sourceAddr);
+                record.dst_id = binaryLog->AddEndpoint(groupAddr);
+                if ((JOIN_EVENT == eventType) || (LEAVE_EVENT == eventType))
+                    record.aux = binaryLog->AddData(MgenBinaryLog::STRING, ifaceName, ifaceNameLen);
+                return binaryLog->WriteEvent(record);
+            }
+            MgenLogEncoder::Encoding encoding = MgenLogEncoder::GetActive(logFile);
+            if (MgenLogEncoder::TEXT != encoding)
+            {
+                LogEncodedEvent(logFile, encoding, eventType, record.event_time,
+                                (Protocol)record.protocol, 
+                                ((LISTEN_EVENT == eventType) || (IGNORE_EVENT == eventType)) ?
+                                    (UINT16)record.aux : groupAddr.GetPort(),
+                                groupAddr, sourceAddr, ifaceName);
+                if (log_flush) fflush(logFile);
+                return true;
+            }
+            Mgen::LogTimestamp(logFile, record.event_time, localTime);
+            switch (eventType)
+            {
+                case LISTEN_EVENT:
+                case IGNORE_EVENT:
+                    Mgen::Log(logFile, "%s proto>%s port>%hu\n",
+                              (LISTEN_EVENT == eventType) ? "LISTEN" : "IGNORE",
+                              MgenBaseEvent::GetStringFromProtocol((Protocol)record.protocol),
+                              (UINT16)record.aux);
+                    break;
+                case JOIN_EVENT:
+                case LEAVE_EVENT:
+                    Mgen::Log(logFile, "%s group>%s", (JOIN_EVENT == eventType) ? "JOIN" : "LEAVE",
+                              groupAddr.GetHostString());
+                    if (sourceAddr.IsValid())
+                        Mgen::Log(logFile, " source>%s", sourceAddr.GetHostString());
+                    if (0 != ifaceNameLen) Mgen::Log(logFile, " interface>%s", ifaceName);
+                    if (0 != groupAddr.GetPort())
+                        Mgen::Log(logFile, " port>%hu\n", groupAddr.GetPort());
+                    else
+                        Mgen::Log(logFile, "\n");
+                    break;
+                default:
+                    Mgen::Log(logFile, "%s\n", (START_EVENT == eventType) ? "START" : "STOP");
+                    break;
+            }
+            if (log_flush) fflush(logFile);
+            return true;
+        }
+        default:
+            DMSG(0, "Mgen::ConvertBinaryLogV3() invalid event type:%d\n", (int)eventType);
+            return false;
+    }  // end switch(eventType)
+}  // end MgenMsg::ConvertBinaryRecord()
@@ -11,12 +11,18 @@
 
 MgenPattern::MgenPattern()
     : interval_remainder(0.0),burst_pattern(NULL),unlimitedRate(false),
-    flowPaused(false)
+    flowPaused(false),replay_file(NULL),replay_binary(false),replay_flow(0),
+    replay_event(INVALID_EVENT),replay_repeat(0),replay_prev_time(0.0),
+    replay_first_gap(-1.0),replay_size_min(MIN_SIZE),replay_size_max(MAX_SIZE),
+    feedback_time(-1.0),ramp_rate_good(0.0),ramp_rate_bad(-1.0),
+    ramp_passed(false),ramp_done(false),adapt_type(INVALID_ADAPT),
+    bucket_rate(0.0),bucket_depth(0.0),bucket_tokens(0.0)
 #ifdef HAVE_PCAP
   ,pcap_device(NULL),
   file_type(INVALID_FILETYPE),repeat_count(-1)
 #endif //HAVE_PCAP
 {
+    replay_fname[0] = '\0';
 #ifdef HAVE_PCAP
   clone_fname[0] = '\0';
 #endif//HAVE_PCAP
@@ -37,6 +43,10 @@ const StringMapper MgenPattern::TYPE_LIST[] =
     {"POISSON", POISSON},
     {"BURST", BURST},
     {"JITTER", JITTER},
+    {"REPLAY", REPLAY},
+    {"RAMP", RAMP},
+    {"ADAPTIVE", ADAPTIVE},
+    {"BUCKET", BUCKET},
 #ifdef HAVE_PCAP
     {"CLONE", CLONE},
 #endif //HAVE_PCAP
@@ -157,6 +167,46 @@ MgenPattern::Duration MgenPattern::GetDurationTypeFromString(const char* string)
     }
 }  // end MgenPattern::GetDurationTypeFromString()
 
+const StringMapper MgenPattern::ADAPT_LIST[] = 
+{
+    {"AIMD",    AIMD},
+    {"LATENCY", LATENCY},
+    {"XXXX",    INVALID_ADAPT} 
+};
+
+MgenPattern::Adapt MgenPattern::GetAdaptTypeFromString(const char* string)
+{
+    // Make comparison case-insensitive
+    char upperString[16];
+    size_t len = strlen(string);
+    len = len < 15 ? len : 15;
+    unsigned int i;
+    for (i =0 ; i < len; i++)
+        upperString[i] = toupper(string[i]);
+    upperString[i] = '\0';
+    unsigned int matchCount = 0;
+    Adapt adaptType = INVALID_ADAPT;
+    const StringMapper* m = ADAPT_LIST;
+    while (INVALID_ADAPT != (*m).key)
+    {
+        if (!strncmp(upperString, (*m).string, len))
+        {
+            adaptType = ((Adapt)((*m).key));
+            matchCount++;
+        }
+        m++; 
+    }
+    if (matchCount > 1)
+    {
+        DMSG(0, "MgenPattern::GetAdaptTypeFromString() Error: ambiguous adaptation type\n");
+        return INVALID_ADAPT;
+    }
+    else
+    {
+        return adaptType;
+    }
+}  // end MgenPattern::GetAdaptTypeFromString()
+
 #ifdef HAVE_PCAP
 const StringMapper MgenPattern::CLONE_FILE_LIST[] =
   {
@@ -198,6 +248,49 @@ MgenPattern::FileType MgenPattern::GetFileTypeFromString(const char* string)
 } // end MgenPattern::GetFileTypeFromString()
 #endif //HAVE_PCAP
 
+// Parses "<size>" or "<sizeMin>:<sizeMax>" and validates against protocol limits
+bool MgenPattern::InitSizeFromString(const char* sizeText, Protocol protocol)
+{
+    if (NULL != strchr(sizeText, ':'))
+    {
+        if (2 != sscanf(sizeText, "%u:%u", &pkt_size_min, &pkt_size_max))
+        {
+            DMSG(0, "MgenPattern::InitSizeFromString() error: invalid variable <size> parameter.\n");
+            return false;
+        }
+        else if (pkt_size_min > pkt_size_max)
+        {
+            unsigned int temp = pkt_size_min;
+            pkt_size_min = pkt_size_max;
+            pkt_size_max = temp;
+        }
+    }
+    else if (1 != sscanf(sizeText, "%u", &pkt_size_min))
+    {
+        DMSG(0, "MgenPattern::InitSizeFromString() error: invalid <size> parameter.\n");
+        return false; 
+    }        
+    else
+    {
+        pkt_size_max = pkt_size_min;
+    }   
+    if (UDP != protocol)
+    {
+        // unlimited message size for non-UDP protocols
+        if (pkt_size_min < MIN_FRAG_SIZE)
+        {
+            DMSG(0,"MgenPattern::InitSizeFromString() error: packet size must be greater than the minimum fragment size: %d.\n",MIN_FRAG_SIZE);
+            return false;
+        }
+    } 
+    else if ((pkt_size_max > MAX_SIZE) || (pkt_size_min < MIN_SIZE))
+    {
+        DMSG(0, "MgenPattern::InitSizeFromString() error: invalid message size.\n");
+        return false;
+    }
+    return true;
+}  // end MgenPattern::InitSizeFromString()
+
 bool MgenPattern::InitFromString(MgenPattern::Type theType, const char* string, Protocol protocol)
 {
     flowPaused = false;
@@ -499,6 +592,193 @@ bool MgenPattern::InitFromString(MgenPattern::Type theType, const char* string,
             last_time.tv_sec = last_time.tv_usec = 0;
             break;
         }
+        case RAMP:  // form "<minRate> <maxRate> <pktSize> <lossMax> <latencyMax> [<tolerance>]"
+        {
+            char sizeText[257];
+            ramp_tolerance = 0.05;
+            int result = sscanf(string, "%lf %lf %256s %lf %lf %lf", &feedback_rate_min, &feedback_rate_max,
+                                sizeText, &ramp_loss_max, &ramp_latency_max, &ramp_tolerance);
+            if (result < 5)
+            {
+                DMSG(0, "MgenPattern::InitFromString(RAMP) error: invalid parameters.\n");
+                return false; 
+            }
+            if ((feedback_rate_min <= 0.0) || (feedback_rate_max < feedback_rate_min))
+            {
+                DMSG(0, "MgenPattern::InitFromString(RAMP) error: invalid <minRate>/<maxRate> range.\n");
+                return false; 
+            }
+            if ((ramp_loss_max < 0.0) || (ramp_loss_max > 1.0) || (ramp_latency_max < 0.0))
+            {
+                DMSG(0, "MgenPattern::InitFromString(RAMP) error: invalid loss/latency threshold.\n");
+                return false; 
+            }
+            if ((ramp_tolerance <= 0.0) || (ramp_tolerance >= 1.0))
+            {
+                DMSG(0, "MgenPattern::InitFromString(RAMP) error: invalid <tolerance>.\n");
+                return false; 
+            }
+            if (!InitSizeFromString(sizeText, protocol))
+            {
+                DMSG(0, "MgenPattern::InitFromString(RAMP) error: invalid <size> parameter.\n");
+                return false; 
+            }
+            interval_ave = 1.0 / feedback_rate_min;
+            ramp_rate_good = 0.0;
+            ramp_rate_bad = -1.0;
+            feedback_time = -1.0;
+            ramp_passed = ramp_done = false;
+            break;
+        }
+        case ADAPTIVE:  // form "AIMD <minRate> <maxRate> <pktSize> <lossMax> <increase> <decrease>"
+                        //   or "LATENCY <minRate> <maxRate> <pktSize> <targetLatency> [<gain>]"
+        {
+            char adaptText[17];
+            char sizeText[257];
+            double param[3];
+            param[2] = -1.0;
+            int result = sscanf(string, "%16s %lf %lf %256s %lf %lf %lf", adaptText, 
+                                &feedback_rate_min, &feedback_rate_max, sizeText, 
+                                param, param+1, param+2);
+            if (result < 5)
+            {
+                DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid parameters.\n");
+                return false; 
+            }
+            adapt_type = GetAdaptTypeFromString(adaptText);
+            switch (adapt_type)
+            {
+                case AIMD:
+                    if (result < 7)
+                    {
+                        DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: missing AIMD parameters.\n");
+                        return false;
+                    }
+                    adapt_loss_max = param[0];
+                    adapt_increase = param[1];
+                    adapt_decrease = param[2];
+                    if ((adapt_loss_max < 0.0) || (adapt_loss_max > 1.0) || (adapt_increase <= 0.0) ||
+                        (adapt_decrease <= 0.0) || (adapt_decrease >= 1.0))
+                    {
+                        DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid AIMD parameters.\n");
+                        return false;
+                    }
+                    break;
+                case LATENCY:
+                    adapt_latency = param[0];
+                    adapt_gain = (result > 5) ? param[1] : 0.5;
+                    if ((adapt_latency <= 0.0) || (adapt_gain <= 0.0) || (adapt_gain > 1.0))
+                    {
+                        DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid LATENCY parameters.\n");
+                        return false;
+                    }
+                    break;
+                case INVALID_ADAPT:
+                    DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid adaptation type.\n");
+                    return false;
+            }
+            if ((feedback_rate_min <= 0.0) || (feedback_rate_max < feedback_rate_min))
+            {
+                DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid <minRate>/<maxRate> range.\n");
+                return false; 
+            }
+            if (!InitSizeFromString(sizeText, protocol))
+            {
+                DMSG(0, "MgenPattern::InitFromString(ADAPTIVE) error: invalid <size> parameter.\n");
+                return false; 
+            }
+            interval_ave = 1.0 / feedback_rate_min;
+            feedback_time = -1.0;
+            break;
+        }
+        case BUCKET:  // form "<bitRate> <pktSize> [<depth>]"
+        {
+            double bitRate;
+            char sizeText[257];
+            bucket_depth = 0.0;
+            if (2 > sscanf(string, "%lf %256s %lf", &bitRate, sizeText, &bucket_depth))
+            {
+                DMSG(0, "MgenPattern::InitFromString(BUCKET) error: invalid parameters.\n");
+                return false; 
+            }
+            if (bitRate < 0.0)
+            {
+                DMSG(0, "MgenPattern::InitFromString(BUCKET) error: invalid bit rate.\n");
+                return false;
+            }
+            if (!InitSizeFromString(sizeText, protocol))
+            {
+                DMSG(0, "MgenPattern::InitFromString(BUCKET) error: invalid <size> parameter.\n");
+                return false; 
+            }
+            // The bucket holds at least one maximum size message
+            if (bucket_depth < (double)pkt_size_max) bucket_depth = (double)pkt_size_max;
+            bucket_rate = bitRate / 8.0;
+            bucket_tokens = 0.0;
+            last_time.tv_sec = last_time.tv_usec = 0;
+            if (0.0 == bucket_rate)
+            {
+                interval_ave = -1.0;
+                flowPaused = true;
+            }
+            else
+            {
+                interval_ave = 0.5 * (double)(pkt_size_min + pkt_size_max) / bucket_rate;
+            }
+            break;
+        }
+        case REPLAY:  // form "<logFile> <flowId> [<repeatCount>]"
+        {
+            char fieldBuffer[Mgen::SCRIPT_LINE_MAX+1];
+            const char* ptr = string;
+            // Strip leading white space
+            while ((' ' == *ptr) || ('\t' == *ptr)) ptr++;
+            if (1 != sscanf(ptr, "%s", fieldBuffer))
+            {
+                DMSG(0, "MgenPattern::InitFromString(REPLAY) error: missing log file name.\n");
+                return false;
+            }
+            if (strlen(fieldBuffer) >= REPLAY_NAME_MAX)
+            {
+                DMSG(0, "MgenPattern::InitFromString(REPLAY) error: log file name too long.\n");
+                return false;
+            }
+            strcpy(replay_fname, fieldBuffer);
+            ptr += strlen(fieldBuffer);
+            while ((' ' == *ptr) || ('\t' == *ptr)) ptr++;
+            if (1 != sscanf(ptr, "%lu", &replay_flow))
+            {
+                DMSG(0, "MgenPattern::InitFromString(REPLAY) error: invalid <flowId> parameter.\n");
+                return false;
+            }
+            // Optional "[<repeatCount>]", the log is replayed once by default
+            replay_repeat = 0;
+            ptr = strchr(ptr, '[');
+            if ((NULL != ptr) && (1 != sscanf(ptr+1, "%d", &replay_repeat)))
+            {
+                DMSG(0, "MgenPattern::InitFromString(REPLAY) error: invalid repeat count.\n");
+                return false;
+            }
+            if (UDP != protocol)
+            {
+                replay_size_min = MIN_FRAG_SIZE;
+                replay_size_max = 0xffffffff;
+            }
+            else
+            {
+                replay_size_min = MIN_SIZE;
+                replay_size_max = MAX_SIZE;
+            }
+            pkt_size_min = pkt_size_max = replay_size_min;
+            replay_event = INVALID_EVENT;
+            replay_first_gap = -1.0;
+            if (NULL != replay_file)
+            {
+                fclose(replay_file);
+                replay_file = NULL;
+            }
+            break;
+        }
 #ifdef HAVE_PCAP
         case CLONE:
 	  {
@@ -621,11 +901,278 @@ double MgenPattern::RestartPcapRead(double& prevTime)
 } // end MgenPattern::RestartPcapRead()
 #endif // HAVE_PCAP
 
+bool MgenPattern::OpenReplayFile()
+{
+    if (NULL == replay_file)
+    {
+        if (NULL == (replay_file = fopen(replay_fname, "rb")))
+        {
+            DMSG(0, "MgenPattern::OpenReplayFile() fopen(%s) error: %s\n", 
+                    replay_fname, GetErrorString());
+            return false;
+        }
+    }
+    else
+    {
+        rewind(replay_file);
+    }
+    // Binary logs begin with a NULL terminated "mgen version=<n> type=binary_log" 
+    // header line, anything else is treated as a text log
+    char lineBuffer[256];
+    replay_binary = false;
+    if ((NULL != fgets(lineBuffer, 256, replay_file)) &&
+        (0 == strncmp(lineBuffer, "mgen", 4)) &&
+        (NULL != strstr(lineBuffer, "type=binary_log")))
+    {
+        if ('\0' != fgetc(replay_file))
+        {
+            DMSG(0, "MgenPattern::OpenReplayFile() error: invalid binary log header\n");
+            fclose(replay_file);
+            replay_file = NULL;
+            return false;
+        }
+        replay_binary = true;
+    }
+    else
+    {
+        rewind(replay_file);
+    }
+    return true;
+}  // end MgenPattern::OpenReplayFile()
+
+// Parses either legacy "hh:mm:ss.usec" or epoch "sec.usec" log timestamps
+bool MgenPattern::ParseLogTime(const char* text, double& theTime)
+{
+    unsigned int hours, minutes;
+    double seconds;
+    if (3 == sscanf(text, "%u:%u:%lf", &hours, &minutes, &seconds))
+    {
+        theTime = 3600.0*hours + 60.0*minutes + seconds;
+        return true;
+    }
+    return (1 == sscanf(text, "%lf", &theTime));
+}  // end MgenPattern::ParseLogTime()
+
+bool MgenPattern::ReadReplayRecord(double& txTime, unsigned int& msgSize)
+{
+    if (replay_binary)
+        return ReadReplayBinaryRecord(txTime, msgSize);
+    else
+        return ReadReplayTextRecord(txTime, msgSize);
+}  // end MgenPattern::ReadReplayRecord()
+
+// Finds the next SEND (or RECV) line for our flow.  For RECV lines the
+// "sent>" time is used so receiver logs reproduce the original send schedule.
+bool MgenPattern::ReadReplayTextRecord(double& txTime, unsigned int& msgSize)
+{
+    char lineBuffer[1024];
+    while (NULL != fgets(lineBuffer, 1024, replay_file))
+    {
+        // Discard remainder of overlong lines (the fields we need come 
+        // before any "data>" or "gps>" content)
+        if (NULL == strchr(lineBuffer, '\n'))
+        {
+            int c;
+            while ((EOF != (c = fgetc(replay_file))) && ('\n' != c));
+        }
+        char timeText[32], eventText[8];
+        if (2 != sscanf(lineBuffer, "%31s %7s", timeText, eventText)) continue;
+        LogEventType eventType;
+        if (0 == strcmp(eventText, "SEND"))
+            eventType = SEND_EVENT;
+        else if (0 == strcmp(eventText, "RECV"))
+            eventType = RECV_EVENT;
+        else
+            continue;
+        if ((INVALID_EVENT != replay_event) && (eventType != replay_event)) continue;
+        unsigned long flowId;
+        const char* ptr = strstr(lineBuffer, " flow>");
+        if ((NULL == ptr) || (1 != sscanf(ptr, " flow>%lu", &flowId))) continue;
+        if (flowId != replay_flow) continue;
+        if (RECV_EVENT == eventType)
+        {
+            ptr = strstr(lineBuffer, " sent>");
+            if ((NULL == ptr) || (1 != sscanf(ptr, " sent>%31s", timeText))) continue;
+        }
+        if (!ParseLogTime(timeText, txTime)) continue;
+        ptr = strstr(lineBuffer, " size>");
+        if ((NULL == ptr) || (1 != sscanf(ptr, " size>%u", &msgSize))) continue;
+        replay_event = eventType;
+        return true;
+    }
+    return false;
+}  // end MgenPattern::ReadReplayTextRecord()
+
+// Only the leading portion of each binary record (through the message
+// "txTime" field) is read, the remainder is skipped
+bool MgenPattern::ReadReplayBinaryRecord(double& txTime, unsigned int& msgSize)
+{
+    // RECV record prefix: eventTime(8) srcPort(2) addrType(1) addrLen(1) addr(<=16)
+    // message prefix: msgLen(2) version(1) flags(1) flowId(4) seqNum(4) txTime(8)
+    const unsigned int RECORD_PREFIX_MAX = 48;
+    char buffer[RECORD_PREFIX_MAX];
+    char header[4];
+    while (4 == fread(header, 1, 4, replay_file))
+    {
+        LogEventType eventType = (LogEventType)header[0];
+        Protocol theProtocol = (Protocol)header[1];
+        UINT16 recordLength;
+        memcpy(&recordLength, header+2, sizeof(INT16));
+        recordLength = ntohs(recordLength);
+        unsigned int readLength = 0;
+        if (((SEND_EVENT == eventType) || (RECV_EVENT == eventType)) &&
+            ((INVALID_EVENT == replay_event) || (eventType == replay_event)))
+        {
+            readLength = (recordLength < RECORD_PREFIX_MAX) ? recordLength : RECORD_PREFIX_MAX;
+            if (fread(buffer, 1, readLength, replay_file) < readLength) break;
+        }
+        if ((readLength < recordLength) && 
+            (0 != fseek(replay_file, recordLength - readLength, SEEK_CUR)))
+        {
+            DMSG(0, "MgenPattern::ReadReplayBinaryRecord() fseek() error: %s\n", GetErrorString());
+            break;
+        }
+        if (0 == readLength) continue;
+        unsigned int index = 0;
+        UINT32 temp32;
+        UINT32 mgenMsgLen = 0;
+        if (RECV_EVENT == eventType)
+        {
+            // skip "eventTime", "srcPort", and "srcAddrType" to "srcAddrLen"
+            index = 11;
+            if (index >= readLength) continue;
+            index += 1 + (UINT8)buffer[index];
+        }
+        else if (TCP == theProtocol)
+        {
+            // TCP SEND records are prefixed with the full mgen message length
+            if (readLength < sizeof(INT32)) continue;
+            memcpy(&temp32, buffer, sizeof(INT32));
+            mgenMsgLen = ntohl(temp32);
+            index = sizeof(INT32);
+        }
+        if ((index + 20) > readLength) continue;
+        memcpy(&temp32, buffer+index+4, sizeof(INT32));
+        if (ntohl(temp32) != replay_flow) continue;
+        memcpy(&temp32, buffer+index+12, sizeof(INT32));
+        txTime = (double)ntohl(temp32);
+        memcpy(&temp32, buffer+index+16, sizeof(INT32));
+        txTime += 1.0e-06 * (double)ntohl(temp32);
+        if (0 != mgenMsgLen)
+        {
+            msgSize = mgenMsgLen;
+        }
+        else
+        {
+            UINT16 temp16;
+            memcpy(&temp16, buffer+index, sizeof(INT16));
+            msgSize = ntohs(temp16);
+        }
+        replay_event = eventType;
+        return true;
+    }
+    return false;
+}  // end MgenPattern::ReadReplayBinaryRecord()
+
+void MgenPattern::SetReplaySize(unsigned int msgSize)
+{
+    if (msgSize < replay_size_min) 
+        msgSize = replay_size_min;
+    else if (msgSize > replay_size_max)
+        msgSize = replay_size_max;
+    pkt_size_min = pkt_size_max = msgSize;
+}  // end MgenPattern::SetReplaySize()
+
+// The RAMP search starts at <minRate> and doubles the rate until the
+// loss/latency thresholds are exceeded (or <maxRate> is reached), then
+// bisects between the highest passing and lowest failing rates.  Each rate
+// is evaluated with the first report covering a full analytic window at
+// that rate.
+//
+// ADAPTIVE patterns instead adjust their rate continuously, either with
+// additive-increase/multiplicative-decrease on reported loss (AIMD) or
+// proportionally to the error from a target average latency (LATENCY).
+bool MgenPattern::OnFeedback(double theTime, double lossFraction, double latencyAve, double windowSize)
+{
+    if (((RAMP != type) || ramp_done) && (ADAPTIVE != type)) return false;
+    if (feedback_time < 0.0)
+    {
+        // First feedback received, measure from here
+        feedback_time = theTime;
+        return false;
+    }
+    if ((theTime - feedback_time) < windowSize) return false;
+    feedback_time = theTime;
+    if (ADAPTIVE == type)
+    {
+        double rate = GetRate();
+        if (AIMD == adapt_type)
+        {
+            if (lossFraction > adapt_loss_max)
+                rate *= adapt_decrease;
+            else
+                rate += adapt_increase;
+        }
+        else  // LATENCY
+        {
+            double scale = 1.0 + adapt_gain * (adapt_latency - latencyAve) / adapt_latency;
+            // Limit rate change per feedback window
+            if (scale < 0.5) 
+                scale = 0.5;
+            else if (scale > 2.0)
+                scale = 2.0;
+            rate *= scale;
+        }
+        if (rate < feedback_rate_min) 
+            rate = feedback_rate_min;
+        else if (rate > feedback_rate_max)
+            rate = feedback_rate_max;
+        interval_ave = 1.0 / rate;
+        return true;
+    }
+    ramp_passed = (lossFraction <= ramp_loss_max) &&
+                  ((0.0 == ramp_latency_max) || (latencyAve <= ramp_latency_max));
+    double rate = GetRate();
+    if (ramp_passed)
+    {
+        ramp_rate_good = rate;
+        if (ramp_rate_bad < 0.0)
+        {
+            if (rate >= feedback_rate_max)
+                ramp_done = true;
+            else
+                rate = (2.0*rate < feedback_rate_max) ? 2.0*rate : feedback_rate_max;
+        }
+        else
+        {
+            rate = 0.5 * (ramp_rate_good + ramp_rate_bad);
+        }
+    }
+    else
+    {
+        ramp_rate_bad = rate;
+        if (ramp_rate_good > 0.0)
+            rate = 0.5 * (ramp_rate_good + ramp_rate_bad);
+        else if (rate <= feedback_rate_min)
+            ramp_done = true;  // even <minRate> exceeds thresholds
+        else 
+            rate = (0.5*rate > feedback_rate_min) ? 0.5*rate : feedback_rate_min;
+    }
+    if ((ramp_rate_bad > 0.0) && ((ramp_rate_bad - ramp_rate_good) <= (ramp_tolerance * ramp_rate_bad)))
+        ramp_done = true;
+    if (ramp_done)
+        rate = (ramp_rate_good > 0.0) ? ramp_rate_good : feedback_rate_min;
+    interval_ave = 1.0 / rate;
+    return true;
+}  // end MgenPattern::OnFeedback()
+
 double MgenPattern::GetPktInterval()
 { 
   switch (type)
   {
     case PERIODIC: 
+    case RAMP:
+    case ADAPTIVE:
          return interval_ave; 
     case POISSON: 
          return (interval_ave > 0.0) ? ExponentialRand(interval_ave) : interval_ave; 
@@ -699,6 +1246,69 @@ double MgenPattern::GetPktInterval()
         interval_remainder = burst_duration;
         return pktInterval;
     }
+    case BUCKET:
+    {
+        // Messages are sent while the bucket has tokens. Each message debits its
+        // size (see GetPktSize()) so the interval is the time to pay off any debt.
+        if (bucket_rate <= 0.0) return -1.0;
+        struct timeval currentTime;
+        ProtoSystemTime(currentTime);
+        if ((0 != last_time.tv_sec) || (0 != last_time.tv_usec))
+        {
+            double deltaTime = (double)(currentTime.tv_sec - last_time.tv_sec);
+            if (currentTime.tv_usec > last_time.tv_usec)
+                deltaTime += 1.0e-06*(double)(currentTime.tv_usec - last_time.tv_usec);
+            else
+                deltaTime -= 1.0e-06*(double)(last_time.tv_usec - currentTime.tv_usec);
+            if (deltaTime > 0.0) bucket_tokens += deltaTime * bucket_rate;
+            if (bucket_tokens > bucket_depth) bucket_tokens = bucket_depth;
+        }
+        last_time = currentTime;
+        return (bucket_tokens < 0.0) ? (-bucket_tokens / bucket_rate) : 0.0;
+    }
+    case REPLAY:
+    {
+        double txTime;
+        unsigned int msgSize;
+        if (NULL == replay_file)  // initial file read
+        {
+            if (!OpenReplayFile()) return -1.0;
+            if (!ReadReplayRecord(txTime, msgSize))
+            {
+                DMSG(0, "MgenPattern::GetPktInterval() error: no SEND/RECV records for flow %lu in replay log %s\n",
+                        replay_flow, replay_fname);
+                return -1.0;
+            }
+            replay_prev_time = txTime;
+            SetReplaySize(msgSize);
+            // flow starting, first message is sent immediately
+            // regardless of interval returned...
+            return 1.0;
+        }
+        if (ReadReplayRecord(txTime, msgSize))
+        {
+            double interval = txTime - replay_prev_time;
+            if (interval < -43200.0) interval += 86400.0;  // legacy timestamp wrapped at midnight
+            if (interval < 0.0) interval = 0.0;  // out of order (e.g. RECV) records are sent immediately
+            replay_prev_time = txTime;
+            if (replay_first_gap < 0.0) replay_first_gap = interval;
+            SetReplaySize(msgSize);
+            return interval;
+        }
+        // End of log, rewind if repeating.  The first record of the next pass
+        // is scheduled using the log's first inter-message gap.
+        if ((0 != replay_repeat) && (replay_first_gap >= 0.0))
+        {
+            if (replay_repeat > 0) replay_repeat--;
+            if (OpenReplayFile() && ReadReplayRecord(txTime, msgSize))
+            {
+                replay_prev_time = txTime;
+                SetReplaySize(msgSize);
+                return replay_first_gap;
+            }
+        }
+        return -1.0;
+    }
 #ifdef HAVE_PCAP
     case CLONE:
       {
@@ -779,12 +1389,23 @@ unsigned int MgenPattern::GetPktSize()
         case PERIODIC:
         case POISSON:
         case JITTER:
+        case RAMP:
+        case ADAPTIVE:
             if (pkt_size_min != pkt_size_max)
                 return UniformRandUnsigned(pkt_size_min, pkt_size_max); 
             else
                 return pkt_size_min;
             break;
         
+        case BUCKET:
+        {
+            unsigned int pktSize = pkt_size_min;
+            if (pkt_size_min != pkt_size_max)
+                pktSize = UniformRandUnsigned(pkt_size_min, pkt_size_max); 
+            bucket_tokens -= (double)pktSize;
+            return pktSize;
+        }
+        case REPLAY:
 #ifdef HAVE_PCAP
         case CLONE:
 #endif //HAVE_PCAP
@@ -0,0 +1,1506 @@
+// mgenstat: single pass statistics from MGEN log files
+//
+// Reads one or more MGEN logs (text, binary or v3 binary, plain or gzip
+// compressed) and reports per-flow and aggregate rate, loss, duplicates,
+// reordering, latency (average, min, max, percentiles) and jitter, for
+// the whole run and, optionally, for each "window" seconds.  Memory use
+// depends on the number of flows, not the length of the logs.
+
+// Notes on options:
+//
+// 1) Several "input" logs (e.g. the sender's log and the receivers' logs)
+//    are read together in event time order.  A RECV whose (flow, seq) is
+//    among the last "join" SEND events logged for its flow and destination
+//    is given the one-way delay from the SEND log time instead of its
+//    "sent" time.  Either way, delays are only as good as the agreement of
+//    the hosts' clocks, and the logs must use the same timestamp format.
+//
+// 2) RECV flows are told apart by flow id, source address/port and
+//    destination address/port, SEND flows by flow id and destination
+//    address/port.
+//
+// 3) Lines of sampled logs ("sample>K") count as K messages in the message
+//    and byte counts.  Latency and jitter are computed over logged lines.
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif // HAVE_ZLIB
+#include "mgenMsg.h"
+#include "mgenEvent.h"
+#include "mgenAnalytic.h"
+#include "mgenBinaryLog.h"
+#include "mgenTimestamp.h"
+
+
+enum CmdType {CMD_INVALID, CMD_ARG, CMD_NOARG};
+
+const char* const CMD_LIST[] =
+{
+    "+input",       // Name of an MGEN log file (may be repeated)
+    "+output",      // Name of output file (default stdout)
+    "+window",      // Reports each flow every <sec> seconds as well
+    "+percentiles", // Latency percentiles to report (default 50,90,99)
+    "+history",     // Duplicate/reorder detection depth (messages)
+    "+join",        // SEND history depth for one-way delay (0 = off)
+    "-epoch",       // Output epoch timestamps
+    NULL
+};
+
+void Usage()
+{
+    fprintf(stderr, "mgenstat input <logFile> [input <logFile> ...][output <outFile>]\n"
+                    "         [window <sec>][percentiles <p>[,<p>...]][history <depth>]\n"
+                    "         [join <depth>][epoch]\n");
+}
+
+/**
+ * @class StatHistogram
+ *
+ * @brief Log-linear histogram of latency (in microseconds) with 16
+ * sub-bins per power of 2, so percentiles are within about 3% of the
+ * true value.  Bins are allocated when the first value is added.
+ */
+class StatHistogram
+{
+  public:
+    StatHistogram() : bins(NULL), total(0) {}
+    ~StatHistogram()
+    {
+        if (NULL != bins) delete[] bins;
+    }
+
+    bool Add(double value);  // sec, negative values count as 0
+    void Reset()
+    {
+        if (NULL != bins) memset(bins, 0, BIN_COUNT*sizeof(UINT32));
+        total = 0;
+    }
+    unsigned long GetTotal() const
+        {return total;}
+    double GetPercentile(double percent) const;  // sec
+
+  private:
+    enum {SUB_BITS = 4, SUB_COUNT = 1 << SUB_BITS, MSB_MAX = 37};
+    enum {BIN_COUNT = (MSB_MAX - SUB_BITS + 2) * SUB_COUNT};
+
+    UINT32*         bins;
+    unsigned long   total;
+};  // end class StatHistogram
+
+bool StatHistogram::Add(double value)
+{
+    if (NULL == bins)
+    {
+        if (NULL == (bins = new UINT32[BIN_COUNT]))
+        {
+            fprintf(stderr, "mgenstat: new histogram error: %s\n", GetErrorString());
+            return false;
+        }
+        memset(bins, 0, BIN_COUNT*sizeof(UINT32));
+    }
+    uint64_t usec = (value > 0.0) ? (uint64_t)(value * 1.0e+06) : 0;
+    uint64_t usecMax = ((uint64_t)2 << MSB_MAX) - 1;
+    if (usec > usecMax) usec = usecMax;
+    unsigned int index;
+    if (usec < SUB_COUNT)
+    {
+        index = (unsigned int)usec;
+    }
+    else
+    {
+        unsigned int msb = SUB_BITS;
+        while (0 != (usec >> (msb + 1))) msb++;
+        unsigned int shift = msb - SUB_BITS;
+        index = (shift + 1) * SUB_COUNT + (unsigned int)((usec >> shift) & (SUB_COUNT - 1));
+    }
+    bins[index]++;
+    total++;
+    return true;
+}  // end StatHistogram::Add()
+
+double StatHistogram::GetPercentile(double percent) const
+{
+    if (0 == total) return 0.0;
+    double rank = ceil(percent * (double)total / 100.0);
+    if (rank < 1.0) rank = 1.0;
+    unsigned long count = 0;
+    unsigned int index = 0;
+    for (; index < (BIN_COUNT - 1); index++)
+    {
+        count += bins[index];
+        if ((double)count >= rank) break;
+    }
+    // Return the middle of the bin
+    if (index < SUB_COUNT) return ((double)index * 1.0e-06);
+    unsigned int shift = index / SUB_COUNT - 1;
+    double low = (double)((uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift);
+    double width = (double)((uint64_t)1 << shift);
+    return ((low + (width - 1.0) / 2.0) * 1.0e-06);
+}  // end StatHistogram::GetPercentile()
+
+// Counts for a flow (or all flows) over a window or the whole run
+struct StatCounts
+{
+    void Reset()
+    {
+        count = bytes = unique = 0;
+        dups = reordered = late = 0;
+        joined = negative = 0;
+        latency_count = 0;
+        latency_sum = latency_min = latency_max = 0.0;
+        histogram.Reset();
+    }
+    void AddLatency(double latency);
+
+    unsigned long long  count;        // messages ("sample>" weighted)
+    unsigned long long  bytes;
+    unsigned long long  unique;       // RECV first arrivals ("sample>" weighted)
+    unsigned long       dups;
+    unsigned long       reordered;
+    unsigned long       late;         // too old to tell
+    unsigned long       joined;       // latency from the SEND log
+    unsigned long       negative;     // latency < 0 (clock offset)
+    unsigned long       latency_count;
+    double              latency_sum;
+    double              latency_min;
+    double              latency_max;
+    StatHistogram       histogram;
+};  // end struct StatCounts
+
+void StatCounts::AddLatency(double latency)
+{
+    if (0 == latency_count)
+    {
+        latency_min = latency_max = latency;
+    }
+    else
+    {
+        if (latency < latency_min) latency_min = latency;
+        if (latency > latency_max) latency_max = latency;
+    }
+    latency_count++;
+    latency_sum += latency;
+    if (latency < 0.0) negative++;
+    histogram.Add(latency);
+}  // end StatCounts::AddLatency()
+
+/**
+ * @class StatInput
+ *
+ * @brief Reads the SEND and RECV events of an MGEN log one at a time into
+ * an MgenMsg.  Text and original format binary logs are streamed (through
+ * zlib when available, which also reads uncompressed files); v3 binary
+ * logs are read with MgenBinaryLogReader.
+ */
+class StatInput
+{
+  public:
+    StatInput();
+    ~StatInput();
+
+    bool Open(const char* thePath);
+    void Close();
+    // Reads the next SEND or RECV event, "false" at end of log
+    bool Next();
+
+    const char* GetPath() const
+        {return path;}
+    bool IsTimeOfDay() const   // "hh:mm:ss" text log timestamps
+        {return time_of_day;}
+    LogEventType GetEventType() const
+        {return event_type;}
+    MgenMsg& GetMsg()
+        {return msg;}
+    double GetTime() const
+        {return event_time;}
+    double GetSentTime() const  // RECV only
+        {return sent_time;}
+    UINT32 GetSize() const
+        {return size;}
+    unsigned long GetEventCount() const
+        {return event_count;}
+    unsigned long GetErrorCount() const
+        {return error_count;}
+
+  private:
+    enum Format {TEXT_LOG, BINARY_LOG, BINARY_LOG_V3};
+    enum {LINE_SIZE = 8192, ADDR_TEXT_MAX = 64};
+    // Last address parsed from text, to skip most address lookups
+    struct AddrCache
+    {
+        char            text[ADDR_TEXT_MAX];
+        ProtoAddress    addr;
+    };
+
+    int Read(char* buffer, unsigned int len);
+    bool ReadLine();
+    bool NextText();
+    bool NextBinary();
+    bool NextBinaryV3();
+    bool ParseLine(char* text);
+    bool ParseTime(const char* text, double& value, bool& timeOfDay);
+    bool ParseAddr(char* text, AddrCache& cache, ProtoAddress& addr);
+
+    const char*         path;
+    Format              format;
+#ifdef HAVE_ZLIB
+    gzFile              file;
+#else
+    FILE*               file;
+#endif // if/else HAVE_ZLIB
+    MgenBinaryLogReader reader;
+    uint64_t            slot;
+    char                line[LINE_SIZE];
+    bool                line_pending;   // first line read by Open()
+    AddrCache           src_cache;
+    AddrCache           dst_cache;
+    bool                time_of_day;
+    double              day_offset;     // for "hh:mm:ss" logs past midnight
+    double              last_time;
+    // Current event
+    LogEventType        event_type;
+    MgenMsg             msg;
+    double              event_time;
+    double              sent_time;
+    UINT32              size;
+    unsigned long       event_count;
+    unsigned long       error_count;
+};  // end class StatInput
+
+StatInput::StatInput()
+ : path(NULL), format(TEXT_LOG), file(NULL), slot(0), line_pending(false),
+   time_of_day(false), day_offset(0.0), last_time(0.0), event_type(INVALID_EVENT),
+   event_time(0.0), sent_time(0.0), size(0), event_count(0), error_count(0)
+{
+    src_cache.text[0] = '\0';
+    dst_cache.text[0] = '\0';
+}
+
+StatInput::~StatInput()
+{
+    Close();
+}
+
+bool StatInput::Open(const char* thePath)
+{
+    Close();
+    path = thePath;
+    if (MgenBinaryLogReader::IsBinaryLogV3(path))
+    {
+        if (!reader.Open(path))
+        {
+            fprintf(stderr, "mgenstat: error opening binary log \"%s\"\n", path);
+            return false;
+        }
+        format = BINARY_LOG_V3;
+        slot = 1;
+        return true;
+    }
+#ifdef HAVE_ZLIB
+    file = gzopen(path, "rb");
+#else
+    file = fopen(path, "rb");
+#endif // if/else HAVE_ZLIB
+    if (NULL == file)
+    {
+        fprintf(stderr, "mgenstat: error opening \"%s\": %s\n", path, GetErrorString());
+        return false;
+    }
+#ifdef HAVE_ZLIB
+    gzbuffer(file, 262144);
+#endif // HAVE_ZLIB
+    // A binary log starts with a NULL terminated header line, as
+    // does a rotated text log part (without the NULL)
+    format = TEXT_LOG;
+    if (!ReadLine())
+    {
+        line_pending = false;
+        return true;  // empty log
+    }
+    line_pending = true;
+    if (0 == strncmp(line, "mgen ", 5))
+    {
+        if (NULL != strstr(line, "type=binary_log"))
+        {
+            char nullByte;
+            if ((1 != Read(&nullByte, 1)) || ('\0' != nullByte))
+            {
+                fprintf(stderr, "mgenstat: \"%s\" invalid binary log header\n", path);
+                Close();
+                return false;
+            }
+            format = BINARY_LOG;
+        }
+        line_pending = false;
+    }
+    return true;
+}  // end StatInput::Open()
+
+void StatInput::Close()
+{
+    if (NULL != file)
+    {
+#ifdef HAVE_ZLIB
+        gzclose(file);
+#else
+        fclose(file);
+#endif // if/else HAVE_ZLIB
+        file = NULL;
+    }
+    if (BINARY_LOG_V3 == format) reader.Close();
+    format = TEXT_LOG;
+    line_pending = false;
+}  // end StatInput::Close()
+
+int StatInput::Read(char* buffer, unsigned int len)
+{
+#ifdef HAVE_ZLIB
+    return gzread(file, buffer, len);
+#else
+    return (int)fread(buffer, 1, len, file);
+#endif // if/else HAVE_ZLIB
+}  // end StatInput::Read()
+
+// Lines longer than LINE_SIZE are truncated (SEND/RECV fields all come
+// before any "data>" payload, but for a trailing "sample>")
+bool StatInput::ReadLine()
+{
+#ifdef HAVE_ZLIB
+    if (NULL == gzgets(file, line, LINE_SIZE)) return false;
+#else
+    if (NULL == fgets(line, LINE_SIZE, file)) return false;
+#endif // if/else HAVE_ZLIB
+    size_t len = strlen(line);
+    if ((len > 0) && ('\n' == line[len - 1])) return true;
+    if (len < (LINE_SIZE - 1)) return true;  // last line without newline
+    char discard[LINE_SIZE];
+    do
+    {
+#ifdef HAVE_ZLIB
+        if (NULL == gzgets(file, discard, LINE_SIZE)) break;
+#else
+        if (NULL == fgets(discard, LINE_SIZE, file)) break;
+#endif // if/else HAVE_ZLIB
+        len = strlen(discard);
+    } while ((len > 0) && ('\n' != discard[len - 1]));
+    return true;
+}  // end StatInput::ReadLine()
+
+bool StatInput::Next()
+{
+    bool result;
+    switch (format)
+    {
+        case BINARY_LOG:
+            result = NextBinary();
+            break;
+        case BINARY_LOG_V3:
+            result = NextBinaryV3();
+            break;
+        default:
+            result = NextText();
+            break;
+    }
+    if (result) event_count++;
+    return result;
+}  // end StatInput::Next()
+
+bool StatInput::NextText()
+{
+    if (NULL == file) return false;
+    while (line_pending || ReadLine())
+    {
+        line_pending = false;
+        if (ParseLine(line)) return true;
+    }
+    return false;
+}  // end StatInput::NextText()
+
+bool StatInput::NextBinary()
+{
+    UINT32 alignedBuffer[MgenMsg::BINARY_RECORD_MAX/4 + 1];
+    unsigned char header[4];
+    while (4 == Read((char*)header, 4))
+    {
+        UINT16 recordLength;
+        memcpy(&recordLength, header + 2, sizeof(UINT16));
+        recordLength = ntohs(recordLength);
+        if (recordLength > MgenMsg::BINARY_RECORD_MAX)
+        {
+            fprintf(stderr, "mgenstat: \"%s\" record len:%hu exceeds maximum length\n",
+                    path, recordLength);
+            error_count++;
+            return false;
+        }
+        if (recordLength != Read((char*)alignedBuffer, recordLength))
+        {
+            fprintf(stderr, "mgenstat: \"%s\" truncated record\n", path);
+            error_count++;
+            return false;
+        }
+        LogEventType eventType = (LogEventType)header[0];
+        if ((SEND_EVENT != eventType) && (RECV_EVENT != eventType)) continue;
+        struct timeval eventTime;
+        if (!msg.UnpackBinaryRecord(eventType, (Protocol)header[1], alignedBuffer,
+                                    recordLength, false, eventTime))
+        {
+            error_count++;
+            continue;
+        }
+        event_type = eventType;
+        event_time = (double)eventTime.tv_sec + 1.0e-06*(double)eventTime.tv_usec;
+        const struct timeval& txTime = msg.GetTxTime();
+        sent_time = (double)txTime.tv_sec + 1.0e-06*(double)txTime.tv_usec;
+        size = ((SEND_EVENT == eventType) && (TCP == msg.GetProtocol())) ?
+                    msg.GetMgenMsgLen() : msg.GetMsgLen();
+        return true;
+    }
+    return false;
+}  // end StatInput::NextBinary()
+
+bool StatInput::NextBinaryV3()
+{
+    uint64_t recordEnd = reader.GetRecordEnd();
+    while (slot < recordEnd)
+    {
+        UINT8 slotType = reader.GetSlotType(slot);
+        if ((SEND_EVENT != slotType) && (RECV_EVENT != slotType))
+        {
+            slot++;
+            continue;
+        }
+        MgenBinaryLog::Record record;
+        MgenBinaryLog::UnpackRecord(reader.GetSlot(slot++), record);
+        msg.UnpackBinaryRecord(reader, record);
+        event_type = (LogEventType)slotType;
+        event_time = (double)record.event_time.tv_sec + 1.0e-06*(double)record.event_time.tv_usec;
+        sent_time = (double)record.tx_time.tv_sec + 1.0e-06*(double)record.tx_time.tv_usec;
+        size = record.size;
+        return true;
+    }
+    return false;
+}  // end StatInput::NextBinaryV3()
+
+bool StatInput::ParseTime(const char* text, double& value, bool& timeOfDay)
+{
+    char* end;
+    unsigned long first = strtoul(text, &end, 10);
+    if (end == text) return false;
+    if (':' == *end)
+    {
+        // "hh:mm:ss.uuuuuu"
+        const char* ptr = end + 1;
+        unsigned long minutes = strtoul(ptr, &end, 10);
+        if ((end == ptr) || (':' != *end)) return false;
+        ptr = end + 1;
+        double seconds = strtod(ptr, &end);
+        if (end == ptr) return false;
+        value = 3600.0*(double)first + 60.0*(double)minutes + seconds;
+        timeOfDay = true;
+    }
+    else
+    {
+        // "sec.usec"
+        value = strtod(text, &end);
+        timeOfDay = false;
+    }
+    return true;
+}  // end StatInput::ParseTime()
+
+// Parses "<addr>/<port>" (modifies "text")
+bool StatInput::ParseAddr(char* text, AddrCache& cache, ProtoAddress& addr)
+{
+    char* slash = strrchr(text, '/');
+    if (NULL == slash) return false;
+    *slash = '\0';
+    if (0 != strcmp(text, cache.text))
+    {
+        if (!cache.addr.ResolveFromString(text))
+        {
+            cache.text[0] = '\0';
+            return false;
+        }
+        strncpy(cache.text, text, ADDR_TEXT_MAX - 1);
+        cache.text[ADDR_TEXT_MAX - 1] = '\0';
+    }
+    addr = cache.addr;
+    addr.SetPort((UINT16)atoi(slash + 1));
+    return true;
+}  // end StatInput::ParseAddr()
+
+// Parses a "SEND" or "RECV" log line, other lines are skipped
+bool StatInput::ParseLine(char* text)
+{
+    char* ptr = text;
+    while (isspace(*ptr)) ptr++;
+    if (('\0' == *ptr) || ('#' == *ptr)) return false;
+    char* eventName = strchr(ptr, ' ');
+    if (NULL == eventName) return false;
+    *eventName++ = '\0';
+    LogEventType eventType;
+    if (0 == strncmp(eventName, "RECV ", 5))
+        eventType = RECV_EVENT;
+    else if (0 == strncmp(eventName, "SEND ", 5))
+        eventType = SEND_EVENT;
+    else
+        return false;
+    double theTime;
+    bool timeOfDay;
+    if (!ParseTime(ptr, theTime, timeOfDay))
+    {
+        error_count++;
+        return false;
+    }
+    time_of_day = timeOfDay;
+    if (timeOfDay)
+    {
+        // Move to the next day when the time of day goes back by more
+        // than 12 hours
+        if ((theTime + day_offset) < (last_time - 43200.0))
+            day_offset += 86400.0;
+        theTime += day_offset;
+    }
+    last_time = theTime;
+    double sentTime = theTime;
+    bool hasFlow = false;
+    msg.SetProtocol(UDP);
+    msg.SetLogSample(0);
+    size = 0;
+    ptr = eventName + 5;
+    while ('\0' != *ptr)
+    {
+        while (' ' == *ptr) ptr++;
+        char* field = ptr;
+        while (('\0' != *ptr) && (' ' != *ptr) && ('\n' != *ptr) && ('\r' != *ptr)) ptr++;
+        if ('\0' != *ptr) *ptr++ = '\0';
+        char* value = strchr(field, '>');
+        if (NULL == value) continue;
+        *value++ = '\0';
+        bool result = true;
+        if (0 == strcmp(field, "proto"))
+        {
+            Protocol protocol = MgenEvent::GetProtocolFromString(value);
+            if (INVALID_PROTOCOL != protocol)
+                msg.SetProtocol(protocol);
+            else
+                result = false;
+        }
+        else if (0 == strcmp(field, "flow"))
+        {
+            msg.SetFlowId((UINT32)strtoul(value, NULL, 10));
+            hasFlow = true;
+        }
+        else if (0 == strcmp(field, "seq"))
+        {
+            msg.SetSeqNum((UINT32)strtoul(value, NULL, 10));
+        }
+        else if (0 == strcmp(field, "src"))
+        {
+            ProtoAddress addr;
+            if ((result = ParseAddr(value, src_cache, addr))) msg.SetSrcAddr(addr);
+        }
+        else if (0 == strcmp(field, "dst"))
+        {
+            ProtoAddress addr;
+            if ((result = ParseAddr(value, dst_cache, addr))) msg.SetDstAddr(addr);
+        }
+        else if (0 == strcmp(field, "sent"))
+        {
+            // The "sent" time is followed by a space, like the log time
+            bool sentTimeOfDay;
+            if ((result = ParseTime(value, sentTime, sentTimeOfDay)) && sentTimeOfDay)
+            {
+                sentTime += day_offset;
+                if ((sentTime - theTime) > 43200.0)
+                    sentTime -= 86400.0;
+                else if ((theTime - sentTime) > 43200.0)
+                    sentTime += 86400.0;
+            }
+        }
+        else if (0 == strcmp(field, "size"))
+        {
+            size = (UINT32)strtoul(value, NULL, 10);
+        }
+        else if (0 == strcmp(field, "sample"))
+        {
+            msg.SetLogSample((unsigned int)strtoul(value, NULL, 10));
+        }
+        else if (0 == strcmp(field, "data"))
+        {
+            break;  // payload is last (but for "flags" and "sample")
+        }
+        if (!result)
+        {
+            error_count++;
+            return false;
+        }
+    }
+    if (!hasFlow)
+    {
+        error_count++;
+        return false;
+    }
+    // "sample>" follows "data>"
+    if (0 == msg.GetLogSample())
+    {
+        char* sample = strstr(ptr, " sample>");
+        if (NULL != sample) msg.SetLogSample((unsigned int)strtoul(sample + 8, NULL, 10));
+    }
+    event_type = eventType;
+    event_time = theTime;
+    sent_time = sentTime;
+    return true;
+}  // end StatInput::ParseLine()
+
+/**
+ * @class StatFlow
+ *
+ * @brief Statistics of one SEND or RECV flow.  SEND flows keep a ring of
+ * recent (seq, time) pairs for RECV flows to look up one-way delays.
+ */
+class StatFlow
+{
+  public:
+    StatFlow();
+    ~StatFlow();
+
+    // Flows are keyed by these fields (zero padded so they can be hashed
+    // and compared as bytes).  The source is not set for SEND flows.
+    struct Key
+    {
+        UINT32  flow_id;
+        UINT16  src_port;
+        UINT16  dst_port;
+        UINT8   type;
+        UINT8   src_len;
+        UINT8   dst_len;
+        UINT8   reserved;
+        char    src_addr[16];
+        char    dst_addr[16];
+    };
+    static void MakeKey(Key& key, LogEventType eventType, UINT32 flowId,
+                        const ProtoAddress& srcAddr, const ProtoAddress& dstAddr);
+    static UINT32 Hash(const Key& key);
+
+    bool Init(const Key& theKey, LogEventType eventType, MgenMsg& theMsg,
+              UINT32 historyDepth, UINT32 joinDepth);
+
+    // Returns the SEND log time of (seq), or -1.0 if not known
+    double GetSendTime(UINT32 seq) const;
+    void AddSendTime(UINT32 seq, double theTime);
+    void UpdateSeq(UINT32 seq);
+    UINT32 GetExpected() const
+        {return (seq_valid ? (max_seq - min_seq + 1) : 0);}
+    // Returns messages expected in the window, and starts the next window
+    UINT32 GetWindowExpected();
+
+    struct JoinEntry
+    {
+        UINT32  seq;
+        bool    valid;
+        double  time;
+    };
+
+    Key                 key;
+    LogEventType        type;
+    Protocol            protocol;
+    ProtoAddress        src_addr;
+    ProtoAddress        dst_addr;
+    StatCounts          total;
+    StatCounts          window;
+    double              first_time;
+    double              last_time;
+    bool                seq_valid;
+    UINT32              min_seq;
+    UINT32              max_seq;
+    UINT32              window_seq;     // max_seq when the window started
+    bool                window_seq_valid;
+    MgenReorderTracker  tracker;        // RECV flows
+    double              jitter;         // RFC 3550 interarrival jitter (sec)
+    double              last_transit;
+    bool                transit_valid;
+    JoinEntry*          join_ring;      // SEND flows
+    UINT32              join_mask;
+    StatFlow*           send_flow;      // RECV flows, once found
+    StatFlow*           next;
+};  // end class StatFlow
+
+StatFlow::StatFlow()
+ : type(INVALID_EVENT), protocol(UDP), first_time(0.0), last_time(0.0),
+   seq_valid(false), min_seq(0), max_seq(0), window_seq(0), window_seq_valid(false),
+   jitter(0.0), last_transit(0.0), transit_valid(false),
+   join_ring(NULL), join_mask(0), send_flow(NULL), next(NULL)
+{
+    memset(&key, 0, sizeof(Key));
+    total.Reset();
+    window.Reset();
+}
+
+StatFlow::~StatFlow()
+{
+    if (NULL != join_ring) delete[] join_ring;
+}
+
+void StatFlow::MakeKey(Key& key, LogEventType eventType, UINT32 flowId,
+                       const ProtoAddress& srcAddr, const ProtoAddress& dstAddr)
+{
+    memset(&key, 0, sizeof(Key));
+    key.flow_id = flowId;
+    key.type = (UINT8)eventType;
+    if ((RECV_EVENT == eventType) && srcAddr.IsValid())
+    {
+        unsigned int len = srcAddr.GetLength();
+        if (len > 16) len = 16;
+        memcpy(key.src_addr, srcAddr.GetRawHostAddress(), len);
+        key.src_len = (UINT8)len;
+        key.src_port = srcAddr.GetPort();
+    }
+    if (dstAddr.IsValid())
+    {
+        unsigned int len = dstAddr.GetLength();
+        if (len > 16) len = 16;
+        memcpy(key.dst_addr, dstAddr.GetRawHostAddress(), len);
+        key.dst_len = (UINT8)len;
+        key.dst_port = dstAddr.GetPort();
+    }
+}  // end StatFlow::MakeKey()
+
+UINT32 StatFlow::Hash(const Key& key)
+{
+    UINT32 hash = 2166136261UL;
+    const UINT8* ptr = (const UINT8*)&key;
+    for (unsigned int i = 0; i < sizeof(Key); i++)
+        hash = (hash ^ ptr[i]) * 16777619UL;
+    return hash;
+}  // end StatFlow::Hash()
+
+bool StatFlow::Init(const Key& theKey, LogEventType eventType, MgenMsg& theMsg,
+                    UINT32 historyDepth, UINT32 joinDepth)
+{
+    key = theKey;
+    type = eventType;
+    protocol = theMsg.GetProtocol();
+    if (RECV_EVENT == eventType) src_addr = theMsg.GetSrcAddr();
+    dst_addr = theMsg.GetDstAddr();
+    if (RECV_EVENT == eventType)
+        return tracker.Init(historyDepth);
+    if (0 != joinDepth)
+    {
+        UINT32 ringSize = 1;
+        while (ringSize < joinDepth) ringSize <<= 1;
+        if (NULL == (join_ring = new JoinEntry[ringSize]))
+        {
+            fprintf(stderr, "mgenstat: new join ring error: %s\n", GetErrorString());
+            return false;
+        }
+        memset(join_ring, 0, ringSize*sizeof(JoinEntry));
+        join_mask = ringSize - 1;
+    }
+    return true;
+}  // end StatFlow::Init()
+
+double StatFlow::GetSendTime(UINT32 seq) const
+{
+    if (NULL == join_ring) return -1.0;
+    const JoinEntry& entry = join_ring[seq & join_mask];
+    return ((entry.valid && (entry.seq == seq)) ? entry.time : -1.0);
+}  // end StatFlow::GetSendTime()
+
+void StatFlow::AddSendTime(UINT32 seq, double theTime)
+{
+    if (NULL == join_ring) return;
+    JoinEntry& entry = join_ring[seq & join_mask];
+    entry.seq = seq;
+    entry.valid = true;
+    entry.time = theTime;
+}  // end StatFlow::AddSendTime()
+
+void StatFlow::UpdateSeq(UINT32 seq)
+{
+    if (!seq_valid)
+    {
+        min_seq = max_seq = seq;
+        seq_valid = true;
+    }
+    else if ((UINT32)(seq - max_seq) < 0x80000000)
+    {
+        max_seq = seq;
+    }
+    else if ((UINT32)(min_seq - seq) < 0x80000000)
+    {
+        min_seq = seq;
+    }
+}  // end StatFlow::UpdateSeq()
+
+UINT32 StatFlow::GetWindowExpected()
+{
+    if (!seq_valid) return 0;
+    UINT32 expected = window_seq_valid ? (max_seq - window_seq) : (max_seq - min_seq + 1);
+    window_seq = max_seq;
+    window_seq_valid = true;
+    return expected;
+}  // end StatFlow::GetWindowExpected()
+
+/**
+ * @class StatFlowTable
+ *
+ * @brief Open addressing hash table of flows, which are also kept in
+ * order of first appearance for output.
+ */
+class StatFlowTable
+{
+  public:
+    StatFlowTable();
+    ~StatFlowTable();
+
+    StatFlow* Find(const StatFlow::Key& key) const;
+    bool Insert(StatFlow* flow);
+    StatFlow* GetHead() const
+        {return head;}
+    unsigned int GetCount() const
+        {return flow_count;}
+
+  private:
+    enum {INIT_SIZE = 64};
+    bool Grow();
+
+    StatFlow**      table;
+    unsigned int    table_size;   // power of 2
+    unsigned int    flow_count;
+    StatFlow*       head;
+    StatFlow*       tail;
+};  // end class StatFlowTable
+
+StatFlowTable::StatFlowTable()
+ : table(NULL), table_size(0), flow_count(0), head(NULL), tail(NULL)
+{
+}
+
+StatFlowTable::~StatFlowTable()
+{
+    StatFlow* flow = head;
+    while (NULL != flow)
+    {
+        StatFlow* next = flow->next;
+        delete flow;
+        flow = next;
+    }
+    if (NULL != table) delete[] table;
+}
+
+StatFlow* StatFlowTable::Find(const StatFlow::Key& key) const
+{
+    if (0 == table_size) return NULL;
+    unsigned int index = StatFlow::Hash(key) & (table_size - 1);
+    while (NULL != table[index])
+    {
+        if (0 == memcmp(&key, &table[index]->key, sizeof(StatFlow::Key)))
+            return table[index];
+        index = (index + 1) & (table_size - 1);
+    }
+    return NULL;
+}  // end StatFlowTable::Find()
+
+bool StatFlowTable::Insert(StatFlow* flow)
+{
+    // Keep load factor under 3/4 so probe sequences stay short
+    if ((4*(flow_count + 1)) > (3*table_size))
+    {
+        if (!Grow()) return false;
+    }
+    unsigned int index = StatFlow::Hash(flow->key) & (table_size - 1);
+    while (NULL != table[index]) index = (index + 1) & (table_size - 1);
+    table[index] = flow;
+    flow_count++;
+    if (NULL != tail)
+        tail->next = flow;
+    else
+        head = flow;
+    tail = flow;
+    return true;
+}  // end StatFlowTable::Insert()
+
+bool StatFlowTable::Grow()
+{
+    unsigned int newSize = (0 != table_size) ? (2 * table_size) : INIT_SIZE;
+    StatFlow** newTable = new StatFlow*[newSize];
+    if (NULL == newTable)
+    {
+        fprintf(stderr, "mgenstat: new flow table error: %s\n", GetErrorString());
+        return false;
+    }
+    memset(newTable, 0, newSize*sizeof(StatFlow*));
+    for (StatFlow* flow = head; NULL != flow; flow = flow->next)
+    {
+        unsigned int index = StatFlow::Hash(flow->key) & (newSize - 1);
+        while (NULL != newTable[index]) index = (index + 1) & (newSize - 1);
+        newTable[index] = flow;
+    }
+    if (NULL != table) delete[] table;
+    table = newTable;
+    table_size = newSize;
+    return true;
+}  // end StatFlowTable::Grow()
+
+
+// Option values and state.  Global, as for the other command line tools.
+enum {INPUT_MAX = 64, PERCENTILE_MAX = 8};
+const char* input_list[INPUT_MAX];
+unsigned int input_count = 0;
+FILE* outfile = stdout;
+double window_size = 0.0;       // sec, 0 = whole run only
+double percentile_list[PERCENTILE_MAX] = {50.0, 90.0, 99.0};
+unsigned int percentile_count = 3;
+UINT32 history_depth = MgenAnalytic::DEFAULT_HISTORY;
+UINT32 join_depth = 4096;
+bool epoch_time = false;
+
+StatFlowTable flow_table;
+MgenTimestampFormatter time_formatter;
+StatCounts send_total;
+StatCounts recv_total;
+StatCounts send_window;
+StatCounts recv_window;
+bool window_started = false;
+double window_start = 0.0;
+double first_time = -1.0;
+double last_time = 0.0;
+
+
+CmdType GetCmdType(const char* cmd)
+{
+    if (!cmd) return CMD_INVALID;
+    unsigned int len = strlen(cmd);
+
+    bool matched = false;
+    CmdType type = CMD_INVALID;
+    const char* const* nextCmd = CMD_LIST;
+    while (*nextCmd)
+    {
+        char lowerCmd[32];  // all commands < 32 characters
+        len = len < 31 ? len : 31;
+        unsigned int i;
+
+        for (i = 0; i < (len + 1); i++)
+        {
+            lowerCmd[i] = tolower(cmd[i]);
+        }
+
+        if (!strncmp(lowerCmd, *nextCmd + 1, len))
+        {
+            if (matched)
+            {
+                // ambiguous command, should only match once
+                return CMD_INVALID;
+            }
+            else
+            {
+                matched = true;
+                if ('+' == *nextCmd[0])
+                    type = CMD_ARG;
+                else
+                    type = CMD_NOARG;
+            }
+        }
+        nextCmd++;
+    }
+    return type;
+}   // end GetCmdType
+
+// Parses "<p>[,<p>...]" with each 0 < p <= 100
+bool ParsePercentiles(const char* text)
+{
+    double valueList[PERCENTILE_MAX];
+    unsigned int count = 0;
+    const char* ptr = text;
+    while ('\0' != *ptr)
+    {
+        char* end;
+        double value = strtod(ptr, &end);
+        if ((end == ptr) || (value <= 0.0) || (value > 100.0) || (count >= PERCENTILE_MAX))
+            return false;
+        valueList[count++] = value;
+        if (',' == *end)
+            ptr = end + 1;
+        else if ('\0' == *end)
+            ptr = end;
+        else
+            return false;
+    }
+    if (0 == count) return false;
+    memcpy(percentile_list, valueList, count*sizeof(double));
+    percentile_count = count;
+    return true;
+}  // end ParsePercentiles()
+
+bool OnCommand(const char* cmd, const char* val)
+{
+    CmdType type = GetCmdType(cmd);
+    unsigned int len = strlen(cmd);
+    char lowerCmd[32];  // all commands < 32 characters
+    len = len < 31 ? len : 31;
+    unsigned int i;
+    for (i = 0; i < (len + 1); i++)
+        lowerCmd[i] = tolower(cmd[i]);
+
+    if (CMD_INVALID == type)
+    {
+        fprintf(stderr, "mgenstat ProcessCommands(%s) error: invalid command\n", cmd);
+        return false;
+    }
+    else if ((CMD_ARG == type) && (NULL == val))
+    {
+        fprintf(stderr, "mgenstat ProcessCommands(%s) missing argument\n", cmd);
+        return false;
+    }
+    else if (!strncmp("input", lowerCmd, len))
+    {
+        if (input_count >= INPUT_MAX)
+        {
+            fprintf(stderr, "mgenstat: too many input files (max %d)\n", INPUT_MAX);
+            return false;
+        }
+        input_list[input_count++] = val;
+    }
+    else if (!strncmp("output", lowerCmd, len))
+    {
+        if (stdout != outfile) fclose(outfile);
+        if (NULL == (outfile = fopen(val, "w")))
+        {
+            outfile = stdout;
+            fprintf(stderr, "mgenstat: error opening output file \"%s\": %s\n", val, GetErrorString());
+            return false;
+        }
+    }
+    else if (!strncmp("window", lowerCmd, len))
+    {
+        double value;
+        if ((1 != sscanf(val, "%lf", &value)) || (value < 0.0))
+        {
+            fprintf(stderr, "mgenstat: invalid window \"%s\"\n", val);
+            return false;
+        }
+        window_size = value;
+    }
+    else if (!strncmp("percentiles", lowerCmd, len))
+    {
+        if (!ParsePercentiles(val))
+        {
+            fprintf(stderr, "mgenstat: invalid percentiles \"%s\" (max %d)\n", val, PERCENTILE_MAX);
+            return false;
+        }
+    }
+    else if (!strncmp("history", lowerCmd, len))
+    {
+        unsigned int value;
+        if ((1 != sscanf(val, "%u", &value)) || (0 == value))
+        {
+            fprintf(stderr, "mgenstat: invalid history depth \"%s\"\n", val);
+            return false;
+        }
+        history_depth = value;
+    }
+    else if (!strncmp("join", lowerCmd, len))
+    {
+        unsigned int value;
+        if (1 != sscanf(val, "%u", &value))
+        {
+            fprintf(stderr, "mgenstat: invalid join depth \"%s\"\n", val);
+            return false;
+        }
+        join_depth = value;
+    }
+    else if (!strncmp("epoch", lowerCmd, len))
+    {
+        epoch_time = true;
+    }
+    return true;
+}  // end OnCommand()
+
+bool ProcessCommands(int argc, const char*const* argv)
+{
+    int i = 1;
+    while (i < argc)
+    {
+        CmdType cmdType = GetCmdType(argv[i]);
+        switch (cmdType)
+        {
+            case CMD_INVALID:
+                fprintf(stderr, "mgenstat error: invalid command: %s\n", argv[i]);
+                return false;
+            case CMD_NOARG:
+                if(!OnCommand(argv[i], NULL))
+                {
+                    fprintf(stderr, "mgenstat OnCommand(%s) error\n", argv[i]);
+                    return false;
+                }
+                i++;
+                break;
+            case CMD_ARG:
+                if(!OnCommand(argv[i], argv[i+1]))
+                {
+                    fprintf(stderr, "mgenstat OnCommand(%s, %s) error\n", argv[i], argv[i+1]);
+                    return false;
+                }
+                i += 2;
+                break;
+        }
+    }
+    return true;
+}  // end ProcessCommands()
+
+void PrintTime(double theTime)
+{
+    struct timeval tv;
+    tv.tv_sec = (long)floor(theTime);
+    tv.tv_usec = (long)((theTime - floor(theTime)) * 1.0e+06 + 0.5);
+    if (tv.tv_usec >= 1000000)
+    {
+        tv.tv_sec++;
+        tv.tv_usec -= 1000000;
+    }
+    char buffer[MgenTimestampFormatter::MAX_LENGTH];
+    unsigned int len = time_formatter.Format(buffer, tv, false, epoch_time);
+    fwrite(buffer, 1, len, outfile);
+}  // end PrintTime()
+
+void PrintFlowKey(const StatFlow& flow)
+{
+    fprintf(outfile, "proto>%s flow>%lu ", MgenEvent::GetStringFromProtocol(flow.protocol),
+            (unsigned long)flow.key.flow_id);
+    if (RECV_EVENT == flow.type)
+        fprintf(outfile, "src>%s/%hu ", flow.src_addr.GetHostString(), flow.src_addr.GetPort());
+    fprintf(outfile, "dst>%s/%hu ", flow.dst_addr.GetHostString(), flow.dst_addr.GetPort());
+}  // end PrintFlowKey()
+
+// Prints the fields common to flow, total and window lines and ends the line
+void PrintCounts(LogEventType eventType, const StatCounts& counts, double duration,
+                 unsigned long long expected, double jitter)
+{
+    double rate = (duration > 0.0) ? (8.0e-03 * (double)counts.bytes / duration) : 0.0;
+    fprintf(outfile, "%s>%llu bytes>%llu duration>%lf rate>%lf kbps",
+            (SEND_EVENT == eventType) ? "sent" : "recv", counts.count, counts.bytes, duration, rate);
+    if (RECV_EVENT == eventType)
+    {
+        unsigned long long lost = (expected > counts.unique) ? (expected - counts.unique) : 0;
+        fprintf(outfile, " lost>%llu dups>%lu reordered>%lu late>%lu",
+                lost, counts.dups, counts.reordered, counts.late);
+        if (0 != counts.latency_count)
+        {
+            fprintf(outfile, " latency ave>%lf min>%lf max>%lf",
+                    counts.latency_sum / (double)counts.latency_count,
+                    counts.latency_min, counts.latency_max);
+            for (unsigned int i = 0; i < percentile_count; i++)
+            {
+                // (clamped, as bins are wider than the observed range)
+                double value = counts.histogram.GetPercentile(percentile_list[i]);
+                if (value < counts.latency_min) value = counts.latency_min;
+                if (value > counts.latency_max) value = counts.latency_max;
+                fprintf(outfile, " p%g>%lf", percentile_list[i], value);
+            }
+            if (jitter >= 0.0) fprintf(outfile, " jitter>%lf", jitter);
+            if (0 != counts.joined) fprintf(outfile, " joined>%lu", counts.joined);
+            if (0 != counts.negative) fprintf(outfile, " negative>%lu", counts.negative);
+        }
+    }
+    fprintf(outfile, "\n");
+}  // end PrintCounts()
+
+// Prints and resets the window counts of each flow (and the aggregate),
+// for flows with events in the window
+void FlushWindow(double duration)
+{
+    unsigned int sendFlows = 0, recvFlows = 0;
+    unsigned long long recvExpected = 0;
+    for (StatFlow* flow = flow_table.GetHead(); NULL != flow; flow = flow->next)
+    {
+        if (0 == flow->window.count) continue;
+        UINT32 expected = flow->GetWindowExpected();
+        PrintTime(window_start);
+        fprintf(outfile, "WINDOW %s ", (SEND_EVENT == flow->type) ? "SEND" : "RECV");
+        PrintFlowKey(*flow);
+        PrintCounts(flow->type, flow->window, duration, expected, flow->jitter);
+        if (SEND_EVENT == flow->type)
+        {
+            sendFlows++;
+        }
+        else
+        {
+            recvFlows++;
+            recvExpected += expected;
+        }
+        flow->window.Reset();
+    }
+    if (0 != sendFlows)
+    {
+        PrintTime(window_start);
+        fprintf(outfile, "WINDOW SEND flows>%u ", sendFlows);
+        PrintCounts(SEND_EVENT, send_window, duration, 0, -1.0);
+    }
+    if (0 != recvFlows)
+    {
+        PrintTime(window_start);
+        fprintf(outfile, "WINDOW RECV flows>%u ", recvFlows);
+        PrintCounts(RECV_EVENT, recv_window, duration, recvExpected, -1.0);
+    }
+    send_window.Reset();
+    recv_window.Reset();
+}  // end FlushWindow()
+
+void PrintTotals()
+{
+    unsigned int sendFlows = 0, recvFlows = 0;
+    unsigned long long recvExpected = 0;
+    for (StatFlow* flow = flow_table.GetHead(); NULL != flow; flow = flow->next)
+    {
+        PrintTime(flow->first_time);
+        fprintf(outfile, "FLOW %s ", (SEND_EVENT == flow->type) ? "SEND" : "RECV");
+        PrintFlowKey(*flow);
+        fprintf(outfile, "seq>%lu-%lu ", (unsigned long)flow->min_seq, (unsigned long)flow->max_seq);
+        UINT32 expected = flow->GetExpected();
+        PrintCounts(flow->type, flow->total, flow->last_time - flow->first_time,
+                    expected, flow->jitter);
+        if (SEND_EVENT == flow->type)
+        {
+            sendFlows++;
+        }
+        else
+        {
+            recvFlows++;
+            recvExpected += expected;
+        }
+    }
+    double duration = last_time - first_time;
+    if (0 != sendFlows)
+    {
+        PrintTime(first_time);
+        fprintf(outfile, "TOTAL SEND flows>%u ", sendFlows);
+        PrintCounts(SEND_EVENT, send_total, duration, 0, -1.0);
+    }
+    if (0 != recvFlows)
+    {
+        PrintTime(first_time);
+        fprintf(outfile, "TOTAL RECV flows>%u ", recvFlows);
+        PrintCounts(RECV_EVENT, recv_total, duration, recvExpected, -1.0);
+    }
+}  // end PrintTotals()
+
+StatFlow* GetFlow(LogEventType eventType, MgenMsg& msg)
+{
+    StatFlow::Key key;
+    StatFlow::MakeKey(key, eventType, msg.GetFlowId(), msg.GetSrcAddr(), msg.GetDstAddr());
+    StatFlow* flow = flow_table.Find(key);
+    if (NULL != flow) return flow;
+    if (NULL == (flow = new StatFlow()))
+    {
+        fprintf(stderr, "mgenstat: new flow error: %s\n", GetErrorString());
+        return NULL;
+    }
+    if (!flow->Init(key, eventType, msg, history_depth, join_depth) ||
+        !flow_table.Insert(flow))
+    {
+        delete flow;
+        return NULL;
+    }
+    return flow;
+}  // end GetFlow()
+
+bool ProcessEvent(StatInput& input)
+{
+    double theTime = input.GetTime();
+    if (first_time < 0.0) first_time = theTime;
+    if (theTime > last_time) last_time = theTime;
+    if (window_size > 0.0)
+    {
+        if (!window_started)
+        {
+            window_start = floor(theTime / window_size) * window_size;
+            window_started = true;
+        }
+        else if (theTime >= (window_start + window_size))
+        {
+            FlushWindow(window_size);
+            window_start = floor(theTime / window_size) * window_size;
+        }
+    }
+    LogEventType eventType = input.GetEventType();
+    MgenMsg& msg = input.GetMsg();
+    StatFlow* flow = GetFlow(eventType, msg);
+    if (NULL == flow) return false;
+    if (0 == flow->total.count) flow->first_time = theTime;
+    flow->last_time = theTime;
+    UINT32 seq = msg.GetSeqNum();
+    flow->UpdateSeq(seq);
+    unsigned int weight = msg.GetLogSample();
+    if (0 == weight) weight = 1;
+    unsigned long long bytes = (unsigned long long)input.GetSize() * weight;
+    StatCounts* countList[3] = {&flow->total, &flow->window, NULL};
+    countList[2] = (SEND_EVENT == eventType) ?
+                        ((window_size > 0.0) ? &send_window : NULL) :
+                        ((window_size > 0.0) ? &recv_window : NULL);
+    StatCounts& aggregate = (SEND_EVENT == eventType) ? send_total : recv_total;
+    if (SEND_EVENT == eventType)
+    {
+        flow->AddSendTime(seq, theTime);
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            if (NULL == countList[i]) continue;
+            countList[i]->count += weight;
+            countList[i]->bytes += bytes;
+        }
+        aggregate.count += weight;
+        aggregate.bytes += bytes;
+        return true;
+    }
+    // Find the SEND flow this RECV flow matches, if any
+    if ((NULL == flow->send_flow) && (0 != join_depth))
+    {
+        StatFlow::Key key;
+        StatFlow::MakeKey(key, SEND_EVENT, msg.GetFlowId(), msg.GetSrcAddr(), msg.GetDstAddr());
+        flow->send_flow = flow_table.Find(key);
+    }
+    bool joined = false;
+    double latency = theTime - input.GetSentTime();
+    if (NULL != flow->send_flow)
+    {
+        double sendTime = flow->send_flow->GetSendTime(seq);
+        if (sendTime >= 0.0)
+        {
+            latency = theTime - sendTime;
+            joined = true;
+        }
+    }
+    MgenReorderTracker::Result result = flow->tracker.Update(seq);
+    // (a "late" arrival is too old to tell and counted as a first arrival)
+    bool duplicate = (MgenReorderTracker::SEQ_DUPLICATE == result);
+    if (!duplicate)
+    {
+        // RFC 3550 interarrival jitter
+        if (flow->transit_valid)
+        {
+            double delta = fabs(latency - flow->last_transit);
+            flow->jitter += (delta - flow->jitter) / 16.0;
+        }
+        flow->last_transit = latency;
+        flow->transit_valid = true;
+    }
+    StatCounts* recvList[4] = {countList[0], countList[1], countList[2], &aggregate};
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        StatCounts* counts = recvList[i];
+        if (NULL == counts) continue;
+        counts->count += weight;
+        counts->bytes += bytes;
+        if (duplicate)
+            counts->dups++;
+        else
+            counts->unique += weight;
+        if (MgenReorderTracker::SEQ_REORDERED == result) counts->reordered++;
+        if (MgenReorderTracker::SEQ_LATE == result) counts->late++;
+        if (!duplicate)
+        {
+            counts->AddLatency(latency);
+            if (joined) counts->joined++;
+        }
+    }
+    return true;
+}  // end ProcessEvent()
+
+
+int main(int argc, char* argv[])
+{
+    if (!ProcessCommands(argc, argv))
+    {
+        fprintf(stderr, "mgenstat: error while processing startup commands\n");
+        Usage();
+        return -1;
+    }
+    if (0 == input_count)
+    {
+        fprintf(stderr, "mgenstat: no input files given\n");
+        Usage();
+        return -1;
+    }
+    StatInput* inputList = new StatInput[input_count];
+    if (NULL == inputList)
+    {
+        fprintf(stderr, "mgenstat: new input list error: %s\n", GetErrorString());
+        return -1;
+    }
+    bool* pending = new bool[input_count];
+    if (NULL == pending)
+    {
+        fprintf(stderr, "mgenstat: new input list error: %s\n", GetErrorString());
+        delete[] inputList;
+        return -1;
+    }
+    for (unsigned int i = 0; i < input_count; i++)
+    {
+        if (!inputList[i].Open(input_list[i]))
+        {
+            delete[] pending;
+            delete[] inputList;
+            return -1;
+        }
+        pending[i] = inputList[i].Next();
+    }
+    // Check the inputs agree on the timestamp format (binary logs use
+    // epoch time)
+    int firstInput = -1;
+    for (unsigned int i = 0; i < input_count; i++)
+    {
+        if (!pending[i]) continue;
+        if (firstInput < 0)
+        {
+            firstInput = (int)i;
+        }
+        else if (inputList[firstInput].IsTimeOfDay() != inputList[i].IsTimeOfDay())
+        {
+            fprintf(stderr, "mgenstat: warning: inputs mix time of day and epoch timestamps "
+                            "(event order and one-way delays will be wrong)\n");
+            break;
+        }
+    }
+    // Merge the inputs in event time order (so SEND events are seen
+    // before the RECV events they're joined with)
+    bool result = true;
+    while (result)
+    {
+        int next = -1;
+        for (unsigned int i = 0; i < input_count; i++)
+        {
+            if (!pending[i]) continue;
+            if ((next < 0) || (inputList[i].GetTime() < inputList[next].GetTime()))
+                next = (int)i;
+        }
+        if (next < 0) break;
+        result = ProcessEvent(inputList[next]);
+        pending[next] = inputList[next].Next();
+    }
+    if (result)
+    {
+        if (window_started)
+        {
+            double duration = last_time - window_start;
+            FlushWindow((duration < window_size) ? duration : window_size);
+        }
+        PrintTotals();
+    }
+    for (unsigned int i = 0; i < input_count; i++)
+    {
+        fprintf(stderr, "mgenstat: \"%s\" %lu events", inputList[i].GetPath(),
+                inputList[i].GetEventCount());
+        if (0 != inputList[i].GetErrorCount())
+            fprintf(stderr, ", %lu unparsed", inputList[i].GetErrorCount());
+        fprintf(stderr, "\n");
+    }
+    delete[] pending;
+    delete[] inputList;
+    if (stdout != outfile) fclose(outfile);
+    return (result ? 0 : -1);
+}  // end main()
@@ -0,0 +1,121 @@
+#include "mgenTimestamp.h"
+
+#include <string.h>
+
+MgenTimestampFormatter::MgenTimestampFormatter()
+ : legacy_valid(false), legacy_local(false), legacy_sec(0),
+   epoch_valid(false), epoch_sec(0), epoch_len(0)
+{
+}
+
+// Writes "%06lu" of "usec" (six digits unless it is out of range)
+unsigned int MgenTimestampFormatter::FormatUsec(char* buffer, unsigned long usec)
+{
+    unsigned int count = 6;
+    if (usec >= 1000000)
+    {
+        for (unsigned long limit = usec / 1000000; 0 != limit; limit /= 10)
+            count++;
+    }
+    for (unsigned int i = count; i > 0; i--)
+    {
+        buffer[i - 1] = '0' + (char)(usec % 10);
+        usec /= 10;
+    }
+    return count;
+}  // end MgenTimestampFormatter::FormatUsec()
+
+void MgenTimestampFormatter::UpdateLegacy(time_t secs, bool localTime)
+{
+    int hour, min, sec;
+#ifdef _WIN32_WCE
+    // Same arithmetic as the legacy Mgen::LogLegacyTimestamp()
+    hour = (int)(secs / 3600);
+    unsigned int hourSecs = 3600 * hour;
+    min = (int)((secs - hourSecs) / 60);
+    sec = (int)(secs - hourSecs - (60*min));
+    hour = hour % 24;
+#else
+    if (!localTime && (secs >= 0))
+    {
+        // gmtime() has no leap seconds, so the time of day is plain arithmetic
+        unsigned long daySecs = (unsigned long)(secs % 86400);
+        hour = (int)(daySecs / 3600);
+        min = (int)((daySecs / 60) % 60);
+        sec = (int)(daySecs % 60);
+    }
+    else
+    {
+        struct tm timeStruct;
+#ifdef WIN32
+        struct tm* timePtr = localTime ? localtime(&secs) : gmtime(&secs);
+        if (NULL != timePtr)
+            timeStruct = *timePtr;
+        else
+            memset(&timeStruct, 0, sizeof(timeStruct));
+#else
+        if (localTime)
+            localtime_r(&secs, &timeStruct);
+        else
+            gmtime_r(&secs, &timeStruct);
+#endif // if/else WIN32
+        hour = timeStruct.tm_hour;
+        min = timeStruct.tm_min;
+        sec = timeStruct.tm_sec;
+    }
+#endif // if/else _WIN32_WCE
+    legacy_text[0] = '0' + hour / 10;
+    legacy_text[1] = '0' + hour % 10;
+    legacy_text[2] = ':';
+    legacy_text[3] = '0' + min / 10;
+    legacy_text[4] = '0' + min % 10;
+    legacy_text[5] = ':';
+    legacy_text[6] = '0' + sec / 10;
+    legacy_text[7] = '0' + sec % 10;
+    legacy_text[8] = '.';
+    legacy_sec = secs;
+    legacy_local = localTime;
+    legacy_valid = true;
+}  // end MgenTimestampFormatter::UpdateLegacy()
+
+unsigned int MgenTimestampFormatter::FormatLegacy(char* buffer, const struct timeval& theTime, bool localTime)
+{
+    time_t secs = theTime.tv_sec;
+    if (!legacy_valid || (secs != legacy_sec) || (localTime != legacy_local))
+        UpdateLegacy(secs, localTime);
+    memcpy(buffer, legacy_text, 9);
+    unsigned int len = 9;
+    len += FormatUsec(buffer + len, (unsigned long)(unsigned int)theTime.tv_usec);
+    buffer[len++] = ' ';
+    return len;
+}  // end MgenTimestampFormatter::FormatLegacy()
+
+void MgenTimestampFormatter::UpdateEpoch(time_t secs)
+{
+    char digits[24];
+    unsigned int count = 0;
+    unsigned long value = (unsigned long)secs;
+    do
+    {
+        digits[count++] = '0' + (char)(value % 10);
+        value /= 10;
+    } while (0 != value);
+    for (unsigned int i = 0; i < count; i++)
+        epoch_text[i] = digits[count - 1 - i];
+    epoch_text[count++] = '.';
+    epoch_len = count;
+    epoch_sec = secs;
+    epoch_valid = true;
+}  // end MgenTimestampFormatter::UpdateEpoch()
+
+unsigned int MgenTimestampFormatter::FormatEpoch(char* buffer, const struct timeval& theTime)
+{
+    time_t secs = theTime.tv_sec;
+    if (!epoch_valid || (secs != epoch_sec))
+        UpdateEpoch(secs);
+    memcpy(buffer, epoch_text, epoch_len);
+    unsigned int len = epoch_len;
+    len += FormatUsec(buffer + len, (unsigned long)theTime.tv_usec);
+    buffer[len++] = ' ';
+    return len;
+}  // end MgenTimestampFormatter::FormatEpoch()
@@ -0,0 +1,136 @@
+/*
+ * This program measures how fast MGEN log timestamps can be formatted.
+ * It compares the printf()-based formatting MGEN used for its log
+ * timestamps with MgenTimestampFormatter, checking that both produce
+ * identical text.  Each "record" is formatted with two timestamps (like
+ * a RECV event's receive and sent times).
+ */
+
+#include "mgenTimestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void usage()
+{
+  fprintf(stderr,"Usage() mgenTimestampBench [<count> [<interval usec>]]\n");
+}
+
+// Keeps the formatting loops from being optimized away
+static volatile unsigned long bench_sink = 0;
+
+static double Now()
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return (double)t.tv_sec + 1.0e-06 * (double)t.tv_usec;
+}
+
+// The printf() formats of Mgen::LogLegacyTimestamp() and Mgen::LogEpochTimestamp()
+static unsigned int PrintfTimestamp(char* buffer, const struct timeval& theTime,
+                                    bool localTime, bool epochTime)
+{
+    if (epochTime)
+        return sprintf(buffer, "%lu.%06lu ", (unsigned long)theTime.tv_sec,
+                       (unsigned long)theTime.tv_usec);
+    time_t secs = theTime.tv_sec;
+    struct tm* timePtr = localTime ? localtime(&secs) : gmtime(&secs);
+    return sprintf(buffer, "%02d:%02d:%02d.%06lu ",
+                   timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                   (unsigned long)(unsigned int)theTime.tv_usec);
+}
+
+static void Advance(struct timeval& t, unsigned long usec)
+{
+    t.tv_usec += usec;
+    while (t.tv_usec >= 1000000)
+    {
+        t.tv_usec -= 1000000;
+        t.tv_sec++;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long count = 5000000;
+    unsigned long interval = 10;  // usec between records (100,000 records/sec)
+    if (argc > 3)
+    {
+        usage();
+        exit(-1);
+    }
+    if ((argc > 1) && (1 != sscanf(argv[1], "%lu", &count)))
+    {
+        usage();
+        exit(-1);
+    }
+    if ((argc > 2) && (1 != sscanf(argv[2], "%lu", &interval)))
+    {
+        usage();
+        exit(-1);
+    }
+
+    struct timeval start;
+    gettimeofday(&start, NULL);
+
+    const char* modeName[3] = {"legacy utc", "legacy local", "epoch"};
+    bool mismatch = false;
+    for (int mode = 0; mode < 3; mode++)
+    {
+        bool localTime = (1 == mode);
+        bool epochTime = (2 == mode);
+        char buffer[2*MgenTimestampFormatter::MAX_LENGTH];
+        char check[2*MgenTimestampFormatter::MAX_LENGTH];
+
+        // Verify the output is byte-identical (first pass, not timed)
+        MgenTimestampFormatter formatter;
+        struct timeval t = start;
+        for (unsigned long i = 0; i < count; i++)
+        {
+            unsigned int len = formatter.Format(buffer, t, localTime, epochTime);
+            unsigned int checkLen = PrintfTimestamp(check, t, localTime, epochTime);
+            if ((len != checkLen) || (0 != memcmp(buffer, check, len)))
+            {
+                fprintf(stderr, "mgenTimestampBench: %s mismatch \"%.*s\" != \"%.*s\"\n",
+                        modeName[mode], (int)len, buffer, (int)checkLen, check);
+                mismatch = true;
+                break;
+            }
+            Advance(t, interval);
+        }
+
+        unsigned long total = 0;
+        t = start;
+        double startTime = Now();
+        for (unsigned long i = 0; i < count; i++)
+        {
+            unsigned int len = PrintfTimestamp(buffer, t, localTime, epochTime);
+            len += PrintfTimestamp(buffer + len, t, localTime, epochTime);
+            total += len + buffer[len - 2];
+            Advance(t, interval);
+        }
+        double printfTime = Now() - startTime;
+
+        MgenTimestampFormatter timer;
+        t = start;
+        startTime = Now();
+        for (unsigned long i = 0; i < count; i++)
+        {
+            unsigned int len = timer.Format(buffer, t, localTime, epochTime);
+            len += timer.Format(buffer + len, t, localTime, epochTime);
+            total += len + buffer[len - 2];
+            Advance(t, interval);
+        }
+        double cachedTime = Now() - startTime;
+
+        if (printfTime <= 0.0) printfTime = 1.0e-06;
+        if (cachedTime <= 0.0) cachedTime = 1.0e-06;
+        fprintf(stdout, "%-14s printf> %12.0f records/sec  cached> %12.0f records/sec  speedup> %5.1fx\n",
+                modeName[mode], (double)count / printfTime, (double)count / cachedTime,
+                printfTime / cachedTime);
+        bench_sink = total;
+    }
+    return (mismatch ? -1 : 0);
+}  // end main()
@@ -17,6 +17,120 @@
 #include <fcntl.h>
 #endif // UNIX
 
+#ifdef HAVE_RECVMMSG
+#include <sys/socket.h>  // for recvmmsg()
+#endif // HAVE_RECVMMSG
+
+#ifdef HAVE_SO_REUSEPORT
+#include <stdlib.h>      // for realloc()
+#include <poll.h>        // for poll()
+#include <sched.h>       // for cpu_set_t
+#include <netinet/in.h>  // for in_pktinfo, in6_pktinfo
+#include <net/if.h>      // for IFNAMSIZ
+#endif // HAVE_SO_REUSEPORT
+
+#ifdef HAVE_SO_TIMESTAMPING
+#include <linux/net_tstamp.h>  // for SOF_TIMESTAMPING_*
+#include <linux/errqueue.h>    // for struct scm_timestamping, sock_extended_err
+#endif // HAVE_SO_TIMESTAMPING
+
+#ifdef HAVE_UDP_GRO
+#include <netinet/udp.h>  // for UDP_GRO
+#ifndef UDP_GRO
+#define UDP_GRO 104       // older libc headers
+#endif // !UDP_GRO
+#endif // HAVE_UDP_GRO
+
+#if defined(SO_TIMESTAMPNS) || defined(HAVE_SO_TIMESTAMPING)
+// Rounds a kernel (nanosecond) timestamp to the microsecond resolution
+// used by MGEN logging and analytics
+static void TimespecToTimeval(const struct timespec& ts, struct timeval& tv)
+{
+    tv.tv_sec = ts.tv_sec;
+    tv.tv_usec = (ts.tv_nsec + 500) / 1000;
+    if (tv.tv_usec >= 1000000)
+    {
+        tv.tv_sec += 1;
+        tv.tv_usec -= 1000000;
+    }
+}  // end TimespecToTimeval()
+#endif // SO_TIMESTAMPNS || HAVE_SO_TIMESTAMPING
+
+#ifdef SO_TIMESTAMPNS
+// Control buffer sized for an SCM_TIMESTAMPNS and a UDP_GRO message
+union MgenRxControl
+{
+    struct cmsghdr  align;
+    char            buffer[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(int))];
+};
+
+// Extracts the kernel receive timestamp (if any) from a recvmsg() 
+// header
+static bool GetKernelRxTime(struct msghdr* msg, struct timeval& rxTime)
+{
+    if (0 != (msg->msg_flags & MSG_CTRUNC)) return false;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); NULL != cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if ((SOL_SOCKET == cmsg->cmsg_level) && (SCM_TIMESTAMPNS == cmsg->cmsg_type))
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(struct timespec));
+            if ((0 == ts.tv_sec) && (0 == ts.tv_nsec)) return false;
+            TimespecToTimeval(ts, rxTime);
+            return true;
+        }
+    }
+    return false;
+}  // end GetKernelRxTime()
+
+#ifdef HAVE_UDP_GRO
+// Returns the UDP_GRO segment size from a recvmsg() header, or 
+// zero if the kernel did not coalesce the received datagram(s)
+static unsigned int GetGroSegmentSize(struct msghdr* msg)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); NULL != cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if ((IPPROTO_UDP == cmsg->cmsg_level) && (UDP_GRO == cmsg->cmsg_type))
+        {
+            int segSize;
+            memcpy(&segSize, CMSG_DATA(cmsg), sizeof(int));
+            return (segSize > 0) ? (unsigned int)segSize : 0;
+        }
+    }
+    return 0;
+}  // end GetGroSegmentSize()
+#endif // HAVE_UDP_GRO
+#endif // SO_TIMESTAMPNS
+
+#ifdef HAVE_SO_REUSEPORT
+// "true" if the IP_PKTINFO (or IPV6_PKTINFO) of a received datagram shows
+// a broadcast or multicast destination.  For these the kernel sets the 
+// IPv4 "ipi_spec_dst" to the receiving interface's address instead of 
+// the (local, unicast) destination address.
+static bool IsGroupDelivery(struct msghdr* msg)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); NULL != cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if ((IPPROTO_IP == cmsg->cmsg_level) && (IP_PKTINFO == cmsg->cmsg_type))
+        {
+            struct in_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(struct in_pktinfo));
+            return (IN_MULTICAST(ntohl(info.ipi_addr.s_addr)) ||
+                    (info.ipi_addr.s_addr != info.ipi_spec_dst.s_addr));
+        }
+#ifdef HAVE_IPV6
+        if ((IPPROTO_IPV6 == cmsg->cmsg_level) && (IPV6_PKTINFO == cmsg->cmsg_type))
+        {
+            struct in6_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(struct in6_pktinfo));
+            return IN6_IS_ADDR_MULTICAST(&info.ipi6_addr);
+        }
+#endif // HAVE_IPV6
+    }
+    return false;
+}  // end IsGroupDelivery()
+#endif // HAVE_SO_REUSEPORT
+
 MgenTransportList::MgenTransportList()
   :  head(NULL), tail(NULL)
 {
@@ -327,12 +441,55 @@ void MgenTransport::RemoveFromPendingList()
 
 void MgenTransport::LogEvent(LogEventType eventType, MgenMsg* theMsg, const struct timeval& theTime, UINT32* buffer)
 {
-    if (!(mgen.GetLogFile()))
-      return;  
+    MgenFlightRecorder& recorder = mgen.GetFlightRecorder();
+    if (!(mgen.GetLogFile()) && !recorder.IsOpen())
+      return;
 
     if (!theMsg->GetDstAddr().IsValid())
         theMsg->SetDstAddr(dstAddress);
 
+    // The RECORDER ring keeps every SEND and RECV event (regardless of
+    // TXLOG/RXLOG, LOGFILTER and LOGSAMPLE)
+    if (recorder.IsOpen() && ((SEND_EVENT == eventType) || (RECV_EVENT == eventType)))
+    {
+        if (RECV_EVENT == eventType) theMsg->SetProtocol(protocol);
+        recorder.Record(eventType, *theMsg, theTime, mgen.GetLogGpsData());
+    }
+    if (!(mgen.GetLogFile()))
+      return;
+
+    // LOGFILTER and LOGSAMPLE are applied before any formatting work
+    unsigned int sample = 0;
+    MgenLogSampler& sampler = mgen.GetLogSampler();
+    if (sampler.IsActive() &&
+        (((SEND_EVENT == eventType) && mgen.GetLogTx()) ||
+         ((RECV_EVENT == eventType) && mgen.GetLogRx())) &&
+        !sampler.Check(eventType, *theMsg, theTime, sample))
+    {
+        if (RECV_EVENT == eventType)
+        {
+            // REPORT content is still logged (text logs only)
+            theMsg->SetProtocol(protocol);
+            if (!mgen.GetLogBinary() && (MgenMsg::MGEN_DATA == theMsg->GetPayloadType()) &&
+                (0 != theMsg->GetPayloadLength()))
+            {
+#ifdef HAVE_PTHREAD
+                MgenLogPipe* logPipe = mgen.GetLogPipe();
+                if (NULL != logPipe) logPipe->SetRecvContext(true);
+#endif // HAVE_PTHREAD
+                theMsg->LogRecvEvent(mgen.GetLogFile(), false, mgen.GetLocalTime(), false,
+                                     false, false, buffer, mgen.GetLogFlush(), -1, theTime);
+#ifdef HAVE_PTHREAD
+                if (NULL != logPipe) logPipe->SetRecvContext(false);
+#endif // HAVE_PTHREAD
+            }
+            if (mgen.GetController())
+                mgen.GetController()->OnMsgReceive(*theMsg);
+        }
+        return;
+    }
+    theMsg->SetLogSample(sample);
+
 
     switch (eventType)
     {
@@ -340,6 +497,11 @@ void MgenTransport::LogEvent(LogEventType eventType, MgenMsg* theMsg, const stru
       {
           if (mgen.GetLogTx())
           {
+#ifdef HAVE_PTHREAD
+              MgenLogPipe* logPipe = mgen.GetLogPipe();
+              if ((NULL != logPipe) && logPipe->PushSend(*theMsg, theTime))
+                  break;
+#endif // HAVE_PTHREAD
               theMsg->LogSendEvent(mgen.GetLogFile(),
                                    mgen.GetLogBinary(),
                                    mgen.GetLocalTime(),
@@ -352,6 +514,19 @@ void MgenTransport::LogEvent(LogEventType eventType, MgenMsg* theMsg, const stru
     case RECV_EVENT:
       {
           theMsg->SetProtocol(protocol);
+#ifdef HAVE_PTHREAD
+          // Plain RECV events go to the log pipe writer thread as compact 
+          // records, otherwise LogRecvEvent() output is queued as text
+          MgenLogPipe* logPipe = mgen.GetLogPipe();
+          if ((NULL != logPipe) && mgen.GetLogRx() &&
+              logPipe->PushRecv(*theMsg, theTime, mgen.GetLogData(), mgen.GetLogGpsData()))
+          {
+              if (mgen.GetController())
+                  mgen.GetController()->OnMsgReceive(*theMsg);
+              break;
+          }
+          if (NULL != logPipe) logPipe->SetRecvContext(true);
+#endif // HAVE_PTHREAD
           theMsg->LogRecvEvent(mgen.GetLogFile(),
                                mgen.GetLogBinary(), 
                                mgen.GetLocalTime(), 
@@ -362,6 +537,9 @@ void MgenTransport::LogEvent(LogEventType eventType, MgenMsg* theMsg, const stru
                                mgen.GetLogFlush(),
                                -1, 
                                theTime);
+#ifdef HAVE_PTHREAD
+          if (NULL != logPipe) logPipe->SetRecvContext(false);
+#endif // HAVE_PTHREAD
 
           // Don't we want rapr to get the message regardless of logging??
           // Could this possibly have been broken too? strange... ljt
@@ -701,6 +879,15 @@ bool MgenSocketTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
             
             if (mgen.GetReuse())
                 socket.SetReuse(true);
+#ifdef HAVE_SO_REUSEPORT
+            // Receive shards share the port (see MgenUdpTransport::StartShards())
+            if ((UDP == protocol) && (mgen.GetRxShards() > 1))
+            {
+                int enable = 1;
+                if (0 != setsockopt(socket.GetHandle(), SOL_SOCKET, SO_REUSEPORT, (char*)&enable, sizeof(enable)))
+                    PLOG(PL_ERROR, "MgenSocketTransport::Open() setsockopt(SO_REUSEPORT) error: %s\n", GetErrorString());
+            }
+#endif // HAVE_SO_REUSEPORT
             if (bindOnOpen)
                 socket.Bind(srcPort);
         }
@@ -788,9 +975,25 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
                                    Protocol theProtocol,
                                    UINT16        thePort)
   : MgenSocketTransport(theMgen,theProtocol,thePort),
-    group_count(0),connect(false)
+#ifdef HAVE_UDP_GRO
+    rx_gro_buffer(NULL),
+#endif // HAVE_UDP_GRO
+#ifdef HAVE_SO_TIMESTAMPING
+    tx_stamp_ring(NULL), tx_stamp_head(0), tx_stamp_count(0), tx_stamp_id(0),
+    tx_timestamp(false), tx_delay_count(0), tx_delay_sum(0.0), 
+    tx_delay_min(0.0), tx_delay_max(0.0),
+#endif // HAVE_SO_TIMESTAMPING
+#ifdef HAVE_SO_REUSEPORT
+    rx_shard_list(NULL), rx_shard_count(0),
+#endif // HAVE_SO_REUSEPORT
+    rx_timestamp(false), rx_gro(false), group_count(0),connect(false)
 {
     socket.SetListener(this,&MgenUdpTransport::OnEvent);
+#ifdef HAVE_SO_REUSEPORT
+    rx_shard_timer.SetListener(this, &MgenUdpTransport::OnShardTimeout);
+    rx_shard_timer.SetInterval(0.1);
+    rx_shard_timer.SetRepeat(-1);
+#endif // HAVE_SO_REUSEPORT
 }
 
 
@@ -799,9 +1002,25 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
                                    UINT16        thePort,
                                    const ProtoAddress&        theDstAddress)
   : MgenSocketTransport(theMgen,theProtocol,thePort,theDstAddress),
-    group_count(0),connect(false)
+#ifdef HAVE_UDP_GRO
+    rx_gro_buffer(NULL),
+#endif // HAVE_UDP_GRO
+#ifdef HAVE_SO_TIMESTAMPING
+    tx_stamp_ring(NULL), tx_stamp_head(0), tx_stamp_count(0), tx_stamp_id(0),
+    tx_timestamp(false), tx_delay_count(0), tx_delay_sum(0.0), 
+    tx_delay_min(0.0), tx_delay_max(0.0),
+#endif // HAVE_SO_TIMESTAMPING
+#ifdef HAVE_SO_REUSEPORT
+    rx_shard_list(NULL), rx_shard_count(0),
+#endif // HAVE_SO_REUSEPORT
+    rx_timestamp(false), rx_gro(false), group_count(0),connect(false)
 {
     socket.SetListener(this,&MgenUdpTransport::OnEvent);
+#ifdef HAVE_SO_REUSEPORT
+    rx_shard_timer.SetListener(this, &MgenUdpTransport::OnShardTimeout);
+    rx_shard_timer.SetInterval(0.1);
+    rx_shard_timer.SetRepeat(-1);
+#endif // HAVE_SO_REUSEPORT
 
     // If the dstAddress is set, we're a "connected" udp socket
     // otherwise we don't have a dst address associated with the
@@ -812,7 +1031,23 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
 
 MgenUdpTransport::~MgenUdpTransport()
 {
-
+#ifdef HAVE_SO_REUSEPORT
+    StopShards();
+#endif // HAVE_SO_REUSEPORT
+#ifdef HAVE_SO_TIMESTAMPING
+    if (NULL != tx_stamp_ring)
+    {
+        delete[] tx_stamp_ring;
+        tx_stamp_ring = NULL;
+    }
+#endif // HAVE_SO_TIMESTAMPING
+#ifdef HAVE_UDP_GRO
+    if (NULL != rx_gro_buffer)
+    {
+        delete[] rx_gro_buffer;
+        rx_gro_buffer = NULL;
+    }
+#endif // HAVE_UDP_GRO
 }
 
 bool MgenUdpTransport::SetMulticastInterface(const char* interfaceName)
@@ -842,8 +1077,19 @@ bool MgenUdpTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
             DMSG(0,"MgenUdpTransport::Open() Error: Failed to connect udp socket.\n");
             return false;
         }
-        else
-            return true;
+#ifdef SO_TIMESTAMPNS
+        if (mgen.GetRxTimestamp() && !rx_timestamp)
+            EnableRxTimestamp();  // falls back to user space timestamps on failure
+#endif // SO_TIMESTAMPNS
+#ifdef HAVE_UDP_GRO
+        if (mgen.GetRxGro() && !rx_gro)
+            EnableRxGro();  // falls back to per-datagram receive on failure
+#endif // HAVE_UDP_GRO
+#ifdef HAVE_SO_TIMESTAMPING
+        if (mgen.GetTxTimestamp() && !tx_timestamp)
+            EnableTxTimestamp();  // falls back to MgenFlow tx_time on failure
+#endif // HAVE_SO_TIMESTAMPING
+        return true;
     }
 
     DMSG(0,"MgenUdpTransport::Open() Error: Failed to open udp socket.\n");
@@ -889,6 +1135,15 @@ bool MgenUdpTransport::JoinGroup(const ProtoAddress& groupAddress,
 	    {
             socket.SetLoopback(true);
             group_count++;
+#ifdef HAVE_SO_REUSEPORT
+            if (0 != rx_shard_count)
+            {
+                // Shards don't receive group traffic (see MgenRxShard::Open())
+                PLOG(PL_WARN, "MgenUdpTransport::JoinGroup() warning: receive shards stopped for multicast port %hu\n",
+                     socket.GetPort());
+                StopShards();
+            }
+#endif // HAVE_SO_REUSEPORT
             return true;
 	    }
         else
@@ -934,6 +1189,28 @@ bool MgenUdpTransport::LeaveGroup(const ProtoAddress& groupAddress,
     }
 }  // end MgenUdpTransport::LeaveGroup()
 
+void MgenUdpTransport::Close()
+{
+    if (1 == reference_count)
+    {
+        // The socket is about to be closed
+#ifdef HAVE_SO_TIMESTAMPING
+        if (tx_timestamp)
+        {
+            RecvTxTimestamps();
+            FlushTxStamps();
+            tx_timestamp = false;
+        }
+#endif // HAVE_SO_TIMESTAMPING
+        rx_timestamp = false;
+        rx_gro = false;
+#ifdef HAVE_SO_REUSEPORT
+        StopShards();
+#endif // HAVE_SO_REUSEPORT
+    }
+    MgenSocketTransport::Close();
+}  // end MgenUdpTransport::Close()
+
 // Receive and log a UDP packet
 void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEvent)
 {
@@ -941,6 +1218,28 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
     {
         case ProtoSocket::RECV:
         {
+#ifdef HAVE_SO_TIMESTAMPING
+            if (tx_timestamp)
+            {
+                // A pending transmit timestamp also makes the socket 
+                // readable, so SEND events are logged as stamps arrive
+                RecvTxTimestamps();
+            }
+#endif // HAVE_SO_TIMESTAMPING
+#ifdef HAVE_RECVMMSG
+            if (mgen.GetRxBatch() > 1)
+            {
+                RecvBatch(theSocket);
+                break;
+            }
+#endif // HAVE_RECVMMSG
+#ifdef SO_TIMESTAMPNS
+            if (rx_timestamp || rx_gro)
+            {
+                RecvControl(theSocket);
+                break;
+            }
+#endif // SO_TIMESTAMPNS
             UINT32 alignedBuffer[MAX_SIZE/4];
             char* buffer = (char*)alignedBuffer;
             unsigned int len = MAX_SIZE;
@@ -948,51 +1247,12 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
             while (theSocket.RecvFrom((char*)buffer, len, srcAddr))
             {
                 if (len == 0) break;
-                if (mgen.GetLogFile() || mgen.ComputeAnalytics())
+                if (mgen.GetLogging() || mgen.ComputeAnalytics() || mgen.GetCounters())
                 {
                     struct timeval currentTime;
                     ProtoSystemTime(currentTime);
-                    MgenMsg theMsg;
-                    // the socket recvFrom gives us our srcAddr
-                    theMsg.SetSrcAddr(srcAddr);
-                    if (theMsg.Unpack(alignedBuffer, len, mgen.GetChecksumForce(), mgen.GetLogData()))
-                    {
-                        if (mgen.GetChecksumForce() || theMsg.FlagIsSet(MgenMsg::CHECKSUM))
-                        {
-                            UINT32 checksum = 0;
-                            theMsg.ComputeCRC32(checksum,(unsigned char*)buffer,len - 4);
-                            checksum = (checksum ^ theMsg.CRC32_XOROT);
-                            UINT32 checksumPosition = len - 4;
-                            UINT32 recvdChecksum;
-                            memcpy(&recvdChecksum,buffer+checksumPosition,4);
-                            recvdChecksum = ntohl(recvdChecksum);
-
-                            if (checksum != recvdChecksum)
-                            {
-                                DMSG(0, "MgenUdpTransport::OnEvent() error: checksum failure\n");
-                                theMsg.SetChecksumError();
-                            }
-                        }
-                        if (theMsg.GetError())
-                        {
-                            if (mgen.GetLogFile())
-                                LogEvent(RERR_EVENT, &theMsg, currentTime);
-                        }
-                        else 
-                        {
-                            ProcessRecvMessage(theMsg, ProtoTime(currentTime));
-                            if (mgen.ComputeAnalytics())
-                                mgen.UpdateRecvAnalytics(currentTime, &theMsg, UDP);
-                            if (mgen.GetLogFile())
-                                LogEvent(RECV_EVENT, &theMsg, currentTime, alignedBuffer);
-                        }
-                    }
-                    else 
-                    {
-                        if (mgen.GetLogFile())
-                            LogEvent(RERR_EVENT, &theMsg, currentTime);
-                    }
-                }  // end if (NULL != mgen.GetLogFile())
+                    HandleRecvMessage(alignedBuffer, len, srcAddr, currentTime);
+                }
                 len = MAX_SIZE;
             }  // end while(theSocket.RecvFrom())
             break;
@@ -1008,6 +1268,548 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
     }  // end switch(theEvent)
 }  // end MgenUdpTransport::OnEvent()
 
+// Unpack, validate, process and log a received UDP message
+void MgenUdpTransport::HandleRecvMessage(UINT32*               alignedBuffer, 
+                                         unsigned int          len, 
+                                         const ProtoAddress&   srcAddr, 
+                                         const struct timeval& currentTime,
+                                         bool                  updateStats)
+{
+    if (updateStats && mgen.GetCounters())
+    {
+        MgenMsgView msgView(alignedBuffer, len);
+        if (msgView.IsValid() &&
+            (!(mgen.GetChecksumForce() || msgView.FlagIsSet(MgenMsg::CHECKSUM)) ||
+             msgView.ChecksumIsValid()))
+        {
+            mgen.GetFlowCounters().Update(srcAddr, msgView.GetDstPort(), msgView.GetFlowId(), 
+                                          msgView.GetSeqNum(), len, currentTime);
+        }
+        // Counters only, so we're done
+        if (!mgen.GetLogging() && !mgen.ComputeAnalytics()) return;
+    }
+    if (!mgen.GetLogging())
+    {
+        // Analytics only, so read just the header fields unless the 
+        // payload carries MGEN_DATA (flow commands, reports) to process
+        MgenMsgView msgView(alignedBuffer, len);
+        if (msgView.IsValid() && (MgenMsg::MGEN_DATA != msgView.GetPayloadType()))
+        {
+            if ((mgen.GetChecksumForce() || msgView.FlagIsSet(MgenMsg::CHECKSUM)) &&
+                !msgView.ChecksumIsValid())
+            {
+                DMSG(0, "MgenUdpTransport::OnEvent() error: checksum failure\n");
+                return;
+            }
+            if (updateStats)
+                mgen.UpdateRecvAnalytics(ProtoTime(currentTime), msgView, srcAddr, UDP);
+            return;
+        }
+    }
+    const char* buffer = (const char*)alignedBuffer;
+    MgenMsg theMsg;
+    // the socket recvFrom gives us our srcAddr
+    theMsg.SetSrcAddr(srcAddr);
+    if (theMsg.Unpack(alignedBuffer, len, mgen.GetChecksumForce(), mgen.GetLogData()))
+    {
+        if (mgen.GetChecksumForce() || theMsg.FlagIsSet(MgenMsg::CHECKSUM))
+        {
+            UINT32 checksum = 0;
+            theMsg.ComputeCRC32(checksum,(unsigned char*)buffer,len - 4);
+            checksum = (checksum ^ theMsg.CRC32_XOROT);
+            UINT32 checksumPosition = len - 4;
+            UINT32 recvdChecksum;
+            memcpy(&recvdChecksum,buffer+checksumPosition,4);
+            recvdChecksum = ntohl(recvdChecksum);
+
+            if (checksum != recvdChecksum)
+            {
+                DMSG(0, "MgenUdpTransport::OnEvent() error: checksum failure\n");
+                theMsg.SetChecksumError();
+            }
+        }
+        if (theMsg.GetError())
+        {
+            if (mgen.GetLogFile())
+                LogEvent(RERR_EVENT, &theMsg, currentTime);
+        }
+        else 
+        {
+            ProcessRecvMessage(theMsg, ProtoTime(currentTime));
+            if (updateStats && mgen.ComputeAnalytics())
+                mgen.UpdateRecvAnalytics(currentTime, &theMsg, UDP);
+            if (mgen.GetLogging())
+                LogEvent(RECV_EVENT, &theMsg, currentTime, alignedBuffer);
+        }
+    }
+    else 
+    {
+        if (mgen.GetLogFile())
+            LogEvent(RERR_EVENT, &theMsg, currentTime);
+    }
+}  // end MgenUdpTransport::HandleRecvMessage()
+
+#ifdef SO_TIMESTAMPNS
+bool MgenUdpTransport::EnableRxTimestamp()
+{
+    int enable = 1;
+    if (0 != setsockopt(socket.GetHandle(), SOL_SOCKET, SO_TIMESTAMPNS, (char*)&enable, sizeof(enable)))
+    {
+        PLOG(PL_ERROR, "MgenUdpTransport::EnableRxTimestamp() setsockopt(SO_TIMESTAMPNS) error: %s\n", GetErrorString());
+        return false;
+    }
+    rx_timestamp = true;
+    return true;
+}  // end MgenUdpTransport::EnableRxTimestamp()
+
+// Per-datagram receive using recvmsg() so the kernel SO_TIMESTAMPNS
+// stamp can be used as the receive time instead of the (later) time
+// the dispatcher got around to reading the socket, and so UDP_GRO
+// coalesced buffers can be split back into messages.
+void MgenUdpTransport::RecvControl(ProtoSocket& theSocket)
+{
+    UINT32 alignedBuffer[MAX_SIZE/4];
+    UINT32* recvBuffer = alignedBuffer;
+    unsigned int recvSize = MAX_SIZE;
+#ifdef HAVE_UDP_GRO
+    if (rx_gro)
+    {
+        recvBuffer = rx_gro_buffer;
+        recvSize = RX_GRO_MAX;
+    }
+#endif // HAVE_UDP_GRO
+    struct sockaddr_storage sockAddr;
+    struct iovec iov;
+    MgenRxControl control;
+    struct msghdr msg;
+    while (true)
+    {
+        iov.iov_base = recvBuffer;
+        iov.iov_len = recvSize;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &sockAddr;
+        msg.msg_namelen = sizeof(sockAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        ssize_t result = recvmsg(theSocket.GetHandle(), &msg, MSG_DONTWAIT);
+        if (result <= 0)
+        {
+            if ((result < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+                PLOG(PL_ERROR, "MgenUdpTransport::RecvControl() recvmsg() error: %s\n", GetErrorString());
+            break;
+        }
+        if (mgen.GetLogging() || mgen.ComputeAnalytics() || mgen.GetCounters())
+        {
+            struct timeval currentTime;
+            if (!GetKernelRxTime(&msg, currentTime))
+                ProtoSystemTime(currentTime);
+            ProtoAddress srcAddr;
+            srcAddr.SetSockAddr(*((struct sockaddr*)&sockAddr));
+#ifdef HAVE_UDP_GRO
+            if (rx_gro)
+            {
+                HandleRecvSegments(recvBuffer, (unsigned int)result, GetGroSegmentSize(&msg), 
+                                   srcAddr, currentTime);
+                continue;
+            }
+#endif // HAVE_UDP_GRO
+            HandleRecvMessage(recvBuffer, (unsigned int)result, srcAddr, currentTime);
+        }
+    }
+}  // end MgenUdpTransport::RecvControl()
+#endif // SO_TIMESTAMPNS
+
+#ifdef HAVE_UDP_GRO
+bool MgenUdpTransport::EnableRxGro()
+{
+    if ((NULL == rx_gro_buffer) && (NULL == (rx_gro_buffer = new UINT32[RX_GRO_MAX/4])))
+    {
+        PLOG(PL_ERROR, "MgenUdpTransport::EnableRxGro() new rx_gro_buffer error: %s\n", GetErrorString());
+        return false;
+    }
+    int enable = 1;
+    if (0 != setsockopt(socket.GetHandle(), IPPROTO_UDP, UDP_GRO, (char*)&enable, sizeof(enable)))
+    {
+        PLOG(PL_ERROR, "MgenUdpTransport::EnableRxGro() setsockopt(UDP_GRO) error: %s\n", GetErrorString());
+        return false;
+    }
+    rx_gro = true;
+    return true;
+}  // end MgenUdpTransport::EnableRxGro()
+
+// Splits a UDP_GRO coalesced receive back into its datagrams
+void MgenUdpTransport::HandleRecvSegments(UINT32*               alignedBuffer, 
+                                          unsigned int          len, 
+                                          unsigned int          segSize,
+                                          const ProtoAddress&   srcAddr, 
+                                          const struct timeval& currentTime)
+{
+    UINT32 segBuffer[MAX_SIZE/4];
+    unsigned int offset = 0;
+    unsigned int segLen;
+    UINT32* segment;
+    while (NULL != (segment = NextSegment(alignedBuffer, len, segSize, offset, segLen, segBuffer)))
+        HandleRecvMessage(segment, segLen, srcAddr, currentTime);
+}  // end MgenUdpTransport::HandleRecvSegments()
+
+// Returns the datagram at "offset" in a UDP_GRO coalesced receive buffer
+// (and advances "offset" past it), or NULL at the end of the buffer.  The
+// kernel only coalesces same-flow datagrams of "segSize" bytes (the last
+// one may be shorter), so each segment is one MGEN message.  Segments 
+// that aren't 32-bit aligned are copied to "segBuffer" (MAX_SIZE bytes) 
+// for MgenMsg::Unpack().
+UINT32* MgenUdpTransport::NextSegment(UINT32*       alignedBuffer, 
+                                      unsigned int  len, 
+                                      unsigned int  segSize,
+                                      unsigned int& offset,
+                                      unsigned int& segLen,
+                                      UINT32*       segBuffer)
+{
+    if (offset >= len) return NULL;
+    if ((0 == segSize) || (segSize > len)) segSize = len;  // not coalesced
+    char* segment = ((char*)alignedBuffer) + offset;
+    bool aligned = (0 == (offset & 0x03));
+    segLen = len - offset;
+    if (segLen > segSize) segLen = segSize;
+    offset += segLen;
+    if (aligned) return (UINT32*)segment;
+    if (segLen > MAX_SIZE) segLen = MAX_SIZE;
+    memcpy(segBuffer, segment, segLen);
+    return segBuffer;
+}  // end MgenUdpTransport::NextSegment()
+#endif // HAVE_UDP_GRO
+
+#ifdef HAVE_SO_TIMESTAMPING
+bool MgenUdpTransport::EnableTxTimestamp()
+{
+    // OPT_ID tags each error queue timestamp with the socket's datagram 
+    // counter and OPT_TSONLY keeps the kernel from looping back the packet
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (0 != setsockopt(socket.GetHandle(), SOL_SOCKET, SO_TIMESTAMPING, (char*)&flags, sizeof(flags)))
+    {
+        PLOG(PL_ERROR, "MgenUdpTransport::EnableTxTimestamp() setsockopt(SO_TIMESTAMPING) error: %s\n", GetErrorString());
+        return false;
+    }
+    if (NULL == tx_stamp_ring)
+    {
+        if (NULL == (tx_stamp_ring = new TxStamp[TX_STAMP_MAX]))
+        {
+            PLOG(PL_ERROR, "MgenUdpTransport::EnableTxTimestamp() new tx_stamp_ring error: %s\n", GetErrorString());
+            return false;
+        }
+    }
+    tx_stamp_head = tx_stamp_count = 0;
+    tx_stamp_id = 0;  // kernel counter restarts when the option is set
+    tx_delay_count = 0;
+    tx_delay_sum = tx_delay_min = tx_delay_max = 0.0;
+    memset(tx_delay_hist, 0, sizeof(tx_delay_hist));
+    tx_timestamp = true;
+    if (!socket.StartInputNotification())
+        PLOG(PL_WARN, "MgenUdpTransport::EnableTxTimestamp() warning: unable to start input notification\n");
+    return true;
+}  // end MgenUdpTransport::EnableTxTimestamp()
+
+void MgenUdpTransport::StopInputNotification()
+{
+    if (!tx_timestamp) socket.StopInputNotification();
+}  // end MgenUdpTransport::StopInputNotification()
+
+void MgenUdpTransport::QueueTxStamp(MgenMsg& theMsg, const UINT32* txBuffer, unsigned int len)
+{
+    if (TX_STAMP_MAX == tx_stamp_count)
+    {
+        // Ring is full, so give up on the oldest timestamp
+        LogTxStamp(tx_stamp_ring[tx_stamp_head], NULL);
+        tx_stamp_head = (tx_stamp_head + 1) % TX_STAMP_MAX;
+        tx_stamp_count--;
+    }
+    TxStamp& txStamp = tx_stamp_ring[(tx_stamp_head + tx_stamp_count) % TX_STAMP_MAX];
+    txStamp.id = tx_stamp_id++;
+    txStamp.msg = theMsg;
+    txStamp.msg.SetPayload(theMsg.GetPayloadType(), NULL, 0);  // payload isn't logged for SEND
+    txStamp.app_time = theMsg.GetTxTime();
+    // SEND records only log the message header
+    memcpy(txStamp.buffer, txBuffer, (len < TX_STAMP_COPY) ? len : TX_STAMP_COPY);
+    tx_stamp_count++;
+}  // end MgenUdpTransport::QueueTxStamp()
+
+// Reads any pending transmit timestamps from the socket error
+// queue and logs the SEND events they complete
+void MgenUdpTransport::RecvTxTimestamps()
+{
+    char control[512];
+    struct msghdr msg;
+    // The whole queue is read (stale timestamps are dropped) so
+    // it doesn't keep the socket readable
+    while (true)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(socket.GetHandle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno))
+                PLOG(PL_ERROR, "MgenUdpTransport::RecvTxTimestamps() recvmsg() error: %s\n", GetErrorString());
+            break;
+        }
+        struct timespec* ts = NULL;
+        struct sock_extended_err* err = NULL;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); NULL != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if ((SOL_SOCKET == cmsg->cmsg_level) && (SCM_TIMESTAMPING == cmsg->cmsg_type))
+            {
+                // ts[0] holds the software timestamp
+                ts = ((struct scm_timestamping*)CMSG_DATA(cmsg))->ts;
+            }
+            else if (((SOL_IP == cmsg->cmsg_level) && (IP_RECVERR == cmsg->cmsg_type)) ||
+                     ((SOL_IPV6 == cmsg->cmsg_level) && (IPV6_RECVERR == cmsg->cmsg_type)))
+            {
+                err = (struct sock_extended_err*)CMSG_DATA(cmsg);
+                if (SO_EE_ORIGIN_TIMESTAMPING != err->ee_origin) err = NULL;
+            }
+        }
+        if ((NULL == ts) || (NULL == err)) continue;
+        struct timeval kernelTime;
+        TimespecToTimeval(ts[0], kernelTime);
+        // Earlier datagrams without a timestamp are logged with their app time
+        while (tx_stamp_count > 0)
+        {
+            TxStamp& txStamp = tx_stamp_ring[tx_stamp_head];
+            INT32 delta = (INT32)(err->ee_data - txStamp.id);
+            if (delta < 0) break;  // stale timestamp
+            LogTxStamp(txStamp, (0 == delta) ? &kernelTime : NULL);
+            tx_stamp_head = (tx_stamp_head + 1) % TX_STAMP_MAX;
+            tx_stamp_count--;
+            if (0 == delta) break;
+        }
+    }
+}  // end MgenUdpTransport::RecvTxTimestamps()
+
+void MgenUdpTransport::LogTxStamp(TxStamp& txStamp, const struct timeval* kernelTime)
+{
+    if (NULL == kernelTime)
+    {
+        LogEvent(SEND_EVENT, &txStamp.msg, txStamp.app_time, txStamp.buffer);
+        return;
+    }
+    double delay = ProtoTime::Delta(ProtoTime(*kernelTime), ProtoTime(txStamp.app_time));
+    if (delay < 0.0) delay = 0.0;
+    if ((0 == tx_delay_count) || (delay < tx_delay_min)) tx_delay_min = delay;
+    if ((0 == tx_delay_count) || (delay > tx_delay_max)) tx_delay_max = delay;
+    tx_delay_sum += delay;
+    tx_delay_count++;
+    unsigned int bin = 0;
+    for (unsigned long usec = (unsigned long)(delay * 1.0e+06); (usec > 1) && (bin < TX_DELAY_BINS - 1); usec >>= 1)
+        bin++;
+    tx_delay_hist[bin]++;
+    // The binary SEND record time is the tx_time in the message buffer
+    // so the logged copy (not the payload) gets the kernel time
+    UINT32 temp32 = htonl((UINT32)kernelTime->tv_sec);
+    memcpy(((char*)txStamp.buffer) + 12, &temp32, sizeof(UINT32));
+    temp32 = htonl((UINT32)kernelTime->tv_usec);
+    memcpy(((char*)txStamp.buffer) + 16, &temp32, sizeof(UINT32));
+    LogEvent(SEND_EVENT, &txStamp.msg, *kernelTime, txStamp.buffer);
+}  // end MgenUdpTransport::LogTxStamp()
+
+// Logs any SEND events still awaiting a timestamp and the in-host
+// send delay summary (text logs only)
+void MgenUdpTransport::FlushTxStamps()
+{
+    while (tx_stamp_count > 0)
+    {
+        LogTxStamp(tx_stamp_ring[tx_stamp_head], NULL);
+        tx_stamp_head = (tx_stamp_head + 1) % TX_STAMP_MAX;
+        tx_stamp_count--;
+    }
+    if (mgen.GetLogBinary() || !mgen.GetLogTx() || (0 == tx_delay_count)) 
+        return;
+    FILE* logFile = MgenLogEncoder::GetTextFile(mgen.GetLogFile());
+    if (NULL == logFile) return;
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    Mgen::LogTimestamp(logFile, currentTime, mgen.GetLocalTime());
+    Mgen::Log(logFile, "TXDELAY proto>%s srcPort>%hu count>%lu min>%.6f ave>%.6f max>%.6f hist>",
+              MgenEvent::GetStringFromProtocol(protocol), socket.GetPort(), tx_delay_count,
+              tx_delay_min, tx_delay_sum / (double)tx_delay_count, tx_delay_max);
+    // "<upper bound usec>:<count>" for each non-empty log2 bin
+    bool first = true;
+    for (unsigned int i = 0; i < TX_DELAY_BINS; i++)
+    {
+        if (0 == tx_delay_hist[i]) continue;
+        Mgen::Log(logFile, "%s%lu:%lu", first ? "" : ",", 1UL << i, tx_delay_hist[i]);
+        first = false;
+    }
+    Mgen::Log(logFile, "\n");
+    if (mgen.GetLogFlush()) fflush(logFile);
+}  // end MgenUdpTransport::FlushTxStamps()
+#endif // HAVE_SO_TIMESTAMPING
+
+#ifdef HAVE_RECVMMSG
+// Pulls up to "rxbatch" datagrams per recvmmsg() call into a preallocated
+// set of buffers, then processes the batch with a single receive timestamp
+// (or per-datagram kernel timestamps when RXTIMESTAMP is enabled).  With
+// RXGRO each buffer may hold several coalesced datagrams.
+void MgenUdpTransport::RecvBatch(ProtoSocket& theSocket)
+{
+    unsigned int slotSize = MAX_SIZE;
+#ifdef HAVE_UDP_GRO
+    if (rx_gro) slotSize = RX_GRO_MAX;
+#endif // HAVE_UDP_GRO
+    if (!rx_batch.Init(mgen.GetRxBatch(), slotSize)) return;
+    unsigned int batchSize = rx_batch.GetBatchSize();
+    while (true)
+    {
+        unsigned int count = rx_batch.Recv(theSocket.GetHandle(), batchSize, rx_timestamp || rx_gro);
+        if (0 == count) break;
+        if (mgen.GetLogging() || mgen.ComputeAnalytics() || mgen.GetCounters())
+        {
+            struct timeval batchTime;
+            ProtoSystemTime(batchTime);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                unsigned int len = rx_batch.GetLength(i);
+                if (0 == len) continue;
+                struct timeval currentTime = batchTime;
+#ifdef SO_TIMESTAMPNS
+                if (rx_timestamp) rx_batch.GetRxTime(i, currentTime);
+#endif // SO_TIMESTAMPNS
+                ProtoAddress srcAddr;
+                rx_batch.GetSrcAddr(i, srcAddr);
+#ifdef HAVE_UDP_GRO
+                if (rx_gro)
+                {
+                    HandleRecvSegments(rx_batch.GetBuffer(i), len, rx_batch.GetSegmentSize(i), 
+                                       srcAddr, currentTime);
+                    continue;
+                }
+#endif // HAVE_UDP_GRO
+                HandleRecvMessage(rx_batch.GetBuffer(i), len, srcAddr, currentTime);
+            }
+        }
+        if (count < batchSize) break;  // socket drained
+    }
+}  // end MgenUdpTransport::RecvBatch()
+
+MgenRxBatch::MgenRxBatch()
+ : buffer(NULL), batch_size(0), slot_size(0), msg_vector(NULL), 
+   iov_vector(NULL), addr_vector(NULL), control_buffer(NULL)
+{
+}
+
+MgenRxBatch::~MgenRxBatch()
+{
+    Destroy();
+}
+
+void MgenRxBatch::Destroy()
+{
+    if (NULL != buffer) delete[] buffer;
+    if (NULL != msg_vector) delete[] msg_vector;
+    if (NULL != iov_vector) delete[] iov_vector;
+    if (NULL != addr_vector) delete[] addr_vector;
+    if (NULL != control_buffer) delete[] control_buffer;
+    buffer = NULL;
+    msg_vector = NULL;
+    iov_vector = NULL;
+    addr_vector = NULL;
+    control_buffer = NULL;
+    batch_size = slot_size = 0;
+}  // end MgenRxBatch::Destroy()
+
+bool MgenRxBatch::Init(unsigned int batchSize, unsigned int slotSize)
+{
+    if (batchSize < 1) batchSize = 1;
+    if (batchSize > BATCH_MAX) batchSize = BATCH_MAX;
+    if ((batchSize == batch_size) && (slotSize == slot_size)) return true;
+    Destroy();
+    buffer = new UINT32[batchSize*(slotSize/4)];
+    msg_vector = new struct mmsghdr[batchSize];
+    iov_vector = new struct iovec[batchSize];
+    addr_vector = new struct sockaddr_storage[batchSize];
+    control_buffer = new char[batchSize*CONTROL_SIZE];
+    if ((NULL == buffer) || (NULL == msg_vector) || (NULL == iov_vector) ||
+        (NULL == addr_vector) || (NULL == control_buffer))
+    {
+        PLOG(PL_ERROR, "MgenRxBatch::Init() new error: %s\n", GetErrorString());
+        Destroy();
+        return false;
+    }
+    memset(msg_vector, 0, batchSize*sizeof(struct mmsghdr));
+    for (unsigned int i = 0; i < batchSize; i++)
+    {
+        iov_vector[i].iov_base = buffer + i*(slotSize/4);
+        iov_vector[i].iov_len = slotSize;
+        msg_vector[i].msg_hdr.msg_iov = iov_vector + i;
+        msg_vector[i].msg_hdr.msg_iovlen = 1;
+        msg_vector[i].msg_hdr.msg_name = addr_vector + i;
+    }
+    batch_size = batchSize;
+    slot_size = slotSize;
+    return true;
+}  // end MgenRxBatch::Init()
+
+unsigned int MgenRxBatch::Recv(int fd, unsigned int count, bool control)
+{
+    if (count > batch_size) count = batch_size;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        struct msghdr& msg = msg_vector[i].msg_hdr;
+        msg.msg_namelen = sizeof(struct sockaddr_storage);
+        msg.msg_control = control ? (control_buffer + i*CONTROL_SIZE) : NULL;
+        msg.msg_controllen = control ? CONTROL_SIZE : 0;
+        msg.msg_flags = 0;
+    }
+    while (true)
+    {
+        int result = recvmmsg(fd, msg_vector, count, MSG_DONTWAIT, NULL);
+        if (result > 0) return (unsigned int)result;
+        if ((result < 0) && (EINTR == errno)) continue;
+        if ((result < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno))
+            PLOG(PL_ERROR, "MgenRxBatch::Recv() recvmmsg() error: %s\n", GetErrorString());
+        return 0;
+    }
+}  // end MgenRxBatch::Recv()
+
+unsigned int MgenRxBatch::GetLength(unsigned int index) const
+{
+    return msg_vector[index].msg_len;
+}  // end MgenRxBatch::GetLength()
+
+const struct sockaddr_storage& MgenRxBatch::GetSockAddr(unsigned int index) const
+{
+    return addr_vector[index];
+}  // end MgenRxBatch::GetSockAddr()
+
+void MgenRxBatch::GetSrcAddr(unsigned int index, ProtoAddress& srcAddr) const
+{
+    srcAddr.SetSockAddr(*((struct sockaddr*)(addr_vector + index)));
+}  // end MgenRxBatch::GetSrcAddr()
+
+#ifdef SO_TIMESTAMPNS
+bool MgenRxBatch::GetRxTime(unsigned int index, struct timeval& rxTime) const
+{
+    return GetKernelRxTime(&msg_vector[index].msg_hdr, rxTime);
+}  // end MgenRxBatch::GetRxTime()
+#endif // SO_TIMESTAMPNS
+
+#ifdef HAVE_UDP_GRO
+unsigned int MgenRxBatch::GetSegmentSize(unsigned int index) const
+{
+    return GetGroSegmentSize(&msg_vector[index].msg_hdr);
+}  // end MgenRxBatch::GetSegmentSize()
+#endif // HAVE_UDP_GRO
+
+#ifdef HAVE_SO_REUSEPORT
+bool MgenRxBatch::IsGroupDelivery(unsigned int index) const
+{
+    return ::IsGroupDelivery(&msg_vector[index].msg_hdr);
+}  // end MgenRxBatch::IsGroupDelivery()
+#endif // HAVE_SO_REUSEPORT
+#endif // HAVE_RECVMMSG
+
 MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg, const ProtoAddress& dstAddr) 
 {
     
@@ -1057,6 +1859,15 @@ MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg, const ProtoAddress&
       return MSG_SEND_FAILED;
       }
 
+#ifdef HAVE_SO_TIMESTAMPING
+    if (tx_timestamp)
+    {
+        // SEND is logged once the kernel transmit timestamp arrives
+        QueueTxStamp(theMsg, txBuffer, len);
+        RecvTxTimestamps();
+        return MSG_SEND_OK;
+    }
+#endif // HAVE_SO_TIMESTAMPING
     LogEvent(SEND_EVENT, &theMsg,theMsg.GetTxTime(), txBuffer);
     return MSG_SEND_OK;
 
@@ -1067,9 +1878,494 @@ bool MgenUdpTransport::Listen(UINT16 port,ProtoAddress::Type addrType, bool bind
     if (!MgenSocketTransport::Listen(port,addrType,bindOnOpen))
       return false;
 
+#ifdef HAVE_SO_REUSEPORT
+    // (not for multicast, see JoinGroup())
+    if ((mgen.GetRxShards() > 1) && (0 == rx_shard_count) && (0 == group_count))
+    {
+        if (!StartShards(port, addrType))
+            DMSG(0, "MgenUdpTransport::Listen() Warning: unable to start receive shards\n");
+    }
+#endif // HAVE_SO_REUSEPORT
     return StartInputNotification();
 
 } // end MgenUdpTransport::Listen
+
+#ifdef HAVE_SO_REUSEPORT
+// Opens "rxshards - 1" additional SO_REUSEPORT sockets on the port, each
+// with its own receive thread.  The kernel hashes each flow (address/port 
+// 4-tuple) to one socket, so a flow's counters and analytics stay within
+// one shard.
+bool MgenUdpTransport::StartShards(UINT16 port, ProtoAddress::Type addrType)
+{
+    unsigned int shardCount = mgen.GetRxShards() - 1;
+    if (NULL == (rx_shard_list = new MgenRxShard*[shardCount]))
+    {
+        PLOG(PL_ERROR, "MgenUdpTransport::StartShards() new rx_shard_list error: %s\n", GetErrorString());
+        return false;
+    }
+    int firstCpu = mgen.GetRxShardCpu();
+    for (unsigned int i = 0; i < shardCount; i++)
+    {
+        MgenRxShard* shard = new MgenRxShard(*this, i + 1);
+        if (NULL == shard)
+        {
+            PLOG(PL_ERROR, "MgenUdpTransport::StartShards() new MgenRxShard error: %s\n", GetErrorString());
+            break;
+        }
+        int shardCpu = (firstCpu < 0) ? -1 : (firstCpu + (int)i + 1);
+        if (!shard->Open(rx_buffer) || !shard->Start(shardCpu))
+        {
+            delete shard;
+            break;
+        }
+        rx_shard_list[rx_shard_count++] = shard;
+    }
+    if (0 == rx_shard_count)
+    {
+        delete[] rx_shard_list;
+        rx_shard_list = NULL;
+        return false;
+    }
+    mgen.GetTimerMgr().ActivateTimer(rx_shard_timer);
+    return true;
+}  // end MgenUdpTransport::StartShards()
+
+void MgenUdpTransport::StopShards()
+{
+    if (NULL == rx_shard_list) return;
+    if (rx_shard_timer.IsActive()) rx_shard_timer.Deactivate();
+    FILE* logFile = MgenLogEncoder::GetTextFile(mgen.GetLogFile());
+    bool logSummary = (NULL != logFile) && !mgen.GetLogBinary();
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    unsigned long rxCount = 0;
+    unsigned long rxBytes = 0;
+    unsigned long dropCount = 0;
+    for (unsigned int i = 0; i < rx_shard_count; i++)
+    {
+        MgenRxShard* shard = rx_shard_list[i];
+        shard->Stop();
+        if (logSummary) shard->LogSummary(logFile, currentTime);
+        rxCount += shard->GetRxCount();
+        rxBytes += shard->GetRxBytes();
+        dropCount += shard->GetDropCount();
+        delete shard;
+    }
+    if (logSummary)
+    {
+        // Merged totals across the worker shards
+        Mgen::LogTimestamp(logFile, currentTime, mgen.GetLocalTime());
+        Mgen::Log(logFile, "RXSHARDS proto>UDP port>%hu shards>%u rx>%lu bytes>%lu drops>%lu\n",
+                  socket.GetPort(), rx_shard_count + 1, rxCount, rxBytes, dropCount);
+        if (mgen.GetLogFlush()) fflush(logFile);
+    }
+    delete[] rx_shard_list;
+    rx_shard_list = NULL;
+    rx_shard_count = 0;
+}  // end MgenUdpTransport::StopShards()
+
+bool MgenUdpTransport::OnShardTimeout(ProtoTimer& /*theTimer*/)
+{
+    for (unsigned int i = 0; i < rx_shard_count; i++)
+        rx_shard_list[i]->Drain();
+    return true;
+}  // end MgenUdpTransport::OnShardTimeout()
+
+// Shard flows are counted separately, so a flow spread across shards
+// by the kernel hash (e.g. changing source ports) has one line per shard
+void MgenUdpTransport::LogCounters(FILE* filePtr, const struct timeval& theTime)
+{
+    for (unsigned int i = 0; i < rx_shard_count; i++)
+        rx_shard_list[i]->LogCounters(filePtr, theTime);
+}  // end MgenUdpTransport::LogCounters()
+
+MgenRxShard::MgenRxShard(MgenUdpTransport& theTransport, unsigned int theIndex)
+  : transport(theTransport), mgen(theTransport.mgen), index(theIndex), cpu(-1),
+    sock_fd(-1), rx_timestamp(false), rx_gro(false), thread_started(false), stop(false), 
+    fill_buffer(NULL), fill_len(0), fill_size(0), drain_buffer(NULL), drain_size(0),
+    report_count(0), rx_count(0), rx_bytes(0), drop_count(0)
+{
+    memset(&config, 0, sizeof(config));
+    pthread_mutex_init(&lock, NULL);
+}
+
+MgenRxShard::~MgenRxShard()
+{
+    Stop();
+    analytic_table.Destroy();
+    if (NULL != fill_buffer) free(fill_buffer);
+    if (NULL != drain_buffer) free(drain_buffer);
+    pthread_mutex_destroy(&lock);
+}
+
+// The shard socket gets the transport socket's local address, device
+// and receive options so it only takes traffic the transport socket 
+// would.  The kernel gives every socket in a SO_REUSEPORT group its own
+// copy of broadcast and multicast datagrams, so the shard asks for their
+// destination (IP_PKTINFO) and leaves these to the transport socket.
+bool MgenRxShard::Open(unsigned int rxBufferSize)
+{
+    int mainFd = transport.socket.GetHandle();
+    struct sockaddr_storage bindAddr;
+    socklen_t addrLen = sizeof(bindAddr);
+    if (0 != getsockname(mainFd, (struct sockaddr*)&bindAddr, &addrLen))
+    {
+        PLOG(PL_ERROR, "MgenRxShard::Open() getsockname() error: %s\n", GetErrorString());
+        return false;
+    }
+    if ((sock_fd = ::socket(bindAddr.ss_family, SOCK_DGRAM, 0)) < 0)
+    {
+        PLOG(PL_ERROR, "MgenRxShard::Open() socket() error: %s\n", GetErrorString());
+        return false;
+    }
+    int enable = 1;
+    bool result = true;
+    if (mgen.GetReuse())
+        setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable));
+#ifdef HAVE_IPV6
+    if (AF_INET6 == bindAddr.ss_family)
+    {
+        int v6Only = 0;
+        socklen_t optLen = sizeof(v6Only);
+        if (0 == getsockopt(mainFd, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&v6Only, &optLen))
+            setsockopt(sock_fd, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&v6Only, sizeof(v6Only));
+        result = (0 == setsockopt(sock_fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, (char*)&enable, sizeof(enable)));
+        // (for IPv4 traffic to a dual-stack socket)
+        setsockopt(sock_fd, IPPROTO_IP, IP_PKTINFO, (char*)&enable, sizeof(enable));
+    }
+    else
+#endif // HAVE_IPV6
+    {
+        result = (0 == setsockopt(sock_fd, IPPROTO_IP, IP_PKTINFO, (char*)&enable, sizeof(enable)));
+    }
+    char ifName[IFNAMSIZ];
+    socklen_t ifLen = sizeof(ifName);
+    if (result && (0 == getsockopt(mainFd, SOL_SOCKET, SO_BINDTODEVICE, ifName, &ifLen)) && (ifLen > 1))
+        result = (0 == setsockopt(sock_fd, SOL_SOCKET, SO_BINDTODEVICE, ifName, ifLen));
+    if (!result ||
+        (0 != setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, (char*)&enable, sizeof(enable))) ||
+        (0 != bind(sock_fd, (struct sockaddr*)&bindAddr, addrLen)))
+    {
+        PLOG(PL_ERROR, "MgenRxShard::Open() shard %u port %hu error: %s\n", 
+             index, transport.socket.GetPort(), GetErrorString());
+        close(sock_fd);
+        sock_fd = -1;
+        return false;
+    }
+    if (0 != rxBufferSize)
+    {
+        int bufferSize = (int)rxBufferSize;
+        setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUF, (char*)&bufferSize, sizeof(bufferSize));
+    }
+    unsigned int slotSize = MAX_SIZE;
+#ifdef SO_TIMESTAMPNS
+    if (transport.rx_timestamp)
+        rx_timestamp = (0 == setsockopt(sock_fd, SOL_SOCKET, SO_TIMESTAMPNS, (char*)&enable, sizeof(enable)));
+#endif // SO_TIMESTAMPNS
+#ifdef HAVE_UDP_GRO
+    if (transport.rx_gro)
+        rx_gro = (0 == setsockopt(sock_fd, IPPROTO_UDP, UDP_GRO, (char*)&enable, sizeof(enable)));
+    if (rx_gro) slotSize = MgenUdpTransport::RX_GRO_MAX;
+#endif // HAVE_UDP_GRO
+    if (!rx_batch.Init(MgenRxBatch::BATCH_MAX, slotSize))
+    {
+        close(sock_fd);
+        sock_fd = -1;
+        return false;
+    }
+    return true;
+}  // end MgenRxShard::Open()
+
+bool MgenRxShard::Start(int theCpu)
+{
+    cpu = theCpu;
+    stop = false;
+    Configure();
+    if (0 != pthread_create(&thread, NULL, ThreadMain, this))
+    {
+        PLOG(PL_ERROR, "MgenRxShard::Start() pthread_create() error: %s\n", GetErrorString());
+        return false;
+    }
+    thread_started = true;
+    if (cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu % CPU_SETSIZE, &cpuSet);
+        if (0 != pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet))
+            PLOG(PL_WARN, "MgenRxShard::Start() unable to pin shard %u to cpu %d\n", index, cpu);
+    }
+    return true;
+}  // end MgenRxShard::Start()
+
+void MgenRxShard::Stop()
+{
+    if (thread_started)
+    {
+        pthread_mutex_lock(&lock);
+        stop = true;
+        pthread_mutex_unlock(&lock);
+        pthread_join(thread, NULL);
+        thread_started = false;
+    }
+    if (sock_fd >= 0)
+    {
+        close(sock_fd);
+        sock_fd = -1;
+    }
+    Drain();
+}  // end MgenRxShard::Stop()
+
+// Main thread, with "lock" held (or before the thread starts)
+void MgenRxShard::Configure()
+{
+    config.logging = mgen.GetLogging();
+    config.analytics = mgen.ComputeAnalytics();
+    config.counters = mgen.GetCounters();
+    config.checksum_force = mgen.GetChecksumForce();
+    config.rx_batch = mgen.GetRxBatch();
+    config.analytic_window = mgen.GetAnalyticWindow();
+    config.analytic_history = mgen.GetAnalyticHistory();
+    config.reorder = (0 != mgen.GetReorderWindow());
+}  // end MgenRxShard::Configure()
+
+void* MgenRxShard::ThreadMain(void* arg)
+{
+    static_cast<MgenRxShard*>(arg)->Run();
+    return NULL;
+}  // end MgenRxShard::ThreadMain()
+
+// Receives with the same MgenRxBatch (RXBATCH, RXTIMESTAMP, RXGRO) path
+// as the transport socket, a full batch per recvmmsg() call unless 
+// RXBATCH is given.  "lock" is taken once per batch.
+void MgenRxShard::Run()
+{
+    UINT32 segBuffer[MAX_SIZE/4];
+    struct pollfd pollFd;
+    pollFd.fd = sock_fd;
+    pollFd.events = POLLIN;
+    while (true)
+    {
+        pthread_mutex_lock(&lock);
+        bool done = stop;
+        unsigned int batchSize = (config.rx_batch > 1) ? config.rx_batch : MgenRxBatch::BATCH_MAX;
+        pthread_mutex_unlock(&lock);
+        if (done) break;
+        if (batchSize > rx_batch.GetBatchSize()) batchSize = rx_batch.GetBatchSize();
+        // Short poll timeout so Stop() is noticed promptly
+        pollFd.revents = 0;
+        if (poll(&pollFd, 1, 100) <= 0) continue;
+        while (true)
+        {
+            unsigned int count = rx_batch.Recv(sock_fd, batchSize, true);
+            if (0 == count) break;
+            struct timeval batchTime;
+            ProtoSystemTime(batchTime);
+            pthread_mutex_lock(&lock);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                unsigned int len = rx_batch.GetLength(i);
+                // (the transport socket gets its own copy of group traffic)
+                if ((0 == len) || rx_batch.IsGroupDelivery(i)) continue;
+                struct timeval rxTime = batchTime;
+#ifdef SO_TIMESTAMPNS
+                if (rx_timestamp) rx_batch.GetRxTime(i, rxTime);
+#endif // SO_TIMESTAMPNS
+                const struct sockaddr_storage& srcAddr = rx_batch.GetSockAddr(i);
+#ifdef HAVE_UDP_GRO
+                if (rx_gro)
+                {
+                    unsigned int offset = 0;
+                    unsigned int segLen;
+                    UINT32* segment;
+                    while (NULL != (segment = MgenUdpTransport::NextSegment(rx_batch.GetBuffer(i), len, 
+                                                                            rx_batch.GetSegmentSize(i),
+                                                                            offset, segLen, segBuffer)))
+                        OnRecv(segment, segLen, srcAddr, rxTime);
+                    continue;
+                }
+#endif // HAVE_UDP_GRO
+                OnRecv(rx_batch.GetBuffer(i), len, srcAddr, rxTime);
+            }
+            pthread_mutex_unlock(&lock);
+            if (count < batchSize) break;  // socket drained
+        }
+    }
+}  // end MgenRxShard::Run()
+
+// Shard thread, called with "lock" held.  All the counters and analytics
+// for the shard's flows are kept here.  Messages that need logging are
+// queued for Drain(), as are messages carrying MGEN_DATA (flow commands,
+// reports) and invalid ones, which get the rest of the 
+// MgenUdpTransport::HandleRecvMessage() processing on the main thread.
+void MgenRxShard::OnRecv(UINT32*                        alignedBuffer, 
+                         unsigned int                   len, 
+                         const struct sockaddr_storage& srcAddr, 
+                         const struct timeval&          rxTime)
+{
+    rx_count++;
+    rx_bytes += len;
+    MgenMsgView msgView(alignedBuffer, len);
+    bool valid = msgView.IsValid();
+    if (valid && (config.checksum_force || msgView.FlagIsSet(MgenMsg::CHECKSUM)))
+        valid = msgView.ChecksumIsValid();
+    if (valid && (config.counters || config.analytics))
+    {
+        ProtoAddress addr;
+        addr.SetSockAddr(*((struct sockaddr*)&srcAddr));
+        if (config.counters)
+            flow_counters.Update(addr, msgView.GetDstPort(), msgView.GetFlowId(), 
+                                 msgView.GetSeqNum(), len, rxTime);
+        if (config.analytics)
+            UpdateAnalytic(msgView, addr, rxTime);
+    }
+    if (valid && (MgenMsg::MGEN_DATA != msgView.GetPayloadType()))
+    {
+        if (config.logging)
+            Enqueue(RECORD_LOG, alignedBuffer, len, srcAddr, rxTime);
+    }
+    else if (config.logging || config.analytics)
+    {
+        Enqueue(RECORD_FULL, alignedBuffer, len, srcAddr, rxTime);
+    }
+}  // end MgenRxShard::OnRecv()
+
+// Called with "lock" held
+void MgenRxShard::UpdateAnalytic(const MgenMsgView&    msgView, 
+                                 const ProtoAddress&   srcAddr, 
+                                 const struct timeval& rxTime)
+{
+    ProtoAddress dstAddr;
+    msgView.GetDstAddr(dstAddr);
+    UINT32 flowId = msgView.GetFlowId();
+    MgenAnalytic* analytic = analytic_table.FindFlow(srcAddr, dstAddr, flowId);
+    if (NULL == analytic)
+    {
+        if (NULL == (analytic = new MgenAnalytic()))
+        {
+            PLOG(PL_ERROR, "MgenRxShard::UpdateAnalytic() new MgenAnalytic() error: %s\n", GetErrorString());
+            return;
+        }
+        if (!analytic->Init(UDP, srcAddr, dstAddr, flowId, config.analytic_window,
+                            config.analytic_history, config.reorder) ||
+            !analytic_table.Insert(*analytic))
+        {
+            PLOG(PL_ERROR, "MgenRxShard::UpdateAnalytic() unable to add new flow analytic: %s\n", GetErrorString());
+            delete analytic;
+            return;
+        }
+    }
+    struct timeval txTime;
+    msgView.GetTxTime(txTime);
+    if (analytic->Update(ProtoTime(rxTime), msgView.GetMsgLen(), ProtoTime(txTime), msgView.GetSeqNum()))
+    {
+        // Mark for logging by Drain()
+        for (unsigned int i = 0; i < report_count; i++)
+            if (analytic == report_list[i]) return;
+        if (report_count < REPORT_MAX)
+            report_list[report_count++] = analytic;
+    }
+}  // end MgenRxShard::UpdateAnalytic()
+
+// Called with "lock" held
+void MgenRxShard::Enqueue(RecordType                     type, 
+                          const UINT32*                  alignedBuffer, 
+                          unsigned int                   len,
+                          const struct sockaddr_storage& srcAddr, 
+                          const struct timeval&          rxTime)
+{
+    // Keep records 8-byte aligned so message buffers can be used in place
+    unsigned int recordLen = (sizeof(Record) + len + 7) & ~((unsigned int)7);
+    if ((fill_len + recordLen) > fill_size)
+    {
+        unsigned int newSize = (0 != fill_size) ? (2 * fill_size) : QUEUE_INIT;
+        while (newSize < (fill_len + recordLen)) newSize *= 2;
+        char* newBuffer = (newSize <= QUEUE_MAX) ? (char*)realloc(fill_buffer, newSize) : NULL;
+        if (NULL == newBuffer)
+        {
+            drop_count++;  // main thread isn't keeping up
+            return;
+        }
+        fill_buffer = newBuffer;
+        fill_size = newSize;
+    }
+    Record* record = (Record*)(fill_buffer + fill_len);
+    record->len = (UINT16)len;
+    record->type = (UINT8)type;
+    record->rx_time = rxTime;
+    record->src_addr = srcAddr;
+    memcpy(fill_buffer + fill_len + sizeof(Record), alignedBuffer, len);
+    fill_len += recordLen;
+}  // end MgenRxShard::Enqueue()
+
+// Main thread: swaps out the queued records and reports, then logs and
+// processes them through the owning transport
+void MgenRxShard::Drain()
+{
+    pthread_mutex_lock(&lock);
+    char* buffer = fill_buffer;
+    unsigned int bufferSize = fill_size;
+    unsigned int bufferLen = fill_len;
+    fill_buffer = drain_buffer;
+    fill_size = drain_size;
+    fill_len = 0;
+    drain_buffer = buffer;
+    drain_size = bufferSize;
+    Configure();
+    pthread_mutex_unlock(&lock);
+    
+    unsigned int offset = 0;
+    while (offset < bufferLen)
+    {
+        Record* record = (Record*)(buffer + offset);
+        UINT32* msgBuffer = (UINT32*)(buffer + offset + sizeof(Record));
+        ProtoAddress srcAddr;
+        srcAddr.SetSockAddr(*((struct sockaddr*)&record->src_addr));
+        if (RECORD_LOG == record->type)
+        {
+            MgenMsg theMsg;
+            theMsg.SetSrcAddr(srcAddr);
+            if (theMsg.Unpack(msgBuffer, record->len, mgen.GetChecksumForce(), mgen.GetLogData()))
+                transport.LogEvent(RECV_EVENT, &theMsg, record->rx_time, msgBuffer);
+        }
+        else
+        {
+            // (already counted and analyzed by the shard thread)
+            transport.HandleRecvMessage(msgBuffer, record->len, srcAddr, record->rx_time, false);
+        }
+        offset += (sizeof(Record) + record->len + 7) & ~((unsigned int)7);
+    }
+    
+    // Log shard analytic reports (these are only read under "lock")
+    pthread_mutex_lock(&lock);
+    FILE* logFile = mgen.GetLogFile();
+    MgenController* controller = mgen.GetController();
+    for (unsigned int i = 0; i < report_count; i++)
+    {
+        MgenAnalytic* analytic = report_list[i];
+        const ProtoTime& reportTime = analytic->GetReportTime();
+        if (NULL != controller)
+            controller->OnUpdateReport(reportTime, analytic->GetReport(reportTime));
+        analytic->Log(logFile, reportTime, reportTime, mgen.GetLocalTime());
+    }
+    report_count = 0;
+    pthread_mutex_unlock(&lock);
+}  // end MgenRxShard::Drain()
+
+void MgenRxShard::LogSummary(FILE* logFile, const struct timeval& theTime)
+{
+    Mgen::LogTimestamp(logFile, theTime, mgen.GetLocalTime());
+    Mgen::Log(logFile, "RXSHARD proto>UDP shard>%u cpu>%d rx>%lu bytes>%lu drops>%lu\n",
+              index, cpu, rx_count, rx_bytes, drop_count);
+}  // end MgenRxShard::LogSummary()
+
+void MgenRxShard::LogCounters(FILE* filePtr, const struct timeval& theTime)
+{
+    pthread_mutex_lock(&lock);
+    flow_counters.Log(filePtr, theTime, mgen.GetLocalTime());
+    pthread_mutex_unlock(&lock);
+}  // end MgenRxShard::LogCounters()
+#endif // HAVE_SO_REUSEPORT
 MgenTcpTransport::MgenTcpTransport(Mgen& theMgen,
                                    Protocol theProtocol,
                                    UINT16 thePort,
@@ -1082,6 +2378,7 @@ MgenTcpTransport::MgenTcpTransport(Mgen& theMgen,
     rx_msg(), rx_buffer_index(0),
     rx_fragment_pending(0),rx_msg_index(0),
     rx_checksum(0),
+    rx_ring(NULL), rx_ring_size(0), rx_ring_head(0), rx_ring_tail(0),
     retry_count(theMgen.GetDefaultRetryCount()),
     retry_delay(theMgen.GetDefaultRetryDelay())
 {
@@ -1097,7 +2394,11 @@ MgenTcpTransport::MgenTcpTransport(Mgen& theMgen,
 
 MgenTcpTransport::~MgenTcpTransport()
 {
-
+    if (NULL != rx_ring)
+    {
+        delete[] rx_ring;
+        rx_ring = NULL;
+    }
 }
 
 void MgenTcpTransport::SetEventOptions(const MgenEvent* event)
@@ -1194,6 +2495,13 @@ void MgenTcpTransport::OnEvent(ProtoSocket& theSocket,ProtoSocket::Event theEven
     case ProtoSocket::RECV:
       
       {
+          // Use the ring buffer path if enabled, but don't switch
+          // over in the middle of a partially received message
+          if (((NULL != rx_ring) || ((0 != mgen.GetTcpRxRing()) && (0 == rx_msg_index))) &&
+              RecvRing(theSocket))
+          {
+              break;
+          }
           while (1)
           {
 
@@ -1504,6 +2812,7 @@ void MgenTcpTransport::ResetRxMsgState()
     memset(rx_checksum_buffer,0,4);
     rx_checksum_buffer[0] = '\0';  
     rx_msg_index = rx_checksum = rx_fragment_pending = rx_buffer_index = 0;
+    rx_ring_head = rx_ring_tail = 0;
     rx_msg.SetMgenMsgLen(0);
     rx_msg.SetMsgLen(0);
     rx_msg.SetFlowId(0);
@@ -1740,7 +3049,7 @@ void MgenTcpTransport::OnRecvMsg(unsigned int numBytes, unsigned int bufferIndex
             ProcessRecvMessage(rx_msg, ProtoTime(currentTime));
             if (mgen.ComputeAnalytics())
                 mgen.UpdateRecvAnalytics(currentTime, &rx_msg, TCP);
-            if (mgen.GetLogFile())
+            if (mgen.GetLogging())
                 LogEvent(RECV_EVENT, &rx_msg, currentTime, rx_msg_buffer);
         }
         else
@@ -1759,6 +3068,167 @@ void MgenTcpTransport::OnRecvMsg(unsigned int numBytes, unsigned int bufferIndex
     
 } // end MgenTcpTransport::OnRecvMsg()
 
+/**
+ * Reads as much as the socket has into the free space of rx_ring
+ * (which is at least RX_RING_MIN bytes) and parses any whole messages
+ * in place.  This replaces the per-message (and per TX_BUFFER_SIZE 
+ * chunk) reads of OnRecvMsg() with a few large reads per event.
+ * Returns false only if the ring can't be allocated.
+ */
+bool MgenTcpTransport::RecvRing(ProtoSocket& theSocket)
+{
+    if (NULL == rx_ring)
+    {
+        unsigned int ringSize = RX_RING_MIN;
+        while (ringSize < mgen.GetTcpRxRing()) ringSize <<= 1;
+        if (NULL == (rx_ring = new UINT32[ringSize/4]))
+        {
+            PLOG(PL_ERROR, "MgenTcpTransport::RecvRing() new rx_ring error: %s\n", GetErrorString());
+            return false;
+        }
+        rx_ring_size = ringSize;
+        rx_ring_head = rx_ring_tail = 0;
+    }
+    char* ringBuffer = (char*)rx_ring;
+    while (IsConnected())
+    {
+        // Read into the contiguous free space following rx_ring_tail
+        // (ParseRing() always leaves room since a message is < RX_RING_MIN)
+        unsigned int offset = rx_ring_tail & (rx_ring_size - 1);
+        unsigned int numBytes = rx_ring_size - (rx_ring_tail - rx_ring_head);
+        if (numBytes > (rx_ring_size - offset))
+            numBytes = rx_ring_size - offset;
+        if (!theSocket.Recv(ringBuffer + offset, numBytes)) break;
+        if (0 == numBytes)
+        {
+#ifdef WIN32
+            // If we've gotten a FD_CLOSE event and havn't
+            // read new data, we're done.
+            if (socket.IsClosing())
+            {
+                ShutdownTransport(OFF_EVENT);
+                socket.SetClosing(false);
+            }
+#endif // WIN32
+            break;
+        }
+        rx_ring_tail += numBytes;
+        // Messages completed by the same read share a receive time
+        struct timeval currentTime;
+        ProtoSystemTime(currentTime);
+        if (!ParseRing(currentTime))
+        {
+            // Message framing is lost, so drop the connection
+            ShutdownTransport(DISCONNECT_EVENT);
+            break;
+        }
+    }
+    return true;
+}  // end MgenTcpTransport::RecvRing()
+
+// Returns false if the stream has an invalid msg_len
+bool MgenTcpTransport::ParseRing(const struct timeval& currentTime)
+{
+    const unsigned char* ringBuffer = (const unsigned char*)rx_ring;
+    unsigned int mask = rx_ring_size - 1;
+    while ((rx_ring_tail - rx_ring_head) >= MSG_LEN_SIZE)
+    {
+        // msg_len may straddle the end of the ring
+        unsigned int offset = rx_ring_head & mask;
+        UINT16 msgLen = (ringBuffer[offset] << 8) | ringBuffer[(offset + 1) & mask];
+        if (msgLen < MSG_LEN_SIZE)
+        {
+            PLOG(PL_ERROR, "MgenTcpTransport::ParseRing() error: invalid msg_len %u from %s/%hu\n",
+                 msgLen, socket.GetDestination().GetHostString(), socket.GetDestination().GetPort());
+            return false;
+        }
+        if ((rx_ring_tail - rx_ring_head) < msgLen) break;  // wait for the rest
+        HandleRingMessage(offset, msgLen, currentTime);
+        rx_ring_head += msgLen;
+    }
+    // Restart at the beginning of the ring when it empties so reads
+    // stay large and messages stay contiguous (and aligned) 
+    if (rx_ring_head == rx_ring_tail)
+        rx_ring_head = rx_ring_tail = 0;
+    return true;
+}  // end MgenTcpTransport::ParseRing()
+
+void MgenTcpTransport::HandleRingMessage(unsigned int offset, UINT16 msgLen, const struct timeval& currentTime)
+{
+    const char* ringBuffer = (const char*)rx_ring;
+    unsigned int mask = rx_ring_size - 1;
+    // Bytes of the message before the end of the ring
+    unsigned int firstLen = rx_ring_size - offset;
+    if (firstLen > msgLen) firstLen = msgLen;
+    
+    // As with OnRecvMsg(), only the first TX_BUFFER_SIZE bytes of a 
+    // fragment are unpacked (and logged).  Unpack() wants an aligned
+    // buffer, so copy only if the message wraps or isn't aligned.
+    unsigned int unpackLen = (msgLen < TX_BUFFER_SIZE) ? msgLen : TX_BUFFER_SIZE;
+    UINT32* alignedBuffer;
+    if ((unpackLen <= firstLen) && (0 == (offset & 3)))
+    {
+        alignedBuffer = rx_ring + (offset >> 2);
+    }
+    else
+    {
+        char* msgBuffer = (char*)rx_msg_buffer;
+        if (unpackLen <= firstLen)
+        {
+            memcpy(msgBuffer, ringBuffer + offset, unpackLen);
+        }
+        else
+        {
+            memcpy(msgBuffer, ringBuffer + offset, firstLen);
+            memcpy(msgBuffer + firstLen, ringBuffer, unpackLen - firstLen);
+        }
+        alignedBuffer = rx_msg_buffer;
+    }
+    rx_msg.ClearError();
+    if (rx_msg.Unpack(alignedBuffer, unpackLen, mgen.GetChecksumForce(), mgen.GetLogData()) &&
+        (msgLen > 4) && (mgen.GetChecksumForce() || rx_msg.FlagIsSet(MgenMsg::CHECKSUM)))
+    {
+        // The CRC is computed in place over the (at most two) 
+        // contiguous regions of the message before the checksum
+        UINT32 checksum = 0;
+        unsigned int crcLen = msgLen - 4;
+        if (crcLen <= firstLen)
+        {
+            MgenMsg::ComputeCRC32(checksum, (const UINT8*)ringBuffer + offset, crcLen);
+        }
+        else
+        {
+            MgenMsg::ComputeCRC32(checksum, (const UINT8*)ringBuffer + offset, firstLen);
+            MgenMsg::ComputeCRC32(checksum, (const UINT8*)ringBuffer, crcLen - firstLen);
+        }
+        checksum ^= MgenMsg::CRC32_XOROT;
+        UINT32 recvdChecksum = 0;
+        for (unsigned int i = crcLen; i < msgLen; i++)
+            recvdChecksum = (recvdChecksum << 8) | (UINT8)ringBuffer[(offset + i) & mask];
+        if (checksum != recvdChecksum)
+        {
+            DMSG(0, "MgenTcpTransport::HandleRingMessage() error: checksum failure\n");
+            rx_msg.SetChecksumError();
+            rx_msg.SetFlag(MgenMsg::CHECKSUM_ERROR);
+        }
+    }
+    if (!rx_msg.GetError())
+    {
+        if (!rx_msg.GetDstAddr().IsValid())
+            rx_msg.SetDstAddr(dstAddress);
+        ProcessRecvMessage(rx_msg, ProtoTime(currentTime));
+        if (mgen.ComputeAnalytics())
+            mgen.UpdateRecvAnalytics(currentTime, &rx_msg, TCP);
+        if (mgen.GetLogging())
+            LogEvent(RECV_EVENT, &rx_msg, currentTime, alignedBuffer);
+    }
+    else
+    {
+        if (mgen.GetLogFile())
+            LogEvent(RERR_EVENT, &rx_msg, currentTime);
+    }
+}  // end MgenTcpTransport::HandleRingMessage()
+
 bool MgenTcpTransport::GetNextTxBuffer(unsigned int numBytes)
 {
     tx_buffer_index += numBytes;
@@ -2019,7 +3489,7 @@ void MgenTcpTransport::CopyMsgBuffer(unsigned int numBytes,unsigned int bufferIn
         ((rx_msg.GetMsgLen() == rx_msg_index) 
          && (rx_msg_index <= TX_BUFFER_SIZE)))
     {
-        if (mgen.GetLogFile()) 
+        if (mgen.GetLogging()) 
         {
             if (rx_msg_index <= TX_BUFFER_SIZE) 
               rx_msg.Unpack(rx_msg_buffer, rx_msg_index, mgen.GetChecksumForce(), mgen.GetLogData());
@@ -2088,7 +3558,7 @@ void MgenSinkTransport::HandleMgenMessage(UINT32* alignedBuffer, unsigned int le
 {
     MgenMsg theMsg;
     theMsg.SetSrcAddr(srcAddr);
-    if (NULL != mgen.GetLogFile())
+    if (mgen.GetLogging())
     {
         struct timeval currentTime;
         ProtoSystemTime(currentTime);
@@ -2121,7 +3591,7 @@ void MgenSinkTransport::HandleMgenMessage(UINT32* alignedBuffer, unsigned int le
             ProcessRecvMessage(theMsg, ProtoTime(currentTime));
             if (mgen.ComputeAnalytics())
                 mgen.UpdateRecvAnalytics(currentTime, &theMsg, SINK);
-            if (mgen.GetLogFile())
+            if (mgen.GetLogging())
                 LogEvent(RECV_EVENT, &theMsg, currentTime, alignedBuffer);       
         } 
     }
@@ -2161,15 +3631,15 @@ void MgenTransport::ProcessRecvMessage(MgenMsg& msg, const ProtoTime& theTime)
             bufferLen -= cmdLen;
             bufferPtr += cmdLen / sizeof(UINT32);
         }
-        else if ((NULL != mgen.GetController()) &&
-                 ((UINT8)MgenDataItem::GetItemType(bufferPtr) > 0x0f))
+        else if ((UINT8)MgenDataItem::GetItemType(bufferPtr) > 0x0f)
         {
-            // Let the MgenController see the received report
+            // Let the MgenController and any matching local flow see the received report
             MgenAnalytic::Report report;
             if (report.InitFromBuffer(bufferPtr, bufferLen))
             {
-                mgen.GetController()->OnRecvReport(theTime, report, msg.GetSrcAddr(), ProtoTime(msg.GetTxTime()));
+                mgen.ProcessRecvReport(theTime, report, msg.GetSrcAddr(), ProtoTime(msg.GetTxTime()));
                 UINT8 reportLen = report.GetLength();
+                if (0 == reportLen) break; // truncated report
                 bufferLen -= reportLen;
                 bufferPtr += (reportLen/sizeof(UINT32));
             }